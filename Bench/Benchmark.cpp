@@ -0,0 +1,282 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Measures every stage of turning a string into a number separately over a fixed corpus
+Usage: MathExpressionParser_bench [case name filter]
+Prints time and allocations per operation, where an operation is processing a single expression
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/MathExpressions.hpp"
+#include "MathExpressionParser/CompiledExpression.hpp"
+
+// Counts every allocation the process makes
+static std::atomic<size_t> AllocationCount(0);
+
+/* Replacements below come as a matched set: memory of every 'new' is obtained with malloc and released with free.
+GCC still flags free in a replaced 'delete' (-Wmismatched-new-delete) once 'new' and 'delete' of some object
+are inlined next to each other, as it assumes the global 'new' is the standard one. The pair matches, so the warning
+is silenced for these definitions only
+*/
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size)
+{
+    AllocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+// Called instead of the unsized one when the size of the object is known (C++14 onwards)
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+// Each measurement is repeated until it accumulates at least this much time
+static const std::chrono::milliseconds MinimumDuration(250);
+
+struct BenchmarkCase
+{
+    std::string Name;
+    std::vector<std::string> Expressions;
+    MathExpressions::Environment Env;
+};
+
+struct Measurement
+{
+    double NsPerOp, OpsPerSecond, AllocationsPerOp;
+};
+
+/// <summary>
+/// Alternates between untimed 'prepare' and timed 'run' until enough time is measured
+/// </summary>
+/// <param name="prepare">- sets up state 'run' consumes</param>
+/// <param name="run">- performs the operations and returns how many it has performed</param>
+static Measurement Measure(const std::function<void()>& prepare, const std::function<size_t()>& run)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::duration elapsed(0);
+    size_t ops = 0, allocations = 0;
+
+    while (elapsed < MinimumDuration)
+    {
+        prepare();
+
+        size_t allocations_before = AllocationCount.load(std::memory_order_relaxed);
+        Clock::time_point start = Clock::now();
+
+        ops += run();
+
+        elapsed += Clock::now() - start;
+        allocations += AllocationCount.load(std::memory_order_relaxed) - allocations_before;
+    }
+
+    double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+    return { ns / ops, ops / (ns / 1e9), static_cast<double>(allocations) / ops };
+}
+
+// Variable names may only consist of letters, and shouldn't start with anything a constant or a function does
+static std::string VariableName(size_t index)
+{
+    std::string name = "v";
+    do
+    {
+        name.push_back(static_cast<char>('a' + index % 26));
+        index /= 26;
+    } while (index);
+
+    return name;
+}
+
+static std::vector<BenchmarkCase> BuildCorpus()
+{
+    std::vector<BenchmarkCase> corpus;
+
+    // Values are picked to keep every function in it's domain
+    MathExpressions::Environment base_env = { { "x", 0.5 }, { "y", 0.25 }, { "z", 2 } };
+
+    corpus.push_back({ "short", {
+        "1+2*3", "x*y-z/2", "(x+y)*z", "-x^2+1", "|x-y|/2", "sqrt(z)*pi", "e^x"
+    }, base_env });
+
+    std::string flat_sum = "1";
+    for (size_t i = 0; i < 512; i++) flat_sum += (i % 2) ? "+x" : "+" + std::to_string(i);
+    corpus.push_back({ "flat_sum", { flat_sum }, base_env });
+
+    std::string nested_brackets = std::string(128, '(') + "x";
+    for (size_t i = 0; i < 128; i++) nested_brackets += "+1)";
+    std::string nested_functions = "x";
+    for (size_t i = 0; i < 64; i++) nested_functions = "sin(" + nested_functions + ")";
+    corpus.push_back({ "deep_nesting", { nested_brackets, nested_functions }, base_env });
+
+    std::string trig;
+    for (size_t i = 0; i < 4; i++)
+    {
+        if (i) trig += "+";
+        trig += "sin(x)*cos(y)+tan(x/2)-asin(y/2)+acos(x/2)*atan(y)+sinh(x)-cosh(y)+tanh(x*y)+log(z, 2)";
+    }
+    corpus.push_back({ "trig", { trig }, base_env });
+
+    BenchmarkCase many_vars = { "many_variables", { "" }, {} };
+    for (size_t i = 0; i < 128; i += 2)
+    {
+        if (i) many_vars.Expressions[0] += "+";
+        many_vars.Expressions[0] += VariableName(i) + "*" + VariableName(i + 1);
+        many_vars.Env[VariableName(i)] = static_cast<long double>(i);
+        many_vars.Env[VariableName(i + 1)] = 0.5;
+    }
+    corpus.push_back(many_vars);
+
+    return corpus;
+}
+
+static void Report(const std::string& case_name, const char* phase, const Measurement& measurement)
+{
+    std::printf(
+        "%-16s %-18s %14.1f ns/op %16.0f ops/s %10.2f allocs/op\n",
+        case_name.c_str(), phase,
+        measurement.NsPerOp, measurement.OpsPerSecond, measurement.AllocationsPerOp
+    );
+}
+
+static void RunCase(const BenchmarkCase& bench_case)
+{
+    const std::vector<std::string>& exprs = bench_case.Expressions;
+    const std::vector<Parser::TokenFactory>& factories = MathExpressions::GetTokenFactories();
+    Parser::Engine parser;
+
+    // Token arrays are consumed by backpatching and parsing, so each round gets fresh ones
+    std::vector<std::vector<Parser::TokenPtr>> tokens(exprs.size());
+    std::vector<Tree<Parser::TokenPtr>> trees(exprs.size());
+
+    auto tokenize_all = [&]() {
+        for (size_t i = 0; i < exprs.size(); i++)
+        {
+            tokens[i].clear();
+            parser.Tokenize(factories, exprs[i], tokens[i]);
+        }
+    };
+    auto backpatch_all = [&]() {
+        for (std::vector<Parser::TokenPtr>& expr_tokens : tokens) parser.Backpatch(expr_tokens);
+    };
+    auto parse_all = [&]() {
+        for (size_t i = 0; i < exprs.size(); i++)
+        {
+            trees[i] = Tree<Parser::TokenPtr>();
+            parser.Parse(tokens[i], trees[i]);
+        }
+    };
+
+    Report(bench_case.Name, "Tokenize", Measure(
+        []() {},
+        [&]() {
+            for (const std::string& expr : exprs)
+            {
+                std::vector<Parser::TokenPtr> expr_tokens;
+                parser.Tokenize(factories, expr, expr_tokens);
+            }
+            return exprs.size();
+        }
+    ));
+
+    Report(bench_case.Name, "Backpatch", Measure(tokenize_all, [&]() { backpatch_all(); return exprs.size(); }));
+
+    Report(bench_case.Name, "Parse", Measure(
+        [&]() { tokenize_all(); backpatch_all(); },
+        [&]() { parse_all(); return exprs.size(); }
+    ));
+
+    tokenize_all();
+    backpatch_all();
+    parse_all();
+    volatile long double sink = 0;
+
+    Report(bench_case.Name, "Evaluate", Measure(
+        []() {},
+        [&]() {
+            for (const Tree<Parser::TokenPtr>& tree : trees)
+            {
+                auto token = dynamic_cast<const MathExpressions::Token*>(tree.Root->Value.get());
+                sink = token->Evaluate(tree.Root, bench_case.Env);
+            }
+            return exprs.size();
+        }
+    ));
+
+    Report(bench_case.Name, "Compile", Measure(
+        []() {},
+        [&]() {
+            for (const std::string& expr : exprs) MathExpressions::Compile(expr);
+            return exprs.size();
+        }
+    ));
+
+    std::vector<MathExpressions::CompiledExpressionPtr> compiled;
+    for (const std::string& expr : exprs) compiled.push_back(MathExpressions::Compile(expr));
+
+    Report(bench_case.Name, "EvaluateCompiled", Measure(
+        []() {},
+        [&]() {
+            for (const MathExpressions::CompiledExpressionPtr& expr : compiled) sink = expr->Evaluate(bench_case.Env);
+            return compiled.size();
+        }
+    ));
+}
+
+int main(int argc, char** argv)
+{
+    const std::string filter = argc > 1 ? argv[1] : "";
+
+    for (const BenchmarkCase& bench_case : BuildCorpus())
+    {
+        if (bench_case.Name.find(filter) == std::string::npos) continue;
+
+        RunCase(bench_case);
+    }
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Allocation.hpp"
+
+// Null while default resource is the initial one
+static std::atomic<MathExpressions::Allocation::MemoryResource*> DefaultResource(nullptr);
+// Overrides default resource for the current thread if set
+static thread_local MathExpressions::Allocation::MemoryResource* ThreadResource = nullptr;
+static thread_local MathExpressions::Allocation::Phase CurrentPhase = MathExpressions::Allocation::Phase::Other;
+
+void* MathExpressions::Allocation::MemoryResource::Allocate(size_t bytes, size_t alignment)
+{
+    return DoAllocate(bytes, alignment);
+}
+
+void MathExpressions::Allocation::MemoryResource::Deallocate(void* ptr, size_t bytes, size_t alignment)
+{
+    DoDeallocate(ptr, bytes, alignment);
+}
+
+void* MathExpressions::Allocation::NewDeleteResource::DoAllocate(size_t bytes, size_t)
+{
+    return ::operator new(bytes);
+}
+
+void MathExpressions::Allocation::NewDeleteResource::DoDeallocate(void* ptr, size_t, size_t)
+{
+    ::operator delete(ptr);
+}
+
+// Tokens held by static objects may be released during exit, so the initial resource is never destroyed
+static MathExpressions::Allocation::MemoryResource* GetInitialResource()
+{
+    static MathExpressions::Allocation::MemoryResource* const resource = new MathExpressions::Allocation::NewDeleteResource();
+    return resource;
+}
+
+MathExpressions::Allocation::MemoryResource* MathExpressions::Allocation::GetDefaultResource()
+{
+    MemoryResource* resource = DefaultResource.load(std::memory_order_acquire);
+    return resource ? resource : GetInitialResource();
+}
+
+MathExpressions::Allocation::MemoryResource* MathExpressions::Allocation::SetDefaultResource(MemoryResource* resource)
+{
+    MemoryResource* previous = DefaultResource.exchange(resource, std::memory_order_acq_rel);
+    return previous ? previous : GetInitialResource();
+}
+
+MathExpressions::Allocation::MemoryResource* MathExpressions::Allocation::GetCurrentResource()
+{
+    return ThreadResource ? ThreadResource : GetDefaultResource();
+}
+
+MathExpressions::Allocation::ResourceScope::ResourceScope(MemoryResource& resource) : Previous(ThreadResource)
+{
+    ThreadResource = &resource;
+}
+
+MathExpressions::Allocation::ResourceScope::~ResourceScope()
+{
+    ThreadResource = Previous;
+}
+
+MathExpressions::Allocation::Phase MathExpressions::Allocation::GetCurrentPhase()
+{
+    return CurrentPhase;
+}
+
+MathExpressions::Allocation::PhaseScope::PhaseScope(Phase phase) : Previous(CurrentPhase)
+{
+    CurrentPhase = phase;
+}
+
+MathExpressions::Allocation::PhaseScope::~PhaseScope()
+{
+    CurrentPhase = Previous;
+}
+
+MathExpressions::Allocation::CountingResource::CountingResource(MemoryResource* upstream)
+    : Upstream(upstream ? upstream : GetDefaultResource())
+{
+    Reset();
+}
+
+void* MathExpressions::Allocation::CountingResource::DoAllocate(size_t bytes, size_t alignment)
+{
+    void* ptr = Upstream->Allocate(bytes, alignment);
+
+    std::atomic<size_t>* counters = Counters[static_cast<size_t>(CurrentPhase)];
+    counters[0].fetch_add(1, std::memory_order_relaxed);
+    counters[2].fetch_add(bytes, std::memory_order_relaxed);
+
+    return ptr;
+}
+
+void MathExpressions::Allocation::CountingResource::DoDeallocate(void* ptr, size_t bytes, size_t alignment)
+{
+    std::atomic<size_t>* counters = Counters[static_cast<size_t>(CurrentPhase)];
+    counters[1].fetch_add(1, std::memory_order_relaxed);
+    counters[3].fetch_add(bytes, std::memory_order_relaxed);
+
+    Upstream->Deallocate(ptr, bytes, alignment);
+}
+
+MathExpressions::Allocation::AllocationStats MathExpressions::Allocation::CountingResource::GetStats(Phase phase) const
+{
+    const std::atomic<size_t>* counters = Counters[static_cast<size_t>(phase)];
+
+    return {
+        counters[0].load(std::memory_order_relaxed), counters[1].load(std::memory_order_relaxed),
+        counters[2].load(std::memory_order_relaxed), counters[3].load(std::memory_order_relaxed)
+    };
+}
+
+MathExpressions::Allocation::AllocationStats MathExpressions::Allocation::CountingResource::GetTotalStats() const
+{
+    AllocationStats total = { 0, 0, 0, 0 };
+    for (size_t phase = 0; phase < static_cast<size_t>(Phase::Count); phase++)
+    {
+        AllocationStats stats = GetStats(static_cast<Phase>(phase));
+        total.Allocations += stats.Allocations;
+        total.Deallocations += stats.Deallocations;
+        total.BytesAllocated += stats.BytesAllocated;
+        total.BytesDeallocated += stats.BytesDeallocated;
+    }
+
+    return total;
+}
+
+void MathExpressions::Allocation::CountingResource::Reset()
+{
+    for (std::atomic<size_t>(&counters)[4] : Counters)
+        for (std::atomic<size_t>& counter : counters) counter.store(0, std::memory_order_relaxed);
+}
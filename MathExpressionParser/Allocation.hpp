@@ -0,0 +1,215 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace MathExpressions
+{
+	/* Pluggable allocation, shaped after C++17's std::pmr (which isn't available in C++11).
+	Tokens, parameter arrays of evaluation and compilation, and string temporaries of number literals
+	the library creates are allocated from the resource current to the calling thread.
+	Not everything is covered, and what isn't never shows up in 'CountingResource' either.
+	Tree nodes are created by the parser engine. Storage of compiled programs (instructions, constants,
+	symbols, calls) and the copy of the source a compiled expression keeps come from the global heap,
+	same as the buffer each thread looks variables up by name with, which lives as long as the thread
+	and would outlive any resource. Compile phase therefore only reports allocations of tokens and
+	parameter arrays, not the size of the program being built
+	*/
+	namespace Allocation
+	{
+		// Source of memory, same contract as std::pmr::memory_resource
+		class MemoryResource
+		{
+		protected:
+			virtual void* DoAllocate(size_t bytes, size_t alignment) = 0;
+			virtual void DoDeallocate(void* ptr, size_t bytes, size_t alignment) = 0;
+		public:
+			virtual ~MemoryResource() = default;
+
+			void* Allocate(size_t bytes, size_t alignment);
+			void Deallocate(void* ptr, size_t bytes, size_t alignment);
+		};
+
+		// Resource backed by global operator new/delete. Alignments past fundamental ones are not supported
+		class NewDeleteResource : public MemoryResource
+		{
+		protected:
+			void* DoAllocate(size_t bytes, size_t alignment) override;
+			void DoDeallocate(void* ptr, size_t bytes, size_t alignment) override;
+		};
+
+		/// <summary>
+		/// Returns resource every thread allocates from unless overriden by 'ResourceScope'.
+		/// Initially, it's a 'NewDeleteResource'
+		/// </summary>
+		MemoryResource* GetDefaultResource();
+
+		/// <summary>
+		/// Replaces default resource and returns the previous one. Null restores the initial resource.
+		/// The resource has to outlive everything allocated from it
+		/// </summary>
+		MemoryResource* SetDefaultResource(MemoryResource* resource);
+
+		/// <summary>
+		/// Returns resource the current thread allocates from
+		/// </summary>
+		MemoryResource* GetCurrentResource();
+
+		/* Makes the current thread allocate from 'resource' for as long as it lives.
+		Anything allocated meanwhile (for instance, tokens of a compiled expression) keeps
+		returning memory to that resource, so it has to outlive those objects as well
+		*/
+		class ResourceScope
+		{
+			MemoryResource* Previous;
+		public:
+			ResourceScope(MemoryResource& resource);
+			~ResourceScope();
+
+			ResourceScope(const ResourceScope&) = delete;
+			ResourceScope& operator=(const ResourceScope&) = delete;
+		};
+
+		// Standard allocator that forwards to a resource. Default constructed ones bind to the current resource
+		template<typename T>
+		class ResourceAllocator
+		{
+			template<typename U> friend class ResourceAllocator;
+
+			MemoryResource* Resource;
+		public:
+			typedef T value_type;
+
+			ResourceAllocator() : Resource(GetCurrentResource()) {}
+			ResourceAllocator(MemoryResource* resource) : Resource(resource) {}
+			template<typename U>
+			ResourceAllocator(const ResourceAllocator<U>& other) : Resource(other.Resource) {}
+
+			T* allocate(size_t count)
+			{
+				if (count > static_cast<size_t>(-1) / sizeof(T)) throw std::bad_alloc();
+
+				return static_cast<T*>(Resource->Allocate(count * sizeof(T), alignof(T)));
+			}
+
+			void deallocate(T* ptr, size_t count)
+			{
+				Resource->Deallocate(ptr, count * sizeof(T), alignof(T));
+			}
+
+			MemoryResource* GetResource() const { return Resource; }
+
+			template<typename U>
+			bool operator==(const ResourceAllocator<U>& other) const { return Resource == other.Resource; }
+			template<typename U>
+			bool operator!=(const ResourceAllocator<U>& other) const { return Resource != other.Resource; }
+		};
+
+		template<typename T>
+		using Vector = std::vector<T, ResourceAllocator<T>>;
+		using String = std::basic_string<char, std::char_traits<char>, ResourceAllocator<char>>;
+
+		/// <summary>
+		/// 'std::make_shared' that allocates from the current resource
+		/// </summary>
+		template<typename T, typename... Args>
+		std::shared_ptr<T> MakeShared(Args&&... args)
+		{
+			return std::allocate_shared<T>(ResourceAllocator<T>(), std::forward<Args>(args)...);
+		}
+
+		// Stages of processing an expression allocations are attributed to
+		enum class Phase : unsigned char
+		{
+			// Anything outside of the phases below
+			Other,
+			Tokenize,
+			Backpatch,
+			Parse,
+			Compile,
+			Evaluate,
+			Count
+		};
+
+		/// <summary>
+		/// Returns phase the current thread is in
+		/// </summary>
+		Phase GetCurrentPhase();
+
+		// Marks the current thread as being in a phase for as long as it lives
+		class PhaseScope
+		{
+			Phase Previous;
+		public:
+			PhaseScope(Phase phase);
+			~PhaseScope();
+
+			PhaseScope(const PhaseScope&) = delete;
+			PhaseScope& operator=(const PhaseScope&) = delete;
+		};
+
+		struct AllocationStats
+		{
+			size_t Allocations, Deallocations;
+			size_t BytesAllocated, BytesDeallocated;
+		};
+
+		/* Forwards to another resource, counting allocations and bytes per phase.
+		Only sees allocations that go through resources (see the top of this namespace).
+		Can be shared between threads
+		*/
+		class CountingResource : public MemoryResource
+		{
+			// Counters of each phase: allocations, deallocations, bytes allocated, bytes deallocated
+			std::atomic<size_t> Counters[static_cast<size_t>(Phase::Count)][4];
+			MemoryResource* Upstream;
+		protected:
+			void* DoAllocate(size_t bytes, size_t alignment) override;
+			void DoDeallocate(void* ptr, size_t bytes, size_t alignment) override;
+		public:
+			/// <param name="upstream">- resource memory comes from, default resource if null</param>
+			CountingResource(MemoryResource* upstream = nullptr);
+
+			/// <summary>
+			/// Returns totals of a single phase
+			/// </summary>
+			AllocationStats GetStats(Phase phase) const;
+
+			/// <summary>
+			/// Returns totals across all phases
+			/// </summary>
+			AllocationStats GetTotalStats() const;
+
+			void Reset();
+		};
+	}
+}
@@ -0,0 +1,220 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "AutomaticDifferentiation.hpp"
+
+/* Computes partial derivatives of an instruction by it's operands, given it's value and values of operands.
+Leaves are never passed here, as they have no operands
+*/
+static void GetPartials(
+    const MathExpressions::Instruction& instr,
+    const long double* values,
+    long double value,
+    long double& out_by_lhs,
+    long double& out_by_rhs
+) {
+    using MathExpressions::OpCode;
+
+    const long double a = values[instr.Lhs];
+    const long double b = (MathExpressions::GetArity(instr.Op) == 2) ? values[instr.Rhs] : 0;
+    out_by_rhs = 0;
+
+    switch (instr.Op)
+    {
+    case OpCode::Add: out_by_lhs = 1; out_by_rhs = 1; break;
+    case OpCode::Sub: out_by_lhs = 1; out_by_rhs = -1; break;
+    case OpCode::Mul: out_by_lhs = b; out_by_rhs = a; break;
+    case OpCode::Div: out_by_lhs = 1 / b; out_by_rhs = -a / (b * b); break;
+    case OpCode::Pow:
+        out_by_lhs = b * powl(a, b - 1);
+        // 'a^b' is only differentiable by 'b' for positive 'a', and is constant at 'a = 0' for positive 'b'
+        out_by_rhs = (a > 0) ? value * logl(a) : ((a == 0 && b > 0) ? 0 : NAN);
+        break;
+    case OpCode::Log:
+        // log(a, b) = ln(a) / ln(b)
+        out_by_lhs = 1 / (a * logl(b));
+        out_by_rhs = -logl(a) / (b * logl(b) * logl(b));
+        break;
+    case OpCode::Negate: out_by_lhs = -1; break;
+    case OpCode::Abs: out_by_lhs = (a == 0) ? 0 : ((a > 0) ? 1 : -1); break;
+    case OpCode::LogE: out_by_lhs = 1 / a; break;
+    case OpCode::Log2: out_by_lhs = 1 / (a * logl(2.0L)); break;
+    case OpCode::Log10: out_by_lhs = 1 / (a * logl(10.0L)); break;
+    case OpCode::Exp: out_by_lhs = value; break;
+    case OpCode::Sqrt: out_by_lhs = 1 / (2 * value); break;
+    case OpCode::Sign: out_by_lhs = 0; break;
+    case OpCode::Sin: out_by_lhs = cosl(a); break;
+    case OpCode::Cos: out_by_lhs = -sinl(a); break;
+    case OpCode::Tan: out_by_lhs = 1 + value * value; break;
+    case OpCode::Cot: out_by_lhs = -(1 + value * value); break;
+    case OpCode::Asin: out_by_lhs = 1 / sqrtl(1 - a * a); break;
+    case OpCode::Acos: out_by_lhs = -1 / sqrtl(1 - a * a); break;
+    case OpCode::Atan: out_by_lhs = 1 / (1 + a * a); break;
+    case OpCode::Sinh: out_by_lhs = coshl(a); break;
+    case OpCode::Cosh: out_by_lhs = sinhl(a); break;
+    case OpCode::Tanh: out_by_lhs = 1 - value * value; break;
+    case OpCode::Asinh: out_by_lhs = 1 / sqrtl(a * a + 1); break;
+    case OpCode::Acosh: out_by_lhs = 1 / sqrtl(a * a - 1); break;
+    case OpCode::Atanh: out_by_lhs = 1 / (1 - a * a); break;
+    default: out_by_lhs = 0;
+    }
+}
+
+// Product of a partial derivative and a derivative, where zero on either side wins over infinity or NaN on the other
+static inline long double Chain(long double partial, long double derivative)
+{
+    return (partial == 0 || derivative == 0) ? 0 : partial * derivative;
+}
+
+static void RejectCalls(const MathExpressions::Program& program)
+{
+    if (!program.GetCalls().empty()) throw std::invalid_argument("Native functions can't be differentiated");
+}
+
+MathExpressions::EvaluationResult MathExpressions::TryEvaluateDirectional(
+    const MathExpressions::Program& program,
+    const long double* symbol_values,
+    const long double* symbol_tangents,
+    long double& out_derivative
+) {
+    RejectCalls(program);
+
+    const std::vector<Instruction>& instructions = program.GetInstructions();
+    std::vector<long double> values(instructions.size()), tangents(instructions.size());
+
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        const Instruction& instr = instructions[i];
+
+        EvaluationStatus status = program.Execute(i, values.data(), symbol_values);
+        if (status != EvaluationStatus::Success) return { 0, status, i };
+
+        switch (instr.Op)
+        {
+        case OpCode::Constant: tangents[i] = 0; break;
+        case OpCode::Variable: tangents[i] = symbol_tangents[instr.Lhs]; break;
+        default:
+        {
+            long double by_lhs, by_rhs;
+            GetPartials(instr, values.data(), values[i], by_lhs, by_rhs);
+
+            tangents[i] = Chain(by_lhs, tangents[instr.Lhs]);
+            if (GetArity(instr.Op) == 2) tangents[i] += Chain(by_rhs, tangents[instr.Rhs]);
+        }
+        }
+    }
+
+    out_derivative = tangents.back();
+    return { values.back(), EvaluationStatus::Success, instructions.size() - 1 };
+}
+
+long double MathExpressions::EvaluateDirectional(
+    const MathExpressions::Program& program,
+    const MathExpressions::Environment& env,
+    const MathExpressions::Environment& direction,
+    long double& out_derivative
+) {
+    if (program.GetInstructions().empty()) throw std::runtime_error("Program has no instructions");
+
+    std::vector<long double> symbol_values;
+    program.ResolveSymbols(env, symbol_values);
+
+    const std::vector<std::string>& symbols = program.GetSymbols();
+    std::vector<long double> symbol_tangents(symbols.size(), 0);
+    for (size_t i = 0; i < symbols.size(); i++)
+    {
+        Environment::const_iterator tangent_it = direction.find(symbols[i]);
+        if (tangent_it != direction.cend()) symbol_tangents[i] = tangent_it->second;
+    }
+
+    EvaluationResult result = TryEvaluateDirectional(program, symbol_values.data(), symbol_tangents.data(), out_derivative);
+    program.ThrowError(result);
+
+    return result.Value;
+}
+
+MathExpressions::EvaluationResult MathExpressions::TryEvaluateGradient(
+    const MathExpressions::Program& program,
+    const long double* symbol_values,
+    long double* out_gradient
+) {
+    RejectCalls(program);
+
+    const std::vector<Instruction>& instructions = program.GetInstructions();
+
+    // Forward pass records value of every instruction. The program itself serves as the rest of the tape
+    std::vector<long double> values(instructions.size());
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        EvaluationStatus status = program.Execute(i, values.data(), symbol_values);
+        if (status != EvaluationStatus::Success) return { 0, status, i };
+    }
+
+    // Backward pass accumulates derivative of the result by each instruction, users always preceding operands
+    std::vector<long double> adjoints(instructions.size(), 0);
+    adjoints.back() = 1;
+    std::fill(out_gradient, out_gradient + program.GetSymbols().size(), 0.0L);
+
+    for (size_t i = instructions.size(); i-- > 0;)
+    {
+        const Instruction& instr = instructions[i];
+        if (adjoints[i] == 0) continue;
+
+        switch (instr.Op)
+        {
+        case OpCode::Constant: break;
+        case OpCode::Variable: out_gradient[instr.Lhs] += adjoints[i]; break;
+        default:
+        {
+            long double by_lhs, by_rhs;
+            GetPartials(instr, values.data(), values[i], by_lhs, by_rhs);
+
+            adjoints[instr.Lhs] += Chain(by_lhs, adjoints[i]);
+            if (GetArity(instr.Op) == 2) adjoints[instr.Rhs] += Chain(by_rhs, adjoints[i]);
+        }
+        }
+    }
+
+    return { values.back(), EvaluationStatus::Success, instructions.size() - 1 };
+}
+
+long double MathExpressions::EvaluateGradient(
+    const MathExpressions::Program& program,
+    const MathExpressions::Environment& env,
+    std::vector<long double>& out_gradient
+) {
+    if (program.GetInstructions().empty()) throw std::runtime_error("Program has no instructions");
+
+    std::vector<long double> symbol_values;
+    program.ResolveSymbols(env, symbol_values);
+
+    out_gradient.assign(program.GetSymbols().size(), 0);
+    EvaluationResult result = TryEvaluateGradient(program, symbol_values.data(), out_gradient.data());
+    program.ThrowError(result);
+
+    return result.Value;
+}
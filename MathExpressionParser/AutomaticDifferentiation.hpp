@@ -0,0 +1,90 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vector>
+#include "CompiledExpression.hpp"
+
+/* Derivatives of compiled programs, computed alongside their values.
+Both modes perform the same checks as 'Program::TryEvaluate' and fail on the same instructions.
+Where a derivative doesn't exist (e.g. 'sqrt' at 0, or 'x^y' by 'y' for negative 'x') it comes out as infinity or NaN,
+unless it's multiplied by zero: both modes skip a term when either the partial derivative or the derivative it's chained with
+is zero, so e.g. 'sqrt(y*0)' has zero derivative by 'y'. Modes can still differ where a derivative is only zero because terms
+cancel out: 'sqrt(y-y)' by 'y' is 0 in forward mode, while reverse mode, which never sees derivatives of operands, gives NaN.
+Derivatives of native functions are unknown, so programs that call them are rejected with std::invalid_argument
+*/
+namespace MathExpressions
+{
+	/// <summary>
+	/// Forward mode: carries a derivative next to every value (i.e. evaluates over dual numbers),
+	/// yielding derivative of the result along a direction in a single pass
+	/// </summary>
+	/// <param name="program">- program to differentiate</param>
+	/// <param name="symbol_values">- values of the symbols, ordered as in the symbol table</param>
+	/// <param name="symbol_tangents">- direction, i.e. derivative of each symbol, ordered as in the symbol table.
+	/// For a partial derivative, set one of them to 1 and the rest to 0</param>
+	/// <param name="out_derivative">- derivative of the result along the direction</param>
+	EvaluationResult TryEvaluateDirectional(
+		const Program& program,
+		const long double* symbol_values,
+		const long double* symbol_tangents,
+		long double& out_derivative
+	);
+
+	/// <summary>
+	/// Resolves symbols and evaluates program with it's derivative along a direction. Throws on errors.
+	/// Symbols missing from the direction are considered constant
+	/// </summary>
+	long double EvaluateDirectional(
+		const Program& program,
+		const Environment& env,
+		const Environment& direction,
+		long double& out_derivative
+	);
+
+	/// <summary>
+	/// Reverse mode: evaluates the program, keeping every intermediate value on a tape,
+	/// then walks it backwards, yielding derivatives of the result by every symbol in two passes
+	/// </summary>
+	/// <param name="program">- program to differentiate</param>
+	/// <param name="symbol_values">- values of the symbols, ordered as in the symbol table</param>
+	/// <param name="out_gradient">- receives derivative by each symbol, ordered as in the symbol table.
+	/// Left untouched if evaluation fails</param>
+	EvaluationResult TryEvaluateGradient(
+		const Program& program,
+		const long double* symbol_values,
+		long double* out_gradient
+	);
+
+	/// <summary>
+	/// Resolves symbols and evaluates program with it's gradient. Throws on errors
+	/// </summary>
+	/// <param name="out_gradient">- derivative by each symbol, ordered as in the symbol table</param>
+	long double EvaluateGradient(
+		const Program& program,
+		const Environment& env,
+		std::vector<long double>& out_gradient
+	);
+}
@@ -0,0 +1,407 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "Exceptions.hpp"
+#include "BatchEvaluation.hpp"
+
+// Rows are evaluated in chunks, one instruction at a time, so every loop below runs over contiguous arrays.
+// Chunk is shrunk for large programs to keep intermediate values around this many elements
+static const size_t BatchScratchElements = 1 << 16;
+static const size_t BatchMaxChunk = 256;
+static const size_t BatchMinChunk = 8;
+
+MathExpressions::BatchOptions::BatchOptions(
+    FaultPolicy policy,
+    long double sentinel
+) : Policy(policy), Sentinel(sentinel) {}
+
+/* Records an error for the row if 'failed' is set and row hasn't faulted yet.
+Written arithmetically rather than with branches, so loops calling it stay vectorizable
+*/
+static inline void FlagFault(unsigned char& fault, bool failed, MathExpressions::EvaluationStatus status)
+{
+    fault += static_cast<unsigned char>((fault == 0) & failed) * static_cast<unsigned char>(status);
+}
+
+// Applies function to every row of the chunk
+template<typename F>
+static void ApplyUnary(long double* res, const long double* arg, size_t rows, F func)
+{
+    for (size_t r = 0; r < rows; r++)
+        res[r] = func(arg[r]);
+}
+
+template<typename F>
+static void ApplyBinary(long double* res, const long double* lhs, const long double* rhs, size_t rows, F func)
+{
+    for (size_t r = 0; r < rows; r++)
+        res[r] = func(lhs[r], rhs[r]);
+}
+
+// Computes domain mask of the chunk: flags every row where 'failed' holds for the argument
+template<typename F>
+static void CheckUnary(unsigned char* faults, const long double* arg, size_t rows, MathExpressions::EvaluationStatus status, F failed)
+{
+    for (size_t r = 0; r < rows; r++)
+        FlagFault(faults[r], failed(arg[r]), status);
+}
+
+template<typename F>
+static void CheckBinary(
+    unsigned char* faults, const long double* lhs, const long double* rhs, size_t rows,
+    MathExpressions::EvaluationStatus status, F failed
+) {
+    for (size_t r = 0; r < rows; r++)
+        FlagFault(faults[r], failed(lhs[r], rhs[r]), status);
+}
+
+/* Calls batch implementation of a native function with columns of it's arguments,
+or the scalar one row after row if there's no batch implementation
+*/
+static void ApplyCall(
+    const MathExpressions::NativeCall& call, const long double* values, size_t chunk, size_t rows, long double* res
+) {
+    const size_t arity = call.Arguments.size();
+
+    const long double* arguments[MathExpressions::NativeFunction::MaxArity];
+    for (size_t k = 0; k < arity; k++) arguments[k] = &values[call.Arguments[k] * chunk];
+
+    if (call.Function->Batch) return call.Function->Batch(arguments, rows, res);
+
+    long double row_arguments[MathExpressions::NativeFunction::MaxArity];
+    for (size_t r = 0; r < rows; r++)
+    {
+        for (size_t k = 0; k < arity; k++) row_arguments[k] = arguments[k][r];
+        res[r] = call.Function->Scalar(row_arguments);
+    }
+}
+
+/* Evaluates every row, chunk after chunk. Symbols are loaded through 'load(symbol, start, rows, out_values, faults)',
+which may also flag rows that lack a value, and results of each chunk are handed to 'store(start, rows, values, faults)',
+which decides what faulted rows turn into
+*/
+template<typename Load, typename Store>
+static void EvaluateChunks(const MathExpressions::Program& program, size_t row_count, Load load, Store store)
+{
+    using MathExpressions::Instruction;
+    using MathExpressions::OpCode;
+    using MathExpressions::EvaluationStatus;
+    using MathExpressions::GetArity;
+
+    const std::vector<Instruction>& instructions = program.GetInstructions();
+    const std::vector<long double>& constants = program.GetConstants();
+    if (instructions.empty()) throw std::runtime_error("Program has no instructions");
+
+    const size_t chunk = std::max(BatchMinChunk, std::min(BatchMaxChunk, BatchScratchElements / instructions.size()));
+    // Values of each instruction for every row of the chunk, instruction after instruction
+    std::vector<long double> values(instructions.size() * chunk);
+    std::vector<unsigned char> faults(chunk);
+
+    typedef EvaluationStatus Status;
+
+    for (size_t start = 0; start < row_count; start += chunk)
+    {
+        const size_t rows = std::min(chunk, row_count - start);
+        std::fill(faults.begin(), faults.begin() + rows, 0);
+
+        for (size_t i = 0; i < instructions.size(); i++)
+        {
+            const Instruction& instr = instructions[i];
+            long double* res = &values[i * chunk];
+
+            // Leaves and calls don't have operands, their 'Lhs' indexes the pool, the symbol table or the call table instead
+            if (instr.Op == OpCode::Constant)
+            {
+                std::fill(res, res + rows, constants[instr.Lhs]);
+                continue;
+            }
+
+            if (instr.Op == OpCode::Variable)
+            {
+                load(instr.Lhs, start, rows, res, faults.data());
+                continue;
+            }
+
+            if (instr.Op == OpCode::Call)
+            {
+                ApplyCall(program.GetCalls()[instr.Lhs], values.data(), chunk, rows, res);
+                continue;
+            }
+
+            const long double* lhs = &values[instr.Lhs * chunk];
+            const long double* rhs = GetArity(instr.Op) > 1 ? &values[instr.Rhs * chunk] : lhs;
+            unsigned char* fault = faults.data();
+
+            // Faulted rows are computed anyway. Whatever they produce is discarded at the end
+            switch (instr.Op)
+            {
+            case OpCode::Add: ApplyBinary(res, lhs, rhs, rows, [](long double a, long double b) { return a + b; }); break;
+            case OpCode::Sub: ApplyBinary(res, lhs, rhs, rows, [](long double a, long double b) { return a - b; }); break;
+            case OpCode::Mul: ApplyBinary(res, lhs, rhs, rows, [](long double a, long double b) { return a * b; }); break;
+            case OpCode::Div:
+                CheckUnary(fault, rhs, rows, Status::DivisionByZero, [](long double b) { return b == 0; });
+                ApplyBinary(res, lhs, rhs, rows, [](long double a, long double b) { return a / b; });
+                break;
+            case OpCode::Pow:
+                // Cannot get root from negative numbers
+                CheckBinary(fault, lhs, rhs, rows, Status::NegativeNumberRoot,
+                    [](long double a, long double b) { return (b < 1.0) & (a < 0.0); });
+                ApplyBinary(res, lhs, rhs, rows, [](long double a, long double b) { return powl(a, b); });
+                break;
+            case OpCode::Log:
+                CheckBinary(fault, lhs, rhs, rows, Status::OutOfDomain,
+                    [](long double a, long double b) { return (a < 0) | (b < 0); });
+                ApplyBinary(res, lhs, rhs, rows, [](long double a, long double b) { return log2l(a) / log2l(b); });
+                break;
+            case OpCode::Negate: ApplyUnary(res, lhs, rows, [](long double a) { return -a; }); break;
+            case OpCode::Abs: ApplyUnary(res, lhs, rows, [](long double a) { return fabsl(a); }); break;
+            case OpCode::LogE:
+                CheckUnary(fault, lhs, rows, Status::OutOfDomain, [](long double a) { return a < 0; });
+                ApplyUnary(res, lhs, rows, [](long double a) { return logl(a); });
+                break;
+            case OpCode::Log2:
+                CheckUnary(fault, lhs, rows, Status::OutOfDomain, [](long double a) { return a < 0; });
+                ApplyUnary(res, lhs, rows, [](long double a) { return log2l(a); });
+                break;
+            case OpCode::Log10:
+                CheckUnary(fault, lhs, rows, Status::OutOfDomain, [](long double a) { return a < 0; });
+                ApplyUnary(res, lhs, rows, [](long double a) { return log10l(a); });
+                break;
+            case OpCode::Exp: ApplyUnary(res, lhs, rows, [](long double a) { return expl(a); }); break;
+            case OpCode::Sqrt:
+                CheckUnary(fault, lhs, rows, Status::NegativeNumberRoot, [](long double a) { return a < 0; });
+                ApplyUnary(res, lhs, rows, [](long double a) { return sqrtl(a); });
+                break;
+            case OpCode::Sign:
+                ApplyUnary(res, lhs, rows, [](long double a) { return (a == 0) ? 0.0L : ((a > 0) ? 1.0L : -1.0L); });
+                break;
+            case OpCode::Sin: ApplyUnary(res, lhs, rows, [](long double a) { return sinl(a); }); break;
+            case OpCode::Cos: ApplyUnary(res, lhs, rows, [](long double a) { return cosl(a); }); break;
+            case OpCode::Tan: ApplyUnary(res, lhs, rows, [](long double a) { return tanl(a); }); break;
+            case OpCode::Cot: ApplyUnary(res, lhs, rows, [](long double a) { return 1 / tanl(a); }); break;
+            case OpCode::Asin:
+                CheckUnary(fault, lhs, rows, Status::OutOfDomain, [](long double a) { return fabsl(a) > 1; });
+                ApplyUnary(res, lhs, rows, [](long double a) { return asinl(a); });
+                break;
+            case OpCode::Acos:
+                CheckUnary(fault, lhs, rows, Status::OutOfDomain, [](long double a) { return fabsl(a) > 1; });
+                ApplyUnary(res, lhs, rows, [](long double a) { return acosl(a); });
+                break;
+            case OpCode::Atan: ApplyUnary(res, lhs, rows, [](long double a) { return atanl(a); }); break;
+            case OpCode::Sinh: ApplyUnary(res, lhs, rows, [](long double a) { return sinhl(a); }); break;
+            case OpCode::Cosh: ApplyUnary(res, lhs, rows, [](long double a) { return coshl(a); }); break;
+            case OpCode::Tanh: ApplyUnary(res, lhs, rows, [](long double a) { return tanhl(a); }); break;
+            case OpCode::Asinh: ApplyUnary(res, lhs, rows, [](long double a) { return asinhl(a); }); break;
+            case OpCode::Acosh:
+                CheckUnary(fault, lhs, rows, Status::OutOfDomain, [](long double a) { return a < 1; });
+                ApplyUnary(res, lhs, rows, [](long double a) { return acoshl(a); });
+                break;
+            case OpCode::Atanh:
+                CheckUnary(fault, lhs, rows, Status::OutOfDomain, [](long double a) { return fabsl(a) > 1; });
+                ApplyUnary(res, lhs, rows, [](long double a) { return atanhl(a); });
+                break;
+            default:
+                break;
+            }
+        }
+
+        // Last instruction holds the result
+        store(start, rows, &values[(instructions.size() - 1) * chunk], faults.data());
+    }
+}
+
+void MathExpressions::EvaluateBatch(
+    const MathExpressions::Program& program,
+    const long double* const* symbol_columns,
+    size_t row_count,
+    const MathExpressions::BatchOptions& options,
+    MathExpressions::BatchResult& out_result
+) {
+    // Values from previous evaluation are kept for 'FaultPolicy::PreviousValue'
+    out_result.Values.resize(row_count);
+    out_result.ErrorMask.assign((row_count + 63) / 64, 0);
+    out_result.Errors.assign(row_count, EvaluationStatus::Success);
+    out_result.ErrorCount = 0;
+
+    const long double fill = options.Policy == FaultPolicy::Sentinel ?
+        options.Sentinel : std::numeric_limits<long double>::quiet_NaN();
+    const bool keep_previous = options.Policy == FaultPolicy::PreviousValue;
+
+    auto load = [&](size_t symbol, size_t start, size_t rows, long double* out_values, unsigned char*) {
+        std::copy(symbol_columns[symbol] + start, symbol_columns[symbol] + start + rows, out_values);
+    };
+
+    // Faulted rows are replaced according to the policy
+    auto store = [&](size_t start, size_t rows, const long double* result, const unsigned char* faults) {
+        long double* out_values = &out_result.Values[start];
+        EvaluationStatus* out_errors = &out_result.Errors[start];
+
+        size_t fault_count = 0;
+        for (size_t r = 0; r < rows; r++)
+        {
+            const bool faulted = faults[r] != 0;
+            const long double replacement = keep_previous ? out_values[r] : fill;
+
+            out_values[r] = faulted ? replacement : result[r];
+            out_errors[r] = static_cast<EvaluationStatus>(faults[r]);
+            fault_count += faulted;
+        }
+
+        // Error mask is only touched if the chunk had any errors
+        if (fault_count)
+        {
+            for (size_t r = 0; r < rows; r++)
+                out_result.ErrorMask[(start + r) / 64] |= static_cast<uint64_t>(faults[r] != 0) << ((start + r) % 64);
+
+            out_result.ErrorCount += fault_count;
+        }
+    };
+
+    EvaluateChunks(program, row_count, load, store);
+}
+
+void MathExpressions::EvaluateBatch(
+    const MathExpressions::Program& program,
+    const MathExpressions::ColumnEnvironment& columns,
+    size_t row_count,
+    const MathExpressions::BatchOptions& options,
+    MathExpressions::BatchResult& out_result
+) {
+    const std::vector<std::string>& symbols = program.GetSymbols();
+
+    std::vector<const long double*> symbol_columns;
+    symbol_columns.reserve(symbols.size());
+
+    for (size_t i = 0; i < symbols.size(); i++)
+    {
+        ColumnEnvironment::const_iterator column_it = columns.find(symbols[i]);
+        if (column_it == columns.cend()) program.ThrowError({ 0, EvaluationStatus::UnresolvedSymbol, i });
+        if (column_it->second.size() < row_count)
+            throw std::invalid_argument("Column '" + symbols[i] + "' is shorter than the batch");
+
+        symbol_columns.push_back(column_it->second.data());
+    }
+
+    EvaluateBatch(program, symbol_columns.data(), row_count, options, out_result);
+}
+
+size_t MathExpressions::GetColumnTypeSize(MathExpressions::ColumnType type)
+{
+    switch (type)
+    {
+    case ColumnType::LongDouble: return sizeof(long double);
+    case ColumnType::Double: return sizeof(double);
+    case ColumnType::Float: return sizeof(float);
+    case ColumnType::Int32: return sizeof(int32_t);
+    case ColumnType::Int64: return sizeof(int64_t);
+    }
+
+    return 0;
+}
+
+// Converts rows of a typed column to values the evaluator works with
+template<typename T>
+static void LoadColumn(const void* data, size_t start, size_t rows, long double* out_values)
+{
+    const T* values = static_cast<const T*>(data) + start;
+    for (size_t r = 0; r < rows; r++)
+        out_values[r] = static_cast<long double>(values[r]);
+}
+
+// Converts results to the type of a column. Faulted rows get 'fill', or are left untouched if 'keep_previous' is set
+template<typename T>
+static void StoreColumn(
+    void* data, size_t start, size_t rows, const long double* values, const unsigned char* faults,
+    long double fill, bool keep_previous
+) {
+    T* out_values = static_cast<T*>(data) + start;
+    for (size_t r = 0; r < rows; r++)
+    {
+        if (!faults[r]) out_values[r] = static_cast<T>(values[r]);
+        else if (!keep_previous) out_values[r] = static_cast<T>(fill);
+    }
+}
+
+size_t MathExpressions::EvaluateBatch(
+    const MathExpressions::Program& program,
+    const MathExpressions::ColumnView* symbol_columns,
+    size_t row_count,
+    const MathExpressions::BatchOptions& options,
+    const MathExpressions::ColumnTarget& out_column
+) {
+    if (out_column.Type != ColumnType::LongDouble && out_column.Type != ColumnType::Double && out_column.Type != ColumnType::Float)
+        throw std::invalid_argument("Results can only be stored in floating-point columns");
+
+    const long double fill = options.Policy == FaultPolicy::Sentinel ?
+        options.Sentinel : std::numeric_limits<long double>::quiet_NaN();
+    const bool keep_previous = options.Policy == FaultPolicy::PreviousValue;
+    size_t fault_count = 0;
+
+    // Rows without a value fault the same way a missing variable does
+    auto load = [&](size_t symbol, size_t start, size_t rows, long double* out_values, unsigned char* faults) {
+        const ColumnView& column = symbol_columns[symbol];
+
+        switch (column.Type)
+        {
+        case ColumnType::LongDouble: LoadColumn<long double>(column.Data, start, rows, out_values); break;
+        case ColumnType::Double: LoadColumn<double>(column.Data, start, rows, out_values); break;
+        case ColumnType::Float: LoadColumn<float>(column.Data, start, rows, out_values); break;
+        case ColumnType::Int32: LoadColumn<int32_t>(column.Data, start, rows, out_values); break;
+        case ColumnType::Int64: LoadColumn<int64_t>(column.Data, start, rows, out_values); break;
+        }
+
+        if (!column.Validity) return;
+        for (size_t r = 0; r < rows; r++)
+        {
+            const bool valid = (column.Validity[(start + r) / 64] >> ((start + r) % 64)) & 1;
+            FlagFault(faults[r], !valid, EvaluationStatus::UnresolvedSymbol);
+        }
+    };
+
+    auto store = [&](size_t start, size_t rows, const long double* values, const unsigned char* faults) {
+        switch (out_column.Type)
+        {
+        case ColumnType::LongDouble: StoreColumn<long double>(out_column.Data, start, rows, values, faults, fill, keep_previous); break;
+        case ColumnType::Double: StoreColumn<double>(out_column.Data, start, rows, values, faults, fill, keep_previous); break;
+        default: StoreColumn<float>(out_column.Data, start, rows, values, faults, fill, keep_previous); break;
+        }
+
+        for (size_t r = 0; r < rows; r++)
+        {
+            fault_count += faults[r] != 0;
+            if (!out_column.Validity) continue;
+
+            uint64_t& word = out_column.Validity[(start + r) / 64];
+            const uint64_t bit = static_cast<uint64_t>(1) << ((start + r) % 64);
+            word = faults[r] ? (word & ~bit) : (word | bit);
+        }
+    };
+
+    EvaluateChunks(program, row_count, load, store);
+    return fault_count;
+}
@@ -0,0 +1,149 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+namespace MathExpressions
+{
+	// Type that defines how variables are stored when evaluating many rows at once
+	using ColumnEnvironment = std::unordered_map<std::string, std::vector<long double>>;
+
+	// What rows that ran into an error evaluate to
+	enum class FaultPolicy : unsigned char
+	{
+		// Quiet NaN
+		NaN,
+		// Value of 'BatchOptions::Sentinel'
+		Sentinel,
+		// Whatever value the row had in the output before evaluation
+		PreviousValue
+	};
+
+	struct BatchOptions
+	{
+		FaultPolicy Policy;
+		long double Sentinel;
+
+		BatchOptions(FaultPolicy policy = FaultPolicy::NaN, long double sentinel = 0);
+	};
+
+	/* Output of a batch evaluation
+	Can be reused between evaluations, which is what 'FaultPolicy::PreviousValue' relies on
+	*/
+	struct BatchResult
+	{
+		std::vector<long double> Values;
+		// Bit 'i % 64' of word 'i / 64' is set if row 'i' has faulted
+		std::vector<uint64_t> ErrorMask;
+		// Kind of the first error each row has ran into, 'Success' for rows that didn't
+		std::vector<EvaluationStatus> Errors;
+		size_t ErrorCount;
+	};
+
+	/// <summary>
+	/// Evaluates program for every row of provided columns. Errors never stop the batch:
+	/// domain checks (division by zero, roots of negative numbers, arguments outside of function's domain)
+	/// are computed as per-row masks without branching, and faulted rows are filled in according to the policy.
+	/// Unlike scalar evaluation, which returns NaN with 'Success' status for arguments outside of function's domain,
+	/// batch evaluation faults such rows with 'OutOfDomain' status (see 'EvaluationStatus')
+	/// </summary>
+	/// <param name="program">- program to evaluate</param>
+	/// <param name="symbol_columns">- one column per symbol, ordered as in program's symbol table.
+	/// Each column has to have at least 'row_count' values</param>
+	/// <param name="row_count">- number of rows in the batch</param>
+	/// <param name="options">- what faulted rows evaluate to</param>
+	/// <param name="out_result">- values, error masks and error kinds of every row</param>
+	void EvaluateBatch(
+		const Program& program,
+		const long double* const* symbol_columns,
+		size_t row_count,
+		const BatchOptions& options,
+		BatchResult& out_result
+	);
+
+	// Type of values in a column that isn't owned by the evaluator (e.g. one mapped from a file)
+	enum class ColumnType : unsigned char
+	{
+		LongDouble, Double, Float, Int32, Int64
+	};
+
+	/// <summary>
+	/// Returns size of a single value of the type in bytes
+	/// </summary>
+	size_t GetColumnTypeSize(ColumnType type);
+
+	// Read-only column of values of any supported type
+	struct ColumnView
+	{
+		const void* Data;
+		ColumnType Type;
+		// Bit 'i % 64' of word 'i / 64' is set if row 'i' has a value, null if every row has one
+		const uint64_t* Validity;
+	};
+
+	// Column results are written into. Only floating-point types can hold results
+	struct ColumnTarget
+	{
+		void* Data;
+		ColumnType Type;
+		// Receives a set bit for every row that has been evaluated and a cleared one for every faulted row. May be null
+		uint64_t* Validity;
+	};
+
+	/// <summary>
+	/// Evaluates program for every row of typed columns, converting values while they're loaded and stored,
+	/// so columns are used where they are (e.g. mapped from a file) without being copied or converted beforehand.
+	/// Rows where any symbol has no value fault with 'UnresolvedSymbol' status.
+	/// Throws std::invalid_argument if the target column isn't of a floating-point type
+	/// </summary>
+	/// <param name="symbol_columns">- one column per symbol, ordered as in program's symbol table.
+	/// Each column has to have at least 'row_count' values</param>
+	/// <param name="out_column">- column of at least 'row_count' values results are written into</param>
+	/// <returns>Number of faulted rows</returns>
+	size_t EvaluateBatch(
+		const Program& program,
+		const ColumnView* symbol_columns,
+		size_t row_count,
+		const BatchOptions& options,
+		const ColumnTarget& out_column
+	);
+
+	/// <summary>
+	/// Looks up columns of program's symbols by their names and evaluates every row.
+	/// Throws UnresolvedSymbol if a column is missing and std::invalid_argument if it's shorter than 'row_count'
+	/// </summary>
+	void EvaluateBatch(
+		const Program& program,
+		const ColumnEnvironment& columns,
+		size_t row_count,
+		const BatchOptions& options,
+		BatchResult& out_result
+	);
+}
@@ -0,0 +1,160 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include "Exceptions.hpp"
+#include "MappedFile.hpp"
+#include "BulkCompilation.hpp"
+
+// Lines are handed out to threads this many at a time
+static const size_t LinesPerClaim = 64;
+
+/* Finds where in the line a parsing error has occurred. Tokens the error refers to die together with
+the expression that has failed to compile, so the line is parsed once more, keeping tokens alive this time.
+Only lines that fail go through this
+*/
+static size_t LocateError(const std::string& line)
+{
+    std::vector<Parser::TokenPtr> tokens;
+    Tree<Parser::TokenPtr> tree;
+    Parser::Engine parser;
+
+    try
+    {
+        parser.Tokenize(MathExpressions::GetTokenFactories(), line, tokens);
+        parser.Backpatch(tokens);
+        parser.Parse(tokens, tree);
+
+        MathExpressions::Program program;
+        if (auto token = dynamic_cast<const MathExpressions::Token*>(tree.Root ? tree.Root->Value.get() : nullptr))
+            token->Compile(*tree.Root, program);
+    }
+    catch (const ParsingError& error)
+    {
+        if (auto token = dynamic_cast<const MathExpressions::SourcedToken*>(error.GetToken()))
+            return static_cast<size_t>(token->Source.Start - line.cbegin());
+    }
+    catch (...) {}
+
+    return std::string::npos;
+}
+
+// Threads that are joined however the owner is left, as destroying a joinable thread terminates the program
+struct WorkerGroup
+{
+    std::vector<std::thread> Threads;
+
+    ~WorkerGroup()
+    {
+        for (std::thread& thread : Threads)
+            if (thread.joinable()) thread.join();
+    }
+};
+
+// Whether the line has nothing to compile
+static bool IsSkipped(const char* begin, const char* end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t')) begin++;
+
+    return begin == end || *begin == '#';
+}
+
+MathExpressions::FormulaTable MathExpressions::CompileLines(const char* data, size_t size, size_t thread_count)
+{
+    // Splitting is a plain scan, it's compilation that is worth spreading over threads
+    std::vector<std::pair<const char*, const char*>> lines;
+    for (const char* begin = data, *end = data + size; begin < end;)
+    {
+        const char* line_end = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        if (!line_end) line_end = end;
+
+        const char* next = line_end + 1;
+        if (line_end > begin && line_end[-1] == '\r') line_end--;
+        lines.emplace_back(begin, line_end);
+
+        begin = next;
+    }
+
+    FormulaTable table;
+    table.Formulas.resize(lines.size());
+
+    if (!thread_count) thread_count = std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::max<size_t>(1, std::min(thread_count, (lines.size() + LinesPerClaim - 1) / LinesPerClaim));
+
+    std::atomic<size_t> cursor(0);
+    // Each thread collects diagnostics on it's own, they're merged once everything is compiled
+    std::vector<std::vector<FormulaDiagnostic>> diagnostics(thread_count);
+
+    auto work = [&](size_t worker) {
+        for (;;)
+        {
+            const size_t first = cursor.fetch_add(LinesPerClaim, std::memory_order_relaxed);
+            if (first >= lines.size()) return;
+
+            for (size_t i = first; i < std::min(first + LinesPerClaim, lines.size()); i++)
+            {
+                if (IsSkipped(lines[i].first, lines[i].second)) continue;
+
+                const std::string line(lines[i].first, lines[i].second);
+                try
+                {
+                    table.Formulas[i] = Compile(line);
+                }
+                catch (const ParsingError& error)
+                {
+                    diagnostics[worker].push_back({ i + 1, LocateError(line), error.what() });
+                }
+                catch (const std::exception& error)
+                {
+                    diagnostics[worker].push_back({ i + 1, std::string::npos, error.what() });
+                }
+            }
+        }
+    };
+
+    // If starting a thread or the calling thread's own share fails, the rest of the workers are still joined
+    {
+        WorkerGroup workers;
+        workers.Threads.reserve(thread_count - 1);
+        for (size_t i = 1; i < thread_count; i++) workers.Threads.emplace_back(work, i);
+        work(0);
+    }
+
+    for (std::vector<FormulaDiagnostic>& worker_diagnostics : diagnostics)
+        table.Diagnostics.insert(table.Diagnostics.end(), worker_diagnostics.begin(), worker_diagnostics.end());
+    std::sort(table.Diagnostics.begin(), table.Diagnostics.end(),
+        [](const FormulaDiagnostic& a, const FormulaDiagnostic& b) { return a.Line < b.Line; });
+
+    return table;
+}
+
+MathExpressions::FormulaTable MathExpressions::CompileFile(const std::string& path, size_t thread_count)
+{
+    MappedFile file(path);
+
+    return CompileLines(file.GetData(), file.GetSize(), thread_count);
+}
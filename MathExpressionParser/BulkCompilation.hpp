@@ -0,0 +1,68 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+namespace MathExpressions
+{
+	// Error a single line of a formula file has ran into
+	struct FormulaDiagnostic
+	{
+		// Number of the line, starting from 1
+		size_t Line;
+		// Offset of the offending token within the line, or std::string::npos if error isn't tied to a token
+		size_t Column;
+		std::string Message;
+	};
+
+	struct FormulaTable
+	{
+		// Formula of each line, in order. Null for blank lines, comments and lines that failed to compile
+		std::vector<CompiledExpressionPtr> Formulas;
+		// Errors of lines that failed to compile, ordered by line
+		std::vector<FormulaDiagnostic> Diagnostics;
+	};
+
+	/// <summary>
+	/// Compiles each line of the text as a separate expression. Lines are split up front
+	/// and handed out to threads in small batches, so long and short lines balance out.
+	/// Errors don't stop compilation, they're collected into diagnostics of their lines instead.
+	/// Blank lines and lines starting with '#' are skipped
+	/// </summary>
+	/// <param name="data">- text with one formula per line</param>
+	/// <param name="size">- length of the text</param>
+	/// <param name="thread_count">- maximum number of threads, including the calling one.
+	/// Zero picks the number of hardware threads</param>
+	FormulaTable CompileLines(const char* data, size_t size, size_t thread_count = 0);
+
+	/// <summary>
+	/// Memory-maps a file with one formula per line and compiles it with 'CompileLines'.
+	/// Throws std::runtime_error if file cannot be opened
+	/// </summary>
+	FormulaTable CompileFile(const std::string& path, size_t thread_count = 0);
+}
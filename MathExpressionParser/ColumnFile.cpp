@@ -0,0 +1,363 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "ColumnFile.hpp"
+
+// Every field has a fixed size, so layout of the file only depends on byte order,
+// which is recorded in the header
+struct ColumnFileHeader
+{
+    char Magic[4];
+    uint32_t Version;
+    uint32_t ByteOrderMark;
+    uint32_t LongDoubleSize;
+    uint64_t RowCount;
+    uint64_t ColumnCount;
+    uint64_t Reserved[4];
+};
+
+struct ColumnFileRecord
+{
+    uint64_t NameOffset, NameLength;
+    uint32_t Type;
+    uint32_t HasValidity;
+    uint64_t DataOffset, ValidityOffset;
+};
+
+static const char ColumnFileMagic[4] = { 'M', 'E', 'P', 'C' };
+static const uint32_t ColumnFileByteOrderMark = 0x01020304;
+// Columns start at page boundaries, so windows of different columns never share pages
+static const size_t ColumnAlignment = 4096;
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Size of a validity bitmap in bytes. It's made of whole words, so it can be read a word at a time
+static size_t GetValiditySize(size_t row_count)
+{
+    return (row_count + 63) / 64 * sizeof(uint64_t);
+}
+
+// Checks that 'count' elements of 'size' bytes starting at 'offset' lie within the file
+static bool InFile(uint64_t offset, uint64_t count, size_t size, size_t file_size)
+{
+    return offset <= file_size && count <= (file_size - offset) / size;
+}
+
+// Byte range of a window of rows within a column's data and it's validity bitmap
+static void GetWindow(
+    const MathExpressions::ColumnRecord& column,
+    size_t first_row,
+    size_t row_count,
+    size_t& out_data_offset,
+    size_t& out_data_size,
+    size_t& out_validity_offset,
+    size_t& out_validity_size
+) {
+    const size_t value_size = MathExpressions::GetColumnTypeSize(column.Type);
+    out_data_offset = column.DataOffset + first_row * value_size;
+    out_data_size = row_count * value_size;
+
+    out_validity_offset = column.ValidityOffset + first_row / 64 * sizeof(uint64_t);
+    out_validity_size = column.HasValidity ? GetValiditySize(first_row % 64 + row_count) : 0;
+}
+
+MathExpressions::ColumnFile::ColumnFile(
+    const std::string& path
+) : File(path), RowCount(0)
+{
+    const size_t file_size = File.GetSize();
+
+    ColumnFileHeader header;
+    if (file_size < sizeof(header)) throw std::runtime_error("'" + path + "' is not a column file");
+    std::memcpy(&header, File.GetData(), sizeof(header));
+
+    if (std::memcmp(header.Magic, ColumnFileMagic, sizeof(ColumnFileMagic)) != 0)
+        throw std::runtime_error("'" + path + "' is not a column file");
+    if (header.Version != Version)
+        throw std::runtime_error("Column file '" + path + "' has unsupported version");
+    if (header.ByteOrderMark != ColumnFileByteOrderMark)
+        throw std::runtime_error("Column file '" + path + "' was written on an incompatible platform");
+    if (!InFile(sizeof(header), header.ColumnCount, sizeof(ColumnFileRecord), file_size))
+        throw std::runtime_error("Column file '" + path + "' is truncated");
+
+    RowCount = static_cast<size_t>(header.RowCount);
+    Columns.reserve(static_cast<size_t>(header.ColumnCount));
+
+    for (uint64_t i = 0; i < header.ColumnCount; i++)
+    {
+        ColumnFileRecord stored;
+        std::memcpy(&stored, File.GetData() + sizeof(header) + i * sizeof(stored), sizeof(stored));
+
+        if (stored.Type > static_cast<uint32_t>(ColumnType::Int64) || !InFile(stored.NameOffset, stored.NameLength, 1, file_size))
+            throw std::runtime_error("Malformed column file record");
+
+        ColumnRecord column;
+        column.Name.assign(File.GetData() + stored.NameOffset, static_cast<size_t>(stored.NameLength));
+        column.Type = static_cast<ColumnType>(stored.Type);
+        column.HasValidity = stored.HasValidity != 0;
+        column.DataOffset = static_cast<size_t>(stored.DataOffset);
+        column.ValidityOffset = static_cast<size_t>(stored.ValidityOffset);
+
+        if (column.Type == ColumnType::LongDouble && header.LongDoubleSize != sizeof(long double))
+            throw std::runtime_error("Column file '" + path + "' was written on an incompatible platform");
+
+        // Values are accessed in place, so they have to be aligned as well as lie within the file
+        const size_t value_size = GetColumnTypeSize(column.Type);
+        if (stored.DataOffset % value_size != 0 || !InFile(stored.DataOffset, header.RowCount, value_size, file_size) ||
+            (column.HasValidity && (stored.ValidityOffset % sizeof(uint64_t) != 0 ||
+                !InFile(stored.ValidityOffset, GetValiditySize(RowCount), 1, file_size))))
+            throw std::runtime_error("Column file '" + path + "' is truncated");
+
+        Columns.push_back(column);
+    }
+}
+
+size_t MathExpressions::ColumnFile::GetRowCount() const
+{
+    return RowCount;
+}
+
+const std::vector<MathExpressions::ColumnRecord>& MathExpressions::ColumnFile::GetColumns() const
+{
+    return Columns;
+}
+
+size_t MathExpressions::ColumnFile::FindColumn(const std::string& name) const
+{
+    for (size_t i = 0; i < Columns.size(); i++)
+        if (Columns[i].Name == name) return i;
+
+    return Columns.size();
+}
+
+MathExpressions::ColumnView MathExpressions::ColumnFile::GetColumn(size_t column) const
+{
+    const ColumnRecord& record = Columns[column];
+    const uint64_t* validity = record.HasValidity ?
+        reinterpret_cast<const uint64_t*>(File.GetData() + record.ValidityOffset) : nullptr;
+
+    return { File.GetData() + record.DataOffset, record.Type, validity };
+}
+
+void MathExpressions::ColumnFile::Prefetch(size_t column, size_t first_row, size_t row_count) const
+{
+    size_t data_offset, data_size, validity_offset, validity_size;
+    GetWindow(Columns[column], first_row, row_count, data_offset, data_size, validity_offset, validity_size);
+
+    File.Prefetch(data_offset, data_size);
+    if (validity_size) File.Prefetch(validity_offset, validity_size);
+}
+
+void MathExpressions::ColumnFile::Evict(size_t column, size_t first_row, size_t row_count) const
+{
+    size_t data_offset, data_size, validity_offset, validity_size;
+    GetWindow(Columns[column], first_row, row_count, data_offset, data_size, validity_offset, validity_size);
+
+    File.Evict(data_offset, data_size);
+    // Bitmap is small, and it's pages are shared by neighbouring windows, so it's kept
+}
+
+// Lays columns out one after another past the header, the records and the names
+static std::vector<MathExpressions::ColumnRecord> PlanColumns(
+    size_t row_count,
+    const std::vector<MathExpressions::ColumnSpec>& columns
+) {
+    size_t offset = sizeof(ColumnFileHeader) + columns.size() * sizeof(ColumnFileRecord);
+    for (const MathExpressions::ColumnSpec& column : columns) offset += column.Name.size();
+
+    std::vector<MathExpressions::ColumnRecord> records;
+    records.reserve(columns.size());
+
+    for (const MathExpressions::ColumnSpec& column : columns)
+    {
+        MathExpressions::ColumnRecord record;
+        static_cast<MathExpressions::ColumnSpec&>(record) = column;
+
+        record.DataOffset = AlignUp(offset, ColumnAlignment);
+        offset = record.DataOffset + row_count * MathExpressions::GetColumnTypeSize(column.Type);
+
+        record.ValidityOffset = AlignUp(offset, sizeof(uint64_t));
+        if (column.HasValidity) offset = record.ValidityOffset + GetValiditySize(row_count);
+
+        records.push_back(record);
+    }
+
+    return records;
+}
+
+// File ends with the last column
+static size_t GetFileSize(const std::vector<MathExpressions::ColumnRecord>& columns, size_t row_count)
+{
+    if (columns.empty()) return sizeof(ColumnFileHeader);
+
+    const MathExpressions::ColumnRecord& last = columns.back();
+    return last.HasValidity ?
+        last.ValidityOffset + GetValiditySize(row_count) :
+        last.DataOffset + row_count * MathExpressions::GetColumnTypeSize(last.Type);
+}
+
+MathExpressions::ColumnFileWriter::ColumnFileWriter(
+    const std::string& path,
+    size_t row_count,
+    const std::vector<MathExpressions::ColumnSpec>& columns
+) : RowCount(row_count), Columns(PlanColumns(row_count, columns)), File(path, GetFileSize(Columns, row_count))
+{
+    char* data = File.GetData();
+
+    ColumnFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, ColumnFileMagic, sizeof(ColumnFileMagic));
+    header.Version = ColumnFile::Version;
+    header.ByteOrderMark = ColumnFileByteOrderMark;
+    header.LongDoubleSize = sizeof(long double);
+    header.RowCount = RowCount;
+    header.ColumnCount = Columns.size();
+    std::memcpy(data, &header, sizeof(header));
+
+    uint64_t name_offset = sizeof(header) + Columns.size() * sizeof(ColumnFileRecord);
+    for (size_t i = 0; i < Columns.size(); i++)
+    {
+        const ColumnRecord& column = Columns[i];
+
+        ColumnFileRecord stored;
+        std::memset(&stored, 0, sizeof(stored));
+        stored.NameOffset = name_offset;
+        stored.NameLength = column.Name.size();
+        stored.Type = static_cast<uint32_t>(column.Type);
+        stored.HasValidity = column.HasValidity;
+        stored.DataOffset = column.DataOffset;
+        stored.ValidityOffset = column.ValidityOffset;
+
+        std::memcpy(data + sizeof(header) + i * sizeof(stored), &stored, sizeof(stored));
+        std::memcpy(data + name_offset, column.Name.data(), column.Name.size());
+        name_offset += column.Name.size();
+    }
+}
+
+size_t MathExpressions::ColumnFileWriter::GetRowCount() const
+{
+    return RowCount;
+}
+
+const std::vector<MathExpressions::ColumnRecord>& MathExpressions::ColumnFileWriter::GetColumns() const
+{
+    return Columns;
+}
+
+size_t MathExpressions::ColumnFileWriter::FindColumn(const std::string& name) const
+{
+    for (size_t i = 0; i < Columns.size(); i++)
+        if (Columns[i].Name == name) return i;
+
+    return Columns.size();
+}
+
+MathExpressions::ColumnTarget MathExpressions::ColumnFileWriter::GetColumn(size_t column)
+{
+    const ColumnRecord& record = Columns[column];
+    uint64_t* validity = record.HasValidity ?
+        reinterpret_cast<uint64_t*>(File.GetData() + record.ValidityOffset) : nullptr;
+
+    return { File.GetData() + record.DataOffset, record.Type, validity };
+}
+
+void MathExpressions::ColumnFileWriter::Evict(size_t column, size_t first_row, size_t row_count)
+{
+    size_t data_offset, data_size, validity_offset, validity_size;
+    GetWindow(Columns[column], first_row, row_count, data_offset, data_size, validity_offset, validity_size);
+
+    // Validity bits of the window share pages with bits of the next one, and take a fraction of the data's space,
+    // so they're left for 'Flush'
+    File.Evict(data_offset, data_size);
+}
+
+void MathExpressions::ColumnFileWriter::Flush()
+{
+    File.Flush(0, File.GetSize());
+}
+
+size_t MathExpressions::EvaluateColumns(
+    const MathExpressions::Program& program,
+    const MathExpressions::ColumnFile& input,
+    MathExpressions::ColumnFileWriter& output,
+    size_t output_column,
+    const MathExpressions::BatchOptions& options,
+    size_t window_rows
+) {
+    const std::vector<std::string>& symbols = program.GetSymbols();
+    const size_t row_count = input.GetRowCount();
+    if (output.GetRowCount() < row_count) throw std::invalid_argument("Output has fewer rows than input");
+
+    std::vector<size_t> input_columns(symbols.size());
+    for (size_t i = 0; i < symbols.size(); i++)
+    {
+        input_columns[i] = input.FindColumn(symbols[i]);
+        if (input_columns[i] == input.GetColumns().size()) program.ThrowError({ 0, EvaluationStatus::UnresolvedSymbol, i });
+    }
+
+    // Windows start at whole words of validity bitmaps, so views of a window are simply offset
+    window_rows = AlignUp(std::max<size_t>(window_rows, 1), 64);
+
+    std::vector<ColumnView> views(symbols.size());
+    const ColumnTarget target = output.GetColumn(output_column);
+    const size_t target_size = GetColumnTypeSize(target.Type);
+    size_t fault_count = 0;
+
+    for (size_t column : input_columns) input.Prefetch(column, 0, std::min(window_rows, row_count));
+
+    for (size_t start = 0; start < row_count; start += window_rows)
+    {
+        const size_t rows = std::min(window_rows, row_count - start);
+
+        // Next window is read in the background while this one is evaluated
+        if (start + rows < row_count)
+            for (size_t column : input_columns) input.Prefetch(column, start + rows, std::min(window_rows, row_count - start - rows));
+
+        for (size_t i = 0; i < symbols.size(); i++)
+        {
+            ColumnView view = input.GetColumn(input_columns[i]);
+            view.Data = static_cast<const char*>(view.Data) + start * GetColumnTypeSize(view.Type);
+            if (view.Validity) view.Validity += start / 64;
+            views[i] = view;
+        }
+
+        ColumnTarget window_target = target;
+        window_target.Data = static_cast<char*>(target.Data) + start * target_size;
+        if (window_target.Validity) window_target.Validity += start / 64;
+
+        fault_count += EvaluateBatch(program, views.data(), rows, options, window_target);
+
+        for (size_t column : input_columns) input.Evict(column, start, rows);
+        output.Evict(output_column, start, rows);
+    }
+
+    return fault_count;
+}
@@ -0,0 +1,159 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "BatchEvaluation.hpp"
+#include "MappedFile.hpp"
+
+namespace MathExpressions
+{
+	// Description of a column of a file that's about to be written
+	struct ColumnSpec
+	{
+		std::string Name;
+		ColumnType Type;
+		// Whether the column has a validity bitmap, i.e. whether some rows may have no value
+		bool HasValidity;
+	};
+
+	// Where a column lies in the file. Offsets are from the beginning of the file
+	struct ColumnRecord : ColumnSpec
+	{
+		size_t DataOffset, ValidityOffset;
+	};
+
+	/* Columnar file that is evaluated straight from memory it's mapped to, without parsing anything
+	Consists of a fixed-size header (magic, format version, byte order, size of 'long double', row and column counts),
+	followed by a table of fixed-size column records and a blob with column names.
+	Each column is an array of values of it's type, starting at a page boundary,
+	optionally followed by a validity bitmap with a bit per row, in the same layout 'ColumnView' uses.
+	Columns are read straight from the mapped file, so files larger than memory can be processed window by window
+	*/
+	class ColumnFile
+	{
+	protected:
+		MappedFile File;
+		size_t RowCount;
+		std::vector<ColumnRecord> Columns;
+	public:
+		// Bumped whenever layout of the file changes
+		static const unsigned Version = 1;
+
+		/// <summary>
+		/// Maps the file and checks it's header and that every column lies within it.
+		/// Throws std::runtime_error if file is not a column file, has a different version,
+		/// was written on an incompatible platform or is truncated
+		/// </summary>
+		ColumnFile(const std::string& path);
+
+		size_t GetRowCount() const;
+		const std::vector<ColumnRecord>& GetColumns() const;
+
+		/// <summary>
+		/// Looks up a column by it's name
+		/// </summary>
+		/// <returns>Index of the column, or the number of columns if there's no such column</returns>
+		size_t FindColumn(const std::string& name) const;
+
+		/// <summary>
+		/// Returns a view of the column that points into the mapped file
+		/// </summary>
+		ColumnView GetColumn(size_t column) const;
+
+		/// <summary>
+		/// Hints the system to start reading specified rows of the column in the background
+		/// </summary>
+		void Prefetch(size_t column, size_t first_row, size_t row_count) const;
+
+		/// <summary>
+		/// Lets the system reclaim memory of specified rows of the column. They're read again if accessed later
+		/// </summary>
+		void Evict(size_t column, size_t first_row, size_t row_count) const;
+	};
+
+	/* Creates a column file of a fixed size and maps it for writing
+	Every value starts as zero and every row is invalid until it's validity bit is set,
+	which evaluation does for every row that didn't fault
+	*/
+	class ColumnFileWriter
+	{
+	protected:
+		size_t RowCount;
+		std::vector<ColumnRecord> Columns;
+		WritableMappedFile File;
+	public:
+		/// <summary>
+		/// Creates (or overwrites) the file with specified columns, writing it's header.
+		/// Throws std::runtime_error if file cannot be created
+		/// </summary>
+		ColumnFileWriter(const std::string& path, size_t row_count, const std::vector<ColumnSpec>& columns);
+
+		size_t GetRowCount() const;
+		const std::vector<ColumnRecord>& GetColumns() const;
+
+		/// <summary>
+		/// Looks up a column by it's name
+		/// </summary>
+		/// <returns>Index of the column, or the number of columns if there's no such column</returns>
+		size_t FindColumn(const std::string& name) const;
+
+		/// <summary>
+		/// Returns a writable view of the column that points into the mapped file
+		/// </summary>
+		ColumnTarget GetColumn(size_t column);
+
+		/// <summary>
+		/// Starts writing specified rows of the column to the file and lets the system reclaim their memory.
+		/// Doesn't wait for them to be written, that's what 'Flush' is for
+		/// </summary>
+		void Evict(size_t column, size_t first_row, size_t row_count);
+
+		/// <summary>
+		/// Writes every change to the file, waiting until it's written
+		/// </summary>
+		void Flush();
+	};
+
+	/// <summary>
+	/// Evaluates program for every row of the input, binding symbols to columns of the same name,
+	/// and writes results into a column of the output. Rows are processed in windows:
+	/// the next window is prefetched while the current one is evaluated, and finished windows are evicted,
+	/// so files larger than memory are streamed rather than loaded.
+	/// Throws UnresolvedSymbol if a column is missing and std::invalid_argument if output has fewer rows than input
+	/// </summary>
+	/// <param name="output_column">- index of output's column results are written into</param>
+	/// <param name="window_rows">- number of rows evaluated at once. Rounded up to a multiple of 64</param>
+	/// <returns>Number of faulted rows</returns>
+	size_t EvaluateColumns(
+		const Program& program,
+		const ColumnFile& input,
+		ColumnFileWriter& output,
+		size_t output_column,
+		const BatchOptions& options = BatchOptions(),
+		size_t window_rows = 1 << 20
+	);
+}
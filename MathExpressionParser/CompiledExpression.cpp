@@ -0,0 +1,523 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <stdexcept>
+#include "Exceptions.hpp"
+#include "CompiledExpression.hpp"
+#include "Instrumentation.hpp"
+
+// Keeps intermediate values of small programs on the stack, and only goes to the heap for large ones
+template<typename T, size_t InlineSize>
+class ScratchBuffer
+{
+	T Inline[InlineSize];
+	std::vector<T> Heap;
+	T* Data;
+public:
+	ScratchBuffer(size_t size) : Data(Inline)
+	{
+		if (size <= InlineSize) return;
+
+		Heap.resize(size);
+		Data = Heap.data();
+	}
+
+	T& operator[](size_t index)
+	{
+		return Data[index];
+	}
+
+	T* GetData()
+	{
+		return Data;
+	}
+};
+
+size_t MathExpressions::GetArity(MathExpressions::OpCode op)
+{
+    switch (op)
+    {
+    case OpCode::Constant: case OpCode::Variable: case OpCode::Call:
+        return 0;
+    case OpCode::Add: case OpCode::Sub: case OpCode::Mul:
+    case OpCode::Div: case OpCode::Pow: case OpCode::Log:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+const char* MathExpressions::GetFunctionName(MathExpressions::OpCode op)
+{
+    // Unary functions, in the same order as in 'OpCode'
+    static const char* const function_names[] = {
+        "ln", "log2", "log10", "exp", "sqrt", "sign",
+        "sin", "cos", "tg", "ctg", "asin", "acos", "atan",
+        "sinh", "cosh", "tanh", "asinh", "acosh", "atanh"
+    };
+
+    if (op == OpCode::Log) return "log";
+    if (op < OpCode::LogE || op > OpCode::Atanh) return nullptr;
+
+    return function_names[static_cast<size_t>(op) - static_cast<size_t>(OpCode::LogE)];
+}
+
+MathExpressions::Program::Program(
+    std::vector<MathExpressions::Instruction> instructions,
+    std::vector<long double> constants,
+    std::vector<std::string> symbols,
+    std::vector<MathExpressions::NativeCall> calls
+) : Instructions(std::move(instructions)), Constants(std::move(constants)), Symbols(std::move(symbols)), Calls(std::move(calls))
+{
+    for (size_t i = 0; i < Instructions.size(); i++)
+    {
+        const Instruction& instr = Instructions[i];
+
+        bool valid;
+        switch (instr.Op)
+        {
+        case OpCode::Constant: valid = instr.Lhs < Constants.size(); break;
+        case OpCode::Variable: valid = instr.Lhs < Symbols.size(); break;
+        case OpCode::Call:
+        {
+            valid = instr.Lhs < Calls.size() && Calls[instr.Lhs].Function &&
+                Calls[instr.Lhs].Arguments.size() == Calls[instr.Lhs].Function->Arity;
+            if (!valid) break;
+
+            for (unsigned argument : Calls[instr.Lhs].Arguments) valid = valid && argument < i;
+            break;
+        }
+        default:
+            valid = instr.Op <= OpCode::Atanh && instr.Lhs < i && (GetArity(instr.Op) < 2 || instr.Rhs < i);
+        }
+
+        if (!valid) throw std::runtime_error("Malformed program");
+    }
+
+    Origins.assign(Instructions.size(), nullptr);
+    SymbolOrigins.assign(Symbols.size(), nullptr);
+    for (size_t i = 0; i < Symbols.size(); i++)
+        SymbolIndices.insert(std::make_pair(Symbols[i], static_cast<unsigned>(i)));
+}
+
+unsigned MathExpressions::Program::Push(
+    MathExpressions::OpCode op,
+    const Parser::IToken* origin,
+    unsigned lhs, unsigned rhs
+) {
+    Instructions.push_back({ op, lhs, rhs });
+    Origins.push_back(origin);
+
+    return static_cast<unsigned>(Instructions.size() - 1);
+}
+
+unsigned MathExpressions::Program::PushConstant(long double value, const Parser::IToken* origin)
+{
+    Constants.push_back(value);
+
+    return Push(OpCode::Constant, origin, static_cast<unsigned>(Constants.size() - 1));
+}
+
+unsigned MathExpressions::Program::PushVariable(const std::string& name, const Parser::IToken* origin)
+{
+    // Every occurence of the same variable shares a single entry in the symbol table
+    auto inserted = SymbolIndices.insert(std::make_pair(name, static_cast<unsigned>(Symbols.size())));
+    if (inserted.second)
+    {
+        Symbols.push_back(name);
+        SymbolOrigins.push_back(origin);
+    }
+
+    return Push(OpCode::Variable, origin, inserted.first->second);
+}
+
+unsigned MathExpressions::Program::PushCall(
+    const MathExpressions::NativeFunction& function,
+    const Parser::IToken* origin,
+    std::vector<unsigned> arguments
+) {
+    if (arguments.size() != function.Arity)
+        throw std::invalid_argument("Native function '" + function.Name + "' is called with wrong number of arguments");
+
+    Calls.push_back({ &function, std::move(arguments) });
+
+    return Push(OpCode::Call, origin, static_cast<unsigned>(Calls.size() - 1));
+}
+
+const std::vector<MathExpressions::Instruction>& MathExpressions::Program::GetInstructions() const
+{
+    return Instructions;
+}
+
+const std::vector<long double>& MathExpressions::Program::GetConstants() const
+{
+    return Constants;
+}
+
+const std::vector<std::string>& MathExpressions::Program::GetSymbols() const
+{
+    return Symbols;
+}
+
+const std::vector<MathExpressions::NativeCall>& MathExpressions::Program::GetCalls() const
+{
+    return Calls;
+}
+
+const Parser::IToken* MathExpressions::Program::GetOrigin(size_t instruction) const
+{
+    return Origins[instruction];
+}
+
+size_t MathExpressions::Program::FindSymbol(const std::string& name) const
+{
+    auto it = SymbolIndices.find(name);
+
+    return it != SymbolIndices.cend() ? it->second : Symbols.size();
+}
+
+size_t MathExpressions::Program::GetMemoryUsage() const
+{
+    size_t usage = sizeof(*this) +
+        Instructions.capacity() * sizeof(Instruction) +
+        Origins.capacity() * sizeof(const Parser::IToken*) +
+        Constants.capacity() * sizeof(long double) +
+        SymbolOrigins.capacity() * sizeof(const Parser::IToken*) +
+        Calls.capacity() * sizeof(NativeCall);
+
+    for (const NativeCall& call : Calls) usage += call.Arguments.capacity() * sizeof(unsigned);
+
+    // Each name is stored twice: in the table and as a key of the index
+    for (const std::string& symbol : Symbols)
+        usage += 2 * (sizeof(std::string) + symbol.capacity()) + sizeof(unsigned) + 2 * sizeof(void*);
+
+    return usage;
+}
+
+void MathExpressions::Program::ResolveSymbols(
+    const MathExpressions::Environment& env,
+    std::vector<long double>& out_values
+) const {
+    size_t missing = TryResolveSymbols(env, out_values);
+    if (missing != Symbols.size()) throw UnresolvedSymbol(SymbolOrigins[missing], Symbols[missing]);
+}
+
+size_t MathExpressions::Program::TryResolveSymbols(
+    const MathExpressions::Environment& env,
+    std::vector<long double>& out_values
+) const {
+    out_values.clear();
+    out_values.reserve(Symbols.size());
+
+    for (size_t i = 0; i < Symbols.size(); i++)
+    {
+        Environment::const_iterator var_it = env.find(Symbols[i]);
+        if (var_it == env.cend()) return i;
+
+        out_values.push_back(var_it->second);
+    }
+
+    return Symbols.size();
+}
+
+// Computes a single instruction. Kept in this file so the evaluation loop below can inline it
+static inline MathExpressions::EvaluationStatus ExecuteInstruction(
+    const MathExpressions::Instruction& instr,
+    const long double* constants,
+    const long double* symbol_values,
+    const MathExpressions::NativeCall* calls,
+    const long double* values,
+    long double& out_value
+) {
+    using MathExpressions::OpCode;
+    using MathExpressions::EvaluationStatus;
+
+    switch (instr.Op)
+    {
+    case OpCode::Constant: out_value = constants[instr.Lhs]; break;
+    case OpCode::Variable: out_value = symbol_values[instr.Lhs]; break;
+    case OpCode::Add: out_value = values[instr.Lhs] + values[instr.Rhs]; break;
+    case OpCode::Sub: out_value = values[instr.Lhs] - values[instr.Rhs]; break;
+    case OpCode::Mul: out_value = values[instr.Lhs] * values[instr.Rhs]; break;
+    case OpCode::Div:
+        if (values[instr.Rhs] == 0) return EvaluationStatus::DivisionByZero;
+        out_value = values[instr.Lhs] / values[instr.Rhs];
+        break;
+    case OpCode::Pow:
+        // Cannot get root from negative numbers
+        if (values[instr.Rhs] < 1.0 && values[instr.Lhs] < 0.0) return EvaluationStatus::NegativeNumberRoot;
+        out_value = powl(values[instr.Lhs], values[instr.Rhs]);
+        break;
+    case OpCode::Log: out_value = log2l(values[instr.Lhs]) / log2l(values[instr.Rhs]); break;
+    case OpCode::Negate: out_value = -values[instr.Lhs]; break;
+    case OpCode::Abs: out_value = fabsl(values[instr.Lhs]); break;
+    case OpCode::LogE: out_value = logl(values[instr.Lhs]); break;
+    case OpCode::Log2: out_value = log2l(values[instr.Lhs]); break;
+    case OpCode::Log10: out_value = log10l(values[instr.Lhs]); break;
+    case OpCode::Exp: out_value = expl(values[instr.Lhs]); break;
+    case OpCode::Sqrt:
+        if (values[instr.Lhs] < 0) return EvaluationStatus::NegativeNumberRoot;
+        out_value = sqrtl(values[instr.Lhs]);
+        break;
+    case OpCode::Sign:
+        out_value = (values[instr.Lhs] == 0) ? 0 : ((values[instr.Lhs] > 0) ? 1 : -1);
+        break;
+    case OpCode::Sin: out_value = sinl(values[instr.Lhs]); break;
+    case OpCode::Cos: out_value = cosl(values[instr.Lhs]); break;
+    case OpCode::Tan: out_value = tanl(values[instr.Lhs]); break;
+    case OpCode::Cot: out_value = 1 / tanl(values[instr.Lhs]); break;
+    case OpCode::Asin: out_value = asinl(values[instr.Lhs]); break;
+    case OpCode::Acos: out_value = acosl(values[instr.Lhs]); break;
+    case OpCode::Atan: out_value = atanl(values[instr.Lhs]); break;
+    case OpCode::Sinh: out_value = sinhl(values[instr.Lhs]); break;
+    case OpCode::Cosh: out_value = coshl(values[instr.Lhs]); break;
+    case OpCode::Tanh: out_value = tanhl(values[instr.Lhs]); break;
+    case OpCode::Asinh: out_value = asinhl(values[instr.Lhs]); break;
+    case OpCode::Acosh: out_value = acoshl(values[instr.Lhs]); break;
+    case OpCode::Atanh: out_value = atanhl(values[instr.Lhs]); break;
+    case OpCode::Call:
+    {
+        const MathExpressions::NativeCall& call = calls[instr.Lhs];
+
+        long double arguments[MathExpressions::NativeFunction::MaxArity];
+        for (size_t k = 0; k < call.Arguments.size(); k++) arguments[k] = values[call.Arguments[k]];
+
+        out_value = call.Function->Scalar(arguments);
+        break;
+    }
+    }
+
+    return EvaluationStatus::Success;
+}
+
+MathExpressions::EvaluationResult MathExpressions::Program::TryEvaluate(const long double* symbol_values) const
+{
+    // Value computed by each instruction. Operands always precede the instruction using them
+    ScratchBuffer<long double, 64> values(Instructions.size());
+
+    for (size_t i = 0; i < Instructions.size(); i++)
+    {
+        EvaluationStatus status = ExecuteInstruction(
+            Instructions[i], Constants.data(), symbol_values, Calls.data(), values.GetData(), values[i]
+        );
+        if (status != EvaluationStatus::Success) return { 0, status, i };
+    }
+
+    return { values[Instructions.size() - 1], EvaluationStatus::Success, Instructions.size() - 1 };
+}
+
+MathExpressions::EvaluationStatus MathExpressions::Program::Execute(
+    size_t instruction,
+    long double* values,
+    const long double* symbol_values
+) const {
+    return ExecuteInstruction(Instructions[instruction], Constants.data(), symbol_values, Calls.data(), values, values[instruction]);
+}
+
+MathExpressions::EvaluationResult MathExpressions::Program::TryEvaluate(const MathExpressions::Environment& env) const
+{
+    std::vector<long double> symbol_values;
+    size_t missing = TryResolveSymbols(env, symbol_values);
+    if (missing != Symbols.size()) return { 0, EvaluationStatus::UnresolvedSymbol, missing };
+
+    return TryEvaluate(symbol_values.data());
+}
+
+void MathExpressions::Program::ThrowError(const MathExpressions::EvaluationResult& result) const
+{
+    switch (result.Status)
+    {
+    case EvaluationStatus::Success: return;
+    case EvaluationStatus::DivisionByZero: throw DivisionByZero(Origins[result.Index]);
+    case EvaluationStatus::NegativeNumberRoot: throw NegativeNumberRoot(Origins[result.Index]);
+    case EvaluationStatus::UnresolvedSymbol: throw UnresolvedSymbol(SymbolOrigins[result.Index], Symbols[result.Index]);
+    case EvaluationStatus::OutOfDomain: throw OutOfDomain(Origins[result.Index]);
+    }
+}
+
+long double MathExpressions::Program::Evaluate(const long double* symbol_values) const
+{
+    if (Instructions.empty()) throw std::runtime_error("Program has no instructions");
+
+    EvaluationResult result = TryEvaluate(symbol_values);
+    ThrowError(result);
+
+    return result.Value;
+}
+
+long double MathExpressions::Program::Evaluate(const MathExpressions::Environment& env) const
+{
+    std::vector<long double> symbol_values;
+    ResolveSymbols(env, symbol_values);
+
+    return Evaluate(symbol_values.data());
+}
+
+MathExpressions::CompiledExpression::CompiledExpression(const std::string& expression)
+    : CompiledExpression(expression, MathExpressions::GetTokenFactories()) {}
+
+MathExpressions::CompiledExpression::CompiledExpression(
+    const std::string& expression,
+    const std::vector<Parser::TokenFactory>& factories
+) : Source(expression)
+{
+    if (Source.empty()) throw std::runtime_error("Empty expression provided");
+
+    Parser::Engine parser;
+
+    // Same steps 'MathExpressions::Evaluate' does, except tokens are built over our own copy
+    // of the expression, so they never outlive the string they point into
+    {
+        MATHEXPRESSIONS_TIME_PHASE(Tokenize);
+        Allocation::PhaseScope allocation_phase(Allocation::Phase::Tokenize);
+        parser.Tokenize(factories, Source, Tokens);
+    }
+    MATHEXPRESSIONS_COUNT(Tokens, Tokens.size());
+    {
+        MATHEXPRESSIONS_TIME_PHASE(Backpatch);
+        Allocation::PhaseScope allocation_phase(Allocation::Phase::Backpatch);
+        parser.Backpatch(Tokens);
+    }
+    {
+        MATHEXPRESSIONS_TIME_PHASE(Parse);
+        Allocation::PhaseScope allocation_phase(Allocation::Phase::Parse);
+        parser.Parse(Tokens, AST);
+    }
+    MATHEXPRESSIONS_COUNT(Nodes, Instrumentation::CountNodes(AST));
+
+    CompileTree();
+}
+
+MathExpressions::CompiledExpression::CompiledExpression(
+    const std::string& expression,
+    const MathExpressions::TreeFactory& factory
+) : Source(expression)
+{
+    if (Source.empty()) throw std::runtime_error("Empty expression provided");
+
+    // Building the tree takes the place of parsing, so it's attributed to the same phase
+    {
+        MATHEXPRESSIONS_TIME_PHASE(Parse);
+        Allocation::PhaseScope allocation_phase(Allocation::Phase::Parse);
+        factory(Source, Tokens, AST);
+    }
+    MATHEXPRESSIONS_COUNT(Tokens, Tokens.size());
+    MATHEXPRESSIONS_COUNT(Nodes, Instrumentation::CountNodes(AST));
+
+    CompileTree();
+}
+
+void MathExpressions::CompiledExpression::CompileTree()
+{
+    auto token = dynamic_cast<const MathExpressions::Token*>(AST.Root ? AST.Root->Value.get() : nullptr);
+    if (!token) throw std::runtime_error("Parser did not return correct token type ('MathExpression::Token')");
+
+    {
+        MATHEXPRESSIONS_TIME_PHASE(Compile);
+        Allocation::PhaseScope allocation_phase(Allocation::Phase::Compile);
+        token->Compile(*AST.Root, Code);
+    }
+    MATHEXPRESSIONS_COUNT(Instructions, Code.GetInstructions().size());
+}
+
+MathExpressions::CompiledExpression::CompiledExpression(
+    const std::string& expression,
+    MathExpressions::Program code
+) : Source(expression), Code(std::move(code))
+{
+    if (Code.GetInstructions().empty()) throw std::runtime_error("Program has no instructions");
+}
+
+const std::string& MathExpressions::CompiledExpression::GetSource() const
+{
+    return Source;
+}
+
+const Tree<Parser::TokenPtr>& MathExpressions::CompiledExpression::GetTree() const
+{
+    return AST;
+}
+
+const MathExpressions::Program& MathExpressions::CompiledExpression::GetProgram() const
+{
+    return Code;
+}
+
+size_t MathExpressions::CompiledExpression::GetMemoryUsage() const
+{
+    // Token types aren't known here, so every token is assumed to be as large as the largest one (pairs).
+    // Every token has a tree node, and both live in 'make_shared' blocks with a control block attached
+    const size_t control_block = 2 * sizeof(void*) + 2 * sizeof(long);
+    const size_t per_token = sizeof(MathExpressions::DistinctPair) + control_block +
+        sizeof(Tree<Parser::TokenPtr>::Node) + control_block + sizeof(Tree<Parser::TokenPtr>::NodePtr);
+
+    return sizeof(*this) - sizeof(Code) + Code.GetMemoryUsage() +
+        Source.capacity() +
+        Tokens.capacity() * sizeof(Parser::TokenPtr) +
+        Tokens.size() * per_token;
+}
+
+void MathExpressions::CompiledExpression::Stringify(std::string& out_expression) const
+{
+    if (!AST.Root)
+    {
+        out_expression += Source;
+        return;
+    }
+
+    AST.Root->Value->Stringify(AST, *AST.Root, out_expression);
+}
+
+void MathExpressions::CompiledExpression::Stringify(std::string& out_expression, MathExpressions::PrintMode mode) const
+{
+    if (!AST.Root)
+    {
+        out_expression += Source;
+        return;
+    }
+
+    Print(AST, out_expression, mode);
+}
+
+long double MathExpressions::CompiledExpression::Evaluate(const MathExpressions::Environment& env) const
+{
+    MATHEXPRESSIONS_TIME_PHASE(Evaluate);
+    MATHEXPRESSIONS_COUNT(Evaluations, 1);
+    Allocation::PhaseScope allocation_phase(Allocation::Phase::Evaluate);
+    return Code.Evaluate(env);
+}
+
+MathExpressions::EvaluationResult MathExpressions::CompiledExpression::TryEvaluate(const MathExpressions::Environment& env) const
+{
+    MATHEXPRESSIONS_TIME_PHASE(Evaluate);
+    MATHEXPRESSIONS_COUNT(Evaluations, 1);
+    Allocation::PhaseScope allocation_phase(Allocation::Phase::Evaluate);
+    return Code.TryEvaluate(env);
+}
+
+MathExpressions::CompiledExpressionPtr MathExpressions::Compile(const std::string& expression)
+{
+    return std::make_shared<const CompiledExpression>(expression);
+}
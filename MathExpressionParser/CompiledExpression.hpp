@@ -0,0 +1,336 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "MathExpressions.hpp"
+#include "NativeFunctions.hpp"
+#include "Printing.hpp"
+
+namespace MathExpressions
+{
+	/* Operations a compiled expression is made of
+	Numeric values of these are written to expression archives,
+	so new operations should only ever be added to the end
+	*/
+	enum class OpCode : unsigned char
+	{
+		// Leaves. 'Lhs' is an index into the constant pool or the symbol table
+		Constant, Variable,
+
+		// Binary operations
+		Add, Sub, Mul, Div, Pow, Log,
+
+		// Unary operations
+		Negate, Abs,
+		LogE, Log2, Log10, Exp, Sqrt, Sign,
+		Sin, Cos, Tan, Cot, Asin, Acos, Atan,
+		Sinh, Cosh, Tanh, Asinh, Acosh, Atanh,
+
+		// Call of a native function. 'Lhs' is an index into the call table of the program
+		Call
+	};
+
+	/// <summary>
+	/// Returns how many operands an operation consumes.
+	/// Arguments of calls are listed by the call table rather than by the instruction, so calls report none
+	/// </summary>
+	size_t GetArity(OpCode op);
+
+	/// <summary>
+	/// Returns the name an operation is written with as a function in expressions (e.g. "sin" or "log"),
+	/// or null if it isn't written as a function. Calls are named by their function (see 'NativeCall')
+	/// </summary>
+	const char* GetFunctionName(OpCode op);
+
+	/* Single step of a compiled expression
+	Operands refer to instructions that precede this one in the program,
+	so executing instructions in order always has operands ready
+	*/
+	struct Instruction
+	{
+		OpCode Op;
+		unsigned Lhs, Rhs;
+	};
+
+	// Native function call a 'Call' instruction performs
+	struct NativeCall
+	{
+		const NativeFunction* Function;
+		// Instructions that compute the arguments. They precede the call, same as operands do
+		std::vector<unsigned> Arguments;
+	};
+
+	// Outcome of an evaluation that doesn't throw
+	enum class EvaluationStatus : unsigned char
+	{
+		Success,
+		DivisionByZero,
+		NegativeNumberRoot,
+		UnresolvedSymbol,
+		/* Argument lies outside of function's domain (e.g. 'acos(2)', 'log(x)' of a negative 'x').
+		Only reported by batch evaluation, which flags such rows so they can be told apart from the rest.
+		Scalar evaluation (and evaluators built on it, such as incremental and parallel ones)
+		follows the C library instead and returns NaN with 'Success' status, so the same expression
+		reports a different status depending on the API it's evaluated with
+		*/
+		OutOfDomain
+	};
+
+	struct EvaluationResult
+	{
+		// Result of calculation. Unspecified if evaluation failed
+		long double Value;
+		EvaluationStatus Status;
+		// Index of the instruction that failed, or of the missing symbol if status is 'UnresolvedSymbol'
+		size_t Index;
+	};
+
+	/* Flat, post-ordered form of an AST
+	Each instruction computes one value; the last instruction is the result of the whole program.
+	Once built, a program is only ever read, so a single instance can be evaluated
+	from any number of threads at once
+	*/
+	class Program
+	{
+	protected:
+		std::vector<Instruction> Instructions;
+		// Token each instruction has been compiled from. Used to report errors
+		std::vector<const Parser::IToken*> Origins;
+		std::vector<long double> Constants;
+		std::vector<std::string> Symbols;
+		std::vector<NativeCall> Calls;
+		// Token that first referenced each symbol
+		std::vector<const Parser::IToken*> SymbolOrigins;
+		std::unordered_map<std::string, unsigned> SymbolIndices;
+	public:
+		Program() = default;
+
+		/// <summary>
+		/// Builds program directly out of it's parts (e.g. when it's loaded from a file) instead of compiling it.
+		/// Instructions are checked to only reference preceding instructions and existing constants, symbols and calls,
+		/// otherwise std::runtime_error is thrown. Origins of such program are null
+		/// </summary>
+		Program(
+			std::vector<Instruction> instructions,
+			std::vector<long double> constants,
+			std::vector<std::string> symbols,
+			std::vector<NativeCall> calls = std::vector<NativeCall>()
+		);
+
+		/// <summary>
+		/// Appends an instruction to the program
+		/// </summary>
+		/// <param name="op">- operation to perform</param>
+		/// <param name="origin">- token this instruction is compiled from</param>
+		/// <param name="lhs">- index of the first operand</param>
+		/// <param name="rhs">- index of the second operand, if operation is binary</param>
+		/// <returns>Index of the new instruction</returns>
+		unsigned Push(OpCode op, const Parser::IToken* origin, unsigned lhs = 0, unsigned rhs = 0);
+
+		/// <summary>
+		/// Adds value to the constant pool and appends an instruction that loads it
+		/// </summary>
+		unsigned PushConstant(long double value, const Parser::IToken* origin);
+
+		/// <summary>
+		/// Registers symbol in the symbol table (once per name) and appends an instruction that loads it
+		/// </summary>
+		unsigned PushVariable(const std::string& name, const Parser::IToken* origin);
+
+		/// <summary>
+		/// Adds a call to the call table and appends an instruction that performs it.
+		/// Throws std::invalid_argument if number of arguments doesn't match function's arity
+		/// </summary>
+		/// <param name="arguments">- indices of instructions that compute the arguments</param>
+		unsigned PushCall(const NativeFunction& function, const Parser::IToken* origin, std::vector<unsigned> arguments);
+
+		const std::vector<Instruction>& GetInstructions() const;
+		const std::vector<long double>& GetConstants() const;
+		const std::vector<std::string>& GetSymbols() const;
+		const std::vector<NativeCall>& GetCalls() const;
+
+		/// <summary>
+		/// Returns the token instruction at specified index has been compiled from.
+		/// May be null if program wasn't compiled from tokens
+		/// </summary>
+		const Parser::IToken* GetOrigin(size_t instruction) const;
+
+		/// <summary>
+		/// Looks up the index of a symbol in the symbol table
+		/// </summary>
+		/// <returns>Index of the symbol, or size of the symbol table if program doesn't reference it</returns>
+		size_t FindSymbol(const std::string& name) const;
+
+		/// <summary>
+		/// Approximates how many bytes this program occupies in memory
+		/// </summary>
+		size_t GetMemoryUsage() const;
+
+		/// <summary>
+		/// Gathers values of all symbols in the symbol table from the environment.
+		/// Throws UnresolvedSymbol if any of them is missing
+		/// </summary>
+		/// <param name="env">- registry of variable values</param>
+		/// <param name="out_values">- values ordered as in the symbol table</param>
+		void ResolveSymbols(const Environment& env, std::vector<long double>& out_values) const;
+
+		/// <summary>
+		/// Same as 'ResolveSymbols', but doesn't throw
+		/// </summary>
+		/// <returns>Index of the first missing symbol, or size of the symbol table if all symbols were found</returns>
+		size_t TryResolveSymbols(const Environment& env, std::vector<long double>& out_values) const;
+
+		/// <summary>
+		/// Runs the program, reporting errors through the result instead of throwing.
+		/// Performs exactly the same checks as 'Evaluate', so it costs no more when nothing fails.
+		/// Program must not be empty
+		/// </summary>
+		/// <param name="symbol_values">- values of the symbols, ordered as in the symbol table</param>
+		EvaluationResult TryEvaluate(const long double* symbol_values) const;
+
+		/// <summary>
+		/// Resolves symbols in provided environment and runs the program without throwing
+		/// </summary>
+		EvaluationResult TryEvaluate(const Environment& env) const;
+
+		/// <summary>
+		/// Computes a single instruction out of values of instructions preceding it.
+		/// Meant for evaluators that don't run the whole program at once
+		/// </summary>
+		/// <param name="instruction">- index of the instruction</param>
+		/// <param name="values">- values of instructions. Result is written at the instruction's own index</param>
+		/// <param name="symbol_values">- values of the symbols, ordered as in the symbol table</param>
+		/// <returns>Success, or the error instruction has ran into, in which case it's value is left untouched</returns>
+		EvaluationStatus Execute(size_t instruction, long double* values, const long double* symbol_values) const;
+
+		/// <summary>
+		/// Throws the exception that describes a failed result (e.g. DivisionByZero with the offending token).
+		/// Does nothing if evaluation has succeeded
+		/// </summary>
+		void ThrowError(const EvaluationResult& result) const;
+
+		/// <summary>
+		/// Runs the program
+		/// </summary>
+		/// <param name="symbol_values">- values of the symbols, ordered as in the symbol table</param>
+		/// <returns>Result of the last instruction</returns>
+		long double Evaluate(const long double* symbol_values) const;
+
+		/// <summary>
+		/// Resolves symbols in provided environment and runs the program
+		/// </summary>
+		long double Evaluate(const Environment& env) const;
+	};
+
+	// Builds the AST of an expression over it's own copy of the source, appending every token it creates to 'out_tokens'
+	using TreeFactory = std::function<void(
+		const std::string& source, std::vector<Parser::TokenPtr>& out_tokens, Tree<Parser::TokenPtr>& out_tree
+	)>;
+
+	/* Expression that has been tokenized, parsed and compiled exactly once
+	Owns the source string, tokens and the AST, so tokens referenced by errors
+	and by the program stay valid for as long as the expression lives.
+	Nothing is modified after construction, therefore a single instance can be shared
+	between threads (e.g. via 'CompiledExpressionPtr') and evaluated concurrently without locks
+	*/
+	class CompiledExpression
+	{
+	protected:
+		// Tokens keep iterators into the source, so neither can be moved once tokenized
+		const std::string Source;
+		std::vector<Parser::TokenPtr> Tokens;
+		Tree<Parser::TokenPtr> AST;
+		Program Code;
+
+		// Compiles the AST into 'Code'
+		void CompileTree();
+	public:
+		/// <summary>
+		/// Tokenizes, parses and compiles provided expression
+		/// </summary>
+		CompiledExpression(const std::string& expression);
+
+		/// <summary>
+		/// Tokenizes expression with provided factories (see 'GetTokenFactories'), then parses and compiles it
+		/// </summary>
+		CompiledExpression(const std::string& expression, const std::vector<Parser::TokenFactory>& factories);
+
+		/// <summary>
+		/// Builds the AST with provided factory instead of tokenizing and parsing the expression, then compiles it.
+		/// Factory is given the expression's own copy of the source, which tokens have to point into
+		/// </summary>
+		CompiledExpression(const std::string& expression, const TreeFactory& factory);
+
+		/// <summary>
+		/// Wraps an already compiled program without parsing the source.
+		/// Such expression has no tokens nor an AST, so 'Stringify' outputs the source as is
+		/// </summary>
+		CompiledExpression(const std::string& expression, Program code);
+
+		CompiledExpression(const CompiledExpression&) = delete;
+		CompiledExpression& operator=(const CompiledExpression&) = delete;
+
+		const std::string& GetSource() const;
+		const Tree<Parser::TokenPtr>& GetTree() const;
+		const Program& GetProgram() const;
+
+		/// <summary>
+		/// Approximates how many bytes this expression occupies in memory, including tokens and the AST
+		/// </summary>
+		size_t GetMemoryUsage() const;
+
+		/// <summary>
+		/// Converts the AST back to a string, or copies the source if expression has no AST
+		/// </summary>
+		void Stringify(std::string& out_expression) const;
+
+		/// <summary>
+		/// Appends the AST laid out as specified to the buffer (see 'Print'), or the source if expression has no AST
+		/// </summary>
+		void Stringify(std::string& out_expression, PrintMode mode) const;
+
+		/// <summary>
+		/// Evaluates compiled expression in provided environment
+		/// </summary>
+		long double Evaluate(const Environment& env) const;
+
+		/// <summary>
+		/// Evaluates compiled expression in provided environment, reporting errors through the result instead of throwing
+		/// </summary>
+		EvaluationResult TryEvaluate(const Environment& env) const;
+	};
+
+	using CompiledExpressionPtr = std::shared_ptr<const CompiledExpression>;
+
+	/// <summary>
+	/// Shorthand that compiles an expression into a shareable instance
+	/// </summary>
+	CompiledExpressionPtr Compile(const std::string& expression);
+}
@@ -24,6 +24,8 @@ SOFTWARE.
 
 #pragma once
 
+#include <string>
+#include <vector>
 #include "Parser/Exceptions.hpp"
 #include "Parser/Parser.hpp"
 
@@ -149,11 +151,24 @@ public:
 	}
 };
 
+// Thrown when argument of a function lies outside of it's domain
+class OutOfDomain : public ParsingError
+{
+public:
+	OutOfDomain(const Parser::IToken* token) : ParsingError(token) {};
+
+	virtual const char* what() const noexcept override
+	{
+		return "Argument is outside of function's domain";
+	}
+};
+
 // Thrown when a value of a variable was not found in the environment table
 class UnresolvedSymbol : public ParsingError
 {
 protected:
-	const std::string& Symbol;
+	// Stored by value, as the name is usually a temporary that doesn't outlive the throw
+	std::string Symbol;
 public:
 	UnresolvedSymbol(const Parser::IToken* token, const std::string& symbol) : ParsingError(token), Symbol(symbol) {};
 
@@ -177,4 +192,24 @@ public:
 	{
 		return "Param delimiter outside of any function";
 	}
+};
+
+// Thrown when formulas of a sheet depend on each other in a cycle
+class CircularDependency : public ExpressionError
+{
+protected:
+	// Names of formulas that form the cycle, each depending on the next one, and the last one on the first
+	std::vector<std::string> Cycle;
+public:
+	CircularDependency(const std::vector<std::string>& cycle) : Cycle(cycle) {};
+
+	virtual const char* what() const noexcept override
+	{
+		return "Formulas depend on each other in a cycle";
+	}
+
+	const std::vector<std::string>& GetCycle() const
+	{
+		return Cycle;
+	}
 };
\ No newline at end of file
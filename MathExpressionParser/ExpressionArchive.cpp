@@ -0,0 +1,284 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "ExpressionArchive.hpp"
+
+// Every field has a fixed size, so layout of the file only depends on byte order,
+// which is recorded in the header
+struct ArchiveHeader
+{
+    char Magic[4];
+    uint32_t Version;
+    uint32_t ByteOrderMark;
+    uint32_t LongDoubleSize;
+    uint64_t ExpressionCount;
+    uint64_t PayloadSize;
+    uint64_t Checksum;
+    uint64_t Reserved[3];
+};
+
+// Location of a single expression's parts. Offsets are relative to the end of the header
+struct ArchiveRecord
+{
+    uint64_t SourceOffset, SourceLength;
+    uint64_t InstructionOffset, InstructionCount;
+    uint64_t ConstantOffset, ConstantCount;
+    uint64_t SymbolOffset, SymbolCount;
+};
+
+struct ArchiveInstruction
+{
+    uint32_t Op, Lhs, Rhs;
+};
+
+// Reference to a string in the blob
+struct ArchiveString
+{
+    uint64_t Offset, Length;
+};
+
+static const char ArchiveMagic[4] = { 'M', 'E', 'P', 'A' };
+static const uint32_t ArchiveByteOrderMark = 0x01020304;
+
+// 64-bit FNV-1a hash of the payload
+static uint64_t ArchiveChecksum(const char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+// Appends raw bytes of an array to a section
+template<typename T>
+static void AppendRaw(std::string& section, const T* values, size_t count)
+{
+    section.append(reinterpret_cast<const char*>(values), count * sizeof(T));
+}
+
+// Pads section with zeroes until it's size is a multiple of 'alignment'
+static void Align(std::string& section, size_t alignment)
+{
+    section.resize((section.size() + alignment - 1) / alignment * alignment, '\0');
+}
+
+void MathExpressions::ExpressionArchive::Write(
+    const std::string& path,
+    const std::vector<MathExpressions::CompiledExpressionPtr>& expressions
+) {
+    std::vector<ArchiveRecord> records;
+    records.reserve(expressions.size());
+
+    // Sections are gathered separately and laid out one after another once their sizes are known
+    std::string constants, instructions, symbols, strings;
+
+    for (const CompiledExpressionPtr& expression : expressions)
+    {
+        const Program& code = expression->GetProgram();
+        ArchiveRecord record;
+
+        // Calls refer to functions registered in this process, which a file can't hold
+        if (!code.GetCalls().empty())
+            throw std::invalid_argument("Expression '" + expression->GetSource() + "' calls native functions and can't be archived");
+
+        record.SourceOffset = strings.size();
+        record.SourceLength = expression->GetSource().size();
+        strings.append(expression->GetSource());
+
+        record.ConstantOffset = constants.size();
+        record.ConstantCount = code.GetConstants().size();
+        AppendRaw(constants, code.GetConstants().data(), code.GetConstants().size());
+
+        record.InstructionOffset = instructions.size();
+        record.InstructionCount = code.GetInstructions().size();
+        for (const Instruction& instr : code.GetInstructions())
+        {
+            ArchiveInstruction stored = { static_cast<uint32_t>(instr.Op), instr.Lhs, instr.Rhs };
+            AppendRaw(instructions, &stored, 1);
+        }
+
+        record.SymbolOffset = symbols.size();
+        record.SymbolCount = code.GetSymbols().size();
+        for (const std::string& symbol : code.GetSymbols())
+        {
+            ArchiveString stored = { strings.size(), symbol.size() };
+            AppendRaw(symbols, &stored, 1);
+            strings.append(symbol);
+        }
+
+        records.push_back(record);
+    }
+
+    // Rebase offsets from their sections to the start of the payload.
+    // Records come first, and 'long double' constants right after them, since they're the most aligned
+    const uint64_t constants_start = records.size() * sizeof(ArchiveRecord);
+    Align(constants, sizeof(ArchiveString));
+    const uint64_t symbols_start = constants_start + constants.size();
+    const uint64_t instructions_start = symbols_start + symbols.size();
+    const uint64_t strings_start = instructions_start + instructions.size();
+
+    for (ArchiveRecord& record : records)
+    {
+        record.SourceOffset += strings_start;
+        record.ConstantOffset += constants_start;
+        record.InstructionOffset += instructions_start;
+        record.SymbolOffset += symbols_start;
+    }
+
+    for (size_t offset = 0; offset < symbols.size(); offset += sizeof(ArchiveString))
+    {
+        ArchiveString stored;
+        std::memcpy(&stored, &symbols[offset], sizeof(stored));
+        stored.Offset += strings_start;
+        std::memcpy(&symbols[offset], &stored, sizeof(stored));
+    }
+
+    std::string payload;
+    AppendRaw(payload, records.data(), records.size());
+    payload.append(constants).append(symbols).append(instructions).append(strings);
+
+    ArchiveHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, ArchiveMagic, sizeof(ArchiveMagic));
+    header.Version = Version;
+    header.ByteOrderMark = ArchiveByteOrderMark;
+    header.LongDoubleSize = sizeof(long double);
+    header.ExpressionCount = records.size();
+    header.PayloadSize = payload.size();
+    header.Checksum = ArchiveChecksum(payload.data(), payload.size());
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(payload.data(), payload.size());
+    if (!file) throw std::runtime_error("Cannot write expression archive '" + path + "'");
+}
+
+MathExpressions::ExpressionArchive::ExpressionArchive(
+    const std::string& path
+) : File(path), Payload(nullptr), PayloadSize(0), ExpressionCount(0)
+{
+    ArchiveHeader header;
+    if (File.GetSize() < sizeof(header)) throw std::runtime_error("'" + path + "' is not an expression archive");
+    std::memcpy(&header, File.GetData(), sizeof(header));
+
+    if (std::memcmp(header.Magic, ArchiveMagic, sizeof(ArchiveMagic)) != 0)
+        throw std::runtime_error("'" + path + "' is not an expression archive");
+    if (header.Version != Version)
+        throw std::runtime_error("Expression archive '" + path + "' has unsupported version");
+    if (header.ByteOrderMark != ArchiveByteOrderMark || header.LongDoubleSize != sizeof(long double))
+        throw std::runtime_error("Expression archive '" + path + "' was written on an incompatible platform");
+    if (header.PayloadSize != File.GetSize() - sizeof(header) ||
+        header.ExpressionCount > header.PayloadSize / sizeof(ArchiveRecord))
+        throw std::runtime_error("Expression archive '" + path + "' is truncated");
+
+    Payload = File.GetData() + sizeof(header);
+    PayloadSize = static_cast<size_t>(header.PayloadSize);
+    ExpressionCount = static_cast<size_t>(header.ExpressionCount);
+
+    if (ArchiveChecksum(Payload, PayloadSize) != header.Checksum)
+        throw std::runtime_error("Expression archive '" + path + "' is corrupted");
+}
+
+size_t MathExpressions::ExpressionArchive::GetExpressionCount() const
+{
+    return ExpressionCount;
+}
+
+// Checks that 'count' elements of 'size' bytes starting at 'offset' lie within the payload
+static bool InPayload(uint64_t offset, uint64_t count, size_t size, size_t payload_size)
+{
+    return offset <= payload_size && count <= (payload_size - offset) / size;
+}
+
+static ArchiveRecord ReadRecord(const char* payload, size_t payload_size, size_t count, size_t index)
+{
+    if (index >= count) throw std::out_of_range("Expression index is out of range");
+
+    ArchiveRecord record;
+    std::memcpy(&record, payload + index * sizeof(ArchiveRecord), sizeof(record));
+
+    if (!InPayload(record.SourceOffset, record.SourceLength, 1, payload_size) ||
+        !InPayload(record.InstructionOffset, record.InstructionCount, sizeof(ArchiveInstruction), payload_size) ||
+        !InPayload(record.ConstantOffset, record.ConstantCount, sizeof(long double), payload_size) ||
+        !InPayload(record.SymbolOffset, record.SymbolCount, sizeof(ArchiveString), payload_size))
+        throw std::runtime_error("Malformed expression archive record");
+
+    return record;
+}
+
+std::string MathExpressions::ExpressionArchive::GetSource(size_t index) const
+{
+    ArchiveRecord record = ReadRecord(Payload, PayloadSize, ExpressionCount, index);
+
+    return std::string(Payload + record.SourceOffset, static_cast<size_t>(record.SourceLength));
+}
+
+MathExpressions::CompiledExpressionPtr MathExpressions::ExpressionArchive::Load(size_t index) const
+{
+    ArchiveRecord record = ReadRecord(Payload, PayloadSize, ExpressionCount, index);
+
+    // Mapped data isn't guaranteed to be aligned for these types, so everything is copied bytewise
+    std::vector<long double> constants(static_cast<size_t>(record.ConstantCount));
+    if (!constants.empty())
+        std::memcpy(constants.data(), Payload + record.ConstantOffset, constants.size() * sizeof(long double));
+
+    std::vector<Instruction> instructions;
+    instructions.reserve(static_cast<size_t>(record.InstructionCount));
+    for (uint64_t i = 0; i < record.InstructionCount; i++)
+    {
+        ArchiveInstruction stored;
+        std::memcpy(&stored, Payload + record.InstructionOffset + i * sizeof(stored), sizeof(stored));
+        // Calls refer to functions by address, so archives never contain them, nor anything past them
+        if (stored.Op >= static_cast<unsigned>(OpCode::Call))
+            throw std::runtime_error("Malformed expression archive record");
+
+        instructions.push_back({ static_cast<OpCode>(stored.Op), stored.Lhs, stored.Rhs });
+    }
+
+    std::vector<std::string> symbols;
+    symbols.reserve(static_cast<size_t>(record.SymbolCount));
+    for (uint64_t i = 0; i < record.SymbolCount; i++)
+    {
+        ArchiveString stored;
+        std::memcpy(&stored, Payload + record.SymbolOffset + i * sizeof(stored), sizeof(stored));
+        if (!InPayload(stored.Offset, stored.Length, 1, PayloadSize))
+            throw std::runtime_error("Malformed expression archive record");
+
+        symbols.push_back(std::string(Payload + stored.Offset, static_cast<size_t>(stored.Length)));
+    }
+
+    // Program checks itself that instructions only reference what's there
+    return std::make_shared<const CompiledExpression>(
+        std::string(Payload + record.SourceOffset, static_cast<size_t>(record.SourceLength)),
+        Program(std::move(instructions), std::move(constants), std::move(symbols))
+    );
+}
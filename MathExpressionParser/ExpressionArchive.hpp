@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CompiledExpression.hpp"
+#include "MappedFile.hpp"
+
+namespace MathExpressions
+{
+	/* File of compiled expressions that can be loaded without tokenizing or parsing them again
+	Consists of a fixed-size header (magic, format version, byte order, size of 'long double',
+	expression count and a checksum of everything past the header), followed by a table of
+	fixed-size records and the sections they point into: constant pools, instructions,
+	symbol tables and a blob with sources and symbol names.
+	The file is memory-mapped and validated once when opened, after which each expression
+	is built straight from the mapped arrays
+	*/
+	class ExpressionArchive
+	{
+	protected:
+		MappedFile File;
+		const char* Payload;
+		size_t PayloadSize;
+		size_t ExpressionCount;
+	public:
+		// Bumped whenever layout of the file or meaning of opcodes changes
+		static const unsigned Version = 1;
+
+		/// <summary>
+		/// Serializes programs and sources of provided expressions into a file.
+		/// Throws std::runtime_error if file cannot be written, and std::invalid_argument if an expression calls native functions
+		/// </summary>
+		static void Write(const std::string& path, const std::vector<CompiledExpressionPtr>& expressions);
+
+		/// <summary>
+		/// Maps the file and checks it's header and checksum.
+		/// Throws std::runtime_error if file is not an archive, has a different version,
+		/// was written on an incompatible platform or is corrupted
+		/// </summary>
+		ExpressionArchive(const std::string& path);
+
+		size_t GetExpressionCount() const;
+
+		/// <summary>
+		/// Returns source of the expression at specified index
+		/// </summary>
+		std::string GetSource(size_t index) const;
+
+		/// <summary>
+		/// Builds compiled expression at specified index out of the mapped file
+		/// </summary>
+		CompiledExpressionPtr Load(size_t index) const;
+	};
+}
@@ -0,0 +1,218 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cctype>
+#include <functional>
+#include "ExpressionCache.hpp"
+
+// Characters names and numbers are made of
+static bool IsWordCharacter(char ch)
+{
+    return std::isalnum(static_cast<unsigned char>(ch)) || ch == '.';
+}
+
+std::string MathExpressions::NormalizeExpression(const std::string& expression)
+{
+    std::string normalized;
+    normalized.reserve(expression.size());
+
+    // Whether blanks have been skipped since the last written character
+    bool skipped_blank = false;
+    for (char ch : expression)
+    {
+        // Same characters whitespace factory consumes
+        if (ch == ' ' || ch == '\t')
+        {
+            skipped_blank = true;
+            continue;
+        }
+
+        // Blank between two names or numbers keeps them from merging into one token,
+        // and blank after a name keeps it from becoming a function call, so those stay
+        if (skipped_blank && !normalized.empty() && IsWordCharacter(normalized.back()) &&
+            (IsWordCharacter(ch) || ch == '('))
+            normalized.push_back(' ');
+
+        skipped_blank = false;
+        normalized.push_back(ch);
+    }
+
+    return normalized;
+}
+
+MathExpressions::ExpressionCache::ExpressionCache(
+    size_t byte_budget,
+    size_t shard_count
+) : Hits(0), Misses(0), Evictions(0)
+{
+    if (shard_count == 0) shard_count = 1;
+
+    for (size_t i = 0; i < shard_count; i++)
+    {
+        Shards.push_back(std::unique_ptr<Shard>(new Shard()));
+        Shards.back()->Bytes = 0;
+    }
+
+    ShardBudget = byte_budget / shard_count;
+}
+
+MathExpressions::ExpressionCache::Shard& MathExpressions::ExpressionCache::GetShard(const std::string& key) const
+{
+    return *Shards[std::hash<std::string>()(key) % Shards.size()];
+}
+
+void MathExpressions::ExpressionCache::Evict(Shard& shard)
+{
+    std::list<Entry>::iterator it = shard.Recency.end();
+    while (shard.Bytes > ShardBudget && it != shard.Recency.begin())
+    {
+        --it;
+
+        // Expressions that are still compiling have someone waiting on them
+        if (it->Bytes == 0) continue;
+
+        shard.Bytes -= it->Bytes;
+        shard.Lookup.erase(it->Key);
+        it = shard.Recency.erase(it);
+        ++Evictions;
+    }
+}
+
+MathExpressions::CompiledExpressionPtr MathExpressions::ExpressionCache::Get(const std::string& expression)
+{
+    std::string key = NormalizeExpression(expression);
+    Shard& shard = GetShard(key);
+
+    std::promise<CompiledExpressionPtr> promise;
+    // Set when another thread has already requested this expression
+    std::shared_future<CompiledExpressionPtr> requested;
+    {
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+
+        auto it = shard.Lookup.find(key);
+        if (it != shard.Lookup.end())
+        {
+            // Mark as most recently used
+            shard.Recency.splice(shard.Recency.begin(), shard.Recency, it->second);
+            ++Hits;
+
+            // Copied under the lock, since the entry may be evicted right after it's released
+            requested = it->second->Value;
+        }
+        else
+        {
+            ++Misses;
+
+            // Publish the future before compiling, so concurrent misses wait for this thread
+            shard.Recency.push_front({ key, promise.get_future().share(), 0 });
+            shard.Lookup.insert(std::make_pair(key, shard.Recency.begin()));
+        }
+    }
+
+    // Either ready, or another thread is compiling this expression right now
+    if (requested.valid()) return requested.get();
+
+    CompiledExpressionPtr compiled;
+    try
+    {
+        // Normalized text is only the key. Source and error positions refer to what the caller has written
+        compiled = Compile(expression);
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+
+        // Entries being compiled are never evicted or cleared, so this one is still ours
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        auto it = shard.Lookup.find(key);
+        shard.Recency.erase(it->second);
+        shard.Lookup.erase(it);
+
+        throw;
+    }
+
+    promise.set_value(compiled);
+
+    std::lock_guard<std::mutex> lock(shard.Mutex);
+    auto it = shard.Lookup.find(key);
+    it->second->Bytes = compiled->GetMemoryUsage() + sizeof(Entry) + 2 * key.capacity();
+    shard.Bytes += it->second->Bytes;
+    Evict(shard);
+
+    return compiled;
+}
+
+void MathExpressions::ExpressionCache::Insert(const MathExpressions::CompiledExpressionPtr& compiled)
+{
+    std::string key = NormalizeExpression(compiled->GetSource());
+    Shard& shard = GetShard(key);
+
+    std::lock_guard<std::mutex> lock(shard.Mutex);
+    if (shard.Lookup.count(key)) return;
+
+    std::promise<CompiledExpressionPtr> promise;
+    promise.set_value(compiled);
+
+    shard.Recency.push_front({ key, promise.get_future().share(), 0 });
+    shard.Lookup.insert(std::make_pair(key, shard.Recency.begin()));
+
+    shard.Recency.front().Bytes = compiled->GetMemoryUsage() + sizeof(Entry) + 2 * key.capacity();
+    shard.Bytes += shard.Recency.front().Bytes;
+    Evict(shard);
+}
+
+void MathExpressions::ExpressionCache::Clear()
+{
+    for (const std::unique_ptr<Shard>& shard : Shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->Mutex);
+
+        for (std::list<Entry>::iterator it = shard->Recency.begin(); it != shard->Recency.end();)
+        {
+            if (it->Bytes == 0)
+            {
+                ++it;
+                continue;
+            }
+
+            shard->Bytes -= it->Bytes;
+            shard->Lookup.erase(it->Key);
+            it = shard->Recency.erase(it);
+        }
+    }
+}
+
+MathExpressions::ExpressionCacheStats MathExpressions::ExpressionCache::GetStats() const
+{
+    ExpressionCacheStats stats = { Hits.load(), Misses.load(), Evictions.load(), 0, 0 };
+
+    for (const std::unique_ptr<Shard>& shard : Shards)
+    {
+        std::lock_guard<std::mutex> lock(shard->Mutex);
+        stats.Entries += shard->Lookup.size();
+        stats.Bytes += shard->Bytes;
+    }
+
+    return stats;
+}
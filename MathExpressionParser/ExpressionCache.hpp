@@ -0,0 +1,121 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+namespace MathExpressions
+{
+	/// <summary>
+	/// Strips whitespace that doesn't affect how expression is tokenized.
+	/// Blanks between two alphanumeric characters (or before a bracket following a name)
+	/// are collapsed into a single space, every other blank is removed
+	/// </summary>
+	/// <returns>Normalized expression</returns>
+	std::string NormalizeExpression(const std::string& expression);
+
+	// Snapshot of cache counters
+	struct ExpressionCacheStats
+	{
+		size_t Hits, Misses, Evictions;
+		// Number of expressions currently stored and their approximate size
+		size_t Entries, Bytes;
+	};
+
+	/* Thread-safe cache of compiled expressions keyed on normalized source text
+	Keys are spread over several shards, each guarded by it's own lock and evicting
+	least recently used expressions once it's share of the byte budget is exceeded.
+	When several threads miss on the same expression at once, only the first one compiles it,
+	the rest wait for it's result
+	*/
+	class ExpressionCache
+	{
+	protected:
+		struct Entry
+		{
+			std::string Key;
+			std::shared_future<CompiledExpressionPtr> Value;
+			// Zero while the expression is still being compiled
+			size_t Bytes;
+		};
+
+		struct Shard
+		{
+			std::mutex Mutex;
+			// Most recently used entries are at the front
+			std::list<Entry> Recency;
+			std::unordered_map<std::string, std::list<Entry>::iterator> Lookup;
+			size_t Bytes;
+		};
+
+		std::vector<std::unique_ptr<Shard>> Shards;
+		size_t ShardBudget;
+		std::atomic<size_t> Hits, Misses, Evictions;
+
+		Shard& GetShard(const std::string& key) const;
+
+		/// <summary>
+		/// Drops least recently used compiled entries until shard fits into it's budget.
+		/// Shard must be locked by the caller
+		/// </summary>
+		void Evict(Shard& shard);
+	public:
+		/// <param name="byte_budget">- approximate amount of memory cached expressions may occupy</param>
+		/// <param name="shard_count">- number of independently locked partitions</param>
+		ExpressionCache(size_t byte_budget, size_t shard_count = 16);
+
+		ExpressionCache(const ExpressionCache&) = delete;
+		ExpressionCache& operator=(const ExpressionCache&) = delete;
+
+		/// <summary>
+		/// Returns compiled expression for provided source, compiling it on a miss.
+		/// Expression is compiled exactly as written, so on a hit the source of the result may differ from the one provided by whitespace.
+		/// Errors thrown while compiling are rethrown to every caller waiting on that expression,
+		/// and the failed expression isn't cached
+		/// </summary>
+		CompiledExpressionPtr Get(const std::string& expression);
+
+		/// <summary>
+		/// Stores an expression compiled elsewhere (e.g. loaded from an 'ExpressionArchive') under it's normalized source.
+		/// Does nothing if that source is already cached
+		/// </summary>
+		void Insert(const CompiledExpressionPtr& compiled);
+
+		/// <summary>
+		/// Drops every compiled expression. Expressions being compiled at the moment are kept
+		/// </summary>
+		void Clear();
+
+		ExpressionCacheStats GetStats() const;
+	};
+}
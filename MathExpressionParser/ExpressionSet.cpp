@@ -0,0 +1,387 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include "ExpressionSet.hpp"
+
+// Identity of an instruction, whose operands have already been merged
+struct InstructionKey
+{
+    MathExpressions::OpCode Op;
+    unsigned Lhs, Rhs;
+
+    bool operator==(const InstructionKey& other) const
+    {
+        return Op == other.Op && Lhs == other.Lhs && Rhs == other.Rhs;
+    }
+};
+
+struct InstructionKeyHash
+{
+    size_t operator()(const InstructionKey& key) const
+    {
+        size_t hash = static_cast<size_t>(key.Op);
+        hash = hash * 1000003 ^ key.Lhs;
+        hash = hash * 1000003 ^ key.Rhs;
+
+        return hash;
+    }
+};
+
+MathExpressions::ExpressionSet::ExpressionSet(const std::vector<MathExpressions::CompiledExpressionPtr>& expressions)
+    : Expressions(expressions), Mappings(expressions.size())
+{
+    std::vector<Instruction> instructions;
+    std::vector<long double> constants;
+    std::vector<std::string> symbols;
+    std::vector<NativeCall> calls;
+
+    std::unordered_map<InstructionKey, unsigned, InstructionKeyHash> instruction_indices;
+    // Zeroes compare equal regardless of their sign, but dividing by them doesn't, so each sign gets a map
+    std::unordered_map<long double, unsigned> constant_indices[2];
+    std::unordered_map<std::string, unsigned> symbol_indices;
+    // Calls of pure functions with the same merged arguments. Impure calls are never merged
+    std::map<std::pair<const NativeFunction*, std::vector<unsigned>>, unsigned> call_indices;
+    // Last expression that has used each merged instruction, plus one
+    std::vector<size_t> last_user;
+
+    for (size_t e = 0; e < Expressions.size(); e++)
+    {
+        if (!Expressions[e]) throw std::invalid_argument("Expression set can't contain null expressions");
+
+        const Program& program = Expressions[e]->GetProgram();
+        const std::vector<Instruction>& source = program.GetInstructions();
+        std::vector<unsigned>& mapping = Mappings[e];
+        mapping.resize(source.size());
+
+        for (size_t i = 0; i < source.size(); i++)
+        {
+            const Instruction& instr = source[i];
+            InstructionKey key = { instr.Op, 0, 0 };
+
+            switch (instr.Op)
+            {
+            case OpCode::Constant:
+            {
+                long double value = program.GetConstants()[instr.Lhs];
+                auto inserted = constant_indices[std::signbit(value)].insert(
+                    std::make_pair(value, static_cast<unsigned>(constants.size()))
+                );
+                if (inserted.second) constants.push_back(value);
+
+                key.Lhs = inserted.first->second;
+                break;
+            }
+            case OpCode::Variable:
+            {
+                const std::string& name = program.GetSymbols()[instr.Lhs];
+                auto inserted = symbol_indices.insert(std::make_pair(name, static_cast<unsigned>(symbols.size())));
+                if (inserted.second) symbols.push_back(name);
+
+                key.Lhs = inserted.first->second;
+                break;
+            }
+            case OpCode::Call:
+            {
+                NativeCall call = program.GetCalls()[instr.Lhs];
+                for (unsigned& argument : call.Arguments) argument = mapping[argument];
+
+                key.Lhs = static_cast<unsigned>(calls.size());
+                if (call.Function->Pure)
+                    key.Lhs = call_indices.insert(std::make_pair(std::make_pair(call.Function, call.Arguments), key.Lhs)).first->second;
+
+                if (key.Lhs == calls.size()) calls.push_back(std::move(call));
+                break;
+            }
+            default:
+                key.Lhs = mapping[instr.Lhs];
+                if (GetArity(instr.Op) == 2) key.Rhs = mapping[instr.Rhs];
+
+                // Both orders of commutative operations compute exactly the same value
+                if ((instr.Op == OpCode::Add || instr.Op == OpCode::Mul) && key.Lhs > key.Rhs)
+                    std::swap(key.Lhs, key.Rhs);
+            }
+
+            auto inserted = instruction_indices.insert(std::make_pair(key, static_cast<unsigned>(instructions.size())));
+            if (inserted.second)
+            {
+                instructions.push_back({ key.Op, key.Lhs, key.Rhs });
+                UseCounts.push_back(0);
+                last_user.push_back(0);
+            }
+
+            const unsigned merged = inserted.first->second;
+            mapping[i] = merged;
+
+            if (last_user[merged] != e + 1)
+            {
+                last_user[merged] = e + 1;
+                UseCounts[merged]++;
+            }
+        }
+    }
+
+    if (!instructions.empty()) Merged = Program(std::move(instructions), std::move(constants), std::move(symbols), std::move(calls));
+}
+
+size_t MathExpressions::ExpressionSet::GetExpressionCount() const
+{
+    return Expressions.size();
+}
+
+const MathExpressions::CompiledExpressionPtr& MathExpressions::ExpressionSet::GetExpression(size_t index) const
+{
+    return Expressions[index];
+}
+
+const MathExpressions::Program& MathExpressions::ExpressionSet::GetProgram() const
+{
+    return Merged;
+}
+
+void MathExpressions::ExpressionSet::TryEvaluate(
+    const MathExpressions::Environment& env,
+    std::vector<MathExpressions::EvaluationResult>& out_results
+) const {
+    const std::vector<Instruction>& instructions = Merged.GetInstructions();
+    const std::vector<std::string>& symbols = Merged.GetSymbols();
+    const unsigned succeeded = UINT_MAX;
+
+    // Missing symbols only fail expressions that reference them, so they're resolved one by one
+    std::vector<long double> symbol_values(symbols.size(), 0);
+    std::vector<bool> resolved(symbols.size(), false);
+    for (size_t i = 0; i < symbols.size(); i++)
+    {
+        Environment::const_iterator var_it = env.find(symbols[i]);
+        if (var_it == env.cend()) continue;
+
+        symbol_values[i] = var_it->second;
+        resolved[i] = true;
+    }
+
+    std::vector<long double> values(instructions.size());
+    // Instruction each failed instruction's error originates from, and the error of every failed instruction
+    std::vector<unsigned> failed_at(instructions.size(), succeeded);
+    std::vector<EvaluationStatus> statuses(instructions.size(), EvaluationStatus::Success);
+
+    for (unsigned i = 0; i < instructions.size(); i++)
+    {
+        const Instruction& instr = instructions[i];
+        const size_t arity = GetArity(instr.Op);
+
+        if (instr.Op == OpCode::Variable && !resolved[instr.Lhs])
+        {
+            failed_at[i] = i;
+            statuses[i] = EvaluationStatus::UnresolvedSymbol;
+            continue;
+        }
+
+        // Failure of an operand fails every instruction that uses it
+        unsigned failed = succeeded;
+        if (arity >= 1) failed = failed_at[instr.Lhs];
+        if (failed == succeeded && arity == 2) failed = failed_at[instr.Rhs];
+        if (instr.Op == OpCode::Call)
+            for (unsigned argument : Merged.GetCalls()[instr.Lhs].Arguments)
+                if (failed == succeeded) failed = failed_at[argument];
+        if (failed != succeeded)
+        {
+            failed_at[i] = failed;
+            continue;
+        }
+
+        EvaluationStatus status = Merged.Execute(i, values.data(), symbol_values.data());
+        if (status != EvaluationStatus::Success)
+        {
+            failed_at[i] = i;
+            statuses[i] = status;
+        }
+    }
+
+    out_results.clear();
+    out_results.reserve(Expressions.size());
+    for (size_t e = 0; e < Expressions.size(); e++)
+    {
+        const Program& program = Expressions[e]->GetProgram();
+        const std::vector<unsigned>& mapping = Mappings[e];
+        const unsigned root = mapping.back();
+
+        if (failed_at[root] == succeeded)
+        {
+            out_results.push_back({ values[root], EvaluationStatus::Success, mapping.size() - 1 });
+            continue;
+        }
+
+        // Error the root has inherited may come from any of it's failed operands, as merging reorders them.
+        // So the error is found again in the expression's own order, same as it's program would: symbols are resolved
+        // before anything is computed, and otherwise the first instruction that fails on it's own is the one reported
+        size_t missing = program.GetSymbols().size();
+        for (size_t i = 0; i < mapping.size(); i++)
+            if (program.GetInstructions()[i].Op == OpCode::Variable && !resolved[instructions[mapping[i]].Lhs])
+                missing = std::min<size_t>(missing, program.GetInstructions()[i].Lhs);
+
+        if (missing != program.GetSymbols().size())
+        {
+            out_results.push_back({ 0, EvaluationStatus::UnresolvedSymbol, missing });
+            continue;
+        }
+
+        size_t first = 0;
+        while (failed_at[mapping[first]] != mapping[first]) first++;
+
+        out_results.push_back({ 0, statuses[mapping[first]], first });
+    }
+}
+
+void MathExpressions::ExpressionSet::Evaluate(
+    const MathExpressions::Environment& env,
+    std::vector<long double>& out_values
+) const {
+    std::vector<EvaluationResult> results;
+    TryEvaluate(env, results);
+
+    out_values.clear();
+    out_values.reserve(results.size());
+    for (size_t e = 0; e < results.size(); e++)
+    {
+        Expressions[e]->GetProgram().ThrowError(results[e]);
+        out_values.push_back(results[e].Value);
+    }
+}
+
+void MathExpressions::ExpressionSet::Describe(size_t instruction, std::string& out_text) const
+{
+    const Instruction& instr = Merged.GetInstructions()[instruction];
+
+    switch (instr.Op)
+    {
+    case OpCode::Constant:
+    {
+        std::ostringstream stream;
+        stream.precision(std::numeric_limits<long double>::digits10);
+        stream << Merged.GetConstants()[instr.Lhs];
+        out_text += stream.str();
+        return;
+    }
+    case OpCode::Variable:
+        out_text += Merged.GetSymbols()[instr.Lhs];
+        return;
+    case OpCode::Add: case OpCode::Sub: case OpCode::Mul: case OpCode::Div: case OpCode::Pow:
+        out_text.push_back('(');
+        Describe(instr.Lhs, out_text);
+        out_text.push_back("+-*/^"[static_cast<size_t>(instr.Op) - static_cast<size_t>(OpCode::Add)]);
+        Describe(instr.Rhs, out_text);
+        out_text.push_back(')');
+        return;
+    case OpCode::Log:
+        out_text += GetFunctionName(instr.Op);
+        out_text.push_back('(');
+        Describe(instr.Lhs, out_text);
+        out_text += ", ";
+        Describe(instr.Rhs, out_text);
+        out_text.push_back(')');
+        return;
+    case OpCode::Negate:
+        out_text.push_back('-');
+        Describe(instr.Lhs, out_text);
+        return;
+    case OpCode::Abs:
+        out_text.push_back('|');
+        Describe(instr.Lhs, out_text);
+        out_text.push_back('|');
+        return;
+    case OpCode::Call:
+    {
+        const NativeCall& call = Merged.GetCalls()[instr.Lhs];
+        out_text += call.Function->Name;
+        out_text.push_back('(');
+        for (size_t k = 0; k < call.Arguments.size(); k++)
+        {
+            if (k) out_text += ", ";
+            Describe(call.Arguments[k], out_text);
+        }
+        out_text.push_back(')');
+        return;
+    }
+    default:
+        out_text += GetFunctionName(instr.Op);
+        out_text.push_back('(');
+        Describe(instr.Lhs, out_text);
+        out_text.push_back(')');
+    }
+}
+
+MathExpressions::SharingReport MathExpressions::ExpressionSet::GetReport(size_t top_count) const
+{
+    const std::vector<Instruction>& instructions = Merged.GetInstructions();
+
+    SharingReport report;
+    report.ExpressionCount = Expressions.size();
+    report.OriginalInstructions = 0;
+    for (const std::vector<unsigned>& mapping : Mappings) report.OriginalInstructions += mapping.size();
+    report.MergedInstructions = instructions.size();
+    report.SharedInstructions = 0;
+
+    // Size of every subexpression, were it computed on it's own
+    std::vector<size_t> sizes(instructions.size());
+    std::vector<size_t> candidates;
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        const Instruction& instr = instructions[i];
+        const size_t arity = GetArity(instr.Op);
+
+        sizes[i] = 1;
+        if (arity >= 1) sizes[i] += sizes[instr.Lhs];
+        if (arity == 2) sizes[i] += sizes[instr.Rhs];
+        if (instr.Op == OpCode::Call)
+            for (unsigned argument : Merged.GetCalls()[instr.Lhs].Arguments) sizes[i] += sizes[argument];
+
+        if (UseCounts[i] < 2) continue;
+
+        report.SharedInstructions++;
+        // Sharing a lone constant or variable isn't worth listing
+        if (arity || instr.Op == OpCode::Call) candidates.push_back(i);
+    }
+
+    // Each expression beyond the first one that contains a subexpression saves computing it again
+    auto saving = [&](size_t i) { return (UseCounts[i] - 1) * sizes[i]; };
+    std::sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) { return saving(a) > saving(b); });
+    if (candidates.size() > top_count) candidates.resize(top_count);
+
+    for (size_t i : candidates)
+    {
+        SharedSubexpression shared = { std::string(), UseCounts[i], sizes[i] };
+        Describe(i, shared.Text);
+        report.MostShared.push_back(std::move(shared));
+    }
+
+    return report;
+}
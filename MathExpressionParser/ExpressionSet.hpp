@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+namespace MathExpressions
+{
+	// Subexpression that appears in several expressions of a set
+	struct SharedSubexpression
+	{
+		std::string Text;
+		// Number of expressions that contain it
+		size_t ExpressionCount;
+		// Number of instructions it takes to compute it on it's own
+		size_t Size;
+	};
+
+	// How much work merging expressions of a set has saved
+	struct SharingReport
+	{
+		size_t ExpressionCount;
+		// Instructions of all expressions taken separately
+		size_t OriginalInstructions;
+		// Instructions left after identical subexpressions have been merged
+		size_t MergedInstructions;
+		// Merged instructions that are used by more than one expression
+		size_t SharedInstructions;
+		// Shared subexpressions that save the most instructions, most saving first
+		std::vector<SharedSubexpression> MostShared;
+	};
+
+	/* Set of expressions merged into a single program, where every distinct subexpression
+	(including constants and variables) is computed exactly once. Subexpressions are identified structurally,
+	with operands of commutative operations ('+' and '*') ordered, so 'exp(-r*t)' in one expression
+	and 'exp(-t*r)' in another share the same instructions. Calls of native functions are only shared if the function is pure.
+	Immutable once built, so it can be evaluated from many threads at once
+	*/
+	class ExpressionSet
+	{
+	protected:
+		std::vector<CompiledExpressionPtr> Expressions;
+		Program Merged;
+		// Instruction of the merged program each instruction of each expression has been merged into
+		std::vector<std::vector<unsigned>> Mappings;
+		// Number of expressions that use each merged instruction
+		std::vector<size_t> UseCounts;
+
+		// Writes an instruction of the merged program as an infix expression
+		void Describe(size_t instruction, std::string& out_text) const;
+	public:
+		ExpressionSet(const std::vector<CompiledExpressionPtr>& expressions);
+
+		ExpressionSet(const ExpressionSet&) = delete;
+		ExpressionSet& operator=(const ExpressionSet&) = delete;
+
+		size_t GetExpressionCount() const;
+		const CompiledExpressionPtr& GetExpression(size_t index) const;
+		const Program& GetProgram() const;
+
+		/// <summary>
+		/// Evaluates every expression at once without throwing. An error only fails expressions that contain
+		/// the failing subexpression (or the missing symbol). Each result is exactly what expression's own program
+		/// would report, so it can be passed to it's 'ThrowError'
+		/// </summary>
+		/// <param name="env">- registry of variable values</param>
+		/// <param name="out_results">- result of each expression, in order the set has been built in</param>
+		void TryEvaluate(const Environment& env, std::vector<EvaluationResult>& out_results) const;
+
+		/// <summary>
+		/// Evaluates every expression at once. Throws error of the first expression that has failed
+		/// </summary>
+		void Evaluate(const Environment& env, std::vector<long double>& out_values) const;
+
+		/// <summary>
+		/// Describes how much sharing has been achieved
+		/// </summary>
+		/// <param name="top_count">- maximum number of shared subexpressions to list</param>
+		SharingReport GetReport(size_t top_count = 10) const;
+	};
+}
@@ -0,0 +1,243 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "Printing.hpp"
+#include "StaticExpression.hpp"
+
+/* Expressions written as C++ code
+Operators and functions below combine variables, numbers and each other into a tree of the same nodes
+'StaticExpression' parses literals into, e.g.
+
+	using namespace MathExpressions::Static;
+	Symbol x = { 0, "x" }, y = { 1, "y" };
+	auto f = x * sin(y) + 2;
+
+Type of the tree is the expression itself, so evaluating it is inlined code without virtual calls or instructions to dispatch.
+The same tree converts to a 'CompiledExpression' (see 'ToCompiledExpression') that the rest of the library works with.
+C++ has no operator that binds like '^' does in expressions, so exponentiation is written as 'pow'
+*/
+namespace MathExpressions
+{
+	namespace Static
+	{
+		// Number captured from C++ code
+		struct Constant
+		{
+			long double Value;
+
+			long double Evaluate(const long double*, EvaluationStatus&) const { return Value; }
+			// Negative numbers are written with a minus, which binds like a negation
+			size_t GetPriority() const { return std::signbit(Value) ? 1 : std::numeric_limits<size_t>::max(); }
+			void Write(std::string& out_text) const { PrintNumber(Value, out_text); }
+
+			TreeBuilder::NodePtr Build(TreeBuilder& builder) const
+			{
+				std::string text;
+				PrintNumber(Value, text);
+				if (!std::signbit(Value)) return builder.Open<MathExpressions::Number>(text.size());
+
+				TreeBuilder::NodePtr negation = builder.Open<MathExpressions::Sub>(1);
+				negation->Children.push_back(builder.Open<MathExpressions::Number>(text.size() - 1));
+				return negation;
+			}
+		};
+
+		/* Named variable. Evaluation reads it's value from the array of variables at 'Index',
+		while it's written as 'Name', which must outlive the expression tree.
+		Name has to read back as a single variable (see 'IsVariableName'), otherwise std::invalid_argument is thrown
+		*/
+		struct Symbol
+		{
+			size_t Index;
+			const char* Name;
+
+			Symbol(size_t index, const char* name) : Index(index), Name(name)
+			{
+				if (!IsVariableName(name)) throw std::invalid_argument("'" + std::string(name) + "' can't be read back as a variable");
+			}
+
+			long double Evaluate(const long double* variables, EvaluationStatus&) const { return variables[Index]; }
+			size_t GetPriority() const { return std::numeric_limits<size_t>::max(); }
+			void Write(std::string& out_text) const { out_text.append(Name); }
+			TreeBuilder::NodePtr Build(TreeBuilder& builder) const { return builder.Open<MathExpressions::Variable>(std::strlen(Name)); }
+		};
+
+		template<class T>
+		struct IsNode : std::false_type {};
+		template<OpCode Op, class Lhs, class Rhs>
+		struct IsNode<Binary<Op, Lhs, Rhs>> : std::true_type {};
+		template<OpCode Op, class Operand>
+		struct IsNode<Unary<Op, Operand>> : std::true_type {};
+		template<class Text, size_t Begin>
+		struct IsNode<Number<Text, Begin>> : std::true_type {};
+		template<class Text, size_t Begin>
+		struct IsNode<Variable<Text, Begin>> : std::true_type {};
+		template<> struct IsNode<Pi> : std::true_type {};
+		template<> struct IsNode<Euler> : std::true_type {};
+		template<> struct IsNode<Constant> : std::true_type {};
+		template<> struct IsNode<Symbol> : std::true_type {};
+
+		// Nodes are used as they are, while arithmetic values become constants
+		template<class T, bool Node = IsNode<T>::value>
+		struct AsNode
+		{
+			typedef T Type;
+			static const T& Convert(const T& node) { return node; }
+		};
+
+		template<class T>
+		struct AsNode<T, false>
+		{
+			typedef Constant Type;
+			static Constant Convert(T value) { return { static_cast<long double>(value) }; }
+		};
+
+		// Operators only apply when at least one operand is a node, and the other one is either a node or a number
+		template<class Lhs, class Rhs>
+		struct AreOperands : std::integral_constant<bool,
+			(IsNode<Lhs>::value || IsNode<Rhs>::value) &&
+			(IsNode<Lhs>::value || std::is_arithmetic<Lhs>::value) &&
+			(IsNode<Rhs>::value || std::is_arithmetic<Rhs>::value)
+		> {};
+
+		template<OpCode Op, class Lhs, class Rhs>
+		using BinaryOf = typename std::enable_if<
+			AreOperands<Lhs, Rhs>::value,
+			Binary<Op, typename AsNode<Lhs>::Type, typename AsNode<Rhs>::Type>
+		>::type;
+
+		template<OpCode Op, class Operand>
+		using UnaryOf = typename std::enable_if<IsNode<Operand>::value, Unary<Op, Operand>>::type;
+
+		template<OpCode Op, class Lhs, class Rhs>
+		BinaryOf<Op, Lhs, Rhs> MakeBinary(const Lhs& lhs, const Rhs& rhs)
+		{
+			return { AsNode<Lhs>::Convert(lhs), AsNode<Rhs>::Convert(rhs) };
+		}
+
+		template<class Lhs, class Rhs>
+		BinaryOf<OpCode::Add, Lhs, Rhs> operator+(const Lhs& lhs, const Rhs& rhs) { return MakeBinary<OpCode::Add>(lhs, rhs); }
+		template<class Lhs, class Rhs>
+		BinaryOf<OpCode::Sub, Lhs, Rhs> operator-(const Lhs& lhs, const Rhs& rhs) { return MakeBinary<OpCode::Sub>(lhs, rhs); }
+		template<class Lhs, class Rhs>
+		BinaryOf<OpCode::Mul, Lhs, Rhs> operator*(const Lhs& lhs, const Rhs& rhs) { return MakeBinary<OpCode::Mul>(lhs, rhs); }
+		template<class Lhs, class Rhs>
+		BinaryOf<OpCode::Div, Lhs, Rhs> operator/(const Lhs& lhs, const Rhs& rhs) { return MakeBinary<OpCode::Div>(lhs, rhs); }
+		template<class Lhs, class Rhs>
+		BinaryOf<OpCode::Pow, Lhs, Rhs> pow(const Lhs& lhs, const Rhs& rhs) { return MakeBinary<OpCode::Pow>(lhs, rhs); }
+
+		/// <summary>
+		/// Logarithm of 'value' to 'base', same as 'log(value, base)' in expressions
+		/// </summary>
+		template<class Lhs, class Rhs>
+		BinaryOf<OpCode::Log, Lhs, Rhs> log(const Lhs& value, const Rhs& base) { return MakeBinary<OpCode::Log>(value, base); }
+
+		template<class Operand>
+		UnaryOf<OpCode::Negate, Operand> operator-(const Operand& operand) { return { operand }; }
+
+		// Functions are named as they're written in expressions, except for the absolute value
+#define MATHEXPRESSIONS_STATIC_FUNCTION(Name, Op) \
+		template<class Operand> \
+		UnaryOf<OpCode::Op, Operand> Name(const Operand& operand) { return { operand }; }
+
+		MATHEXPRESSIONS_STATIC_FUNCTION(abs, Abs)
+		MATHEXPRESSIONS_STATIC_FUNCTION(ln, LogE)
+		MATHEXPRESSIONS_STATIC_FUNCTION(log2, Log2)
+		MATHEXPRESSIONS_STATIC_FUNCTION(log10, Log10)
+		MATHEXPRESSIONS_STATIC_FUNCTION(exp, Exp)
+		MATHEXPRESSIONS_STATIC_FUNCTION(sqrt, Sqrt)
+		MATHEXPRESSIONS_STATIC_FUNCTION(sign, Sign)
+		MATHEXPRESSIONS_STATIC_FUNCTION(sin, Sin)
+		MATHEXPRESSIONS_STATIC_FUNCTION(cos, Cos)
+		MATHEXPRESSIONS_STATIC_FUNCTION(tan, Tan)
+		MATHEXPRESSIONS_STATIC_FUNCTION(cot, Cot)
+		MATHEXPRESSIONS_STATIC_FUNCTION(asin, Asin)
+		MATHEXPRESSIONS_STATIC_FUNCTION(acos, Acos)
+		MATHEXPRESSIONS_STATIC_FUNCTION(atan, Atan)
+		MATHEXPRESSIONS_STATIC_FUNCTION(sinh, Sinh)
+		MATHEXPRESSIONS_STATIC_FUNCTION(cosh, Cosh)
+		MATHEXPRESSIONS_STATIC_FUNCTION(tanh, Tanh)
+		MATHEXPRESSIONS_STATIC_FUNCTION(asinh, Asinh)
+		MATHEXPRESSIONS_STATIC_FUNCTION(acosh, Acosh)
+		MATHEXPRESSIONS_STATIC_FUNCTION(atanh, Atanh)
+
+#undef MATHEXPRESSIONS_STATIC_FUNCTION
+
+		/// <summary>
+		/// Evaluates an expression tree, reporting errors through the result instead of throwing.
+		/// Result's index is always 0, as the tree has no instructions
+		/// </summary>
+		/// <param name="variables">- values of variables, indexed by 'Symbol::Index'</param>
+		template<class Node>
+		typename std::enable_if<IsNode<Node>::value, EvaluationResult>::type TryEvaluate(const Node& node, const long double* variables)
+		{
+			EvaluationStatus status = EvaluationStatus::Success;
+			long double value = node.Evaluate(variables, status);
+
+			return { value, status, 0 };
+		}
+
+		/// <summary>
+		/// Evaluates an expression tree. Throws std::runtime_error if evaluation fails
+		/// </summary>
+		/// <param name="variables">- values of variables, indexed by 'Symbol::Index'</param>
+		template<class Node>
+		typename std::enable_if<IsNode<Node>::value, long double>::type Evaluate(const Node& node, const long double* variables)
+		{
+			EvaluationResult result = TryEvaluate(node, variables);
+			ThrowError(result);
+
+			return result.Value;
+		}
+
+		/// <summary>
+		/// Converts an expression tree into a compiled expression without parsing anything.
+		/// It's source is the tree written as text, and it's AST is built straight out of the nodes over that text,
+		/// so it has the same AST and program as the text compiled at runtime, and can be printed, hashed and checked like any other
+		/// </summary>
+		template<class Node>
+		typename std::enable_if<IsNode<Node>::value, CompiledExpressionPtr>::type ToCompiledExpression(const Node& node)
+		{
+			std::string text;
+			node.Write(text);
+
+			TreeFactory factory = [&node](
+				const std::string& source, std::vector<Parser::TokenPtr>& out_tokens, Tree<Parser::TokenPtr>& out_tree
+			) {
+				TreeBuilder builder(source, out_tokens);
+				out_tree.Root = node.Build(builder);
+			};
+			return std::make_shared<const CompiledExpression>(text, factory);
+		}
+	}
+}
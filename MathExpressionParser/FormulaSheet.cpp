@@ -0,0 +1,368 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include "Exceptions.hpp"
+#include "FormulaSheet.hpp"
+
+// Holds threads until all of them have reached it. Reusable
+class LevelBarrier
+{
+    std::mutex Mutex;
+    std::condition_variable Released;
+    const size_t Count;
+    size_t Waiting, Generation;
+    // Whether anything has failed by the time the last thread arrived
+    bool Aborted;
+public:
+    LevelBarrier(size_t count) : Count(count), Waiting(0), Generation(0), Aborted(false) {}
+
+    // Waits for all threads, then tells each of them the same thing: whether 'failed' was set when the last one arrived.
+    // Threads deciding on their own could disagree, leaving some of them waiting on threads that have already left
+    bool Wait(const std::atomic<bool>& failed)
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        size_t generation = Generation;
+
+        if (++Waiting == Count)
+        {
+            Waiting = 0;
+            Aborted = failed.load(std::memory_order_relaxed);
+            Generation++;
+            Released.notify_all();
+            return Aborted;
+        }
+
+        // Nobody can flip the next generation before this thread arrives there, so 'Aborted' is still ours
+        Released.wait(lock, [&]() { return Generation != generation; });
+        return Aborted;
+    }
+};
+
+MathExpressions::FormulaSheet::FormulaSheet() : Ordered(true), Evaluated(false) {}
+
+void MathExpressions::FormulaSheet::Set(const std::string& name, const std::string& expression)
+{
+    Set(name, MathExpressions::Compile(expression));
+}
+
+void MathExpressions::FormulaSheet::Set(const std::string& name, MathExpressions::CompiledExpressionPtr expression)
+{
+    if (!expression) throw std::invalid_argument("Formula has no expression");
+
+    auto inserted = Indices.insert(std::make_pair(name, Formulas.size()));
+    if (inserted.second) Formulas.push_back({ name, std::move(expression), {} });
+    else Formulas[inserted.first->second].Expression = std::move(expression);
+
+    Ordered = false;
+    Evaluated = false;
+}
+
+bool MathExpressions::FormulaSheet::Remove(const std::string& name)
+{
+    auto it = Indices.find(name);
+    if (it == Indices.end()) return false;
+
+    // Last formula takes the place of the removed one
+    size_t index = it->second;
+    Indices.erase(it);
+    if (index != Formulas.size() - 1)
+    {
+        Formulas[index] = std::move(Formulas.back());
+        Indices[Formulas[index].Name] = index;
+    }
+    Formulas.pop_back();
+
+    Ordered = false;
+    Evaluated = false;
+    return true;
+}
+
+MathExpressions::CompiledExpressionPtr MathExpressions::FormulaSheet::Get(const std::string& name) const
+{
+    auto it = Indices.find(name);
+
+    return it != Indices.cend() ? Formulas[it->second].Expression : CompiledExpressionPtr();
+}
+
+size_t MathExpressions::FormulaSheet::GetFormulaCount() const
+{
+    return Formulas.size();
+}
+
+void MathExpressions::FormulaSheet::Order()
+{
+    if (Ordered) return;
+
+    // How many of each formula's own dependencies haven't been placed yet
+    std::vector<size_t> pending(Formulas.size());
+    Dependents.assign(Formulas.size(), std::vector<size_t>());
+    InputDependents.clear();
+
+    for (size_t i = 0; i < Formulas.size(); i++)
+    {
+        Formula& formula = Formulas[i];
+        formula.Dependencies.clear();
+
+        for (const std::string& symbol : formula.Expression->GetProgram().GetSymbols())
+        {
+            auto it = Indices.find(symbol);
+            if (it == Indices.end())
+            {
+                InputDependents[symbol].push_back(i);
+                continue;
+            }
+
+            formula.Dependencies.push_back(it->second);
+            Dependents[it->second].push_back(i);
+        }
+
+        pending[i] = formula.Dependencies.size();
+    }
+
+    // Kahn's algorithm, one level at a time
+    Levels.clear();
+    std::vector<size_t> level;
+    for (size_t i = 0; i < Formulas.size(); i++)
+        if (!pending[i]) level.push_back(i);
+
+    size_t placed = 0;
+    while (!level.empty())
+    {
+        placed += level.size();
+
+        std::vector<size_t> next;
+        for (size_t formula : level)
+            for (size_t dependent : Dependents[formula])
+                if (!--pending[dependent]) next.push_back(dependent);
+
+        Levels.push_back(std::move(level));
+        level = std::move(next);
+    }
+
+    if (placed != Formulas.size())
+    {
+        /* Every formula that couldn't be placed has a dependency that couldn't be placed either,
+        so following such dependencies from any of them eventually comes back to a formula already visited
+        */
+        const size_t unvisited = std::numeric_limits<size_t>::max();
+        std::vector<size_t> visited_at(Formulas.size(), unvisited);
+        std::vector<size_t> path;
+
+        size_t cur = std::find_if(pending.begin(), pending.end(), [](size_t count) { return count != 0; }) - pending.begin();
+        while (visited_at[cur] == unvisited)
+        {
+            visited_at[cur] = path.size();
+            path.push_back(cur);
+
+            for (size_t dependency : Formulas[cur].Dependencies)
+            {
+                if (!pending[dependency]) continue;
+
+                cur = dependency;
+                break;
+            }
+        }
+
+        std::vector<std::string> cycle;
+        for (size_t i = visited_at[cur]; i < path.size(); i++) cycle.push_back(Formulas[path[i]].Name);
+
+        Levels.clear();
+        throw CircularDependency(cycle);
+    }
+
+    Ranks.resize(Formulas.size());
+    size_t rank = 0;
+    for (const std::vector<size_t>& level : Levels)
+        for (size_t formula : level) Ranks[formula] = rank++;
+
+    Ordered = true;
+}
+
+std::vector<std::vector<std::string>> MathExpressions::FormulaSheet::GetLevels()
+{
+    Order();
+
+    std::vector<std::vector<std::string>> levels;
+    for (const std::vector<size_t>& level : Levels)
+    {
+        levels.emplace_back();
+        for (size_t formula : level) levels.back().push_back(Formulas[formula].Name);
+    }
+
+    return levels;
+}
+
+void MathExpressions::FormulaSheet::Evaluate(MathExpressions::Environment& store, size_t thread_count)
+{
+    Order();
+    Evaluated = false;
+
+    /* Every formula gets a slot in the store before evaluation begins. Nothing is inserted afterwards,
+    so threads can look up inputs and write results to distinct slots without locking.
+    Formulas only read slots of preceding levels, which the barrier between levels publishes
+    */
+    std::vector<long double*> slots(Formulas.size());
+    for (size_t i = 0; i < Formulas.size(); i++)
+        slots[i] = &store.insert(std::make_pair(Formulas[i].Name, 0.0L)).first->second;
+
+    size_t widest = 0;
+    for (const std::vector<size_t>& level : Levels) widest = std::max(widest, level.size());
+
+    if (!thread_count) thread_count = std::max(1u, std::thread::hardware_concurrency());
+    thread_count = std::min(thread_count, widest);
+
+    if (thread_count <= 1)
+    {
+        for (const std::vector<size_t>& level : Levels)
+            for (size_t formula : level) *slots[formula] = Formulas[formula].Expression->Evaluate(store);
+
+        Evaluated = true;
+        return;
+    }
+
+    // Each level is handed out formula by formula through it's own cursor
+    std::unique_ptr<std::atomic<size_t>[]> cursors(new std::atomic<size_t>[Levels.size()]);
+    for (size_t i = 0; i < Levels.size(); i++) cursors[i].store(0, std::memory_order_relaxed);
+
+    LevelBarrier barrier(thread_count);
+    std::atomic<bool> failed(false);
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&]() {
+        for (size_t level = 0; level < Levels.size(); level++)
+        {
+            const std::vector<size_t>& formulas = Levels[level];
+
+            while (!failed.load(std::memory_order_relaxed))
+            {
+                size_t i = cursors[level].fetch_add(1, std::memory_order_relaxed);
+                if (i >= formulas.size()) break;
+
+                try
+                {
+                    *slots[formulas[i]] = Formulas[formulas[i]].Expression->Evaluate(store);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error) error = std::current_exception();
+                    failed.store(true, std::memory_order_relaxed);
+                }
+            }
+
+            if (barrier.Wait(failed)) return;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < thread_count; i++) workers.emplace_back(work);
+    work();
+    for (std::thread& worker : workers) worker.join();
+
+    if (error) std::rethrow_exception(error);
+
+    Evaluated = true;
+}
+
+std::vector<std::string> MathExpressions::FormulaSheet::Recalculate(
+    MathExpressions::Environment& store,
+    const MathExpressions::Environment& changes
+) {
+    // Values of formulas are results, overwriting one would leave it's dependents computed from the old value
+    for (const Environment::value_type& change : changes)
+        if (Indices.count(change.first))
+            throw std::invalid_argument("'" + change.first + "' is a formula, only inputs can be changed");
+
+    for (const Environment::value_type& change : changes) store[change.first] = change.second;
+
+    std::vector<std::string> changed;
+    if (!Evaluated)
+    {
+        // Nothing to compare against, so every formula is considered changed
+        Evaluate(store, 1);
+        changed.resize(Formulas.size());
+        for (size_t i = 0; i < Formulas.size(); i++) changed[Ranks[i]] = Formulas[i].Name;
+
+        return changed;
+    }
+
+    // Min-heap of ranks of formulas to recompute, so formulas are recomputed in evaluation order
+    std::vector<size_t> queue;
+    std::vector<bool> queued(Formulas.size(), false);
+    auto enqueue = [&](const std::vector<size_t>& formulas) {
+        for (size_t formula : formulas)
+        {
+            if (queued[formula]) continue;
+
+            queued[formula] = true;
+            queue.push_back(Ranks[formula]);
+            std::push_heap(queue.begin(), queue.end(), std::greater<size_t>());
+        }
+    };
+
+    for (const Environment::value_type& change : changes)
+    {
+        auto input = InputDependents.find(change.first);
+        if (input != InputDependents.end()) enqueue(input->second);
+    }
+
+    // Positions in evaluation order map back to formulas
+    std::vector<size_t> by_rank(Formulas.size());
+    for (size_t i = 0; i < Formulas.size(); i++) by_rank[Ranks[i]] = i;
+
+    Evaluated = false;
+    while (!queue.empty())
+    {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<size_t>());
+        const size_t formula = by_rank[queue.back()];
+        queue.pop_back();
+
+        long double& slot = store[Formulas[formula].Name];
+        const long double value = Formulas[formula].Expression->Evaluate(store);
+
+        // Cut off propagation if the value is the same. NaN never compares equal, so it always propagates,
+        // and zeroes of different signs differ once divided by
+        if (value == slot && std::signbit(value) == std::signbit(slot)) continue;
+
+        slot = value;
+        changed.push_back(Formulas[formula].Name);
+        enqueue(Dependents[formula]);
+    }
+    Evaluated = true;
+
+    return changed;
+}
@@ -0,0 +1,124 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+namespace MathExpressions
+{
+	/* Set of named formulas that may reference each other by name (e.g. 'margin = revenue - cost',
+	'ratio = margin / revenue'). Symbols that aren't names of formulas are inputs read from the store.
+	Formulas are ordered topologically and split into levels, where each formula only depends on formulas
+	of preceding levels, so formulas of the same level can be evaluated in parallel
+	*/
+	class FormulaSheet
+	{
+	protected:
+		struct Formula
+		{
+			std::string Name;
+			CompiledExpressionPtr Expression;
+			// Formulas this one references
+			std::vector<size_t> Dependencies;
+		};
+
+		std::vector<Formula> Formulas;
+		std::unordered_map<std::string, size_t> Indices;
+		// Indices of formulas of each level
+		std::vector<std::vector<size_t>> Levels;
+		// Formulas that reference each formula, and each input
+		std::vector<std::vector<size_t>> Dependents;
+		std::unordered_map<std::string, std::vector<size_t>> InputDependents;
+		// Position of each formula in evaluation order
+		std::vector<size_t> Ranks;
+		// Whether dependencies and levels reflect current formulas
+		bool Ordered;
+		// Whether values in the store are up to date with formulas, as of the last evaluation
+		bool Evaluated;
+
+		/// <summary>
+		/// Resolves dependencies and splits formulas into levels. Throws CircularDependency if there's a cycle
+		/// </summary>
+		void Order();
+	public:
+		FormulaSheet();
+
+		/// <summary>
+		/// Compiles and adds a formula, replacing any formula with the same name
+		/// </summary>
+		void Set(const std::string& name, const std::string& expression);
+
+		/// <summary>
+		/// Adds an already compiled formula, replacing any formula with the same name
+		/// </summary>
+		void Set(const std::string& name, CompiledExpressionPtr expression);
+
+		/// <summary>
+		/// Removes a formula. Formulas that referenced it will read it from the store from now on
+		/// </summary>
+		/// <returns>False if there was no such formula</returns>
+		bool Remove(const std::string& name);
+
+		/// <summary>
+		/// Returns formula with provided name, or null if there's none
+		/// </summary>
+		CompiledExpressionPtr Get(const std::string& name) const;
+
+		size_t GetFormulaCount() const;
+
+		/// <summary>
+		/// Returns names of formulas of each level in evaluation order.
+		/// Throws CircularDependency if formulas depend on each other in a cycle
+		/// </summary>
+		std::vector<std::vector<std::string>> GetLevels();
+
+		/// <summary>
+		/// Evaluates every formula level by level and writes results into the store under formula's name.
+		/// Formulas of the same level are evaluated in parallel. If any formula throws, evaluation stops
+		/// after the level it belongs to and the exception is rethrown; results of completed levels stay in the store.
+		/// The store must not be accessed by anything else meanwhile
+		/// </summary>
+		/// <param name="store">- values of inputs, receives values of formulas</param>
+		/// <param name="thread_count">- maximum number of threads, including the calling one.
+		/// Zero picks the number of hardware threads</param>
+		void Evaluate(Environment& store, size_t thread_count = 0);
+
+		/// <summary>
+		/// Applies changes to the store and recomputes only formulas that depend on changed values, directly or not,
+		/// in evaluation order. Formulas whose value turns out to be the same don't cause their dependents to be recomputed.
+		/// The store must hold results of the previous evaluation (or recalculation), otherwise formulas
+		/// have been changed since then and everything is evaluated.
+		/// If a formula throws, the exception propagates and the next call evaluates everything.
+		/// Throws std::invalid_argument, changing nothing, if a change names a formula rather than an input
+		/// </summary>
+		/// <param name="store">- store previously passed to 'Evaluate'</param>
+		/// <param name="changes">- new values of inputs</param>
+		/// <returns>Names of formulas whose values have changed, in evaluation order</returns>
+		std::vector<std::string> Recalculate(Environment& store, const Environment& changes);
+	};
+}
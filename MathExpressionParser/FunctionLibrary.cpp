@@ -0,0 +1,286 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include "Exceptions.hpp"
+#include "FunctionLibrary.hpp"
+
+MathExpressions::InlineFunctionCall::InlineFunctionCall(
+    View<std::string> source_range,
+    const MathExpressions::InlineFunction* function
+) : ArgumentedFunction(source_range), Function(function) {};
+
+long double MathExpressions::InlineFunctionCall::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
+{
+    Allocation::Vector<long double> arguments;
+    EvaluateChildren(node, arguments, env, Function->Parameters.size());
+
+    const Program& body = Function->Body->GetProgram();
+    const std::vector<std::string>& symbols = body.GetSymbols();
+
+    // Parameters take values of arguments, while the rest of the symbols are looked up same as variables are
+    Allocation::Vector<long double> symbol_values(symbols.size());
+    for (size_t i = 0; i < symbols.size(); i++)
+    {
+        const size_t parameter = Function->SymbolParameters[i];
+        if (parameter < arguments.size())
+        {
+            symbol_values[i] = arguments[parameter];
+            continue;
+        }
+
+        Environment::const_iterator var_it = env.find(symbols[i]);
+        if (var_it == env.cend()) throw UnresolvedSymbol(this, symbols[i]);
+
+        symbol_values[i] = var_it->second;
+    }
+
+    return body.Evaluate(symbol_values.data());
+}
+
+unsigned MathExpressions::InlineFunctionCall::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    Allocation::Vector<unsigned> arguments;
+    CompileChildren(node, arguments, program, Function->Parameters.size());
+
+    const Program& body = Function->Body->GetProgram();
+    const std::vector<Instruction>& instructions = body.GetInstructions();
+
+    /* Index each instruction of the body has in the calling program
+    Instructions are attributed to the call, as tokens of the body belong to the library,
+    which compiled program may outlive. Errors inside the body are therefore reported at the call
+    */
+    Allocation::Vector<unsigned> mapped;
+    mapped.reserve(instructions.size());
+
+    for (const Instruction& instruction : instructions)
+    {
+        switch (instruction.Op)
+        {
+        case OpCode::Constant:
+            mapped.push_back(program.PushConstant(body.GetConstants()[instruction.Lhs], this));
+            break;
+        case OpCode::Variable:
+        {
+            const size_t parameter = Function->SymbolParameters[instruction.Lhs];
+            mapped.push_back(parameter < arguments.size() ?
+                arguments[parameter] :
+                program.PushVariable(body.GetSymbols()[instruction.Lhs], this)
+            );
+            break;
+        }
+        case OpCode::Call:
+        {
+            const NativeCall& call = body.GetCalls()[instruction.Lhs];
+
+            std::vector<unsigned> call_arguments;
+            call_arguments.reserve(call.Arguments.size());
+            for (unsigned argument : call.Arguments) call_arguments.push_back(mapped[argument]);
+
+            mapped.push_back(program.PushCall(*call.Function, this, std::move(call_arguments)));
+            break;
+        }
+        default:
+            mapped.push_back(program.Push(
+                instruction.Op, this,
+                mapped[instruction.Lhs], GetArity(instruction.Op) == 2 ? mapped[instruction.Rhs] : 0
+            ));
+        }
+    }
+
+    // Body that returns one of it's parameters computes nothing on it's own, yet result of the whole program
+    // is it's last instruction. Multiplying by one is exact, so the value comes out unchanged
+    const Instruction& result = instructions.back();
+    if (result.Op == OpCode::Variable && Function->SymbolParameters[result.Lhs] < arguments.size())
+        return program.Push(OpCode::Mul, this, mapped.back(), program.PushConstant(1, this));
+
+    return mapped.back();
+}
+
+// Matches a name followed by an opening bracket, if the library has a function under that name
+static Parser::TokenPtr MatchFunctionCall(
+    const MathExpressions::FunctionLibrary& library,
+    const std::string& in_expr, size_t& cursor
+) {
+    std::string::const_iterator start = in_expr.cbegin() + cursor, end = start;
+    for (; end != in_expr.cend() && std::isalpha(static_cast<unsigned char>(*end)); ++end);
+
+    if (start == end || end == in_expr.cend() || *end != '(') return Parser::TokenPtr();
+
+    const MathExpressions::InlineFunction* function = library.Find(std::string(start, end));
+    if (!function) return Parser::TokenPtr();
+
+    ++end;
+    cursor = end - in_expr.cbegin();
+    return MathExpressions::Allocation::MakeShared<MathExpressions::InlineFunctionCall>(
+        View<std::string>(&in_expr, start, end), function
+    );
+}
+
+static bool IsName(const std::string& name)
+{
+    if (name.empty()) return false;
+
+    for (char ch : name)
+        if (!std::isalpha(static_cast<unsigned char>(ch))) return false;
+
+    return true;
+}
+
+/* Throws if a variable of a function the body calls is named the same as a parameter of the function being defined.
+Inlining would have bound such variable to the parameter, instead of leaving it to the caller
+*/
+static void CheckCaptures(
+    const Tree<Parser::TokenPtr>::Node& node,
+    const std::string& name, const std::vector<std::string>& parameters
+) {
+    if (auto call = dynamic_cast<const MathExpressions::InlineFunctionCall*>(node.Value.get()))
+    {
+        const MathExpressions::InlineFunction& callee = *call->Function;
+        const std::vector<std::string>& symbols = callee.Body->GetProgram().GetSymbols();
+
+        for (size_t i = 0; i < symbols.size(); i++)
+        {
+            if (callee.SymbolParameters[i] < callee.Parameters.size()) continue;
+
+            if (std::find(parameters.cbegin(), parameters.cend(), symbols[i]) != parameters.cend())
+                throw std::invalid_argument(
+                    "Parameter '" + symbols[i] + "' of function '" + name +
+                    "' would capture variable of the same name used by function '" + callee.Name + "'"
+                );
+        }
+    }
+
+    for (const Tree<Parser::TokenPtr>::NodePtr& child : node.Children)
+        CheckCaptures(*child, name, parameters);
+}
+
+MathExpressions::FunctionLibrary::FunctionLibrary() : Factories(MathExpressions::GetTokenFactories(
+    [this](const std::string& in_expr, size_t& cursor) { return MatchFunctionCall(*this, in_expr, cursor); }
+)) {}
+
+const MathExpressions::InlineFunction& MathExpressions::FunctionLibrary::Define(const std::string& definition)
+{
+    const size_t assignment = definition.find('=');
+    if (assignment == std::string::npos)
+        throw std::invalid_argument("Function definition '" + definition + "' has no '='");
+
+    // Head of the definition is 'name(parameter, ...)', with any amount of whitespace in between
+    size_t cursor = 0;
+    auto skip_blanks = [&]() {
+        for (; cursor < assignment && std::isblank(static_cast<unsigned char>(definition[cursor])); cursor++);
+    };
+    auto read_name = [&]() {
+        const size_t start = cursor;
+        for (; cursor < assignment && std::isalpha(static_cast<unsigned char>(definition[cursor])); cursor++);
+
+        return definition.substr(start, cursor - start);
+    };
+    auto malformed = [&]() {
+        return std::invalid_argument("Function definition '" + definition + "' should start with 'name(parameter, ...)'");
+    };
+
+    skip_blanks();
+    const std::string name = read_name();
+    skip_blanks();
+    if (cursor == assignment || definition[cursor] != '(') throw malformed();
+    ++cursor;
+
+    std::vector<std::string> parameters;
+    while (true)
+    {
+        skip_blanks();
+        parameters.push_back(read_name());
+        skip_blanks();
+
+        if (cursor == assignment) throw malformed();
+
+        // Same separators calls accept
+        const char separator = definition[cursor++];
+        if (separator == ')') break;
+        if (separator != ',' && separator != ';') throw malformed();
+    }
+
+    skip_blanks();
+    if (cursor != assignment) throw malformed();
+
+    return Define(name, parameters, definition.substr(assignment + 1));
+}
+
+const MathExpressions::InlineFunction& MathExpressions::FunctionLibrary::Define(
+    const std::string& name,
+    const std::vector<std::string>& parameters,
+    const std::string& body
+) {
+    if (!IsName(name)) throw std::invalid_argument("Name of function '" + name + "' may only consist of letters");
+    if (IsReservedName(name)) throw std::invalid_argument("'" + name + "' is a built-in name");
+    if (FindNativeFunction(name)) throw std::invalid_argument("'" + name + "' is a native function");
+    if (Functions.count(name)) throw std::invalid_argument("Function '" + name + "' is already defined");
+
+    if (parameters.empty()) throw std::invalid_argument("Function '" + name + "' must have at least one parameter");
+    for (size_t i = 0; i < parameters.size(); i++)
+    {
+        const std::string& parameter = parameters[i];
+
+        if (!IsName(parameter))
+            throw std::invalid_argument("Parameter '" + parameter + "' of function '" + name + "' may only consist of letters");
+        // Constants are matched before variables, so such a name would be split into a constant and a variable
+        if (parameter[0] == 'e' || parameter.compare(0, 2, "pi") == 0)
+            throw std::invalid_argument("Parameter '" + parameter + "' of function '" + name + "' would be read as a constant");
+        if (std::find(parameters.cbegin(), parameters.cbegin() + i, parameter) != parameters.cbegin() + i)
+            throw std::invalid_argument("Parameter '" + parameter + "' of function '" + name + "' is repeated");
+    }
+
+    // Function isn't in the library yet, so the body can only call functions defined before.
+    // Calling itself would be read as a variable named after the function instead
+    InlineFunction function = { name, parameters, Compile(body), std::vector<size_t>() };
+    if (function.Body->GetProgram().FindSymbol(name) < function.Body->GetProgram().GetSymbols().size())
+        throw std::invalid_argument("Function '" + name + "' can't refer to itself");
+
+    CheckCaptures(*function.Body->GetTree().Root, name, parameters);
+
+    for (const std::string& symbol : function.Body->GetProgram().GetSymbols())
+        function.SymbolParameters.push_back(std::find(parameters.cbegin(), parameters.cend(), symbol) - parameters.cbegin());
+
+    return Functions.emplace(name, std::move(function)).first->second;
+}
+
+const MathExpressions::InlineFunction* MathExpressions::FunctionLibrary::Find(const std::string& name) const
+{
+    auto it = Functions.find(name);
+
+    return it != Functions.cend() ? &it->second : nullptr;
+}
+
+const std::vector<Parser::TokenFactory>& MathExpressions::FunctionLibrary::GetTokenFactories() const
+{
+    return Factories;
+}
+
+MathExpressions::CompiledExpressionPtr MathExpressions::FunctionLibrary::Compile(const std::string& expression) const
+{
+    return std::make_shared<const CompiledExpression>(expression, Factories);
+}
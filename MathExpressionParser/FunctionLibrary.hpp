@@ -0,0 +1,123 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+namespace MathExpressions
+{
+	/* Function defined in the expression language itself, e.g. 'f(x, y) = x^2 + y'
+	Body is compiled once, when the function is defined. Calls of it are never performed at runtime,
+	compiling a call copies instructions of the body into the calling program instead (see 'InlineFunctionCall')
+	*/
+	struct InlineFunction
+	{
+		std::string Name;
+		std::vector<std::string> Parameters;
+		CompiledExpressionPtr Body;
+		// Parameter each symbol of the body is bound to, ordered as in body's symbol table.
+		// Symbols that aren't parameters are listed as 'Parameters.size()' and remain variables of the caller
+		std::vector<size_t> SymbolParameters;
+	};
+
+	/* Call of a function from a 'FunctionLibrary'
+	Evaluates 'A(...)' as the body of 'A' with parameters bound to values of arguments.
+	Compiling the call inlines the body: it's instructions are appended to the calling program, with parameters
+	referring to instructions that compute the arguments. Each argument is therefore computed once no matter how often
+	the body uses it, and the program is left with no calls for anything working with it to see through.
+	If parameter count doesn't match function's arity, throws UnexpectedSubexpressionCount
+	*/
+	class InlineFunctionCall : public ArgumentedFunction
+	{
+	public:
+		const InlineFunction* Function;
+
+		TOKEN_CONSTR_DEF(InlineFunctionCall, const InlineFunction*);
+
+		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
+	};
+
+	/* Named functions that expressions compiled with the library may call
+	Shared fragments of formulas can be defined once, e.g. 'discount(r, t) = exp(-r*t)', rather than pasted into
+	every formula that uses them. A function may call functions defined before it, so there's never any recursion.
+	Defining functions isn't thread-safe, while compiling with a library that isn't being changed is.
+	Programs compiled with a library don't refer to it (only their trees do), so they may outlive it
+	*/
+	class FunctionLibrary
+	{
+	protected:
+		// Elements of an unordered map never move, so tokens may point to them as the library grows
+		std::unordered_map<std::string, InlineFunction> Functions;
+		// Default factories plus one that matches calls of functions in this library
+		std::vector<Parser::TokenFactory> Factories;
+	public:
+		FunctionLibrary();
+
+		// Factories refer to the library, so it can't be copied
+		FunctionLibrary(const FunctionLibrary&) = delete;
+		FunctionLibrary& operator=(const FunctionLibrary&) = delete;
+
+		/// <summary>
+		/// Defines a function written as 'name(parameters) = body', e.g. 'f(x, y) = x^2 + y'.
+		/// Throws std::invalid_argument if the definition is malformed (see the other overload for the rest of the checks)
+		/// </summary>
+		/// <returns>The new function</returns>
+		const InlineFunction& Define(const std::string& definition);
+
+		/// <summary>
+		/// Defines a function out of separate parts of it's definition.
+		/// Throws std::invalid_argument if the name is taken (by a built-in function or constant, a native function
+		/// or a function of this library), if names aren't made of letters, if parameters repeat or would be read as constants,
+		/// or if a parameter would capture a variable of a function the body calls.
+		/// Errors in the body are thrown the same way 'Compile' throws them
+		/// </summary>
+		/// <param name="name">- name calls refer to the function by</param>
+		/// <param name="parameters">- names of parameters, at least one</param>
+		/// <param name="body">- expression over parameters, variables and functions defined before</param>
+		/// <returns>The new function</returns>
+		const InlineFunction& Define(const std::string& name, const std::vector<std::string>& parameters, const std::string& body);
+
+		/// <summary>
+		/// Looks up a function by name
+		/// </summary>
+		/// <returns>Function of this library, or null if there's none with such name</returns>
+		const InlineFunction* Find(const std::string& name) const;
+
+		/// <summary>
+		/// Returns factories that tokenize expressions calling functions of this library
+		/// </summary>
+		const std::vector<Parser::TokenFactory>& GetTokenFactories() const;
+
+		/// <summary>
+		/// Compiles an expression that may call functions of this library, inlining their bodies into it
+		/// </summary>
+		CompiledExpressionPtr Compile(const std::string& expression) const;
+	};
+}
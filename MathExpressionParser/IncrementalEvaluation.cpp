@@ -0,0 +1,201 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include "IncrementalEvaluation.hpp"
+
+// Builds ranges of 'out_items' delimited by 'out_offsets' out of (group, item) pairs, items staying in order
+static void BuildGroups(
+    const std::vector<std::pair<unsigned, unsigned>>& pairs,
+    size_t group_count,
+    std::vector<unsigned>& out_items,
+    std::vector<size_t>& out_offsets
+) {
+    out_offsets.assign(group_count + 1, 0);
+    for (const std::pair<unsigned, unsigned>& pair : pairs) out_offsets[pair.first + 1]++;
+    for (size_t i = 0; i < group_count; i++) out_offsets[i + 1] += out_offsets[i];
+
+    out_items.resize(pairs.size());
+    std::vector<size_t> fill(out_offsets.begin(), out_offsets.end() - 1);
+    for (const std::pair<unsigned, unsigned>& pair : pairs) out_items[fill[pair.first]++] = pair.second;
+}
+
+MathExpressions::IncrementalEvaluator::IncrementalEvaluator(MathExpressions::CompiledExpressionPtr expression)
+    : Expression(std::move(expression)), Code(Expression->GetProgram()),
+    UnassignedCount(Code.GetSymbols().size()), Primed(false), RecomputedCount(0)
+{
+    const std::vector<Instruction>& instructions = Code.GetInstructions();
+    if (instructions.empty()) throw std::runtime_error("Program has no instructions");
+
+    std::vector<std::pair<unsigned, unsigned>> uses, loads;
+    for (unsigned i = 0; i < instructions.size(); i++)
+    {
+        const Instruction& instr = instructions[i];
+        size_t arity = GetArity(instr.Op);
+
+        if (instr.Op == OpCode::Variable) loads.push_back(std::make_pair(instr.Lhs, i));
+        if (instr.Op == OpCode::Call)
+        {
+            const NativeCall& call = Code.GetCalls()[instr.Lhs];
+            if (!call.Function->Pure) ImpureCalls.push_back(i);
+
+            // Same argument may be passed several times, and it's user is still queued once
+            for (auto argument = call.Arguments.cbegin(); argument != call.Arguments.cend(); ++argument)
+                if (std::find(call.Arguments.cbegin(), argument, *argument) == argument)
+                    uses.push_back(std::make_pair(*argument, i));
+        }
+        if (arity >= 1) uses.push_back(std::make_pair(instr.Lhs, i));
+        // 'x*x' uses the same operand twice, but it's user only has to be queued once
+        if (arity == 2 && instr.Rhs != instr.Lhs) uses.push_back(std::make_pair(instr.Rhs, i));
+    }
+
+    BuildGroups(uses, instructions.size(), Users, UserOffsets);
+    BuildGroups(loads, Code.GetSymbols().size(), Loads, LoadOffsets);
+
+    SymbolValues.assign(Code.GetSymbols().size(), 0);
+    SymbolAssigned.assign(Code.GetSymbols().size(), false);
+    Values.assign(instructions.size(), 0);
+    Queued.assign(instructions.size(), false);
+}
+
+const MathExpressions::CompiledExpressionPtr& MathExpressions::IncrementalEvaluator::GetExpression() const
+{
+    return Expression;
+}
+
+void MathExpressions::IncrementalEvaluator::Enqueue(unsigned instruction)
+{
+    if (Queued[instruction]) return;
+
+    Queued[instruction] = true;
+    Queue.push_back(instruction);
+    std::push_heap(Queue.begin(), Queue.end(), std::greater<unsigned>());
+}
+
+void MathExpressions::IncrementalEvaluator::SetVariable(size_t symbol, long double value)
+{
+    if (symbol >= SymbolValues.size()) throw std::out_of_range("Symbol index is out of range");
+
+    if (!SymbolAssigned[symbol])
+    {
+        SymbolAssigned[symbol] = true;
+        UnassignedCount--;
+    }
+    // Zeroes of different signs compare equal, but differ once divided by
+    else if (SymbolValues[symbol] == value && std::signbit(SymbolValues[symbol]) == std::signbit(value)) return;
+
+    SymbolValues[symbol] = value;
+
+    // Until the first full evaluation there's nothing to keep up to date
+    if (!Primed) return;
+
+    for (size_t i = LoadOffsets[symbol]; i < LoadOffsets[symbol + 1]; i++) Enqueue(Loads[i]);
+}
+
+bool MathExpressions::IncrementalEvaluator::SetVariable(const std::string& name, long double value)
+{
+    size_t symbol = Code.FindSymbol(name);
+    if (symbol == SymbolValues.size()) return false;
+
+    SetVariable(symbol, value);
+    return true;
+}
+
+void MathExpressions::IncrementalEvaluator::SetVariables(const MathExpressions::Environment& env)
+{
+    const std::vector<std::string>& symbols = Code.GetSymbols();
+    for (size_t i = 0; i < symbols.size(); i++)
+    {
+        Environment::const_iterator var_it = env.find(symbols[i]);
+        if (var_it != env.cend()) SetVariable(i, var_it->second);
+    }
+}
+
+MathExpressions::EvaluationResult MathExpressions::IncrementalEvaluator::TryEvaluate()
+{
+    const size_t last = Values.size() - 1;
+    RecomputedCount = 0;
+
+    if (UnassignedCount)
+    {
+        size_t missing = std::find(SymbolAssigned.begin(), SymbolAssigned.end(), false) - SymbolAssigned.begin();
+        return { 0, EvaluationStatus::UnresolvedSymbol, missing };
+    }
+
+    // First evaluation has nothing to reuse, so it runs the whole program
+    if (!Primed)
+    {
+        for (size_t i = 0; i < Values.size(); i++)
+        {
+            RecomputedCount++;
+            EvaluationStatus status = Code.Execute(i, Values.data(), SymbolValues.data());
+            if (status != EvaluationStatus::Success) return { 0, status, i };
+        }
+
+        Primed = true;
+        return { Values[last], EvaluationStatus::Success, last };
+    }
+
+    for (unsigned call : ImpureCalls) Enqueue(call);
+
+    while (!Queue.empty())
+    {
+        // Smallest index first, so operands are always up to date before their users
+        const unsigned instruction = Queue.front();
+
+        long double previous = Values[instruction];
+        RecomputedCount++;
+        EvaluationStatus status = Code.Execute(instruction, Values.data(), SymbolValues.data());
+        if (status != EvaluationStatus::Success) return { 0, status, instruction };
+
+        std::pop_heap(Queue.begin(), Queue.end(), std::greater<unsigned>());
+        Queue.pop_back();
+        Queued[instruction] = false;
+
+        // Cut off propagation if the value is the same. NaN never compares equal, so it always propagates,
+        // and zeroes of different signs differ once divided by
+        if (Values[instruction] == previous && std::signbit(Values[instruction]) == std::signbit(previous)) continue;
+
+        for (size_t i = UserOffsets[instruction]; i < UserOffsets[instruction + 1]; i++) Enqueue(Users[i]);
+    }
+
+    return { Values[last], EvaluationStatus::Success, last };
+}
+
+long double MathExpressions::IncrementalEvaluator::Evaluate()
+{
+    EvaluationResult result = TryEvaluate();
+    Code.ThrowError(result);
+
+    return result.Value;
+}
+
+size_t MathExpressions::IncrementalEvaluator::GetRecomputedCount() const
+{
+    return RecomputedCount;
+}
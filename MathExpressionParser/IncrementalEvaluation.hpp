@@ -0,0 +1,109 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+namespace MathExpressions
+{
+	/* Evaluates an expression repeatedly while only a few of it's variables change in between.
+	Value of every instruction is kept from the previous evaluation, and changing a variable
+	only queues instructions that read it. Evaluation recomputes queued instructions in program order,
+	and queues users of an instruction only if it's value has actually changed, so unaffected subtrees
+	(and subtrees whose result turned out the same) are never recomputed. Calls of impure native functions
+	are queued by every evaluation, since their result may change on it's own.
+	Holds mutable state, therefore each thread needs an evaluator of it's own. They can share the expression
+	*/
+	class IncrementalEvaluator
+	{
+	protected:
+		CompiledExpressionPtr Expression;
+		const Program& Code;
+		// Instructions that use each instruction as an operand, as ranges of 'Users' delimited by 'UserOffsets'
+		std::vector<unsigned> Users;
+		std::vector<size_t> UserOffsets;
+		// Instructions that load each symbol, delimited by 'LoadOffsets'
+		std::vector<unsigned> Loads;
+		std::vector<size_t> LoadOffsets;
+		// Calls of impure functions, which are recomputed by every evaluation
+		std::vector<unsigned> ImpureCalls;
+
+		std::vector<long double> SymbolValues;
+		std::vector<bool> SymbolAssigned;
+		size_t UnassignedCount;
+		// Cached value of every instruction
+		std::vector<long double> Values;
+		// Min-heap of instructions that have to be recomputed, and whether each instruction is in it
+		std::vector<unsigned> Queue;
+		std::vector<bool> Queued;
+		// Whether cached values are complete, i.e. the program has been evaluated in full at least once
+		bool Primed;
+		size_t RecomputedCount;
+
+		void Enqueue(unsigned instruction);
+	public:
+		IncrementalEvaluator(CompiledExpressionPtr expression);
+
+		IncrementalEvaluator(const IncrementalEvaluator&) = delete;
+		IncrementalEvaluator& operator=(const IncrementalEvaluator&) = delete;
+
+		const CompiledExpressionPtr& GetExpression() const;
+
+		/// <summary>
+		/// Assigns a value to a symbol. Does nothing if symbol already has this value, sign of zero included
+		/// </summary>
+		/// <param name="symbol">- index of the symbol in program's symbol table</param>
+		void SetVariable(size_t symbol, long double value);
+
+		/// <summary>
+		/// Assigns a value to a variable by it's name
+		/// </summary>
+		/// <returns>False if expression doesn't reference such variable</returns>
+		bool SetVariable(const std::string& name, long double value);
+
+		/// <summary>
+		/// Assigns every variable the expression references that's present in the environment
+		/// </summary>
+		void SetVariables(const Environment& env);
+
+		/// <summary>
+		/// Recomputes whatever changed since the last evaluation, reporting errors through the result.
+		/// Instructions that fail stay queued, so they're retried by the next evaluation
+		/// </summary>
+		EvaluationResult TryEvaluate();
+
+		/// <summary>
+		/// Same as 'TryEvaluate', but throws on errors, same as 'Program::Evaluate'
+		/// </summary>
+		long double Evaluate();
+
+		/// <summary>
+		/// Returns how many instructions the last evaluation has computed
+		/// </summary>
+		size_t GetRecomputedCount() const;
+	};
+}
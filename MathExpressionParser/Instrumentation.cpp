@@ -0,0 +1,75 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Instrumentation.hpp"
+
+// Statistics the current thread is collecting into
+static thread_local MathExpressions::Instrumentation::Stats* CurrentStats = nullptr;
+
+MathExpressions::Instrumentation::Stats::Stats()
+    : Tokenize(0), Backpatch(0), Parse(0), Compile(0), Evaluate(0),
+    Tokens(0), Nodes(0), Instructions(0), FactoryAttempts(0),
+    PairLookups(0), PairCacheHits(0), Evaluations(0)
+{}
+
+MathExpressions::Instrumentation::Scope::Scope(Stats& target) : Previous(CurrentStats)
+{
+    CurrentStats = &target;
+}
+
+MathExpressions::Instrumentation::Scope::~Scope()
+{
+    CurrentStats = Previous;
+}
+
+MathExpressions::Instrumentation::Stats* MathExpressions::Instrumentation::Current()
+{
+    return CurrentStats;
+}
+
+MathExpressions::Instrumentation::PhaseTimer::PhaseTimer(
+    std::chrono::nanoseconds Stats::* phase
+) : Phase(phase), Start(std::chrono::steady_clock::now()) {}
+
+MathExpressions::Instrumentation::PhaseTimer::~PhaseTimer()
+{
+    if (!CurrentStats) return;
+
+    CurrentStats->*Phase += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Start);
+}
+
+// Counts the node and everything below it
+static size_t CountSubtree(const Tree<Parser::TokenPtr>::Node& node)
+{
+    size_t count = 1;
+    for (const Tree<Parser::TokenPtr>::NodePtr& child : node.Children)
+        count += CountSubtree(*child);
+
+    return count;
+}
+
+size_t MathExpressions::Instrumentation::CountNodes(const Tree<Parser::TokenPtr>& tree)
+{
+    return tree.Root ? CountSubtree(*tree.Root) : 0;
+}
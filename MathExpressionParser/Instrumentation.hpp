@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include "Parser/Parser.hpp"
+#include "Parser/Tree.hpp"
+
+/* Instrumentation is only compiled in when MATHEXPRESSIONS_INSTRUMENTATION is defined
+(see MATHEXPRESSIONPARSER_INSTRUMENTATION CMake option). Otherwise macros below expand to nothing,
+and 'Scope' simply never receives anything
+*/
+#ifdef MATHEXPRESSIONS_INSTRUMENTATION
+// Adds 'amount' to a counter of statistics collected by the current thread
+#define MATHEXPRESSIONS_COUNT(Field, amount) \
+	do { if (MathExpressions::Instrumentation::Stats* mep_stats = MathExpressions::Instrumentation::Current()) \
+		mep_stats->Field += (amount); } while (false)
+// Adds time until the end of enclosing block to a phase of statistics collected by the current thread
+#define MATHEXPRESSIONS_TIME_PHASE(Field) \
+	MathExpressions::Instrumentation::PhaseTimer mep_phase_timer_##Field(&MathExpressions::Instrumentation::Stats::Field)
+#else
+#define MATHEXPRESSIONS_COUNT(Field, amount) do {} while (false)
+#define MATHEXPRESSIONS_TIME_PHASE(Field) do {} while (false)
+#endif
+
+namespace MathExpressions
+{
+	namespace Instrumentation
+	{
+		// Everything that has been recorded while collecting
+		struct Stats
+		{
+			// Time spent in each phase
+			std::chrono::nanoseconds Tokenize, Backpatch, Parse, Compile, Evaluate;
+			// Number of tokens the tokenizer has produced and nodes in resulting ASTs
+			size_t Tokens, Nodes;
+			// Number of instructions in compiled programs
+			size_t Instructions;
+			// How many times token factories were invoked
+			size_t FactoryAttempts;
+			// Searches for a matching pair token, and how many of them were answered by the cache
+			size_t PairLookups, PairCacheHits;
+			size_t Evaluations;
+
+			Stats();
+		};
+
+		/* Collects statistics of everything the current thread does into 'target'
+		for as long as it lives. Scopes can be nested, the innermost one receives statistics
+		*/
+		class Scope
+		{
+			Stats* Previous;
+		public:
+			Scope(Stats& target);
+			~Scope();
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+		};
+
+		/// <summary>
+		/// Returns statistics the current thread is collecting into, or null if it isn't collecting
+		/// </summary>
+		Stats* Current();
+
+		// Adds time it has been alive for to a phase of current statistics
+		class PhaseTimer
+		{
+			std::chrono::nanoseconds Stats::* Phase;
+			std::chrono::steady_clock::time_point Start;
+		public:
+			PhaseTimer(std::chrono::nanoseconds Stats::* phase);
+			~PhaseTimer();
+		};
+
+		/// <summary>
+		/// Counts nodes in the tree
+		/// </summary>
+		size_t CountNodes(const Tree<Parser::TokenPtr>& tree);
+	}
+}
@@ -0,0 +1,414 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include "IntervalEvaluation.hpp"
+
+using MathExpressions::Interval;
+
+static const long double Pi = 3.141592653589793238462643383279502884L;
+static const long double Infinity = INFINITY;
+// Library functions aren't correctly rounded, so their results are moved outwards by this many representable values
+static const int LibraryErrorSteps = 4;
+
+bool MathExpressions::Interval::IsEmpty() const
+{
+    return std::isnan(Lo) || std::isnan(Hi);
+}
+
+bool MathExpressions::Interval::Contains(long double value) const
+{
+    return Lo <= value && value <= Hi;
+}
+
+static Interval Empty()
+{
+    return { NAN, NAN };
+}
+
+// Smallest range containing both ranges
+static Interval Hull(const Interval& a, const Interval& b)
+{
+    if (a.IsEmpty()) return b;
+    if (b.IsEmpty()) return a;
+
+    return { std::min(a.Lo, b.Lo), std::max(a.Hi, b.Hi) };
+}
+
+// Part of the range that lies within [lo, hi]
+static Interval Intersect(const Interval& range, long double lo, long double hi)
+{
+    if (range.Hi < lo || range.Lo > hi) return Empty();
+
+    return { std::max(range.Lo, lo), std::min(range.Hi, hi) };
+}
+
+/* Following functions round their result towards 'toward', which is either -Infinity (for lower bounds)
+or Infinity (for upper bounds). Arithmetic recovers the exact rounding error, so exact results stay exact.
+Infinite operands stand for unbounded values, so they produce infinite results,
+while overflow of finite operands is rounded back to the largest finite value when it's required
+*/
+
+// Result of a library function as a bound. NaN means nothing is known about the bound
+static long double LibraryBound(long double value, long double toward)
+{
+    if (std::isnan(value)) return toward;
+
+    for (int step = 0; step < LibraryErrorSteps; step++) value = nextafterl(value, toward);
+    return value;
+}
+
+// Rounds inexact result, given the sign of difference between exact and rounded results
+static inline long double Round(long double value, long double error, long double toward)
+{
+    return (error == 0 || (error > 0) != (toward > 0)) ? value : nextafterl(value, toward);
+}
+
+static long double AddBound(long double a, long double b, long double toward)
+{
+    long double sum = a + b;
+    if (std::isnan(sum)) return toward;
+    if (std::isinf(sum)) return (std::isinf(a) || std::isinf(b)) ? sum : nextafterl(sum, toward);
+
+    // Error-free transformation, 'sum + error' is the exact sum
+    long double b_part = sum - a;
+    long double error = (a - (sum - b_part)) + (b - b_part);
+
+    return Round(sum, error, toward);
+}
+
+static long double MultiplyBound(long double a, long double b, long double toward)
+{
+    // Zero times a value, however large, is still zero
+    if (a == 0 || b == 0) return 0;
+
+    long double product = a * b;
+    if (std::isinf(product)) return (std::isinf(a) || std::isinf(b)) ? product : nextafterl(product, toward);
+    // Error of denormalized results can't be recovered
+    if (fabsl(product) < LDBL_MIN) return nextafterl(product, toward);
+
+    return Round(product, fmal(a, b, -product), toward);
+}
+
+// Divisor may be a signed zero, which stands for values approaching zero from that side
+static long double DivideBound(long double a, long double b, long double toward)
+{
+    if (a == 0) return 0;
+
+    long double quotient = a / b;
+    if (std::isnan(quotient)) return toward;
+    if (b == 0 || std::isinf(a) || std::isinf(b)) return quotient;
+    if (std::isinf(quotient)) return nextafterl(quotient, toward);
+    if (fabsl(quotient) < LDBL_MIN) return nextafterl(quotient, toward);
+
+    // Remainder is exact. Exact quotient exceeds the rounded one when remainder has the same sign as the divisor
+    long double remainder = fmal(-quotient, b, a);
+    if (remainder == 0) return quotient;
+
+    return Round(quotient, ((remainder > 0) == (b > 0)) ? 1 : -1, toward);
+}
+
+// Applies operation to every pair of bounds, taking the extremes. Valid for operations monotonic in each operand
+template<long double (*Operation)(long double, long double, long double)>
+static Interval Corners(const Interval& a, const Interval& b)
+{
+    return {
+        std::min(
+            std::min(Operation(a.Lo, b.Lo, -Infinity), Operation(a.Lo, b.Hi, -Infinity)),
+            std::min(Operation(a.Hi, b.Lo, -Infinity), Operation(a.Hi, b.Hi, -Infinity))
+        ),
+        std::max(
+            std::max(Operation(a.Lo, b.Lo, Infinity), Operation(a.Lo, b.Hi, Infinity)),
+            std::max(Operation(a.Hi, b.Lo, Infinity), Operation(a.Hi, b.Hi, Infinity))
+        )
+    };
+}
+
+// Values of 'a / b', leaving out the point where 'b' is zero
+static Interval Quotient(const Interval& a, const Interval& b)
+{
+    if (b.Lo == 0 && b.Hi == 0) return Empty();
+
+    // Zero bounds are approached from the inside of the range, which decides the sign of infinity they produce
+    if (b.Lo >= 0) return Corners<DivideBound>(a, { +0.0L, b.Hi });
+    if (b.Hi <= 0) return Corners<DivideBound>(a, { b.Lo, -0.0L });
+
+    return Hull(Corners<DivideBound>(a, { b.Lo, -0.0L }), Corners<DivideBound>(a, { +0.0L, b.Hi }));
+}
+
+static long double PowerBound(long double a, long double b, long double toward)
+{
+    return LibraryBound(powl(a, b), toward);
+}
+
+// Values of 'a ^ b' as evaluation computes them, leaving out points that fail or yield NaN
+static Interval Exponentiate(const Interval& a, const Interval& b)
+{
+    // Integer power of any base, the most common case. Odd powers are increasing, even ones depend on magnitude
+    if (b.Lo == b.Hi && b.Lo >= 1 && b.Lo == floorl(b.Lo))
+    {
+        if (fmodl(b.Lo, 2) != 0 || a.Lo >= 0) return { PowerBound(a.Lo, b.Lo, -Infinity), PowerBound(a.Hi, b.Lo, Infinity) };
+        if (a.Hi <= 0) return { PowerBound(a.Hi, b.Lo, -Infinity), PowerBound(a.Lo, b.Lo, Infinity) };
+
+        return { 0, PowerBound(std::max(-a.Lo, a.Hi), b.Lo, Infinity) };
+    }
+
+    // Non-negative base is monotonic in each operand
+    Interval result = Empty();
+    Interval positive = Intersect(a, 0, Infinity);
+    if (!positive.IsEmpty()) result = Corners<PowerBound>(positive, b);
+
+    /* Negative base only yields a number for integer exponents, which can't be less than 1.
+    Magnitude of such results is bounded by the same power of the base's magnitude, while the sign may be either
+    */
+    Interval negative = Intersect(a, -Infinity, 0);
+    Interval exponents = Intersect(b, 1, Infinity);
+    if (!negative.IsEmpty() && !exponents.IsEmpty() && ceill(exponents.Lo) <= exponents.Hi)
+    {
+        long double magnitude = Corners<PowerBound>({ -negative.Hi, -negative.Lo }, exponents).Hi;
+        result = Hull(result, { -magnitude, magnitude });
+    }
+
+    return result;
+}
+
+// Applies an increasing function to a range
+static Interval Increasing(long double (*function)(long double), const Interval& x)
+{
+    return { LibraryBound(function(x.Lo), -Infinity), LibraryBound(function(x.Hi), Infinity) };
+}
+
+// Applies a decreasing function to a range
+static Interval Decreasing(long double (*function)(long double), const Interval& x)
+{
+    return { LibraryBound(function(x.Hi), -Infinity), LibraryBound(function(x.Lo), Infinity) };
+}
+
+/* Tells whether the range contains a point 'offset + k * period' for some integer 'k'.
+Points are computed with rounded pi, so ones close to the bounds are considered contained
+*/
+static bool ContainsPeriodicPoint(const Interval& x, long double offset, long double period)
+{
+    // Beyond this magnitude neighbouring points can't be told apart reliably. Also catches infinite bounds
+    if (!(fabsl(x.Lo) < 1e15L && fabsl(x.Hi) < 1e15L)) return true;
+    if (x.Hi - x.Lo >= period) return true;
+
+    long double point = offset + ceill((x.Lo - offset) / period) * period;
+    long double slack = (fabsl(point) + 1) * 64 * LDBL_EPSILON;
+
+    return point - slack <= x.Hi || point - period + slack >= x.Lo;
+}
+
+// Sine reaches it's extremes at 'pi/2 + 2k*pi' and '-pi/2 + 2k*pi', and is monotonic between them
+static Interval SineRange(const Interval& x)
+{
+    bool has_max = ContainsPeriodicPoint(x, Pi / 2, 2 * Pi);
+    bool has_min = ContainsPeriodicPoint(x, -Pi / 2, 2 * Pi);
+    long double lo = sinl(x.Lo), hi = sinl(x.Hi);
+
+    return {
+        has_min ? -1 : std::max(-1.0L, LibraryBound(std::min(lo, hi), -Infinity)),
+        has_max ? 1 : std::min(1.0L, LibraryBound(std::max(lo, hi), Infinity))
+    };
+}
+
+// Cosine reaches it's extremes at '2k*pi' and 'pi + 2k*pi', and is monotonic between them
+static Interval CosineRange(const Interval& x)
+{
+    bool has_max = ContainsPeriodicPoint(x, 0, 2 * Pi);
+    bool has_min = ContainsPeriodicPoint(x, Pi, 2 * Pi);
+    long double lo = cosl(x.Lo), hi = cosl(x.Hi);
+
+    return {
+        has_min ? -1 : std::max(-1.0L, LibraryBound(std::min(lo, hi), -Infinity)),
+        has_max ? 1 : std::min(1.0L, LibraryBound(std::max(lo, hi), Infinity))
+    };
+}
+
+// Tangent is increasing between it's poles at 'pi/2 + k*pi', and unbounded around them
+static Interval TangentRange(const Interval& x)
+{
+    if (ContainsPeriodicPoint(x, Pi / 2, Pi)) return { -Infinity, Infinity };
+
+    return Increasing(tanl, x);
+}
+
+static long double CotangentValue(long double x)
+{
+    return 1 / tanl(x);
+}
+
+// Cotangent is decreasing between it's poles at 'k*pi', and unbounded around them
+static Interval CotangentRange(const Interval& x)
+{
+    if (ContainsPeriodicPoint(x, 0, Pi)) return { -Infinity, Infinity };
+
+    return Decreasing(CotangentValue, x);
+}
+
+// Even functions that increase with magnitude of the argument
+static Interval Even(long double (*function)(long double), long double at_zero, const Interval& x)
+{
+    if (x.Lo >= 0) return Increasing(function, x);
+    if (x.Hi <= 0) return Decreasing(function, x);
+
+    return { at_zero, LibraryBound(function(std::max(-x.Lo, x.Hi)), Infinity) };
+}
+
+static long double SignOf(long double x)
+{
+    return (x == 0) ? 0 : ((x > 0) ? 1 : -1);
+}
+
+MathExpressions::IntervalResult MathExpressions::TryEvaluateInterval(
+    const MathExpressions::Program& program,
+    const MathExpressions::Interval* symbol_ranges
+) {
+    const std::vector<Instruction>& instructions = program.GetInstructions();
+    const std::vector<long double>& constants = program.GetConstants();
+
+    std::vector<Interval> ranges(instructions.size());
+    bool may_fail = false;
+
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        const Instruction& instr = instructions[i];
+        Interval& out = ranges[i];
+
+        switch (instr.Op)
+        {
+        case OpCode::Constant: out = { constants[instr.Lhs], constants[instr.Lhs] }; continue;
+        case OpCode::Variable: out = symbol_ranges[instr.Lhs]; continue;
+        case OpCode::Call:
+        {
+            // Nothing is known about native functions, so any value is possible once arguments are
+            out = { -Infinity, Infinity };
+            for (unsigned argument : program.GetCalls()[instr.Lhs].Arguments)
+                if (ranges[argument].IsEmpty()) out = Empty();
+            continue;
+        }
+        default: break;
+        }
+
+        const Interval a = ranges[instr.Lhs];
+        const Interval b = (GetArity(instr.Op) == 2) ? ranges[instr.Rhs] : Interval{ 0, 0 };
+
+        // Operands that never evaluate to a number don't let the result do so either
+        if (a.IsEmpty() || b.IsEmpty())
+        {
+            out = Empty();
+            continue;
+        }
+
+        switch (instr.Op)
+        {
+        case OpCode::Add: out = { AddBound(a.Lo, b.Lo, -Infinity), AddBound(a.Hi, b.Hi, Infinity) }; break;
+        case OpCode::Sub: out = { AddBound(a.Lo, -b.Hi, -Infinity), AddBound(a.Hi, -b.Lo, Infinity) }; break;
+        case OpCode::Mul: out = Corners<MultiplyBound>(a, b); break;
+        case OpCode::Div:
+            if (b.Lo == 0 && b.Hi == 0) return { Empty(), EvaluationStatus::DivisionByZero, i, may_fail };
+            may_fail = may_fail || b.Contains(0);
+            out = Quotient(a, b);
+            break;
+        case OpCode::Pow:
+            if (b.Hi < 1 && a.Hi < 0) return { Empty(), EvaluationStatus::NegativeNumberRoot, i, may_fail };
+            may_fail = may_fail || (b.Lo < 1 && a.Lo < 0);
+            out = Exponentiate(a, b);
+            break;
+        case OpCode::Log:
+        {
+            /* Evaluated as 'log2(a) / log2(b)'. Base of 1 is a zero divisor, which yields infinity of the sign of 'log2(a)'
+            instead of failing. Quotient leaves out exact zero divisors, so a base of exactly 1 divides by a positive zero here,
+            while ranges of bases around 1 reach the same infinities through bounds approaching zero
+            */
+            Interval log_a = Intersect(a, 0, Infinity), base = Intersect(b, 0, Infinity);
+            if (log_a.IsEmpty() || base.IsEmpty())
+            {
+                out = Empty();
+                break;
+            }
+
+            log_a = Increasing(log2l, log_a);
+            out = (base.Lo == 1 && base.Hi == 1) ? Corners<DivideBound>(log_a, { +0.0L, +0.0L }) : Quotient(log_a, Increasing(log2l, base));
+            break;
+        }
+        case OpCode::Negate: out = { -a.Hi, -a.Lo }; break;
+        case OpCode::Abs:
+            out = (a.Lo >= 0) ? a : ((a.Hi <= 0) ? Interval{ -a.Hi, -a.Lo } : Interval{ 0, std::max(-a.Lo, a.Hi) });
+            break;
+        case OpCode::LogE: out = Intersect(a, 0, Infinity); if (!out.IsEmpty()) out = Increasing(logl, out); break;
+        case OpCode::Log2: out = Intersect(a, 0, Infinity); if (!out.IsEmpty()) out = Increasing(log2l, out); break;
+        case OpCode::Log10: out = Intersect(a, 0, Infinity); if (!out.IsEmpty()) out = Increasing(log10l, out); break;
+        case OpCode::Exp: out = Increasing(expl, a); break;
+        case OpCode::Sqrt:
+            if (a.Hi < 0) return { Empty(), EvaluationStatus::NegativeNumberRoot, i, may_fail };
+            may_fail = may_fail || a.Lo < 0;
+            out = Increasing(sqrtl, Intersect(a, 0, Infinity));
+            break;
+        case OpCode::Sign: out = { SignOf(a.Lo), SignOf(a.Hi) }; break;
+        case OpCode::Sin: out = SineRange(a); break;
+        case OpCode::Cos: out = CosineRange(a); break;
+        case OpCode::Tan: out = TangentRange(a); break;
+        case OpCode::Cot: out = CotangentRange(a); break;
+        case OpCode::Asin: out = Intersect(a, -1, 1); if (!out.IsEmpty()) out = Increasing(asinl, out); break;
+        case OpCode::Acos: out = Intersect(a, -1, 1); if (!out.IsEmpty()) out = Decreasing(acosl, out); break;
+        case OpCode::Atan: out = Increasing(atanl, a); break;
+        case OpCode::Sinh: out = Increasing(sinhl, a); break;
+        case OpCode::Cosh: out = Even(coshl, 1, a); break;
+        case OpCode::Tanh: out = Increasing(tanhl, a); break;
+        case OpCode::Asinh: out = Increasing(asinhl, a); break;
+        case OpCode::Acosh: out = Intersect(a, 1, Infinity); if (!out.IsEmpty()) out = Increasing(acoshl, out); break;
+        case OpCode::Atanh: out = Intersect(a, -1, 1); if (!out.IsEmpty()) out = Increasing(atanhl, out); break;
+        default: break;
+        }
+    }
+
+    return { ranges.back(), EvaluationStatus::Success, instructions.size() - 1, may_fail };
+}
+
+Interval MathExpressions::EvaluateInterval(
+    const MathExpressions::Program& program,
+    const MathExpressions::IntervalEnvironment& env
+) {
+    if (program.GetInstructions().empty()) throw std::runtime_error("Program has no instructions");
+
+    const std::vector<std::string>& symbols = program.GetSymbols();
+    std::vector<Interval> symbol_ranges(symbols.size());
+    for (size_t i = 0; i < symbols.size(); i++)
+    {
+        IntervalEnvironment::const_iterator range_it = env.find(symbols[i]);
+        if (range_it == env.cend()) program.ThrowError({ 0, EvaluationStatus::UnresolvedSymbol, i });
+
+        symbol_ranges[i] = range_it->second;
+    }
+
+    IntervalResult result = TryEvaluateInterval(program, symbol_ranges.data());
+    program.ThrowError({ 0, result.Status, result.Index });
+
+    return result.Value;
+}
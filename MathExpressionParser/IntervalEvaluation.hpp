@@ -0,0 +1,80 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include "CompiledExpression.hpp"
+
+/* Evaluation of compiled programs over ranges of values instead of single values.
+Every variable is given a closed range, and the result is a range that is guaranteed to contain
+every value the program evaluates to when each variable takes any value in it's range.
+Bounds are rounded outwards, so they hold despite rounding errors, but they are usually wider than the exact range
+(e.g. 'x-x' over [0, 1] yields [-1, 1]), as each instruction only knows ranges of it's operands.
+Points where the program doesn't evaluate to a number (e.g. 'acos(2)' or a failed division) are left out of the result
+*/
+namespace MathExpressions
+{
+	/* Closed range of values [Lo, Hi]. Bounds may be infinite.
+	A range with NaN bounds is empty, i.e. contains no values at all
+	*/
+	struct Interval
+	{
+		long double Lo, Hi;
+
+		bool IsEmpty() const;
+		bool Contains(long double value) const;
+	};
+
+	using IntervalEnvironment = std::unordered_map<std::string, Interval>;
+
+	struct IntervalResult
+	{
+		// Range of values of the program. Unspecified if evaluation is certain to fail
+		Interval Value;
+		// Error every point of the ranges runs into, or Success if at least some points may evaluate
+		EvaluationStatus Status;
+		// Index of the instruction that is certain to fail, or of the missing symbol if status is 'UnresolvedSymbol'
+		size_t Index;
+		// Whether some (but not all) points of the ranges may fail to evaluate, e.g. when a divisor's range contains zero
+		bool MayFail;
+	};
+
+	/// <summary>
+	/// Evaluates program over ranges of symbols, reporting errors through the result instead of throwing.
+	/// Program must not be empty
+	/// </summary>
+	/// <param name="program">- program to evaluate</param>
+	/// <param name="symbol_ranges">- ranges of the symbols, ordered as in the symbol table</param>
+	IntervalResult TryEvaluateInterval(const Program& program, const Interval* symbol_ranges);
+
+	/// <summary>
+	/// Resolves ranges of symbols and evaluates program over them.
+	/// Throws if any symbol is missing or if evaluation fails at every point of the ranges
+	/// </summary>
+	/// <param name="env">- range of each variable</param>
+	/// <returns>Range that contains every value the program may evaluate to</returns>
+	Interval EvaluateInterval(const Program& program, const IntervalEnvironment& env);
+}
@@ -0,0 +1,294 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <stdexcept>
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MathExpressions::MappedFile::MappedFile(
+    const std::string& path
+) : Data(nullptr), Size(0), FileHandle(INVALID_HANDLE_VALUE), MappingHandle(nullptr)
+{
+    FileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (FileHandle == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot open file '" + path + "'");
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(FileHandle, &size))
+    {
+        CloseHandle(FileHandle);
+        throw std::runtime_error("Cannot read size of file '" + path + "'");
+    }
+
+    Size = static_cast<size_t>(size.QuadPart);
+    // Empty files cannot be mapped, but there's nothing to map in them anyway
+    if (Size == 0) return;
+
+    MappingHandle = CreateFileMappingA(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (MappingHandle) Data = static_cast<const char*>(MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0));
+
+    if (!Data)
+    {
+        if (MappingHandle) CloseHandle(MappingHandle);
+        CloseHandle(FileHandle);
+        throw std::runtime_error("Cannot map file '" + path + "'");
+    }
+}
+
+MathExpressions::MappedFile::~MappedFile()
+{
+    if (Data) UnmapViewOfFile(Data);
+    if (MappingHandle) CloseHandle(MappingHandle);
+    CloseHandle(FileHandle);
+}
+
+void MathExpressions::MappedFile::Prefetch(size_t offset, size_t size) const
+{
+    if (offset >= Size) return;
+
+    WIN32_MEMORY_RANGE_ENTRY range = { const_cast<char*>(Data) + offset, std::min(size, Size - offset) };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MathExpressions::MappedFile::Evict(size_t offset, size_t size) const
+{
+    // Unlocking pages that aren't locked removes them from the working set
+    if (offset < Size) VirtualUnlock(const_cast<char*>(Data) + offset, std::min(size, Size - offset));
+}
+
+MathExpressions::WritableMappedFile::WritableMappedFile(
+    const std::string& path,
+    size_t size
+) : Data(nullptr), Size(size), FileHandle(INVALID_HANDLE_VALUE), MappingHandle(nullptr)
+{
+    FileHandle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (FileHandle == INVALID_HANDLE_VALUE) throw std::runtime_error("Cannot create file '" + path + "'");
+
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(Size);
+    if (!SetFilePointerEx(FileHandle, end, nullptr, FILE_BEGIN) || !SetEndOfFile(FileHandle))
+    {
+        CloseHandle(FileHandle);
+        throw std::runtime_error("Cannot resize file '" + path + "'");
+    }
+
+    if (Size == 0) return;
+
+    MappingHandle = CreateFileMappingA(FileHandle, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if (MappingHandle) Data = static_cast<char*>(MapViewOfFile(MappingHandle, FILE_MAP_WRITE, 0, 0, 0));
+
+    if (!Data)
+    {
+        if (MappingHandle) CloseHandle(MappingHandle);
+        CloseHandle(FileHandle);
+        throw std::runtime_error("Cannot map file '" + path + "'");
+    }
+}
+
+MathExpressions::WritableMappedFile::~WritableMappedFile()
+{
+    if (Data) UnmapViewOfFile(Data);
+    if (MappingHandle) CloseHandle(MappingHandle);
+    CloseHandle(FileHandle);
+}
+
+void MathExpressions::WritableMappedFile::Flush(size_t offset, size_t size)
+{
+    if (offset >= Size) return;
+
+    FlushViewOfFile(Data + offset, std::min(size, Size - offset));
+    FlushFileBuffers(FileHandle);
+}
+
+void MathExpressions::WritableMappedFile::Evict(size_t offset, size_t size)
+{
+    // Writing the view back is only started, it's 'Flush' that waits for the file to be written
+    if (offset < Size) FlushViewOfFile(Data + offset, std::min(size, Size - offset));
+    if (offset < Size) VirtualUnlock(Data + offset, std::min(size, Size - offset));
+}
+#else
+MathExpressions::MappedFile::MappedFile(
+    const std::string& path
+) : Data(nullptr), Size(0), Descriptor(-1)
+{
+    Descriptor = open(path.c_str(), O_RDONLY);
+    if (Descriptor < 0) throw std::runtime_error("Cannot open file '" + path + "'");
+
+    struct stat info;
+    if (fstat(Descriptor, &info) != 0)
+    {
+        close(Descriptor);
+        throw std::runtime_error("Cannot read size of file '" + path + "'");
+    }
+
+    Size = static_cast<size_t>(info.st_size);
+    // Empty files cannot be mapped, but there's nothing to map in them anyway
+    if (Size == 0) return;
+
+    void* mapping = mmap(nullptr, Size, PROT_READ, MAP_SHARED, Descriptor, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close(Descriptor);
+        throw std::runtime_error("Cannot map file '" + path + "'");
+    }
+
+    Data = static_cast<const char*>(mapping);
+}
+
+MathExpressions::MappedFile::~MappedFile()
+{
+    if (Data) munmap(const_cast<char*>(Data), Size);
+    close(Descriptor);
+}
+
+static size_t GetPageSize()
+{
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+/* Expands range to whole pages, as memory advice only applies to them, and clamps it to the mapping.
+Returns false if nothing is left of the range
+*/
+static bool AlignToPages(size_t& offset, size_t& size, size_t mapping_size)
+{
+    if (offset >= mapping_size || size == 0) return false;
+
+    const size_t end = offset + std::min(size, mapping_size - offset);
+    offset -= offset % GetPageSize();
+    size = end - offset;
+    return true;
+}
+
+/* Shrinks range to whole pages that lie within it, so dropping them never drops data around the range
+(e.g. the start of a window that has just been prefetched). The last page of the mapping counts as whole,
+as there's nothing past it. Returns false if no whole page is left
+*/
+static bool ShrinkToPages(size_t& offset, size_t& size, size_t mapping_size)
+{
+    if (offset >= mapping_size || size == 0) return false;
+
+    const size_t page_size = GetPageSize();
+    size_t end = offset + std::min(size, mapping_size - offset);
+    if (end != mapping_size) end -= end % page_size;
+    offset += (page_size - offset % page_size) % page_size;
+    if (offset >= end) return false;
+
+    size = end - offset;
+    return true;
+}
+
+void MathExpressions::MappedFile::Prefetch(size_t offset, size_t size) const
+{
+    if (AlignToPages(offset, size, Size)) madvise(const_cast<char*>(Data) + offset, size, MADV_WILLNEED);
+}
+
+void MathExpressions::MappedFile::Evict(size_t offset, size_t size) const
+{
+    // Pages of a read-only mapping are never dirty, so they're simply read again if needed
+    if (ShrinkToPages(offset, size, Size)) madvise(const_cast<char*>(Data) + offset, size, MADV_DONTNEED);
+}
+
+MathExpressions::WritableMappedFile::WritableMappedFile(
+    const std::string& path,
+    size_t size
+) : Data(nullptr), Size(size), Descriptor(-1)
+{
+    Descriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (Descriptor < 0) throw std::runtime_error("Cannot create file '" + path + "'");
+
+    if (ftruncate(Descriptor, static_cast<off_t>(Size)) != 0)
+    {
+        close(Descriptor);
+        throw std::runtime_error("Cannot resize file '" + path + "'");
+    }
+
+    if (Size == 0) return;
+
+    void* mapping = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, Descriptor, 0);
+    if (mapping == MAP_FAILED)
+    {
+        close(Descriptor);
+        throw std::runtime_error("Cannot map file '" + path + "'");
+    }
+
+    Data = static_cast<char*>(mapping);
+}
+
+MathExpressions::WritableMappedFile::~WritableMappedFile()
+{
+    if (Data) munmap(Data, Size);
+    close(Descriptor);
+}
+
+void MathExpressions::WritableMappedFile::Flush(size_t offset, size_t size)
+{
+    if (AlignToPages(offset, size, Size)) msync(Data + offset, size, MS_SYNC);
+}
+
+void MathExpressions::WritableMappedFile::Evict(size_t offset, size_t size)
+{
+    if (!ShrinkToPages(offset, size, Size)) return;
+
+    // Dropping pages of a shared mapping only unmaps them: dirty ones stay in the page cache until they're written back.
+    // So writing them back is only started here, it's 'Flush' that waits for the file to be written
+    msync(Data + offset, size, MS_ASYNC);
+    madvise(Data + offset, size, MADV_DONTNEED);
+}
+#endif
+
+const char* MathExpressions::MappedFile::GetData() const
+{
+    return Data;
+}
+
+size_t MathExpressions::MappedFile::GetSize() const
+{
+    return Size;
+}
+
+char* MathExpressions::WritableMappedFile::GetData()
+{
+    return Data;
+}
+
+const char* MathExpressions::WritableMappedFile::GetData() const
+{
+    return Data;
+}
+
+size_t MathExpressions::WritableMappedFile::GetSize() const
+{
+    return Size;
+}
@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace MathExpressions
+{
+	/* Read-only view of a whole file mapped into memory
+	Throws std::runtime_error if file cannot be opened or mapped
+	*/
+	class MappedFile
+	{
+	protected:
+		const char* Data;
+		size_t Size;
+#ifdef _WIN32
+		void* FileHandle;
+		void* MappingHandle;
+#else
+		int Descriptor;
+#endif
+	public:
+		MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* GetData() const;
+		size_t GetSize() const;
+
+		/// <summary>
+		/// Hints the system to start reading specified range of the file in the background
+		/// </summary>
+		void Prefetch(size_t offset, size_t size) const;
+
+		/// <summary>
+		/// Hints the system that specified range won't be needed soon, so it's memory can be reclaimed.
+		/// Range is read from the file again if it's accessed later. Pages that hold data outside of the range are kept
+		/// </summary>
+		void Evict(size_t offset, size_t size) const;
+	};
+
+	/* Writable view of a whole file mapped into memory. The file is created, or truncated, to the requested size.
+	Changes reach the file no later than when the view is destroyed
+	Throws std::runtime_error if file cannot be created or mapped
+	*/
+	class WritableMappedFile
+	{
+	protected:
+		char* Data;
+		size_t Size;
+#ifdef _WIN32
+		void* FileHandle;
+		void* MappingHandle;
+#else
+		int Descriptor;
+#endif
+	public:
+		WritableMappedFile(const std::string& path, size_t size);
+		~WritableMappedFile();
+
+		WritableMappedFile(const WritableMappedFile&) = delete;
+		WritableMappedFile& operator=(const WritableMappedFile&) = delete;
+
+		char* GetData();
+		const char* GetData() const;
+		size_t GetSize() const;
+
+		/// <summary>
+		/// Writes changes made to specified range back to the file, waiting until they're written
+		/// </summary>
+		void Flush(size_t offset, size_t size);
+
+		/// <summary>
+		/// Starts writing changes made to specified range back to the file without waiting for them,
+		/// and lets the system reclaim it's memory. Pages that hold data outside of the range are kept
+		/// </summary>
+		void Evict(size_t offset, size_t size);
+	};
+}
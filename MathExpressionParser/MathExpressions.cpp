@@ -23,11 +23,15 @@ SOFTWARE.
 */
 
 #define _USE_MATH_DEFINES
+#include <cerrno>
 #include <cmath>
+#include <cstdlib>
 #include <limits>
 #include <unordered_set>
 #include "Exceptions.hpp"
 #include "MathExpressions.hpp"
+#include "CompiledExpression.hpp"
+#include "Instrumentation.hpp"
 
 // Boilerplate for constructor implementation of tokens that take substring of expression as their constructor's first parameter
 #define TOKEN_CONSTR_IMPL(ClassName, BaseClass) MathExpressions::##ClassName##::##ClassName##(View<std::string> source_range \
@@ -37,12 +41,18 @@ MathExpressions::SourcedToken::SourcedToken(
     View<std::string> source_range
 ) : Source(source_range) {};
 
+void MathExpressions::SourcedToken::AppendSource(std::string& out_expression) const
+{
+    // Appending a range of iterators would construct a temporary string first
+    if (Source.Start != Source.End) out_expression.append(&*Source.Start, Source.End - Source.Start);
+}
+
 void MathExpressions::SourcedToken::Stringify(
     View<std::vector<Parser::TokenPtr>> tokens,
     std::vector<Parser::TokenPtr>::const_iterator cur_token,
     std::string& out_expression
 ) const {
-    out_expression += std::string(Source.Start, Source.End);
+    AppendSource(out_expression);
 }
 
 void MathExpressions::SourcedToken::Stringify(
@@ -50,7 +60,7 @@ void MathExpressions::SourcedToken::Stringify(
     const Tree<Parser::TokenPtr>::Node& cur_node,
     std::string& out_expression
 ) const {
-    out_expression += std::string(Source.Start, Source.End);
+    AppendSource(out_expression);
 }
 
 // Since almost no tokens use backpatching for anything, default is just doing nothing
@@ -68,7 +78,7 @@ TOKEN_CONSTR_IMPL(Token, SourcedToken);
 
 void MathExpressions::Token::EvaluateChildren(
     const Tree<Parser::TokenPtr>::NodePtr& ast_node,
-    std::vector<long double>& out_params,
+    MathExpressions::Allocation::Vector<long double>& out_params,
     const MathExpressions::Environment& env,
     size_t expected_param_count = 0
 ) const {
@@ -80,13 +90,51 @@ void MathExpressions::Token::EvaluateChildren(
     for (const Tree<Parser::TokenPtr>::NodePtr& node : ast_node->Children)
     {
         // Can't evaluate if several token do not belong to category of math expression tokens
-        auto token = std::dynamic_pointer_cast<const MathExpressions::Token>(node->Value);
+        // Casting the raw pointer avoids touching the reference count, which is shared between threads
+        auto token = dynamic_cast<const MathExpressions::Token*>(node->Value.get());
         if (!token) throw WrongTokenType(node->Value.get());
 
         out_params.push_back(token->Evaluate(node, env));
     }
 }
 
+void MathExpressions::Token::CompileChildren(
+    const Tree<Parser::TokenPtr>::Node& ast_node,
+    MathExpressions::Allocation::Vector<unsigned>& out_children,
+    MathExpressions::Program& out_program,
+    size_t expected_param_count
+) const {
+    if (expected_param_count && ast_node.Children.size() != expected_param_count)
+        throw UnexpectedSubexpressionCount(this, ast_node.Children.size(), expected_param_count);
+
+    for (const Tree<Parser::TokenPtr>::NodePtr& node : ast_node.Children)
+    {
+        auto token = dynamic_cast<const MathExpressions::Token*>(node->Value.get());
+        if (!token) throw WrongTokenType(node->Value.get());
+
+        out_children.push_back(token->Compile(*node, out_program));
+    }
+}
+
+unsigned MathExpressions::Token::CompileOperation(
+    const Tree<Parser::TokenPtr>::Node& ast_node,
+    MathExpressions::Program& out_program,
+    MathExpressions::OpCode op,
+    size_t expected_param_count
+) const {
+    Allocation::Vector<unsigned> params;
+    CompileChildren(ast_node, params, out_program, expected_param_count);
+
+    if (params.size() == 1) return out_program.Push(op, this, params[0]);
+
+    // Same order 'Evaluate' combines parameters in: first one is the initial value
+    unsigned res = params[0];
+    for (size_t i = 1; i < params.size(); i++)
+        res = out_program.Push(op, this, res, params[i]);
+
+    return res;
+}
+
 bool MathExpressions::Token::IsPrecedent(const Parser::IToken* other) const
 {
     /* Can't definitively tell the precedence between two tokens if 
@@ -126,11 +174,32 @@ size_t MathExpressions::Numeric::GetPriority() const
 
 TOKEN_CONSTR_IMPL(Number, Numeric);
 
+// Same as 'std::stold', but the null-terminated copy of the number comes from the current resource
+static long double ParseNumber(const View<std::string>& source)
+{
+    const MathExpressions::Allocation::String text(source.Start, source.End);
+
+    char* end = nullptr;
+    errno = 0;
+    const long double value = std::strtold(text.c_str(), &end);
+    if (end == text.c_str()) throw std::invalid_argument("stold");
+    if (errno == ERANGE) throw std::out_of_range("stold");
+
+    return value;
+}
+
 long double MathExpressions::Number::Evaluate(
     const Tree<Parser::TokenPtr>::NodePtr& node, 
     const MathExpressions::Environment& env
 ) const {
-    return std::stold(std::string(Source.Start, Source.End));
+    return ParseNumber(Source);
+}
+
+unsigned MathExpressions::Number::Compile(
+    const Tree<Parser::TokenPtr>::Node&, 
+    MathExpressions::Program& program
+) const {
+    return program.PushConstant(ParseNumber(Source), this);
 }
 
 TOKEN_CONSTR_IMPL(Pythagorean, Numeric);
@@ -142,6 +211,13 @@ long double MathExpressions::Pythagorean::Evaluate(
     return M_PI;
 }
 
+unsigned MathExpressions::Pythagorean::Compile(
+    const Tree<Parser::TokenPtr>::Node&, 
+    MathExpressions::Program& program
+) const {
+    return program.PushConstant(M_PI, this);
+}
+
 TOKEN_CONSTR_IMPL(ExponentConst, Numeric);
 
 long double MathExpressions::ExponentConst::Evaluate(
@@ -151,13 +227,25 @@ long double MathExpressions::ExponentConst::Evaluate(
     return M_E;
 }
 
+unsigned MathExpressions::ExponentConst::Compile(
+    const Tree<Parser::TokenPtr>::Node&, 
+    MathExpressions::Program& program
+) const {
+    return program.PushConstant(M_E, this);
+}
+
 TOKEN_CONSTR_IMPL(Variable, Numeric);
 
 long double MathExpressions::Variable::Evaluate(
     const Tree<Parser::TokenPtr>::NodePtr&, 
     const MathExpressions::Environment& env
 ) const {
-    std::string var_name(Source.Start, Source.End);
+    /* 'Environment' can only be searched with an 'std::string', so the name is copied into
+    a buffer each thread keeps around, which stops allocating once it fits the longest name.
+    Buffer lives as long as the thread, longer than any resource, so it's allocated from the global heap
+    */
+    static thread_local std::string var_name;
+    var_name.assign(Source.Start, Source.End);
     // Finds the value of the variable in 'env'
     Environment::const_iterator var_it = env.find(var_name);
     if (var_it == env.cend()) throw UnresolvedSymbol(this, var_name);
@@ -165,6 +253,14 @@ long double MathExpressions::Variable::Evaluate(
     return var_it->second;
 }
 
+unsigned MathExpressions::Variable::Compile(
+    const Tree<Parser::TokenPtr>::Node&, 
+    MathExpressions::Program& program
+) const {
+    // Environment is only looked up at evaluation, so for now just register the name
+    return program.PushVariable(std::string(Source.Start, Source.End), this);
+}
+
 TOKEN_CONSTR_IMPL(BinaryOp, Token);
 
 void MathExpressions::BinaryOp::SplitPoints(
@@ -218,7 +314,7 @@ long double MathExpressions::Add::Evaluate(const Tree<Parser::TokenPtr>::NodePtr
     // Operation result
     long double res = 0;
     // Evaluated children values
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env);
     
     for (long double param : params)
@@ -227,6 +323,13 @@ long double MathExpressions::Add::Evaluate(const Tree<Parser::TokenPtr>::NodePtr
     return res;
 }
 
+unsigned MathExpressions::Add::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    if (node.Children.size() < 2) throw UnexpectedSubexpressionCount(this, node.Children.size(), 2);
+
+    return CompileOperation(node, program, MathExpressions::OpCode::Add, 0);
+}
+
 TOKEN_CONSTR_IMPL(Sub, BinaryOp);
 
 void MathExpressions::Sub::Stringify(
@@ -259,7 +362,7 @@ long double MathExpressions::Sub::Evaluate(const Tree<Parser::TokenPtr>::NodePtr
     // Same as above
     if (node->Children.empty()) throw UnexpectedSubexpressionCount(this, node->Children.size(), 1);
 
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env);
 
     // Special rule for when minus sign is placed in front of another token without any applicable
@@ -278,6 +381,16 @@ long double MathExpressions::Sub::Evaluate(const Tree<Parser::TokenPtr>::NodePtr
     return res;
 }
 
+unsigned MathExpressions::Sub::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    if (node.Children.empty()) throw UnexpectedSubexpressionCount(this, 0, 1);
+
+    // Lone minus sign is a negation
+    if (node.Children.size() == 1) return CompileOperation(node, program, MathExpressions::OpCode::Negate, 1);
+
+    return CompileOperation(node, program, MathExpressions::OpCode::Sub, 0);
+}
+
 TOKEN_CONSTR_IMPL(Mul, BinaryOp);
 
 size_t MathExpressions::Mul::GetPriority() const
@@ -289,7 +402,7 @@ long double MathExpressions::Mul::Evaluate(const Tree<Parser::TokenPtr>::NodePtr
 {
     // Same as above
     long double res = 1;
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env);
 
     if (params.size() < 2) throw UnexpectedSubexpressionCount(this, params.size(), 2);
@@ -300,6 +413,13 @@ long double MathExpressions::Mul::Evaluate(const Tree<Parser::TokenPtr>::NodePtr
     return res;
 }
 
+unsigned MathExpressions::Mul::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    if (node.Children.size() < 2) throw UnexpectedSubexpressionCount(this, node.Children.size(), 2);
+
+    return CompileOperation(node, program, MathExpressions::OpCode::Mul, 0);
+}
+
 TOKEN_CONSTR_IMPL(Div, BinaryOp);
 
 size_t MathExpressions::Div::GetPriority() const
@@ -310,7 +430,7 @@ size_t MathExpressions::Div::GetPriority() const
 long double MathExpressions::Div::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
     // Same as above
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env);
 
     if (params.size() < 2) throw UnexpectedSubexpressionCount(this, params.size(), 2);
@@ -325,6 +445,13 @@ long double MathExpressions::Div::Evaluate(const Tree<Parser::TokenPtr>::NodePtr
     return res;
 }
 
+unsigned MathExpressions::Div::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    if (node.Children.size() < 2) throw UnexpectedSubexpressionCount(this, node.Children.size(), 2);
+
+    return CompileOperation(node, program, MathExpressions::OpCode::Div, 0);
+}
+
 TOKEN_CONSTR_IMPL(Pow, BinaryOp);
 
 size_t MathExpressions::Pow::GetPriority() const
@@ -334,7 +461,7 @@ size_t MathExpressions::Pow::GetPriority() const
 
 long double MathExpressions::Pow::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 2);
 
     // Cannot get root from negative numbers
@@ -343,6 +470,11 @@ long double MathExpressions::Pow::Evaluate(const Tree<Parser::TokenPtr>::NodePtr
     return powl(params[0], params[1]);
 }
 
+unsigned MathExpressions::Pow::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Pow, 2);
+}
+
 TOKEN_CONSTR_IMPL(Pair, Token);
 
 void MathExpressions::Pair::FindNextToken(
@@ -380,7 +512,7 @@ void MathExpressions::Pair::Stringify(
     // Closing tokens should be handled on a case-by-case basis
     SourcedToken::Stringify(tree, cur_node, out_expression);
 
-    for (Tree<Parser::TokenPtr>::NodePtr child_node : cur_node.Children)
+    for (const Tree<Parser::TokenPtr>::NodePtr& child_node : cur_node.Children)
         child_node->Value->Stringify(tree, *child_node, out_expression);
 }
 
@@ -428,10 +560,14 @@ void MathExpressions::DistinctPair::LookupMatchingToken(
         throw NoMatchingToken(this);
     }
 
+    MATHEXPRESSIONS_COUNT(PairLookups, 1);
+
     // If cached pair had already been found, linearly searching for it can be skipped
     const PairCacheMap::const_iterator it = PairCache.find(token_range.Source);
     if (it != PairCache.cend())
     {
+        MATHEXPRESSIONS_COUNT(PairCacheHits, 1);
+
         // If cached 'pair' turns out to be the end of the container,
         // this means that matching token couldn't be found during caching
         if (it->second != token_range.Source->cend())
@@ -490,12 +626,21 @@ bool MathExpressions::Bracket::IsMatchingToken(const Pair* token) const
 long double MathExpressions::Bracket::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
     // Simply pipe up whatever is inbetween
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return params[0];
 }
 
+unsigned MathExpressions::Bracket::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    // Brackets only shape the tree, so they don't need an instruction of their own
+    Allocation::Vector<unsigned> params;
+    CompileChildren(node, params, program, 1);
+
+    return params[0];
+}
+
 TOKEN_CONSTR_IMPL(IndistinctPair, Pair);
 
 void MathExpressions::IndistinctPair::LookupMatchingToken(
@@ -503,10 +648,14 @@ void MathExpressions::IndistinctPair::LookupMatchingToken(
     std::vector<Parser::TokenPtr>::const_iterator& out_token,
     bool safe
 ) const {
+    MATHEXPRESSIONS_COUNT(PairLookups, 1);
+
     // Same idea as with 'DistinctPair::LookupMatchingToken'
     PairCacheMap::const_iterator it = PairCache.find(token_range.Source);
     if (it != PairCache.cend())
     {
+        MATHEXPRESSIONS_COUNT(PairCacheHits, 1);
+
         if (it->second != token_range.Source->cend())
         {
             out_token = it->second;
@@ -557,12 +706,17 @@ long double MathExpressions::ModBracket::Evaluate(
     const MathExpressions::Environment& env
 ) const {
     // Return the absolute value of the value of whatever subexpression brackets have
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return fabsl(params[0]);
 }
 
+unsigned MathExpressions::ModBracket::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Abs, 1);
+}
+
 MathExpressions::Function::Function(
     View<std::string> source_range
 ) : DistinctPair(source_range, false) {};
@@ -593,32 +747,47 @@ TOKEN_CONSTR_IMPL(LogarithmE, Function);
 
 long double MathExpressions::LogarithmE::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return logl(params[0]);
 }
 
+unsigned MathExpressions::LogarithmE::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::LogE, 1);
+}
+
 TOKEN_CONSTR_IMPL(Logarithm2, Function);
 
 long double MathExpressions::Logarithm2::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return log2l(params[0]);
 }
 
+unsigned MathExpressions::Logarithm2::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Log2, 1);
+}
+
 TOKEN_CONSTR_IMPL(Logarithm10, Function);
 
 long double MathExpressions::Logarithm10::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return log10l(params[0]);
 }
 
+unsigned MathExpressions::Logarithm10::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Log10, 1);
+}
+
 TOKEN_CONSTR_IMPL(ArgumentedFunction, Function);
 
 void MathExpressions::ArgumentedFunction::SplitPoints(
@@ -675,33 +844,45 @@ void MathExpressions::ArgumentedFunction::Stringify(
         out_expression.append(", ");
         (*it)->Value->Stringify(tree, **it, out_expression);
     }
+
+    out_expression.push_back(')');
 }
 
 TOKEN_CONSTR_IMPL(Logarithm, ArgumentedFunction);
 
 long double MathExpressions::Logarithm::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 2);
 
     return log2l(params[0]) / log2l(params[1]);
 }
 
+unsigned MathExpressions::Logarithm::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Log, 2);
+}
+
 TOKEN_CONSTR_IMPL(ExponentFunc, Function);
 
 long double MathExpressions::ExponentFunc::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return expl(params[0]);
 }
 
+unsigned MathExpressions::ExponentFunc::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Exp, 1);
+}
+
 TOKEN_CONSTR_IMPL(SquareRoot, Function);
 
 long double MathExpressions::SquareRoot::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     if (params[0] < 0) throw NegativeNumberRoot(this);
@@ -709,146 +890,242 @@ long double MathExpressions::SquareRoot::Evaluate(const Tree<Parser::TokenPtr>::
     return sqrtl(params[0]);
 }
 
+unsigned MathExpressions::SquareRoot::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Sqrt, 1);
+}
+
 TOKEN_CONSTR_IMPL(Sign, Function);
 
 long double MathExpressions::Sign::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return (params[0] == 0) ? 0 : ((params[0] > 0) ? 1 : -1);
 }
 
+unsigned MathExpressions::Sign::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Sign, 1);
+}
+
 TOKEN_CONSTR_IMPL(Sine, Function);
 
 long double MathExpressions::Sine::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return sinl(params[0]);
 }
 
+unsigned MathExpressions::Sine::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Sin, 1);
+}
+
 TOKEN_CONSTR_IMPL(Cosine, Function);
 
 long double MathExpressions::Cosine::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return cosl(params[0]);
 }
 
+unsigned MathExpressions::Cosine::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Cos, 1);
+}
+
 TOKEN_CONSTR_IMPL(Tangent, Function);
 
 long double MathExpressions::Tangent::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return tanl(params[0]);
 }
 
+unsigned MathExpressions::Tangent::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Tan, 1);
+}
+
 TOKEN_CONSTR_IMPL(Cotangent, Function);
 
 long double MathExpressions::Cotangent::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return 1 / tanl(params[0]);
 }
 
+unsigned MathExpressions::Cotangent::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Cot, 1);
+}
+
 TOKEN_CONSTR_IMPL(Arcsine, Function);
 
 long double MathExpressions::Arcsine::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return asinl(params[0]);
 }
 
+unsigned MathExpressions::Arcsine::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Asin, 1);
+}
+
 TOKEN_CONSTR_IMPL(Arccosine, Function);
 
 long double MathExpressions::Arccosine::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return acosl(params[0]);
 }
 
+unsigned MathExpressions::Arccosine::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Acos, 1);
+}
+
 TOKEN_CONSTR_IMPL(Arctangent, Function);
 
 long double MathExpressions::Arctangent::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return atanl(params[0]);
 }
 
+unsigned MathExpressions::Arctangent::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Atan, 1);
+}
+
 TOKEN_CONSTR_IMPL(HyperbolicSine, Function);
 
 long double MathExpressions::HyperbolicSine::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return sinhl(params[0]);
 }
 
+unsigned MathExpressions::HyperbolicSine::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Sinh, 1);
+}
+
 TOKEN_CONSTR_IMPL(HyperbolicCosine, Function);
 
 long double MathExpressions::HyperbolicCosine::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return coshl(params[0]);
 }
 
+unsigned MathExpressions::HyperbolicCosine::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Cosh, 1);
+}
+
 TOKEN_CONSTR_IMPL(HyperbolicTangent, Function);
 
 long double MathExpressions::HyperbolicTangent::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return tanhl(params[0]);
 }
 
+unsigned MathExpressions::HyperbolicTangent::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Tanh, 1);
+}
+
 TOKEN_CONSTR_IMPL(HyperbolicArcsine, Function);
 
 long double MathExpressions::HyperbolicArcsine::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return asinhl(params[0]);
 }
 
+unsigned MathExpressions::HyperbolicArcsine::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Asinh, 1);
+}
+
 TOKEN_CONSTR_IMPL(HyperbolicArccosine, Function);
 
 long double MathExpressions::HyperbolicArccosine::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return acoshl(params[0]);
 }
 
+unsigned MathExpressions::HyperbolicArccosine::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Acosh, 1);
+}
+
 TOKEN_CONSTR_IMPL(HyperbolicArctangent, Function);
 
 long double MathExpressions::HyperbolicArctangent::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
 {
-    std::vector<long double> params;
+    Allocation::Vector<long double> params;
     EvaluateChildren(node, params, env, 1);
 
     return atanhl(params[0]);
 }
 
+unsigned MathExpressions::HyperbolicArctangent::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    return CompileOperation(node, program, MathExpressions::OpCode::Atanh, 1);
+}
+
+MathExpressions::NativeFunctionCall::NativeFunctionCall(
+    View<std::string> source_range,
+    const MathExpressions::NativeFunction* function
+) : ArgumentedFunction(source_range), Function(function) {};
+
+long double MathExpressions::NativeFunctionCall::Evaluate(const Tree<Parser::TokenPtr>::NodePtr& node, const MathExpressions::Environment& env) const
+{
+    Allocation::Vector<long double> params;
+    EvaluateChildren(node, params, env, Function->Arity);
+
+    return Function->Scalar(params.data());
+}
+
+unsigned MathExpressions::NativeFunctionCall::Compile(const Tree<Parser::TokenPtr>::Node& node, MathExpressions::Program& program) const
+{
+    Allocation::Vector<unsigned> params;
+    CompileChildren(node, params, program, Function->Arity);
+
+    return program.PushCall(*Function, this, std::vector<unsigned>(params.begin(), params.end()));
+}
+
 // Set of factories fed to 'Parse' method of a parser
 // Matches a number
 static Parser::TokenPtr MET_NumberFactory(const std::string& in_expr, size_t& cursor)
@@ -879,7 +1156,7 @@ static Parser::TokenPtr MET_NumberFactory(const std::string& in_expr, size_t& cu
     // If there were no digits, bail
     if (cursor == original_cursor) return Parser::TokenPtr();
 
-    return std::make_shared<MathExpressions::Number>(
+    return MathExpressions::Allocation::MakeShared<MathExpressions::Number>(
         View<std::string>(&in_expr, in_expr.cbegin() + original_cursor, in_expr.cbegin() + cursor)
     );
 }
@@ -896,7 +1173,7 @@ static Parser::TokenPtr TokenFromCharacter(
         std::string::const_iterator start = in_expr.cbegin() + cursor;
         ++cursor;
         std::string::const_iterator end = in_expr.cbegin() + cursor;
-        return std::make_shared<T>(View<std::string>(&in_expr, start, end));
+        return MathExpressions::Allocation::MakeShared<T>(View<std::string>(&in_expr, start, end));
     }
 
     return Parser::TokenPtr();
@@ -935,7 +1212,7 @@ static Parser::TokenPtr TokenFromString(
     }
 
     if (is_equal)
-        return std::make_shared<T>(View<std::string>(&in_expr, in_expr.cbegin() + original_cursor, in_expr.cbegin() + cursor));
+        return MathExpressions::Allocation::MakeShared<T>(View<std::string>(&in_expr, in_expr.cbegin() + original_cursor, in_expr.cbegin() + cursor));
     
     cursor = original_cursor;
     return Parser::TokenPtr();
@@ -994,14 +1271,14 @@ static Parser::TokenPtr MET_BracketFactory(const std::string& in_expr, size_t& c
     {
         cursor++;
         // If bracket is opening, the 'Variant' on Bracket instance is set to false
-        return std::make_shared<MathExpressions::Bracket>(View<std::string>(&in_expr, start, end), false);
+        return MathExpressions::Allocation::MakeShared<MathExpressions::Bracket>(View<std::string>(&in_expr, start, end), false);
     }
 
     if (in_expr[cursor] == ')')
     {
         cursor++;
         // ...otherwise it's set to true
-        return std::make_shared<MathExpressions::Bracket>(View<std::string>(&in_expr, start, end), true);
+        return MathExpressions::Allocation::MakeShared<MathExpressions::Bracket>(View<std::string>(&in_expr, start, end), true);
     }
 
     return Parser::TokenPtr();
@@ -1149,7 +1426,26 @@ static Parser::TokenPtr MET_HyperbolicArctangentFactory(const std::string& in_ex
 {
     static const std::vector<std::string> func_aliases = { "atgh(", "atanh(", "arctgh(", "arctanh(" };
 
-    return TokenFromEitherStrings<MathExpressions::HyperbolicTangent>(in_expr, cursor, func_aliases);
+    return TokenFromEitherStrings<MathExpressions::HyperbolicArctangent>(in_expr, cursor, func_aliases);
+}
+
+// Matches a name followed by an opening bracket, if a native function is registered under that name
+static Parser::TokenPtr MET_NativeFunctionFactory(const std::string& in_expr, size_t& cursor)
+{
+    std::string::const_iterator start = in_expr.cbegin() + cursor, end = start;
+    for (; end != in_expr.cend() && std::isalpha(static_cast<unsigned char>(*end)); ++end);
+
+    if (start == end || end == in_expr.cend() || *end != '(') return Parser::TokenPtr();
+
+    // Names are only looked up when they're followed by a bracket, so variables cost no lookups
+    const MathExpressions::NativeFunction* function = MathExpressions::FindNativeFunction(std::string(start, end));
+    if (!function) return Parser::TokenPtr();
+
+    ++end;
+    cursor = end - in_expr.cbegin();
+    return MathExpressions::Allocation::MakeShared<MathExpressions::NativeFunctionCall>(
+        View<std::string>(&in_expr, start, end), function
+    );
 }
 
 static Parser::TokenPtr MET_VariableFactory(const std::string& in_expr, size_t& cursor)
@@ -1158,7 +1454,7 @@ static Parser::TokenPtr MET_VariableFactory(const std::string& in_expr, size_t&
     for (; end != in_expr.cend() && std::isalpha(*end); ++end, ++cursor);
 
     return (start != end) ? 
-        std::make_shared<MathExpressions::Variable>(View<std::string>(&in_expr, start, end)) :
+        MathExpressions::Allocation::MakeShared<MathExpressions::Variable>(View<std::string>(&in_expr, start, end)) :
         Parser::TokenPtr();
 }
 
@@ -1215,46 +1511,79 @@ static Parser::TokenPtr MET_WhitespaceFactory(const std::string& in_expr, size_t
     return Parser::TokenPtr();
 }
 
-const std::vector<Parser::TokenFactory>& MathExpressions::GetTokenFactories()
+#ifdef MATHEXPRESSIONS_INSTRUMENTATION
+// Counts every attempt to match a token with the factory
+template<Parser::TokenPtr (*Factory)(const std::string&, size_t&)>
+static Parser::TokenPtr CountedFactory(const std::string& in_expr, size_t& cursor)
 {
-    /* Pre - generated vector with all the factories packed into it
-    Notice the order. Because parser just iterates over this vector linearly,
-    order of factories determines their priority. For instance, nothing stopping
-    'pi' from being just two consequtive variables, but because MET_PythagoreanFactory
-    is ordered before MET_VariableFactory, it always matches as a pi constant
-    */
-    static const std::vector<Parser::TokenFactory> ME_Factories = 
+    MATHEXPRESSIONS_COUNT(FactoryAttempts, 1);
+
+    return Factory(in_expr, cursor);
+}
+
+#define MET_FACTORY(factory) CountedFactory<factory>
+#else
+#define MET_FACTORY(factory) factory
+#endif
+
+/* Builds the vector with all the factories packed into it
+Notice the order. Because parser just iterates over this vector linearly,
+order of factories determines their priority. For instance, nothing stopping
+'pi' from being just two consequtive variables, but because MET_PythagoreanFactory
+is ordered before MET_VariableFactory, it always matches as a pi constant
+*/
+static std::vector<Parser::TokenFactory> BuildTokenFactories(const Parser::TokenFactory& functions)
+{
+    std::vector<Parser::TokenFactory> factories =
     { 
-        MET_WhitespaceFactory, 
-
-        MET_BracketFactory, MET_ModBracketFactory,
-
-        MET_AddFactory, MET_SubFactory,
-        MET_MulFactory, MET_DivFactory,
-        MET_PowFactory,
-
-        MET_LogarithmEFactory, MET_Logarithm2Factory,
-        MET_Logarithm10Factory, MET_LogarithmFactory,
-        MET_ExponentFuncFactory,
-        MET_SquareRootFactory, MET_SignFactory,
-        MET_SineFactory, MET_CosineFactory,
-        MET_TangentFactory, MET_CotangentFactory,
-        MET_ArcsineFactory, MET_ArccosineFactory,
-        MET_ArctangentFactory,
-        MET_HyperbolicSineFactory, MET_HyperbolicCosineFactory,
-        MET_HyperbolicTangentFactory,
-        MET_HyperbolicArcsineFactory, MET_HyperbolicArccosineFactory,
-        MET_HyperbolicArctangentFactory,
-
-        MET_SeparatorFactory,
-
-        MET_NumberFactory, MET_PythagoreanFactory,
-        MET_ExponentConstFactory, MET_VariableFactory
+        MET_FACTORY(MET_WhitespaceFactory), 
+
+        MET_FACTORY(MET_BracketFactory), MET_FACTORY(MET_ModBracketFactory),
+
+        MET_FACTORY(MET_AddFactory), MET_FACTORY(MET_SubFactory),
+        MET_FACTORY(MET_MulFactory), MET_FACTORY(MET_DivFactory),
+        MET_FACTORY(MET_PowFactory),
+
+        MET_FACTORY(MET_LogarithmEFactory), MET_FACTORY(MET_Logarithm2Factory),
+        MET_FACTORY(MET_Logarithm10Factory), MET_FACTORY(MET_LogarithmFactory),
+        MET_FACTORY(MET_ExponentFuncFactory),
+        MET_FACTORY(MET_SquareRootFactory), MET_FACTORY(MET_SignFactory),
+        MET_FACTORY(MET_SineFactory), MET_FACTORY(MET_CosineFactory),
+        MET_FACTORY(MET_TangentFactory), MET_FACTORY(MET_CotangentFactory),
+        MET_FACTORY(MET_ArcsineFactory), MET_FACTORY(MET_ArccosineFactory),
+        MET_FACTORY(MET_ArctangentFactory),
+        MET_FACTORY(MET_HyperbolicSineFactory), MET_FACTORY(MET_HyperbolicCosineFactory),
+        MET_FACTORY(MET_HyperbolicTangentFactory),
+        MET_FACTORY(MET_HyperbolicArcsineFactory), MET_FACTORY(MET_HyperbolicArccosineFactory),
+        MET_FACTORY(MET_HyperbolicArctangentFactory),
+        MET_FACTORY(MET_NativeFunctionFactory)
     };
 
+    // Functions have to be matched before variables, as names of both are runs of letters
+    if (functions) factories.push_back(functions);
+
+    factories.insert(factories.end(), {
+        MET_FACTORY(MET_SeparatorFactory),
+
+        MET_FACTORY(MET_NumberFactory), MET_FACTORY(MET_PythagoreanFactory),
+        MET_FACTORY(MET_ExponentConstFactory), MET_FACTORY(MET_VariableFactory)
+    });
+
+    return factories;
+}
+
+const std::vector<Parser::TokenFactory>& MathExpressions::GetTokenFactories()
+{
+    static const std::vector<Parser::TokenFactory> ME_Factories = BuildTokenFactories(Parser::TokenFactory());
+
     return ME_Factories;
 }
 
+std::vector<Parser::TokenFactory> MathExpressions::GetTokenFactories(const Parser::TokenFactory& functions)
+{
+    return BuildTokenFactories(functions);
+}
+
 long double MathExpressions::Evaluate(
     const std::string& expression, 
     const Environment& env, 
@@ -1265,12 +1594,26 @@ long double MathExpressions::Evaluate(
 
     Parser::Engine parser;
 
-    // Identify tokens in the string
-    parser.Tokenize(MathExpressions::GetTokenFactories(), expression, out_tokens);
-    // Fill-in any information other token require that involve other tokens
-    parser.Backpatch(out_tokens);
-    // Build an AST out of provided tokens
-    parser.Parse(out_tokens, out_ast);
+    {
+        MATHEXPRESSIONS_TIME_PHASE(Tokenize);
+        Allocation::PhaseScope allocation_phase(Allocation::Phase::Tokenize);
+        // Identify tokens in the string
+        parser.Tokenize(MathExpressions::GetTokenFactories(), expression, out_tokens);
+    }
+    MATHEXPRESSIONS_COUNT(Tokens, out_tokens.size());
+    {
+        MATHEXPRESSIONS_TIME_PHASE(Backpatch);
+        Allocation::PhaseScope allocation_phase(Allocation::Phase::Backpatch);
+        // Fill-in any information other token require that involve other tokens
+        parser.Backpatch(out_tokens);
+    }
+    {
+        MATHEXPRESSIONS_TIME_PHASE(Parse);
+        Allocation::PhaseScope allocation_phase(Allocation::Phase::Parse);
+        // Build an AST out of provided tokens
+        parser.Parse(out_tokens, out_ast);
+    }
+    MATHEXPRESSIONS_COUNT(Nodes, Instrumentation::CountNodes(out_ast));
 
     // If result contains something that isn't a subclass of 'MathExpression::Token', something went wrong
     const Parser::TokenPtr token = out_ast.Root->Value;
@@ -1278,5 +1621,8 @@ long double MathExpressions::Evaluate(
     if (!math_token) throw std::runtime_error("Parser did not return correct token type ('MathExpression::Token')");
 
     // Calculate and return the result
+    MATHEXPRESSIONS_TIME_PHASE(Evaluate);
+    MATHEXPRESSIONS_COUNT(Evaluations, 1);
+    Allocation::PhaseScope allocation_phase(Allocation::Phase::Evaluate);
     return math_token->Evaluate(out_ast.Root, env);
 }
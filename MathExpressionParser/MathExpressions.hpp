@@ -30,6 +30,7 @@ SOFTWARE.
 #include <unordered_map>
 #include "Parser/Parser.hpp"
 #include "Parser/Tree.hpp"
+#include "Allocation.hpp"
 
 // Boilerplate for constructor definition of tokens which constructors take in a range of source expression as a parameter
 #define TOKEN_CONSTR_DEF(ClassName, ...) ClassName##(View<std::string>, ##__VA_ARGS__##)
@@ -39,6 +40,12 @@ namespace MathExpressions
 	// Type that defines how variables are stored
 	using Environment = std::unordered_map<std::string, long double>;
 
+	// Flat representation of an AST tokens compile themselves into. Defined in 'CompiledExpression.hpp'
+	class Program;
+	enum class OpCode : unsigned char;
+	// Function implemented in C++ and registered by name. Defined in 'NativeFunctions.hpp'
+	struct NativeFunction;
+
 	// Token implementation that tracks where it has been sourced from
 	struct SourcedToken : public Parser::IToken
 	{
@@ -46,6 +53,11 @@ namespace MathExpressions
 
 		TOKEN_CONSTR_DEF(SourcedToken);
 
+		/// <summary>
+		/// Appends the part of the expression this token has been sourced from, without allocating anything but the output
+		/// </summary>
+		void AppendSource(std::string& out_expression) const;
+
 		virtual void Stringify(
 			View<std::vector<Parser::TokenPtr>> tokens,
 			std::vector<Parser::TokenPtr>::const_iterator cur_token,
@@ -103,10 +115,39 @@ namespace MathExpressions
 		/// if number of children doesn't match this</param>
 		void EvaluateChildren(
 			const Tree<Parser::TokenPtr>::NodePtr& cur_node,
-			std::vector<long double>& out_children,  
+			Allocation::Vector<long double>& out_children,  
 			const Environment& env,
 			size_t expected_param_count
 		) const;
+
+		/// <summary>
+		/// Compiles this token's child tokens down the ast
+		/// </summary>
+		/// <param name="cur_node">- node in the tree being compiled with it's associated token
+		/// being this one</param>
+		/// <param name="out_children">- indices of instructions that compute this token's children</param>
+		/// <param name="out_program">- program instructions are appended to</param>
+		/// <param name="expected_param_count">- a number of expected children.
+		/// If non-zero, automatically throws UnexpectedSubexpressionCount 
+		/// if number of children doesn't match this</param>
+		void CompileChildren(
+			const Tree<Parser::TokenPtr>::Node& cur_node,
+			Allocation::Vector<unsigned>& out_children,
+			Program& out_program,
+			size_t expected_param_count = 0
+		) const;
+
+		/// <summary>
+		/// Compiles children, then applies operation to them.
+		/// If there are more than two children, operation is folded over them from left to right
+		/// </summary>
+		/// <returns>Index of the instruction holding the result</returns>
+		unsigned CompileOperation(
+			const Tree<Parser::TokenPtr>::Node& cur_node,
+			Program& out_program,
+			OpCode op,
+			size_t expected_param_count
+		) const;
 	public:
 		TOKEN_CONSTR_DEF(Token);
 
@@ -130,6 +171,20 @@ namespace MathExpressions
 			const Environment& env
 		) const = 0;
 
+		/// <summary>
+		/// Appends instructions that compute the value of this token to the program.
+		/// Performs the same checks 'Evaluate' does on the structure of the tree, 
+		/// so compiled program only has to deal with errors that depend on values
+		/// </summary>
+		/// <param name="cur_node">- node in the tree being compiled with it's associated token
+		/// being this one</param>
+		/// <param name="out_program">- program instructions are appended to</param>
+		/// <returns>Index of the instruction holding the result</returns>
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node& cur_node,
+			Program& out_program
+		) const = 0;
+
 		virtual bool IsPrecedent(const Parser::IToken*) const override;
 
 		virtual void FindNextToken(
@@ -166,6 +221,11 @@ namespace MathExpressions
 			const Tree<Parser::TokenPtr>::NodePtr&,
 			const Environment&
 		) const override;
+
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node&,
+			Program&
+		) const override;
 	};
 
 	/* Pi
@@ -180,6 +240,11 @@ namespace MathExpressions
 			const Tree<Parser::TokenPtr>::NodePtr&,
 			const Environment&
 		) const override;
+
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node&,
+			Program&
+		) const override;
 	};
 
 	/* Euler's number
@@ -194,6 +259,11 @@ namespace MathExpressions
 			const Tree<Parser::TokenPtr>::NodePtr&,
 			const Environment&
 		) const override;
+
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node&,
+			Program&
+		) const override;
 	};
 
 	/* Variable
@@ -211,6 +281,11 @@ namespace MathExpressions
 			const Tree<Parser::TokenPtr>::NodePtr&,
 			const Environment&
 		) const override;
+
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node&,
+			Program&
+		) const override;
 	};
 
 	/* Basic class for any binary operation - an operation that takes two children and combines their values in a specific way
@@ -251,6 +326,11 @@ namespace MathExpressions
 			const Tree<Parser::TokenPtr>::NodePtr&,
 			const Environment&
 		) const override;
+
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node&,
+			Program&
+		) const override;
 	};
 
 	/* Subtraction
@@ -276,6 +356,11 @@ namespace MathExpressions
 			const Tree<Parser::TokenPtr>::NodePtr&,
 			const Environment&
 		) const override;
+
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node&,
+			Program&
+		) const override;
 	};
 
 	/* Multiplication
@@ -292,6 +377,11 @@ namespace MathExpressions
 			const Tree<Parser::TokenPtr>::NodePtr&,
 			const Environment&
 		) const override;
+
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node&,
+			Program&
+		) const override;
 	};
 
 	/* Division
@@ -308,6 +398,11 @@ namespace MathExpressions
 			const Tree<Parser::TokenPtr>::NodePtr&,
 			const Environment&
 		) const override;
+
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node&,
+			Program&
+		) const override;
 	};
 
 	/* Power
@@ -324,6 +419,11 @@ namespace MathExpressions
 			const Tree<Parser::TokenPtr>::NodePtr&,
 			const Environment&
 		) const override;
+
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node&,
+			Program&
+		) const override;
 	};
 
 	/* Basic class for a token that needs to have some sort of pair in expression it's in
@@ -445,6 +545,11 @@ namespace MathExpressions
 			const Tree<Parser::TokenPtr>::NodePtr&,
 			const Environment&
 		) const override;
+
+		virtual unsigned Compile(
+			const Tree<Parser::TokenPtr>::Node&,
+			Program&
+		) const override;
 	};
 
 	// Base class for pairs of identical tokens
@@ -477,6 +582,8 @@ namespace MathExpressions
 		virtual bool IsMatchingToken(const Pair*) const override;
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Base class for functions
@@ -510,6 +617,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(LogarithmE);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Logarithm with the base of 2
@@ -521,6 +630,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Logarithm2);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Logarithm with the base of 10
@@ -532,6 +643,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Logarithm10);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	// Base for function with multiple arguments
@@ -563,6 +676,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Logarithm);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Euler's number raised to a power
@@ -574,6 +689,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(ExponentFunc);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Square root
@@ -586,6 +703,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(SquareRoot);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Sign
@@ -600,6 +719,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Sign);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Sine
@@ -611,6 +732,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Sine);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Cosine
@@ -622,6 +745,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Cosine);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Tangent
@@ -633,6 +758,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Tangent);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Cotangent
@@ -644,6 +771,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Cotangent);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Arcsine
@@ -655,6 +784,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Arcsine);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Arccosine
@@ -666,6 +797,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Arccosine);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Arctangent
@@ -677,6 +810,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(Arctangent);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Hyperbolic sine
@@ -688,6 +823,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(HyperbolicSine);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Hyperbolic cosine
@@ -699,6 +836,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(HyperbolicCosine);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Hyperbolic tangent
@@ -710,6 +849,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(HyperbolicTangent);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Hyperbolic arcsine
@@ -721,6 +862,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(HyperbolicArcsine);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Hyperbolic arccosine
@@ -732,6 +875,8 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(HyperbolicArccosine);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/* Hyperbolic arctangent
@@ -743,6 +888,25 @@ namespace MathExpressions
 		TOKEN_CONSTR_DEF(HyperbolicArctangent);
 
 		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
+	};
+
+	/* Call of a registered native function
+	Evaluates 'A(...)' by passing values of parameters to the implementation of 'A',
+	where 'A' - name of the function (see 'RegisterNativeFunction').
+	If parameter count doesn't match function's arity, throws UnexpectedSubexpressionCount
+	*/
+	class NativeFunctionCall : public ArgumentedFunction
+	{
+	public:
+		const NativeFunction* Function;
+
+		TOKEN_CONSTR_DEF(NativeFunctionCall, const NativeFunction*);
+
+		virtual long double Evaluate(const Tree<Parser::TokenPtr>::NodePtr&, const Environment&) const override;
+
+		virtual unsigned Compile(const Tree<Parser::TokenPtr>::Node&, Program&) const override;
 	};
 
 	/// <summary>
@@ -750,6 +914,12 @@ namespace MathExpressions
 	/// </summary>
 	const std::vector<Parser::TokenFactory>& GetTokenFactories();
 
+	/// <summary>
+	/// Same factories, plus one that matches additional functions (e.g. those of a 'FunctionLibrary').
+	/// It's tried after built-in and native functions, but before constants and variables
+	/// </summary>
+	std::vector<Parser::TokenFactory> GetTokenFactories(const Parser::TokenFactory& functions);
+
 	/// <summary>
 	/// Shorthand that tokenizes, parses and evaluates expression in provided string and environment
 	/// </summary>
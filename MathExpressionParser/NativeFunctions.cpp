@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cctype>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include "NativeFunctions.hpp"
+
+// Names the tokenizer matches before native functions, which would therefore never be called
+static const char* const ReservedNames[] = {
+    "ln", "log2", "log10", "log", "exp", "sqrt", "sign", "sin", "cos",
+    "tg", "tan", "ctg", "ctan", "asin", "arcsin", "acos", "arccos", "atg", "atan", "arctg", "arctan",
+    "sinh", "cosh", "tgh", "tanh", "asinh", "arcsinh", "acosh", "arccosh", "atgh", "atanh", "arctgh", "arctanh",
+    "pi", "e"
+};
+
+/* Registered functions by name
+Elements of an unordered map never move, so pointers to them stay valid as the registry grows.
+Tokenizers of different threads look functions up concurrently, hence the mutex
+*/
+struct NativeRegistry
+{
+    std::mutex Mutex;
+    std::unordered_map<std::string, MathExpressions::NativeFunction> Functions;
+};
+
+static NativeRegistry& GetRegistry()
+{
+    static NativeRegistry registry;
+
+    return registry;
+}
+
+void MathExpressions::RegisterNativeFunction(const MathExpressions::NativeFunction& function)
+{
+    if (function.Name.empty()) throw std::invalid_argument("Native function must have a name");
+    for (char ch : function.Name)
+        if (!std::isalpha(static_cast<unsigned char>(ch)))
+            throw std::invalid_argument("Name of native function '" + function.Name + "' may only consist of letters");
+
+    if (MathExpressions::IsReservedName(function.Name))
+        throw std::invalid_argument("'" + function.Name + "' is a built-in name");
+
+    if (function.Arity < 1 || function.Arity > NativeFunction::MaxArity)
+        throw std::invalid_argument("Native function '" + function.Name + "' has unsupported arity");
+    if (!function.Scalar)
+        throw std::invalid_argument("Native function '" + function.Name + "' has no scalar implementation");
+
+    NativeRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+
+    if (!registry.Functions.insert(std::make_pair(function.Name, function)).second)
+        throw std::invalid_argument("Native function '" + function.Name + "' is already registered");
+}
+
+bool MathExpressions::IsReservedName(const std::string& name)
+{
+    for (const char* reserved : ReservedNames)
+        if (name == reserved) return true;
+
+    return false;
+}
+
+bool MathExpressions::IsVariableName(const std::string& name)
+{
+    if (name.empty() || IsReservedName(name)) return false;
+
+    for (char ch : name)
+        if (!std::isalpha(static_cast<unsigned char>(ch))) return false;
+
+    // Constants are matched before variables
+    return name[0] != 'e' && name.compare(0, 2, "pi") != 0;
+}
+
+const MathExpressions::NativeFunction* MathExpressions::FindNativeFunction(const std::string& name)
+{
+    NativeRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+
+    auto it = registry.Functions.find(name);
+
+    return it != registry.Functions.cend() ? &it->second : nullptr;
+}
@@ -0,0 +1,90 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace MathExpressions
+{
+	/// <summary>
+	/// Scalar implementation of a native function. Receives exactly as many arguments as the function declares
+	/// </summary>
+	using NativeScalar = long double (*)(const long double* arguments);
+
+	/// <summary>
+	/// Batch implementation of a native function. Computes 'count' rows at once, where 'arguments[i]'
+	/// points to 'count' values of the i-th argument, and writes results to 'out_values'
+	/// </summary>
+	using NativeBatch = void (*)(const long double* const* arguments, size_t count, long double* out_values);
+
+	/* Function implemented in C++ that expressions call by name, e.g. 'hypot(x, y)'
+	Calls are compiled into a single instruction that invokes the implementation directly,
+	without tokens, virtual calls or allocations. Errors are reported the way built-in functions do,
+	by returning NaN, since the implementation has no way to fail evaluation
+	*/
+	struct NativeFunction
+	{
+		// Most arguments a native function can take
+		static const size_t MaxArity = 8;
+
+		// Consists of letters only, same as variables
+		std::string Name;
+		// Number of arguments, from 1 to 'MaxArity'
+		size_t Arity;
+		// Whether the function always returns the same value for the same arguments and has no side effects.
+		// Calls of pure functions with the same arguments may be computed once, and arguments of such calls may be computed
+		// on other threads, while impure ones are always called, in program order
+		bool Pure;
+		NativeScalar Scalar;
+		// Optional. Batch evaluation calls 'Scalar' row by row if it's null
+		NativeBatch Batch;
+	};
+
+	/// <summary>
+	/// Registers a function, so expressions compiled from now on recognize calls of it.
+	/// Registrations are permanent, as compiled expressions refer to functions directly.
+	/// Throws std::invalid_argument if the name is taken (including by built-in functions and constants),
+	/// isn't made of letters, or if arity or scalar implementation are invalid
+	/// </summary>
+	void RegisterNativeFunction(const NativeFunction& function);
+
+	/// <summary>
+	/// Whether the name belongs to a built-in function or constant, which the tokenizer matches before anything else
+	/// </summary>
+	bool IsReservedName(const std::string& name);
+
+	/// <summary>
+	/// Whether the name reads back as a single variable: it consists of letters, isn't a built-in name,
+	/// and doesn't start with a constant, which the tokenizer would split it at (e.g. 'epsilon' reads as 'e' and 'psilon')
+	/// </summary>
+	bool IsVariableName(const std::string& name);
+
+	/// <summary>
+	/// Looks up a registered function by name
+	/// </summary>
+	/// <returns>Registered function, or null if there's none with such name</returns>
+	const NativeFunction* FindNativeFunction(const std::string& name);
+}
@@ -0,0 +1,406 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include "ParallelEvaluation.hpp"
+
+// Pool and queue of the current thread, if it belongs to a pool
+static thread_local const MathExpressions::TaskPool* CurrentPool = nullptr;
+static thread_local size_t CurrentQueue = 0;
+// Number of tasks the current thread runs while joining others. Past the limit it only waits, so the stack stays bounded
+static thread_local size_t JoinDepth = 0;
+static const size_t MaxJoinDepth = 256;
+
+MathExpressions::TaskPool::Task::Task(std::function<void()> work) : Work(std::move(work)), Done(false) {}
+
+MathExpressions::TaskPool::TaskPool(size_t thread_count) : Pending(0), Stopping(false)
+{
+    if (!thread_count) thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+    Queues.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; i++) Queues.emplace_back(new Queue());
+    for (size_t i = 1; i < thread_count; i++) Threads.emplace_back(&TaskPool::RunThread, this, i);
+}
+
+MathExpressions::TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(SleepMutex);
+        Stopping = true;
+    }
+    Wakeup.notify_all();
+
+    for (std::thread& thread : Threads) thread.join();
+}
+
+size_t MathExpressions::TaskPool::GetThreadCount() const
+{
+    return Queues.size();
+}
+
+size_t MathExpressions::TaskPool::GetQueueIndex() const
+{
+    return (CurrentPool == this) ? CurrentQueue : 0;
+}
+
+void MathExpressions::TaskPool::Fork(MathExpressions::TaskPool::Task& task)
+{
+    // Counted before it's queued, so a thread that takes it never sees the counter drop below zero
+    {
+        std::lock_guard<std::mutex> lock(SleepMutex);
+        Pending.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Queue& queue = *Queues[GetQueueIndex()];
+    {
+        std::lock_guard<std::mutex> lock(queue.Mutex);
+        queue.Tasks.push_back(&task);
+    }
+
+    Wakeup.notify_one();
+}
+
+bool MathExpressions::TaskPool::RunOne(size_t queue_index)
+{
+    Task* task = nullptr;
+
+    // Own tasks are taken newest first, as they're the likeliest to be joined soon
+    {
+        Queue& own = *Queues[queue_index];
+        std::lock_guard<std::mutex> lock(own.Mutex);
+        if (!own.Tasks.empty())
+        {
+            task = own.Tasks.back();
+            own.Tasks.pop_back();
+        }
+    }
+
+    // Others' tasks are stolen oldest first, as they tend to be the largest
+    for (size_t i = 1; !task && i < Queues.size(); i++)
+    {
+        Queue& victim = *Queues[(queue_index + i) % Queues.size()];
+        std::lock_guard<std::mutex> lock(victim.Mutex);
+        if (!victim.Tasks.empty())
+        {
+            task = victim.Tasks.front();
+            victim.Tasks.pop_front();
+        }
+    }
+
+    if (!task) return false;
+
+    Pending.fetch_sub(1, std::memory_order_relaxed);
+    task->Work();
+    // Task may be destroyed by whoever joins it as soon as it's marked done
+    task->Done.store(true, std::memory_order_release);
+
+    return true;
+}
+
+void MathExpressions::TaskPool::RunThread(size_t queue_index)
+{
+    CurrentPool = this;
+    CurrentQueue = queue_index;
+
+    for (;;)
+    {
+        if (RunOne(queue_index)) continue;
+
+        std::unique_lock<std::mutex> lock(SleepMutex);
+        Wakeup.wait(lock, [this]() { return Stopping || Pending.load(std::memory_order_relaxed) > 0; });
+        if (Stopping) return;
+    }
+}
+
+void MathExpressions::TaskPool::Join(MathExpressions::TaskPool::Task& task)
+{
+    const size_t queue_index = GetQueueIndex();
+
+    while (!task.Done.load(std::memory_order_acquire))
+    {
+        if (JoinDepth < MaxJoinDepth)
+        {
+            JoinDepth++;
+            bool ran = RunOne(queue_index);
+            JoinDepth--;
+
+            if (ran) continue;
+        }
+
+        std::this_thread::yield();
+    }
+}
+
+// Subtrees cheaper than this are computed by the thread that reaches them
+static const size_t ForkCost = 1 << 12;
+// Expressions cheaper than this are evaluated sequentially as a whole
+static const size_t SequentialCost = 1 << 15;
+
+// Rough cost of an operation relative to an addition
+static size_t GetOperationCost(MathExpressions::OpCode op)
+{
+    using MathExpressions::OpCode;
+
+    switch (op)
+    {
+    case OpCode::Constant: case OpCode::Variable:
+    case OpCode::Add: case OpCode::Sub: case OpCode::Mul:
+    case OpCode::Negate: case OpCode::Abs: case OpCode::Sign:
+        return 1;
+    case OpCode::Div: case OpCode::Sqrt:
+        return 4;
+    default:
+        return 16;
+    }
+}
+
+// State of a single evaluation, shared by every task of it
+struct MathExpressions::ParallelEvaluator::Context
+{
+    TaskPool& Pool;
+    const long double* SymbolValues;
+    // Value of every instruction. Tasks compute disjoint subtrees, so they never write the same values
+    std::vector<long double> Values;
+
+    // Failed instruction with the lowest index, which is the one sequential evaluation would stop at
+    std::mutex FailureMutex;
+    std::atomic<size_t> FailedIndex;
+    EvaluationStatus Status;
+
+    Context(TaskPool& pool, const long double* symbol_values, size_t instruction_count)
+        : Pool(pool), SymbolValues(symbol_values), Values(instruction_count),
+        FailedIndex(std::numeric_limits<size_t>::max()), Status(EvaluationStatus::Success) {}
+
+    void Fail(size_t instruction, EvaluationStatus status)
+    {
+        std::lock_guard<std::mutex> lock(FailureMutex);
+        if (instruction >= FailedIndex.load(std::memory_order_relaxed)) return;
+
+        FailedIndex.store(instruction, std::memory_order_relaxed);
+        Status = status;
+    }
+
+    // Whether an instruction can be skipped, because it can't fail before an already recorded failure
+    bool IsPastFailure(size_t instruction) const
+    {
+        return instruction > FailedIndex.load(std::memory_order_relaxed);
+    }
+};
+
+MathExpressions::ParallelEvaluator::ParallelEvaluator(
+    MathExpressions::CompiledExpressionPtr expression
+) : Expression(std::move(expression)), Code(Expression->GetProgram()), Forkable(true)
+{
+    const std::vector<Instruction>& instructions = Code.GetInstructions();
+    Costs.resize(instructions.size());
+    Starts.resize(instructions.size());
+
+    std::vector<size_t> sizes(instructions.size());
+    std::vector<bool> used(instructions.size(), false);
+
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        const Instruction& instr = instructions[i];
+        const size_t arity = GetArity(instr.Op);
+
+        Costs[i] = GetOperationCost(instr.Op);
+        Starts[i] = i;
+        sizes[i] = 1;
+
+        // Leaves' operands index the constant pool and the symbol table, not instructions. Calls take theirs from the call table
+        const unsigned binary_operands[] = { instr.Lhs, instr.Rhs };
+        const unsigned* operands = binary_operands;
+        size_t operand_count = arity;
+        if (instr.Op == OpCode::Call)
+        {
+            const NativeCall& call = Code.GetCalls()[instr.Lhs];
+            operands = call.Arguments.data();
+            operand_count = call.Arguments.size();
+
+            // Impure functions have to be called in program order, one at a time
+            if (!call.Function->Pure) Forkable = false;
+        }
+
+        for (size_t k = 0; k < operand_count; k++)
+        {
+            const unsigned operand = operands[k];
+
+            Costs[i] += Costs[operand];
+            Starts[i] = std::min(Starts[i], Starts[operand]);
+            sizes[i] += sizes[operand];
+
+            // Programs that reuse values (e.g. merged by 'ExpressionSet') aren't trees, and can't be split into subtrees
+            if (used[operand]) Forkable = false;
+            used[operand] = true;
+        }
+
+        // Subtree is contiguous if it spans exactly as many instructions as it consists of
+        if (i - Starts[i] + 1 != sizes[i]) Forkable = false;
+    }
+}
+
+const MathExpressions::CompiledExpressionPtr& MathExpressions::ParallelEvaluator::GetExpression() const
+{
+    return Expression;
+}
+
+size_t MathExpressions::ParallelEvaluator::GetCost() const
+{
+    return Costs.empty() ? 0 : Costs.back();
+}
+
+void MathExpressions::ParallelEvaluator::RunSequentially(size_t root, MathExpressions::ParallelEvaluator::Context& context) const
+{
+    if (context.IsPastFailure(Starts[root])) return;
+
+    for (size_t i = Starts[root]; i <= root; i++)
+    {
+        EvaluationStatus status = Code.Execute(i, context.Values.data(), context.SymbolValues);
+        if (status == EvaluationStatus::Success) continue;
+
+        context.Fail(i, status);
+        return;
+    }
+}
+
+void MathExpressions::ParallelEvaluator::RunSubtree(size_t root, MathExpressions::ParallelEvaluator::Context& context) const
+{
+    const std::vector<Instruction>& instructions = Code.GetInstructions();
+
+    // Costly operations on the way down, each with the tasks it's cheaper operands are computed by
+    std::vector<size_t> path;
+    std::vector<std::vector<TaskPool::Task*>> waits;
+    std::vector<std::unique_ptr<TaskPool::Task>> forks;
+
+    // Cheap operands met on the way down that haven't been forked yet. Left-folded chains such as 'a + b + c + ...'
+    // have nothing but cheap operands along the spine, so they're gathered until there's enough work for a task.
+    // Operations that contributed to the group wait on it once it's forked
+    std::vector<size_t> group, group_users;
+    size_t group_cost = 0;
+
+    size_t node = root;
+    while (Costs[node] >= ForkCost)
+    {
+        const Instruction& instr = instructions[node];
+        path.push_back(node);
+        waits.emplace_back();
+
+        std::vector<size_t> operands;
+        if (instr.Op == OpCode::Call)
+        {
+            const std::vector<unsigned>& arguments = Code.GetCalls()[instr.Lhs].Arguments;
+            operands.assign(arguments.begin(), arguments.end());
+        }
+        else
+        {
+            operands.push_back(instr.Lhs);
+            if (GetArity(instr.Op) == 2) operands.push_back(instr.Rhs);
+        }
+
+        // Every other operand is forked or grouped, and the walk goes on down the costliest one
+        size_t costliest = 0;
+        for (size_t k = 1; k < operands.size(); k++)
+            if (Costs[operands[k]] > Costs[operands[costliest]]) costliest = k;
+
+        for (size_t k = 0; k < operands.size(); k++)
+        {
+            if (k == costliest) continue;
+            const size_t cheaper = operands[k];
+
+            if (Costs[cheaper] >= ForkCost)
+            {
+                forks.emplace_back(new TaskPool::Task([this, cheaper, &context]() { RunSubtree(cheaper, context); }));
+                context.Pool.Fork(*forks.back());
+                waits.back().push_back(forks.back().get());
+                continue;
+            }
+
+            if (group_users.empty() || group_users.back() != path.size() - 1) group_users.push_back(path.size() - 1);
+            group.push_back(cheaper);
+            group_cost += Costs[cheaper];
+
+            if (group_cost >= ForkCost)
+            {
+                std::vector<size_t> roots;
+                roots.swap(group);
+                group_cost = 0;
+
+                forks.emplace_back(new TaskPool::Task([this, roots, &context]() {
+                    for (size_t operand : roots) RunSequentially(operand, context);
+                }));
+                context.Pool.Fork(*forks.back());
+                for (size_t user : group_users) waits[user].push_back(forks.back().get());
+                group_users.clear();
+            }
+        }
+
+        node = operands[costliest];
+    }
+
+    for (size_t operand : group) RunSequentially(operand, context);
+    RunSequentially(node, context);
+
+    // Way back up, computing operations in program order. Every forked task is joined, even after a failure, as it refers to the context
+    for (size_t i = path.size(); i-- > 0;)
+    {
+        for (TaskPool::Task* task : waits[i]) context.Pool.Join(*task);
+        if (context.IsPastFailure(path[i])) continue;
+
+        EvaluationStatus status = Code.Execute(path[i], context.Values.data(), context.SymbolValues);
+        if (status != EvaluationStatus::Success) context.Fail(path[i], status);
+    }
+}
+
+MathExpressions::EvaluationResult MathExpressions::ParallelEvaluator::TryEvaluate(
+    const long double* symbol_values,
+    MathExpressions::TaskPool& pool
+) const {
+    const size_t root = Code.GetInstructions().size() - 1;
+    if (!Forkable || Costs[root] < SequentialCost || pool.GetThreadCount() < 2) return Code.TryEvaluate(symbol_values);
+
+    Context context(pool, symbol_values, Code.GetInstructions().size());
+    RunSubtree(root, context);
+
+    const size_t failed = context.FailedIndex.load(std::memory_order_relaxed);
+    if (failed != std::numeric_limits<size_t>::max()) return { 0, context.Status, failed };
+
+    return { context.Values[root], EvaluationStatus::Success, root };
+}
+
+long double MathExpressions::ParallelEvaluator::Evaluate(
+    const MathExpressions::Environment& env,
+    MathExpressions::TaskPool& pool
+) const {
+    if (Code.GetInstructions().empty()) throw std::runtime_error("Program has no instructions");
+
+    std::vector<long double> symbol_values;
+    Code.ResolveSymbols(env, symbol_values);
+
+    EvaluationResult result = TryEvaluate(symbol_values.data(), pool);
+    Code.ThrowError(result);
+
+    return result.Value;
+}
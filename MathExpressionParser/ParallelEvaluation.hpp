@@ -0,0 +1,164 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+namespace MathExpressions
+{
+	/* Pool of threads that run fork-join tasks
+	Every thread has a queue of it's own: tasks are pushed to and taken from the back of the queue of the thread
+	that forks them, while idle threads steal from the front of other queues, taking the oldest (i.e. largest) tasks.
+	A thread waiting for a task runs other tasks meanwhile, so waiting never blocks a thread the task may need.
+	Threads outside of the pool share a single queue, and can fork and wait on tasks as well
+	*/
+	class TaskPool
+	{
+	public:
+		// Unit of work. It must not throw, and must stay alive until it's done
+		struct Task
+		{
+			std::function<void()> Work;
+			std::atomic<bool> Done;
+
+			Task(std::function<void()> work);
+		};
+	protected:
+		struct Queue
+		{
+			std::mutex Mutex;
+			std::deque<Task*> Tasks;
+		};
+
+		// Queue 0 is shared by threads outside of the pool, the rest belong to pool's threads
+		std::vector<std::unique_ptr<Queue>> Queues;
+		std::vector<std::thread> Threads;
+
+		std::mutex SleepMutex;
+		std::condition_variable Wakeup;
+		// Number of tasks in all queues. Only increased while 'SleepMutex' is held, so sleepers never miss a task
+		std::atomic<size_t> Pending;
+		bool Stopping;
+
+		// Index of the queue of the current thread
+		size_t GetQueueIndex() const;
+
+		/// <summary>
+		/// Runs a single task, taken from the current thread's queue or stolen from another one
+		/// </summary>
+		/// <returns>Whether there was a task to run</returns>
+		bool RunOne(size_t queue_index);
+
+		void RunThread(size_t queue_index);
+	public:
+		/// <param name="thread_count">- number of threads that run tasks, including one that waits on them.
+		/// Zero picks the number of hardware threads</param>
+		TaskPool(size_t thread_count = 0);
+		~TaskPool();
+
+		TaskPool(const TaskPool&) = delete;
+		TaskPool& operator=(const TaskPool&) = delete;
+
+		/// <summary>
+		/// Returns number of threads of the pool, plus one for the thread that waits on tasks
+		/// </summary>
+		size_t GetThreadCount() const;
+
+		/// <summary>
+		/// Queues task to be run by any thread
+		/// </summary>
+		void Fork(Task& task);
+
+		/// <summary>
+		/// Runs queued tasks until specified one is done
+		/// </summary>
+		void Join(Task& task);
+	};
+
+	/* Evaluates a single huge expression using several threads
+	Cost of every subtree is estimated once, when the evaluator is created. Evaluation walks down from the root
+	along the costliest operand of each operation, forking the others onto the pool if they're costly enough.
+	Arguments of calls of pure native functions are operands too, while calls of impure ones keep evaluation sequential.
+	Cheaper operands met along the way are gathered into groups that are forked once they're costly enough together,
+	so long chains like 'a + b + c + ...' are split up too. Operations along the path are computed on the way back up,
+	in program order, once their operands are done.
+	Operations are never regrouped, so results are exactly the same as those of sequential evaluation.
+	Expressions that are too cheap to benefit from threads are evaluated sequentially, without touching the pool
+	*/
+	class ParallelEvaluator
+	{
+	protected:
+		CompiledExpressionPtr Expression;
+		const Program& Code;
+		// Estimated cost of computing each instruction together with it's operands
+		std::vector<size_t> Costs;
+		// First instruction of each instruction's subtree
+		std::vector<size_t> Starts;
+		// Whether every subtree occupies a contiguous range of instructions, which is what forking relies on
+		bool Forkable;
+
+		struct Context;
+
+		/// <summary>
+		/// Computes every instruction of the subtree
+		/// </summary>
+		void RunSubtree(size_t root, Context& context) const;
+
+		/// <summary>
+		/// Computes instructions of the subtree in program order on the current thread
+		/// </summary>
+		void RunSequentially(size_t root, Context& context) const;
+	public:
+		ParallelEvaluator(CompiledExpressionPtr expression);
+
+		const CompiledExpressionPtr& GetExpression() const;
+
+		/// <summary>
+		/// Returns estimated cost of evaluating the whole expression, in roughly the cost of an addition
+		/// </summary>
+		size_t GetCost() const;
+
+		/// <summary>
+		/// Evaluates the expression, reporting errors through the result instead of throwing.
+		/// Reports the same error sequential evaluation would
+		/// </summary>
+		/// <param name="symbol_values">- values of the symbols, ordered as in the symbol table</param>
+		/// <param name="pool">- threads to fork subtrees onto</param>
+		EvaluationResult TryEvaluate(const long double* symbol_values, TaskPool& pool) const;
+
+		/// <summary>
+		/// Resolves symbols in provided environment and evaluates the expression. Throws on errors
+		/// </summary>
+		long double Evaluate(const Environment& env, TaskPool& pool) const;
+	};
+}
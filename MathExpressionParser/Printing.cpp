@@ -0,0 +1,180 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include "MathExpressions.hpp"
+#include "Printing.hpp"
+
+typedef Tree<Parser::TokenPtr>::Node Node;
+
+// Brackets a subexpression is wrapped into, if any
+static const Node& Unbracket(const Node& node)
+{
+    const Node* inner = &node;
+    while (inner->Children.size() == 1 && dynamic_cast<const MathExpressions::Bracket*>(inner->Value.get()))
+        inner = inner->Children[0].get();
+
+    return *inner;
+}
+
+// Numbers, variables, functions and absolute values are never split by the parser, so they bind tighter than any operation
+static size_t GetBindingPriority(const Node& node)
+{
+    if (auto op = dynamic_cast<const MathExpressions::BinaryOp*>(node.Value.get())) return op->GetPriority();
+
+    return std::numeric_limits<size_t>::max();
+}
+
+static void PrintCompact(const Tree<Parser::TokenPtr>& tree, const Node& node, std::string& out_text);
+
+/* Operations split at the rightmost of their lowest priority tokens, so a left operand only needs brackets
+if it binds looser than the operation, while a right operand needs them if it binds as loose. Exponentiation
+brackets operands of the same priority on both sides, so the text doesn't depend on which way it's grouped
+*/
+static void PrintOperand(
+    const Tree<Parser::TokenPtr>& tree, const Node& operand, size_t min_priority, std::string& out_text
+) {
+    const Node& inner = Unbracket(operand);
+    if (GetBindingPriority(inner) >= min_priority) return PrintCompact(tree, inner, out_text);
+
+    out_text.push_back('(');
+    PrintCompact(tree, inner, out_text);
+    out_text.push_back(')');
+}
+
+static void PrintCompact(const Tree<Parser::TokenPtr>& tree, const Node& node, std::string& out_text)
+{
+    const Parser::IToken* token = node.Value.get();
+
+    if (auto op = dynamic_cast<const MathExpressions::BinaryOp*>(token))
+    {
+        const size_t priority = op->GetPriority();
+        const bool grouped_either_way = static_cast<bool>(dynamic_cast<const MathExpressions::Pow*>(token));
+
+        // Negation is a subtraction without a left operand
+        if (node.Children.size() == 2)
+            PrintOperand(tree, *node.Children[0], grouped_either_way ? priority + 1 : priority, out_text);
+        op->AppendSource(out_text);
+        if (!node.Children.empty()) PrintOperand(tree, *node.Children.back(), priority + 1, out_text);
+        return;
+    }
+
+    if (dynamic_cast<const MathExpressions::Bracket*>(token) && node.Children.size() == 1)
+        return PrintCompact(tree, Unbracket(node), out_text);
+
+    // Absolute value brackets are indistinct, so brackets inside of them may be what tells them apart
+    auto function = dynamic_cast<const MathExpressions::Function*>(token);
+    if (!function) return token->Stringify(tree, node, out_text);
+
+    function->AppendSource(out_text);
+    for (size_t i = 0; i < node.Children.size(); i++)
+    {
+        if (i) out_text.push_back(',');
+        PrintCompact(tree, Unbracket(*node.Children[i]), out_text);
+    }
+    out_text.push_back(')');
+}
+
+void MathExpressions::Print(const Tree<Parser::TokenPtr>& tree, std::string& out_text, MathExpressions::PrintMode mode)
+{
+    if (!tree.Root) return;
+
+    if (mode == PrintMode::Source) return tree.Root->Value->Stringify(tree, *tree.Root, out_text);
+
+    PrintCompact(tree, Unbracket(*tree.Root), out_text);
+}
+
+// Integers that fit into 64 bits are written digit by digit
+static bool PrintInteger(long double magnitude, std::string& out_text)
+{
+    if (magnitude != truncl(magnitude) || magnitude >= 18446744073709551616.0L) return false;
+
+    char digits[20];
+    size_t count = 0;
+    unsigned long long integer = static_cast<unsigned long long>(magnitude);
+    do
+    {
+        digits[count++] = static_cast<char>('0' + integer % 10);
+        integer /= 10;
+    } while (integer);
+
+    while (count) out_text.push_back(digits[--count]);
+    return true;
+}
+
+void MathExpressions::PrintNumber(long double value, std::string& out_text)
+{
+    if (!std::isfinite(value)) throw std::invalid_argument("Only finite numbers can be printed");
+
+    if (std::signbit(value)) out_text.push_back('-');
+    const long double magnitude = fabsl(value);
+    if (PrintInteger(magnitude, out_text)) return;
+
+    /* More significant digits never read back further from the value than fewer do,
+    so the shortest precision that reads back exactly is binary searched
+    */
+    char scientific[64];
+    int lowest = 1, highest = std::numeric_limits<long double>::max_digits10;
+    while (lowest < highest)
+    {
+        const int digits = (lowest + highest) / 2;
+        std::snprintf(scientific, sizeof(scientific), "%.*Le", digits - 1, magnitude);
+
+        if (std::strtold(scientific, nullptr) == magnitude) highest = digits;
+        else lowest = digits + 1;
+    }
+    std::snprintf(scientific, sizeof(scientific), "%.*Le", lowest - 1, magnitude);
+
+    // Scientific notation is 'd.ddde[+-]xx', or 'de[+-]xx' for a single digit
+    char mantissa[std::numeric_limits<long double>::max_digits10];
+    size_t count = 0;
+    const char* cursor = scientific;
+    for (; *cursor != 'e'; cursor++)
+        if (*cursor != '.') mantissa[count++] = *cursor;
+    const long exponent = std::strtol(cursor + 1, nullptr, 10);
+
+    while (count > 1 && mantissa[count - 1] == '0') count--;
+
+    if (exponent < 0)
+    {
+        out_text.append("0.");
+        out_text.append(static_cast<size_t>(-exponent - 1), '0');
+        out_text.append(mantissa, count);
+    }
+    else if (static_cast<size_t>(exponent) + 1 >= count)
+    {
+        out_text.append(mantissa, count);
+        out_text.append(static_cast<size_t>(exponent) + 1 - count, '0');
+    }
+    else
+    {
+        out_text.append(mantissa, exponent + 1);
+        out_text.push_back('.');
+        out_text.append(mantissa + exponent + 1, count - exponent - 1);
+    }
+}
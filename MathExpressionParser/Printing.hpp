@@ -0,0 +1,56 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include "Parser/Parser.hpp"
+#include "Parser/Tree.hpp"
+
+namespace MathExpressions
+{
+	// How 'Print' lays an expression out
+	enum class PrintMode : unsigned char
+	{
+		// Every token as it has been written, same as 'Stringify'
+		Source,
+		// Brackets that don't change how the expression is parsed are left out, and parameters are separated by bare commas
+		Compact
+	};
+
+	/// <summary>
+	/// Appends text of the AST to the buffer. Nothing is allocated besides growing the buffer,
+	/// so a buffer that's cleared and reused stops allocating once it fits the longest expression.
+	/// Compact text parses back into the same AST, minus the brackets it has left out
+	/// </summary>
+	/// <param name="out_text">- buffer text is appended to</param>
+	void Print(const Tree<Parser::TokenPtr>& tree, std::string& out_text, PrintMode mode = PrintMode::Compact);
+
+	/// <summary>
+	/// Appends the shortest decimal that reads back as exactly the same value. Decimal is written in plain notation,
+	/// as 'e' in an exponent would be read as Euler's number. Integers are written without going through formatting.
+	/// Throws std::invalid_argument if value isn't finite
+	/// </summary>
+	void PrintNumber(long double value, std::string& out_text);
+}
@@ -0,0 +1,868 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "CompiledExpression.hpp"
+
+/* Expressions parsed by the C++ compiler
+An expression written as a string literal is parsed into a type while the program is compiled,
+following the same grammar and operator priorities the runtime parser does. Evaluating it is plain
+inlined code with no parsing, no instructions to dispatch and no memory to allocate,
+and a malformed literal fails to compile. 'ExpressionTemplates.hpp' builds the same nodes out of C++ operators.
+Only C++11 'constexpr' is used, so every helper below consists of a single return statement.
+Those helpers recurse once per token, so parsing is limited by the compiler's constexpr depth
+(512 by default in GCC and Clang, see -fconstexpr-depth): a literal can have at most about 500 tokens
+between a pair of brackets, and takes a few seconds to compile close to that.
+Longer expressions belong to the runtime parser.
+Define one with MATHEXPRESSIONS_STATIC_EXPRESSION(Name, "x*sin(y)+2") at namespace scope
+*/
+#define MATHEXPRESSIONS_STATIC_EXPRESSION(Name, literal) \
+	struct Name##Text { static constexpr const char* Get() { return literal; } }; \
+	typedef MathExpressions::StaticExpression<Name##Text> Name
+
+namespace MathExpressions
+{
+	namespace Static
+	{
+		// Records the first failure of an evaluation, later ones are the consequences of it
+		inline void Fail(EvaluationStatus& status, EvaluationStatus failure)
+		{
+			if (status == EvaluationStatus::Success) status = failure;
+		}
+
+		// Nodes have no tokens to report, so failures are described by their status alone
+		inline void ThrowError(const EvaluationResult& result)
+		{
+			switch (result.Status)
+			{
+			case EvaluationStatus::Success: return;
+			case EvaluationStatus::DivisionByZero: throw std::runtime_error("Division by zero");
+			case EvaluationStatus::NegativeNumberRoot: throw std::runtime_error("Root of a negative number");
+			default: throw std::runtime_error("Evaluation failed");
+			}
+		}
+
+		// Same operations 'Program' executes, with the same failures
+		inline long double ApplyBinary(OpCode op, long double lhs, long double rhs, EvaluationStatus& status)
+		{
+			switch (op)
+			{
+			case OpCode::Add: return lhs + rhs;
+			case OpCode::Sub: return lhs - rhs;
+			case OpCode::Mul: return lhs * rhs;
+			case OpCode::Div:
+				if (rhs == 0) Fail(status, EvaluationStatus::DivisionByZero);
+				return lhs / rhs;
+			case OpCode::Pow:
+				if (rhs < 1.0 && lhs < 0.0) Fail(status, EvaluationStatus::NegativeNumberRoot);
+				return powl(lhs, rhs);
+			case OpCode::Log: return log2l(lhs) / log2l(rhs);
+			default: throw std::invalid_argument("Operation isn't binary");
+			}
+		}
+
+		inline long double ApplyUnary(OpCode op, long double operand, EvaluationStatus& status)
+		{
+			switch (op)
+			{
+			case OpCode::Negate: return -operand;
+			case OpCode::Abs: return fabsl(operand);
+			case OpCode::LogE: return logl(operand);
+			case OpCode::Log2: return log2l(operand);
+			case OpCode::Log10: return log10l(operand);
+			case OpCode::Exp: return expl(operand);
+			case OpCode::Sqrt:
+				if (operand < 0) Fail(status, EvaluationStatus::NegativeNumberRoot);
+				return sqrtl(operand);
+			case OpCode::Sign: return (operand == 0) ? 0 : ((operand > 0) ? 1 : -1);
+			case OpCode::Sin: return sinl(operand);
+			case OpCode::Cos: return cosl(operand);
+			case OpCode::Tan: return tanl(operand);
+			case OpCode::Cot: return 1 / tanl(operand);
+			case OpCode::Asin: return asinl(operand);
+			case OpCode::Acos: return acosl(operand);
+			case OpCode::Atan: return atanl(operand);
+			case OpCode::Sinh: return sinhl(operand);
+			case OpCode::Cosh: return coshl(operand);
+			case OpCode::Tanh: return tanhl(operand);
+			case OpCode::Asinh: return asinhl(operand);
+			case OpCode::Acosh: return acoshl(operand);
+			case OpCode::Atanh: return atanhl(operand);
+			default: throw std::invalid_argument("Operation isn't unary");
+			}
+		}
+
+		// Priority an operation has in expressions, as the runtime parser sees it. Functions are never split, so they bind the tightest
+		constexpr size_t GetOperationPriority(OpCode op)
+		{
+			return
+				(op == OpCode::Add || op == OpCode::Sub || op == OpCode::Negate) ? 1 :
+				(op == OpCode::Mul || op == OpCode::Div) ? 2 :
+				op == OpCode::Pow ? 3 : std::numeric_limits<size_t>::max();
+		}
+
+		constexpr char GetOperatorSymbol(OpCode op)
+		{
+			return op == OpCode::Add ? '+' : op == OpCode::Sub ? '-' : op == OpCode::Mul ? '*' : op == OpCode::Div ? '/' : '^';
+		}
+
+		// Writes a node as an operand, bracketed if it binds looser than 'min_priority' (same rules 'PrintMode::Compact' follows)
+		template<class Node>
+		void WriteOperand(const Node& node, size_t min_priority, std::string& out_text)
+		{
+			if (node.GetPriority() >= min_priority) return node.Write(out_text);
+
+			out_text.push_back('(');
+			node.Write(out_text);
+			out_text.push_back(')');
+		}
+
+		/* Builds the AST of a node that has been written as 'Source' without parsing it.
+		Nodes step over their text the same way 'Write' has laid it out, creating the tokens the tokenizer would have
+		over the same characters, so the tree is the one the runtime parser gives the text
+		*/
+		class TreeBuilder
+		{
+			const std::string& Source;
+			std::vector<Parser::TokenPtr>& Tokens;
+			size_t Cursor;
+		public:
+			typedef Tree<Parser::TokenPtr>::NodePtr NodePtr;
+
+			TreeBuilder(const std::string& source, std::vector<Parser::TokenPtr>& out_tokens)
+				: Source(source), Tokens(out_tokens), Cursor(0) {}
+
+			// Creates a token over the next 'length' characters, e.g. a closing bracket that has no node of it's own
+			template<class T, class... Args>
+			void Step(size_t length, Args... args)
+			{
+				if (Cursor + length > Source.size()) throw std::logic_error("Node is built past the text it's written as");
+
+				View<std::string> range(&Source, Source.cbegin() + Cursor, Source.cbegin() + Cursor + length);
+				Cursor += length;
+				Tokens.push_back(Allocation::MakeShared<T>(range, args...));
+			}
+
+			// Same as 'Step', but also returns a node of the tree that holds the token
+			template<class T, class... Args>
+			NodePtr Open(size_t length, Args... args)
+			{
+				Step<T>(length, args...);
+
+				NodePtr node = std::make_shared<Tree<Parser::TokenPtr>::Node>();
+				node->Value = Tokens.back();
+				return node;
+			}
+		};
+
+		// Token class the runtime parser gives each operation. Negation is a subtraction without a left operand
+		template<OpCode Op>
+		struct OperationToken;
+
+#define MATHEXPRESSIONS_STATIC_TOKEN(Op, TokenClass) \
+		template<> struct OperationToken<OpCode::Op> { typedef MathExpressions::TokenClass Type; };
+
+		MATHEXPRESSIONS_STATIC_TOKEN(Add, Add)
+		MATHEXPRESSIONS_STATIC_TOKEN(Sub, Sub)
+		MATHEXPRESSIONS_STATIC_TOKEN(Mul, Mul)
+		MATHEXPRESSIONS_STATIC_TOKEN(Div, Div)
+		MATHEXPRESSIONS_STATIC_TOKEN(Pow, Pow)
+		MATHEXPRESSIONS_STATIC_TOKEN(Log, Logarithm)
+		MATHEXPRESSIONS_STATIC_TOKEN(Negate, Sub)
+		MATHEXPRESSIONS_STATIC_TOKEN(Abs, ModBracket)
+		MATHEXPRESSIONS_STATIC_TOKEN(LogE, LogarithmE)
+		MATHEXPRESSIONS_STATIC_TOKEN(Log2, Logarithm2)
+		MATHEXPRESSIONS_STATIC_TOKEN(Log10, Logarithm10)
+		MATHEXPRESSIONS_STATIC_TOKEN(Exp, ExponentFunc)
+		MATHEXPRESSIONS_STATIC_TOKEN(Sqrt, SquareRoot)
+		MATHEXPRESSIONS_STATIC_TOKEN(Sign, Sign)
+		MATHEXPRESSIONS_STATIC_TOKEN(Sin, Sine)
+		MATHEXPRESSIONS_STATIC_TOKEN(Cos, Cosine)
+		MATHEXPRESSIONS_STATIC_TOKEN(Tan, Tangent)
+		MATHEXPRESSIONS_STATIC_TOKEN(Cot, Cotangent)
+		MATHEXPRESSIONS_STATIC_TOKEN(Asin, Arcsine)
+		MATHEXPRESSIONS_STATIC_TOKEN(Acos, Arccosine)
+		MATHEXPRESSIONS_STATIC_TOKEN(Atan, Arctangent)
+		MATHEXPRESSIONS_STATIC_TOKEN(Sinh, HyperbolicSine)
+		MATHEXPRESSIONS_STATIC_TOKEN(Cosh, HyperbolicCosine)
+		MATHEXPRESSIONS_STATIC_TOKEN(Tanh, HyperbolicTangent)
+		MATHEXPRESSIONS_STATIC_TOKEN(Asinh, HyperbolicArcsine)
+		MATHEXPRESSIONS_STATIC_TOKEN(Acosh, HyperbolicArccosine)
+		MATHEXPRESSIONS_STATIC_TOKEN(Atanh, HyperbolicArctangent)
+
+#undef MATHEXPRESSIONS_STATIC_TOKEN
+
+		// Builds a node written by 'WriteOperand', bracketed the same way
+		template<class Node>
+		TreeBuilder::NodePtr BuildOperand(const Node& node, size_t min_priority, TreeBuilder& builder)
+		{
+			if (node.GetPriority() >= min_priority) return node.Build(builder);
+
+			TreeBuilder::NodePtr bracket = builder.Open<MathExpressions::Bracket>(1, false);
+			bracket->Children.push_back(node.Build(builder));
+			builder.Step<MathExpressions::Bracket>(1, true);
+			return bracket;
+		}
+
+		/* Nodes of a parsed expression. Every node evaluates it's operands left to right, reporting failures
+		through 'status' rather than branching out, so an expression evaluates as a single straight sequence.
+		Nodes can also write themselves as text that parses back into the same expression, and build the AST of that text
+		*/
+		template<OpCode Op, class Lhs, class Rhs>
+		struct Binary
+		{
+			Lhs Left;
+			Rhs Right;
+
+			long double Evaluate(const long double* variables, EvaluationStatus& status) const
+			{
+				long double lhs = Left.Evaluate(variables, status);
+				return ApplyBinary(Op, lhs, Right.Evaluate(variables, status), status);
+			}
+
+			size_t GetPriority() const
+			{
+				return GetOperationPriority(Op);
+			}
+
+			void Write(std::string& out_text) const
+			{
+				if (Op == OpCode::Log)
+				{
+					out_text.append("log(");
+					Left.Write(out_text);
+					out_text.push_back(',');
+					Right.Write(out_text);
+					out_text.push_back(')');
+					return;
+				}
+
+				const size_t priority = GetOperationPriority(Op);
+				WriteOperand(Left, (Op == OpCode::Pow) ? priority + 1 : priority, out_text);
+				out_text.push_back(GetOperatorSymbol(Op));
+				WriteOperand(Right, priority + 1, out_text);
+			}
+
+			TreeBuilder::NodePtr Build(TreeBuilder& builder) const
+			{
+				typedef typename OperationToken<Op>::Type OpToken;
+
+				if (Op == OpCode::Log)
+				{
+					TreeBuilder::NodePtr node = builder.Open<OpToken>(std::strlen("log("));
+					node->Children.push_back(Left.Build(builder));
+					builder.Step<MathExpressions::ParamSeparator>(1);
+					node->Children.push_back(Right.Build(builder));
+					builder.Step<MathExpressions::Bracket>(1, true);
+					return node;
+				}
+
+				const size_t priority = GetOperationPriority(Op);
+				TreeBuilder::NodePtr lhs = BuildOperand(Left, (Op == OpCode::Pow) ? priority + 1 : priority, builder);
+				TreeBuilder::NodePtr node = builder.Open<OpToken>(1);
+				node->Children.push_back(lhs);
+				node->Children.push_back(BuildOperand(Right, priority + 1, builder));
+				return node;
+			}
+		};
+
+		template<OpCode Op, class Operand>
+		struct Unary
+		{
+			Operand Argument;
+
+			long double Evaluate(const long double* variables, EvaluationStatus& status) const
+			{
+				return ApplyUnary(Op, Argument.Evaluate(variables, status), status);
+			}
+
+			size_t GetPriority() const
+			{
+				return GetOperationPriority(Op);
+			}
+
+			void Write(std::string& out_text) const
+			{
+				switch (Op)
+				{
+				case OpCode::Negate:
+					out_text.push_back('-');
+					WriteOperand(Argument, GetOperationPriority(Op) + 1, out_text);
+					return;
+				case OpCode::Abs:
+					out_text.push_back('|');
+					Argument.Write(out_text);
+					out_text.push_back('|');
+					return;
+				default:
+					out_text.append(GetFunctionName(Op));
+					out_text.push_back('(');
+					Argument.Write(out_text);
+					out_text.push_back(')');
+				}
+			}
+
+			TreeBuilder::NodePtr Build(TreeBuilder& builder) const
+			{
+				typedef typename OperationToken<Op>::Type OpToken;
+				TreeBuilder::NodePtr node;
+
+				switch (Op)
+				{
+				case OpCode::Negate:
+					node = builder.Open<OpToken>(1);
+					node->Children.push_back(BuildOperand(Argument, GetOperationPriority(Op) + 1, builder));
+					return node;
+				case OpCode::Abs:
+					node = builder.Open<OpToken>(1);
+					node->Children.push_back(Argument.Build(builder));
+					builder.Step<OpToken>(1);
+					return node;
+				default:
+					// Function tokens include the opening bracket
+					node = builder.Open<OpToken>(std::strlen(GetFunctionName(Op)) + 1);
+					node->Children.push_back(Argument.Build(builder));
+					builder.Step<MathExpressions::Bracket>(1, true);
+					return node;
+				}
+			}
+		};
+
+		// Pi and Euler's number are the same 'double' constants the runtime parser uses
+		struct Pi
+		{
+			static constexpr long double GetValue() { return static_cast<long double>(3.14159265358979323846); }
+
+			long double Evaluate(const long double*, EvaluationStatus&) const { return GetValue(); }
+			size_t GetPriority() const { return std::numeric_limits<size_t>::max(); }
+			void Write(std::string& out_text) const { out_text.append("pi"); }
+			TreeBuilder::NodePtr Build(TreeBuilder& builder) const { return builder.Open<MathExpressions::Pythagorean>(2); }
+		};
+
+		struct Euler
+		{
+			static constexpr long double GetValue() { return static_cast<long double>(2.71828182845904523536); }
+
+			long double Evaluate(const long double*, EvaluationStatus&) const { return GetValue(); }
+			size_t GetPriority() const { return std::numeric_limits<size_t>::max(); }
+			void Write(std::string& out_text) const { out_text.push_back('e'); }
+			TreeBuilder::NodePtr Build(TreeBuilder& builder) const { return builder.Open<MathExpressions::ExponentConst>(1); }
+		};
+
+		enum class TokenKind : unsigned char
+		{
+			End, Number, Pi, Euler, Variable, Function,
+			Open, Close, Modulus, Separator,
+			Add, Sub, Mul, Div, Pow,
+			Invalid
+		};
+
+		// Names of functions, including the opening bracket, in the order the runtime tokenizer tries them
+		static const size_t FunctionCount = 33;
+
+		constexpr const char* GetFunctionAlias(size_t index)
+		{
+			return
+				index == 0 ? "ln(" : index == 1 ? "log2(" : index == 2 ? "log10(" : index == 3 ? "log(" :
+				index == 4 ? "exp(" : index == 5 ? "sqrt(" : index == 6 ? "sign(" :
+				index == 7 ? "sin(" : index == 8 ? "cos(" :
+				index == 9 ? "tg(" : index == 10 ? "tan(" : index == 11 ? "ctg(" : index == 12 ? "ctan(" :
+				index == 13 ? "asin(" : index == 14 ? "arcsin(" : index == 15 ? "acos(" : index == 16 ? "arccos(" :
+				index == 17 ? "atg(" : index == 18 ? "atan(" : index == 19 ? "arctg(" : index == 20 ? "arctan(" :
+				index == 21 ? "sinh(" : index == 22 ? "cosh(" : index == 23 ? "tgh(" : index == 24 ? "tanh(" :
+				index == 25 ? "asinh(" : index == 26 ? "arcsinh(" : index == 27 ? "acosh(" : index == 28 ? "arccosh(" :
+				index == 29 ? "atgh(" : index == 30 ? "atanh(" : index == 31 ? "arctgh(" : "arctanh(";
+		}
+
+		constexpr OpCode GetFunctionOp(size_t index)
+		{
+			return
+				index == 0 ? OpCode::LogE : index == 1 ? OpCode::Log2 : index == 2 ? OpCode::Log10 : index == 3 ? OpCode::Log :
+				index == 4 ? OpCode::Exp : index == 5 ? OpCode::Sqrt : index == 6 ? OpCode::Sign :
+				index == 7 ? OpCode::Sin : index == 8 ? OpCode::Cos :
+				index <= 10 ? OpCode::Tan : index <= 12 ? OpCode::Cot :
+				index <= 14 ? OpCode::Asin : index <= 16 ? OpCode::Acos : index <= 20 ? OpCode::Atan :
+				index == 21 ? OpCode::Sinh : index == 22 ? OpCode::Cosh : index <= 24 ? OpCode::Tanh :
+				index <= 26 ? OpCode::Asinh : index <= 28 ? OpCode::Acosh : OpCode::Atanh;
+		}
+
+		constexpr bool IsBlank(char ch) { return ch == ' ' || ch == '\t'; }
+		constexpr bool IsDigit(char ch) { return ch >= '0' && ch <= '9'; }
+		constexpr bool IsAlpha(char ch) { return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z'); }
+
+		constexpr size_t SkipBlank(const char* text, size_t pos)
+		{
+			return IsBlank(text[pos]) ? SkipBlank(text, pos + 1) : pos;
+		}
+
+		// Steps over 8 characters at a time, so long literals stay within the compiler's limit on recursion depth
+		constexpr size_t GetLength(const char* text, size_t pos = 0)
+		{
+			return
+				!text[pos] ? pos : !text[pos + 1] ? pos + 1 : !text[pos + 2] ? pos + 2 : !text[pos + 3] ? pos + 3 :
+				!text[pos + 4] ? pos + 4 : !text[pos + 5] ? pos + 5 : !text[pos + 6] ? pos + 6 : !text[pos + 7] ? pos + 7 :
+				GetLength(text, pos + 8);
+		}
+
+		constexpr bool StartsWith(const char* text, size_t pos, const char* prefix)
+		{
+			return !*prefix || (text[pos] == *prefix && StartsWith(text, pos + 1, prefix + 1));
+		}
+
+		// Index of the function alias at the position, or 'FunctionCount' if there's none
+		constexpr size_t FindFunction(const char* text, size_t pos, size_t index = 0)
+		{
+			return (index == FunctionCount || StartsWith(text, pos, GetFunctionAlias(index))) ?
+				index : FindFunction(text, pos, index + 1);
+		}
+
+		constexpr size_t SkipName(const char* text, size_t pos)
+		{
+			return IsAlpha(text[pos]) ? SkipName(text, pos + 1) : pos;
+		}
+
+		constexpr TokenKind GetKind(const char* text, size_t pos)
+		{
+			return
+				!text[pos] ? TokenKind::End :
+				text[pos] == '(' ? TokenKind::Open : text[pos] == ')' ? TokenKind::Close :
+				text[pos] == '|' ? TokenKind::Modulus :
+				(text[pos] == ',' || text[pos] == ';') ? TokenKind::Separator :
+				text[pos] == '+' ? TokenKind::Add : text[pos] == '-' ? TokenKind::Sub :
+				text[pos] == '*' ? TokenKind::Mul : text[pos] == '/' ? TokenKind::Div :
+				text[pos] == '^' ? TokenKind::Pow :
+				(IsDigit(text[pos]) || text[pos] == '.') ? TokenKind::Number :
+				!IsAlpha(text[pos]) ? TokenKind::Invalid :
+				(text[SkipName(text, pos)] == '(' && FindFunction(text, pos) != FunctionCount) ? TokenKind::Function :
+				StartsWith(text, pos, "pi") ? TokenKind::Pi :
+				text[pos] == 'e' ? TokenKind::Euler :
+				IsAlpha(text[pos]) ? TokenKind::Variable :
+				TokenKind::Invalid;
+		}
+
+		constexpr size_t SkipNumber(const char* text, size_t pos)
+		{
+			return (IsDigit(text[pos]) || text[pos] == '.') ? SkipNumber(text, pos + 1) : pos;
+		}
+
+		constexpr size_t GetTokenEnd(const char* text, size_t pos)
+		{
+			return
+				GetKind(text, pos) == TokenKind::End ? pos :
+				GetKind(text, pos) == TokenKind::Function ? pos + GetLength(GetFunctionAlias(FindFunction(text, pos))) :
+				GetKind(text, pos) == TokenKind::Number ? SkipNumber(text, pos) :
+				GetKind(text, pos) == TokenKind::Pi ? pos + 2 :
+				GetKind(text, pos) == TokenKind::Variable ? SkipName(text, pos) :
+				pos + 1;
+		}
+
+		// Start of the token that follows the one at the position
+		constexpr size_t Next(const char* text, size_t pos)
+		{
+			return SkipBlank(text, GetTokenEnd(text, pos));
+		}
+
+		constexpr size_t FindClosing(const char* text, size_t pos);
+		constexpr size_t FindModulus(const char* text, size_t pos);
+
+		// Same as 'Next', except pairs are skipped as a whole, like the runtime parser skips them
+		constexpr size_t NextTopLevel(const char* text, size_t pos)
+		{
+			return
+				(GetKind(text, pos) == TokenKind::Open || GetKind(text, pos) == TokenKind::Function) ?
+					Next(text, FindClosing(text, Next(text, pos))) :
+				GetKind(text, pos) == TokenKind::Modulus ? Next(text, FindModulus(text, Next(text, pos))) :
+				Next(text, pos);
+		}
+
+		// Position of the bracket that closes a pair whose contents start at the position, or of the end if there's none
+		constexpr size_t FindClosing(const char* text, size_t pos)
+		{
+			return (GetKind(text, pos) == TokenKind::Close || GetKind(text, pos) == TokenKind::End) ?
+				pos : FindClosing(text, NextTopLevel(text, pos));
+		}
+
+		constexpr size_t FindModulus(const char* text, size_t pos)
+		{
+			return (
+				GetKind(text, pos) == TokenKind::Modulus ||
+				GetKind(text, pos) == TokenKind::Close || GetKind(text, pos) == TokenKind::End
+			) ? pos : FindModulus(text, NextTopLevel(text, pos));
+		}
+
+		// First separator of function parameters in the range, or it's end
+		constexpr size_t FindSeparator(const char* text, size_t pos, size_t end)
+		{
+			return (pos >= end || GetKind(text, pos) == TokenKind::Separator) ? pos : FindSeparator(text, NextTopLevel(text, pos), end);
+		}
+
+		constexpr size_t GetPriority(TokenKind kind)
+		{
+			return
+				(kind == TokenKind::Add || kind == TokenKind::Sub) ? 1 :
+				(kind == TokenKind::Mul || kind == TokenKind::Div) ? 2 :
+				kind == TokenKind::Pow ? 3 :
+				kind == TokenKind::Function ? 4 : 5;
+		}
+
+		// Token the range is split at: the rightmost of the tokens with the lowest priority outside of pairs
+		constexpr size_t FindSplit(const char* text, size_t pos, size_t end, size_t best)
+		{
+			return pos >= end ? best : FindSplit(
+				text, NextTopLevel(text, pos), end,
+				GetPriority(GetKind(text, pos)) <= GetPriority(GetKind(text, best)) ? pos : best
+			);
+		}
+
+		constexpr size_t CountDots(const char* text, size_t pos, size_t end)
+		{
+			return pos == end ? 0 : (text[pos] == '.') + CountDots(text, pos + 1, end);
+		}
+
+		constexpr size_t CountFractionDigits(const char* text, size_t pos, size_t end, bool past_dot = false)
+		{
+			return pos == end ? 0 :
+				(past_dot && IsDigit(text[pos])) + CountFractionDigits(text, pos + 1, end, past_dot || text[pos] == '.');
+		}
+
+		constexpr unsigned long long GetIntegerDigits(const char* text, size_t pos, size_t end, unsigned long long value = 0)
+		{
+			return pos == end ? value :
+				GetIntegerDigits(text, pos + 1, end, IsDigit(text[pos]) ? value * 10 + (text[pos] - '0') : value);
+		}
+
+		constexpr long double GetDigits(const char* text, size_t pos, size_t end, long double value = 0)
+		{
+			return pos == end ? value :
+				GetDigits(text, pos + 1, end, IsDigit(text[pos]) ? value * 10 + (text[pos] - '0') : value);
+		}
+
+		constexpr long double GetPowerOfTen(size_t exponent)
+		{
+			return exponent ? 10 * GetPowerOfTen(exponent - 1) : 1;
+		}
+
+		/* Digits of numbers that fit into 64 bits are gathered exactly and divided by an exact power of ten,
+		which rounds once, so the value is the same 'strtold' reads
+		*/
+		constexpr long double GetNumber(const char* text, size_t begin, size_t end)
+		{
+			return (
+				end - begin - CountDots(text, begin, end) <= 19 ?
+					static_cast<long double>(GetIntegerDigits(text, begin, end)) : GetDigits(text, begin, end)
+			) / GetPowerOfTen(CountFractionDigits(text, begin, end));
+		}
+
+		constexpr bool IsSameName(const char* text, size_t lhs, size_t rhs)
+		{
+			return (!IsAlpha(text[lhs]) || !IsAlpha(text[rhs])) ?
+				(!IsAlpha(text[lhs]) && !IsAlpha(text[rhs])) :
+				(text[lhs] == text[rhs] && IsSameName(text, lhs + 1, rhs + 1));
+		}
+
+		// First occurrence of the variable at 'target', searching from 'pos'
+		constexpr size_t FindFirstOccurrence(const char* text, size_t pos, size_t target)
+		{
+			return (pos >= target || (GetKind(text, pos) == TokenKind::Variable && IsSameName(text, pos, target))) ?
+				pos : FindFirstOccurrence(text, Next(text, pos), target);
+		}
+
+		// Number of distinct variables that occur before 'end', searching from 'pos'
+		constexpr size_t CountVariables(const char* text, size_t pos, size_t end)
+		{
+			return pos >= end ? 0 : (
+				GetKind(text, pos) == TokenKind::Variable &&
+				FindFirstOccurrence(text, SkipBlank(text, 0), pos) == pos
+			) + CountVariables(text, Next(text, pos), end);
+		}
+
+		// Variables are numbered in the order they first occur in
+		constexpr size_t GetVariableIndex(const char* text, size_t pos)
+		{
+			return CountVariables(text, SkipBlank(text, 0), FindFirstOccurrence(text, SkipBlank(text, 0), pos));
+		}
+
+		template<class Text, size_t Begin, size_t End, bool NonEmpty = (Begin < End)>
+		struct ParseRange;
+
+		template<class Text, size_t Begin, size_t End, size_t Split, TokenKind Kind>
+		struct ParseToken
+		{
+			static_assert(Kind != TokenKind::Invalid, "Expression has a character that doesn't start any token");
+			static_assert(Kind == TokenKind::Invalid, "Expression has a token where an operand is expected");
+			typedef void Type;
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseLeaf
+		{
+			static_assert(Split == Begin && Next(Text::Get(), Split) == End, "Expression is missing an operator between operands");
+		};
+
+		// Number written at 'Begin'
+		template<class Text, size_t Begin>
+		struct Number
+		{
+			static const size_t End = GetTokenEnd(Text::Get(), Begin);
+			static_assert(CountDots(Text::Get(), Begin, End) <= 1, "Number has more than one dot");
+			static_assert(CountDots(Text::Get(), Begin, End) < End - Begin, "Number has no digits");
+
+			long double Evaluate(const long double*, EvaluationStatus&) const
+			{
+				constexpr long double value = GetNumber(Text::Get(), Begin, End);
+				return value;
+			}
+
+			size_t GetPriority() const { return std::numeric_limits<size_t>::max(); }
+			void Write(std::string& out_text) const { out_text.append(Text::Get() + Begin, End - Begin); }
+			TreeBuilder::NodePtr Build(TreeBuilder& builder) const { return builder.Open<MathExpressions::Number>(End - Begin); }
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Number> : ParseLeaf<Text, Begin, End, Split>
+		{
+			typedef Number<Text, Split> Type;
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Pi> : ParseLeaf<Text, Begin, End, Split>
+		{
+			typedef Pi Type;
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Euler> : ParseLeaf<Text, Begin, End, Split>
+		{
+			typedef Euler Type;
+		};
+
+		// Variable written at 'Begin'. It's value is read from the array of variables, which are numbered in the order they first occur in
+		template<class Text, size_t Begin>
+		struct Variable
+		{
+			static const size_t End = SkipName(Text::Get(), Begin);
+			static const size_t Index = GetVariableIndex(Text::Get(), Begin);
+
+			long double Evaluate(const long double* variables, EvaluationStatus&) const { return variables[Index]; }
+			size_t GetPriority() const { return std::numeric_limits<size_t>::max(); }
+			void Write(std::string& out_text) const { out_text.append(Text::Get() + Begin, End - Begin); }
+			TreeBuilder::NodePtr Build(TreeBuilder& builder) const { return builder.Open<MathExpressions::Variable>(End - Begin); }
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Variable> : ParseLeaf<Text, Begin, End, Split>
+		{
+			typedef Variable<Text, Split> Type;
+		};
+
+		// Only bracketed expressions and absolute values can be left, as anything after them would have been split at
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Open>
+		{
+			static const size_t Closing = FindClosing(Text::Get(), Next(Text::Get(), Split));
+			static_assert(Split == Begin, "Expression is missing an operator before a bracket");
+			static_assert(GetKind(Text::Get(), Closing) == TokenKind::Close, "Bracket is never closed");
+
+			typedef typename ParseRange<Text, Next(Text::Get(), Split), Closing>::Type Type;
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Modulus>
+		{
+			static const size_t Closing = FindModulus(Text::Get(), Next(Text::Get(), Split));
+			static_assert(Split == Begin, "Expression is missing an operator before an absolute value");
+			static_assert(GetKind(Text::Get(), Closing) == TokenKind::Modulus, "Absolute value is never closed");
+
+			typedef Unary<OpCode::Abs, typename ParseRange<Text, Next(Text::Get(), Split), Closing>::Type> Type;
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split, bool TwoParameters = GetFunctionOp(FindFunction(Text::Get(), Split)) == OpCode::Log>
+		struct ParseFunction
+		{
+			static const size_t Closing = FindClosing(Text::Get(), Next(Text::Get(), Split));
+			static_assert(GetKind(Text::Get(), Closing) == TokenKind::Close, "Function's bracket is never closed");
+			static_assert(
+				FindSeparator(Text::Get(), Next(Text::Get(), Split), Closing) == Closing,
+				"Function takes a single parameter"
+			);
+
+			typedef Unary<
+				GetFunctionOp(FindFunction(Text::Get(), Split)),
+				typename ParseRange<Text, Next(Text::Get(), Split), Closing>::Type
+			> Type;
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseFunction<Text, Begin, End, Split, true>
+		{
+			static const size_t Closing = FindClosing(Text::Get(), Next(Text::Get(), Split));
+			static const size_t Separator = FindSeparator(Text::Get(), Next(Text::Get(), Split), Closing);
+			static_assert(GetKind(Text::Get(), Closing) == TokenKind::Close, "Function's bracket is never closed");
+			static_assert(Separator != Closing, "Function takes two parameters");
+			static_assert(
+				FindSeparator(Text::Get(), NextTopLevel(Text::Get(), Separator), Closing) == Closing,
+				"Function takes two parameters"
+			);
+
+			typedef Binary<
+				OpCode::Log,
+				typename ParseRange<Text, Next(Text::Get(), Split), Separator>::Type,
+				typename ParseRange<Text, Next(Text::Get(), Separator), Closing>::Type
+			> Type;
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Function> : ParseFunction<Text, Begin, End, Split>
+		{
+			static_assert(Split == Begin, "Expression is missing an operator before a function");
+			static_assert(
+				NextTopLevel(Text::Get(), Split) == End,
+				"Expression is missing an operator after a function"
+			);
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split, OpCode Op>
+		struct ParseBinary
+		{
+			static_assert(Split != Begin, "Operation is missing it's left operand");
+
+			typedef Binary<
+				Op,
+				typename ParseRange<Text, Begin, Split>::Type,
+				typename ParseRange<Text, Next(Text::Get(), Split), End>::Type
+			> Type;
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Add> : ParseBinary<Text, Begin, End, Split, OpCode::Add> {};
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Mul> : ParseBinary<Text, Begin, End, Split, OpCode::Mul> {};
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Div> : ParseBinary<Text, Begin, End, Split, OpCode::Div> {};
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Pow> : ParseBinary<Text, Begin, End, Split, OpCode::Pow> {};
+
+		// Subtraction without a left operand is a negation
+		template<class Text, size_t Begin, size_t End, size_t Split, bool Negation = (Split == Begin)>
+		struct ParseSub : ParseBinary<Text, Begin, End, Split, OpCode::Sub> {};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseSub<Text, Begin, End, Split, true>
+		{
+			typedef Unary<OpCode::Negate, typename ParseRange<Text, Next(Text::Get(), Split), End>::Type> Type;
+		};
+
+		template<class Text, size_t Begin, size_t End, size_t Split>
+		struct ParseToken<Text, Begin, End, Split, TokenKind::Sub> : ParseSub<Text, Begin, End, Split> {};
+
+		template<class Text, size_t Begin, size_t End, bool NonEmpty>
+		struct ParseRange
+		{
+			static const size_t Split = FindSplit(Text::Get(), Begin, End, Begin);
+
+			typedef typename ParseToken<Text, Begin, End, Split, GetKind(Text::Get(), Split)>::Type Type;
+		};
+
+		template<class Text, size_t Begin, size_t End>
+		struct ParseRange<Text, Begin, End, false>
+		{
+			static_assert(Begin < End, "Expression is missing an operand");
+			typedef void Type;
+		};
+	}
+
+	/* Expression parsed at compile time from 'Text::Get()', a 'constexpr' function returning a string literal
+	(see MATHEXPRESSIONS_STATIC_EXPRESSION). Variables are passed as an array, in the order they first occur in the expression
+	*/
+	template<class Text>
+	class StaticExpression
+	{
+	public:
+		typedef typename Static::ParseRange<
+			Text, Static::SkipBlank(Text::Get(), 0), Static::GetLength(Text::Get())
+		>::Type Tree;
+
+		/// <summary>
+		/// Returns number of distinct variables in the expression
+		/// </summary>
+		static constexpr size_t GetVariableCount()
+		{
+			return Static::CountVariables(Text::Get(), Static::SkipBlank(Text::Get(), 0), Static::GetLength(Text::Get()));
+		}
+
+		/// <summary>
+		/// Returns name of a variable by it's index
+		/// </summary>
+		static std::string GetVariableName(size_t index)
+		{
+			const char* text = Text::Get();
+			for (size_t pos = Static::SkipBlank(text, 0); text[pos]; pos = Static::Next(text, pos))
+			{
+				if (Static::GetKind(text, pos) != Static::TokenKind::Variable) continue;
+				if (Static::GetVariableIndex(text, pos) == index) return std::string(text + pos, text + Static::SkipName(text, pos));
+			}
+
+			throw std::out_of_range("Expression has no variable with such index");
+		}
+
+		static const char* GetSource()
+		{
+			return Text::Get();
+		}
+
+		/// <summary>
+		/// Evaluates the expression, reporting errors through the result instead of throwing.
+		/// Result's index is always 0, as the expression has no instructions
+		/// </summary>
+		/// <param name="variables">- values of the variables, 'GetVariableCount' of them</param>
+		static EvaluationResult TryEvaluate(const long double* variables)
+		{
+			EvaluationStatus status = EvaluationStatus::Success;
+			long double value = Tree().Evaluate(variables, status);
+
+			return { value, status, 0 };
+		}
+
+		/// <summary>
+		/// Evaluates the expression. Throws std::runtime_error if evaluation fails
+		/// </summary>
+		/// <param name="variables">- values of the variables, 'GetVariableCount' of them</param>
+		static long double Evaluate(const long double* variables = nullptr)
+		{
+			EvaluationResult result = TryEvaluate(variables);
+			Static::ThrowError(result);
+
+			return result.Value;
+		}
+	};
+}
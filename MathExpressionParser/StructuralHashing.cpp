@@ -0,0 +1,233 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include <algorithm>
+#include <functional>
+#include <typeinfo>
+#include <unordered_map>
+#include "FunctionLibrary.hpp"
+#include "MathExpressions.hpp"
+#include "StructuralHashing.hpp"
+
+typedef Tree<Parser::TokenPtr>::Node Node;
+typedef Tree<Parser::TokenPtr>::NodePtr NodePtr;
+// Hashes of nodes (with brackets stripped) by their address
+typedef std::unordered_map<const Node*, size_t> HashMemo;
+
+// Brackets a subexpression is wrapped into, if any
+static const NodePtr& Unbracket(const NodePtr& node)
+{
+    const NodePtr* inner = &node;
+    while ((*inner)->Children.size() == 1 && dynamic_cast<const MathExpressions::Bracket*>((*inner)->Value.get()))
+        inner = &(*inner)->Children[0];
+
+    return *inner;
+}
+
+static size_t Mix(size_t seed, size_t value)
+{
+    return seed ^ (value + static_cast<size_t>(0x9e3779b97f4a7c15ULL) + (seed << 6) + (seed >> 2));
+}
+
+// Numbers are identified by their value, so '2' and '2.0' are the same, while variables aren't numbers
+static bool IsNumber(const Parser::IToken* token)
+{
+    return dynamic_cast<const MathExpressions::Numeric*>(token) && !dynamic_cast<const MathExpressions::Variable*>(token);
+}
+
+static long double GetNumber(const NodePtr& node)
+{
+    static const MathExpressions::Environment no_variables;
+
+    return static_cast<const MathExpressions::Token*>(node->Value.get())->Evaluate(node, no_variables);
+}
+
+static bool IsCommutative(const Node& node, MathExpressions::OperandOrder order)
+{
+    if (order != MathExpressions::OperandOrder::Normalized || node.Children.size() != 2) return false;
+
+    const Parser::IToken* token = node.Value.get();
+    return dynamic_cast<const MathExpressions::Add*>(token) || dynamic_cast<const MathExpressions::Mul*>(token);
+}
+
+/* Name that identifies a variable or a called function. Other tokens are identified by their kind alone,
+so aliases of built-in functions (e.g. 'tg' and 'tan') are the same token, and so are operators written with different spacing
+*/
+static bool GetName(const Parser::IToken* token, const char*& out_name, size_t& out_length)
+{
+    const std::string* name = nullptr;
+    if (auto native = dynamic_cast<const MathExpressions::NativeFunctionCall*>(token)) name = &native->Function->Name;
+    else if (auto inline_call = dynamic_cast<const MathExpressions::InlineFunctionCall*>(token)) name = &inline_call->Function->Name;
+    else if (auto variable = dynamic_cast<const MathExpressions::Variable*>(token))
+    {
+        out_length = static_cast<size_t>(variable->Source.End - variable->Source.Start);
+        out_name = out_length ? &*variable->Source.Start : nullptr;
+        return true;
+    }
+
+    if (!name) return false;
+
+    out_name = name->data();
+    out_length = name->size();
+    return true;
+}
+
+// Hashes what identifies the token itself: it's kind and either it's value or it's name (see 'GetName')
+static size_t HashToken(const NodePtr& node)
+{
+    const Parser::IToken* token = node->Value.get();
+    size_t hash = Mix(typeid(*token).hash_code(), node->Children.size());
+
+    if (IsNumber(token))
+    {
+        // Zeroes are the same regardless of their sign, as they compare equal
+        long double value = GetNumber(node);
+        return Mix(hash, std::hash<long double>()(value == 0 ? 0 : value));
+    }
+
+    const char* name;
+    size_t length;
+    if (GetName(token, name, length))
+        for (size_t i = 0; i < length; i++) hash = Mix(hash, static_cast<unsigned char>(name[i]));
+
+    return hash;
+}
+
+/* Hashes a subtree bottom-up, recording hash of every node it visits into 'memo' if one is provided,
+so comparisons can look hashes of operands up rather than hash the same subtrees at every level
+*/
+static size_t HashNode(const NodePtr& bracketed, MathExpressions::OperandOrder order, HashMemo* memo = nullptr)
+{
+    const NodePtr& node = Unbracket(bracketed);
+    size_t hash = HashToken(node);
+
+    if (IsCommutative(*node, order))
+    {
+        size_t lhs = HashNode(node->Children[0], order, memo), rhs = HashNode(node->Children[1], order, memo);
+        hash = Mix(Mix(hash, std::min(lhs, rhs)), std::max(lhs, rhs));
+    }
+    else
+        for (const NodePtr& child : node->Children) hash = Mix(hash, HashNode(child, order, memo));
+
+    if (memo) (*memo)[node.get()] = hash;
+
+    return hash;
+}
+
+static bool IsSameToken(const NodePtr& lhs, const NodePtr& rhs)
+{
+    const Parser::IToken* lhs_token = lhs->Value.get();
+    const Parser::IToken* rhs_token = rhs->Value.get();
+    if (typeid(*lhs_token) != typeid(*rhs_token) || lhs->Children.size() != rhs->Children.size()) return false;
+
+    if (IsNumber(lhs_token)) return GetNumber(lhs) == GetNumber(rhs);
+
+    // Tokens of the same kind either both have names or both don't
+    const char* lhs_name;
+    const char* rhs_name;
+    size_t lhs_length, rhs_length;
+    if (!GetName(lhs_token, lhs_name, lhs_length)) return true;
+
+    GetName(rhs_token, rhs_name, rhs_length);
+    return lhs_length == rhs_length && std::equal(lhs_name, lhs_name + lhs_length, rhs_name);
+}
+
+// Hashes of both trees are only consulted for commutative operations, to pick which way their operands pair up
+static bool IsSameNode(
+    const NodePtr& lhs_bracketed, const NodePtr& rhs_bracketed,
+    MathExpressions::OperandOrder order, const HashMemo& hashes
+) {
+    const NodePtr& lhs = Unbracket(lhs_bracketed);
+    const NodePtr& rhs = Unbracket(rhs_bracketed);
+    if (!IsSameToken(lhs, rhs)) return false;
+
+    if (IsCommutative(*lhs, order))
+    {
+        /* Hashes of operands tell which way they may pair up, so operands are only compared in the order
+        their hashes match in. Both orders are only tried if both operands hash the same
+        */
+        const size_t lhs_first = hashes.at(Unbracket(lhs->Children[0]).get());
+        const size_t lhs_second = hashes.at(Unbracket(lhs->Children[1]).get());
+        const size_t rhs_first = hashes.at(Unbracket(rhs->Children[0]).get());
+        const size_t rhs_second = hashes.at(Unbracket(rhs->Children[1]).get());
+
+        if (lhs_first == rhs_first && lhs_second == rhs_second &&
+            IsSameNode(lhs->Children[0], rhs->Children[0], order, hashes) &&
+            IsSameNode(lhs->Children[1], rhs->Children[1], order, hashes))
+            return true;
+
+        return lhs_first == rhs_second && lhs_second == rhs_first &&
+            IsSameNode(lhs->Children[0], rhs->Children[1], order, hashes) &&
+            IsSameNode(lhs->Children[1], rhs->Children[0], order, hashes);
+    }
+
+    for (size_t i = 0; i < lhs->Children.size(); i++)
+        if (!IsSameNode(lhs->Children[i], rhs->Children[i], order, hashes)) return false;
+
+    return true;
+}
+
+size_t MathExpressions::HashStructure(const Tree<Parser::TokenPtr>& tree, MathExpressions::OperandOrder order)
+{
+    return tree.Root ? HashNode(tree.Root, order) : 0;
+}
+
+bool MathExpressions::IsSameStructure(
+    const Tree<Parser::TokenPtr>& lhs,
+    const Tree<Parser::TokenPtr>& rhs,
+    MathExpressions::OperandOrder order
+) {
+    if (!lhs.Root || !rhs.Root) return !lhs.Root && !rhs.Root;
+
+    // Every node is hashed once up front, which keeps comparison linear however deep trees are
+    HashMemo hashes;
+    if (order == OperandOrder::Normalized)
+    {
+        HashNode(lhs.Root, order, &hashes);
+        HashNode(rhs.Root, order, &hashes);
+    }
+
+    return IsSameNode(lhs.Root, rhs.Root, order, hashes);
+}
+
+MathExpressions::StructuralHash::StructuralHash(MathExpressions::OperandOrder order) : Order(order) {}
+
+size_t MathExpressions::StructuralHash::operator()(const MathExpressions::CompiledExpressionPtr& expression) const
+{
+    if (!expression->GetTree().Root) return std::hash<std::string>()(expression->GetSource());
+
+    return HashStructure(expression->GetTree(), Order);
+}
+
+MathExpressions::StructuralEqual::StructuralEqual(MathExpressions::OperandOrder order) : Order(order) {}
+
+bool MathExpressions::StructuralEqual::operator()(
+    const MathExpressions::CompiledExpressionPtr& lhs,
+    const MathExpressions::CompiledExpressionPtr& rhs
+) const {
+    if (!lhs->GetTree().Root || !rhs->GetTree().Root)
+        return !lhs->GetTree().Root && !rhs->GetTree().Root && lhs->GetSource() == rhs->GetSource();
+
+    return IsSameStructure(lhs->GetTree(), rhs->GetTree(), Order);
+}
@@ -0,0 +1,82 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include "Parser/Parser.hpp"
+#include "Parser/Tree.hpp"
+#include "CompiledExpression.hpp"
+
+namespace MathExpressions
+{
+	// How structural comparison treats operands of additions and multiplications
+	enum class OperandOrder : unsigned char
+	{
+		// 'x+y' and 'y+x' are different expressions
+		AsWritten,
+		// 'x+y' and 'y+x' are the same expression. Operands are only ever swapped, never regrouped,
+		// so 'x+y+z' and 'x+(y+z)' stay different, as they can evaluate to different results
+		Normalized
+	};
+
+	/// <summary>
+	/// Hashes the structure of the AST: kinds of tokens and how they're nested, names of variables and called functions and values of numbers.
+	/// Whitespace, redundant brackets and aliases of built-in functions don't affect the hash, so 'x+y', 'x + y' and '(x)+y' hash the same,
+	/// and so do 'tg(x)' and 'tan(x)'.
+	/// Walks the AST once and allocates nothing
+	/// </summary>
+	size_t HashStructure(const Tree<Parser::TokenPtr>& tree, OperandOrder order = OperandOrder::AsWritten);
+
+	/// <summary>
+	/// Checks whether two ASTs have the same structure, in the same sense 'HashStructure' hashes it
+	/// </summary>
+	bool IsSameStructure(
+		const Tree<Parser::TokenPtr>& lhs,
+		const Tree<Parser::TokenPtr>& rhs,
+		OperandOrder order = OperandOrder::AsWritten
+	);
+
+	/* Hash and equality of compiled expressions by structure, for keying containers, e.g.
+	std::unordered_map<CompiledExpressionPtr, T, StructuralHash, StructuralEqual>.
+	Expressions without an AST (loaded from an archive) are compared by their source
+	*/
+	struct StructuralHash
+	{
+		OperandOrder Order;
+
+		StructuralHash(OperandOrder order = OperandOrder::AsWritten);
+
+		size_t operator()(const CompiledExpressionPtr& expression) const;
+	};
+
+	struct StructuralEqual
+	{
+		OperandOrder Order;
+
+		StructuralEqual(OperandOrder order = OperandOrder::AsWritten);
+
+		bool operator()(const CompiledExpressionPtr& lhs, const CompiledExpressionPtr& rhs) const;
+	};
+}
@@ -0,0 +1,323 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include "Printing.hpp"
+#include "SymbolicDifferentiation.hpp"
+
+using MathExpressions::OpCode;
+
+// Node of an expression being differentiated. Immutable, so subexpressions are freely shared between nodes
+struct Symbolic;
+typedef std::shared_ptr<const Symbolic> SymbolicPtr;
+
+struct Symbolic
+{
+    OpCode Op;
+    // Value of a constant
+    long double Value;
+    // Name of a variable
+    std::string Name;
+    SymbolicPtr Lhs, Rhs;
+};
+
+static SymbolicPtr MakeConstant(long double value)
+{
+    return std::make_shared<const Symbolic>(Symbolic{ OpCode::Constant, value, std::string(), nullptr, nullptr });
+}
+
+static bool IsConstant(const SymbolicPtr& node, long double value)
+{
+    return node->Op == OpCode::Constant && node->Value == value;
+}
+
+/* Creates an operation, simplifying it on the way
+Only simplifications that can't change the result of evaluation on their own are performed, except that
+multiplication by zero is assumed to be zero. So 'u-u' and 'u^0' are kept, as 'u' may fail or be infinite.
+Folded constants that aren't finite are left unfolded, so errors like division by zero still happen
+when the derivative is evaluated
+*/
+static SymbolicPtr Make(OpCode op, SymbolicPtr lhs, SymbolicPtr rhs = nullptr)
+{
+    const bool constant_lhs = lhs->Op == OpCode::Constant;
+    const bool constant_rhs = rhs && rhs->Op == OpCode::Constant;
+    long double folded = std::numeric_limits<long double>::quiet_NaN();
+
+    switch (op)
+    {
+    case OpCode::Add:
+        if (constant_lhs && constant_rhs) folded = lhs->Value + rhs->Value;
+        else if (IsConstant(lhs, 0)) return rhs;
+        else if (IsConstant(rhs, 0)) return lhs;
+        else if (rhs->Op == OpCode::Negate) return Make(OpCode::Sub, lhs, rhs->Lhs);
+        else if (lhs->Op == OpCode::Negate) return Make(OpCode::Sub, rhs, lhs->Lhs);
+        break;
+    case OpCode::Sub:
+        if (constant_lhs && constant_rhs) folded = lhs->Value - rhs->Value;
+        else if (IsConstant(rhs, 0)) return lhs;
+        else if (IsConstant(lhs, 0)) return Make(OpCode::Negate, rhs);
+        else if (rhs->Op == OpCode::Negate) return Make(OpCode::Add, lhs, rhs->Lhs);
+        break;
+    case OpCode::Mul:
+        if (constant_lhs && constant_rhs) folded = lhs->Value * rhs->Value;
+        // Constants go first, so they can be combined with constants of nested multiplications
+        else if (constant_rhs) return Make(OpCode::Mul, rhs, lhs);
+        else if (IsConstant(lhs, 0)) return lhs;
+        else if (IsConstant(lhs, 1)) return rhs;
+        else if (IsConstant(lhs, -1)) return Make(OpCode::Negate, rhs);
+        else if (constant_lhs && rhs->Op == OpCode::Mul && rhs->Lhs->Op == OpCode::Constant)
+            return Make(OpCode::Mul, MakeConstant(lhs->Value * rhs->Lhs->Value), rhs->Rhs);
+        else if (lhs->Op == OpCode::Negate && rhs->Op == OpCode::Negate) return Make(OpCode::Mul, lhs->Lhs, rhs->Lhs);
+        else if (lhs->Op == OpCode::Negate) return Make(OpCode::Negate, Make(OpCode::Mul, lhs->Lhs, rhs));
+        else if (rhs->Op == OpCode::Negate) return Make(OpCode::Negate, Make(OpCode::Mul, lhs, rhs->Lhs));
+        break;
+    case OpCode::Div:
+        // Zero is only folded over a nonzero constant, as '0/x' still fails wherever 'x' is zero
+        if (constant_lhs && constant_rhs && rhs->Value != 0) folded = lhs->Value / rhs->Value;
+        else if (IsConstant(rhs, 1)) return lhs;
+        else if (lhs->Op == OpCode::Negate) return Make(OpCode::Negate, Make(OpCode::Div, lhs->Lhs, rhs));
+        break;
+    case OpCode::Pow:
+        if (constant_lhs && constant_rhs && !(rhs->Value < 1 && lhs->Value < 0)) folded = powl(lhs->Value, rhs->Value);
+        else if (IsConstant(rhs, 1)) return lhs;
+        break;
+    case OpCode::Negate:
+        if (constant_lhs) folded = -lhs->Value;
+        else if (lhs->Op == OpCode::Negate) return lhs->Lhs;
+        break;
+    default:
+        break;
+    }
+
+    if (std::isfinite(folded)) return MakeConstant(folded);
+
+    return std::make_shared<const Symbolic>(Symbolic{ op, 0, std::string(), std::move(lhs), std::move(rhs) });
+}
+
+static SymbolicPtr Square(const SymbolicPtr& node)
+{
+    return Make(OpCode::Pow, node, MakeConstant(2));
+}
+
+// Derivative of an operation by it's argument, multiplied by derivative of the argument
+static SymbolicPtr DifferentiateUnary(const SymbolicPtr& node, const SymbolicPtr& du)
+{
+    const SymbolicPtr& u = node->Lhs;
+    const SymbolicPtr one = MakeConstant(1);
+
+    switch (node->Op)
+    {
+    case OpCode::Negate: return Make(OpCode::Negate, du);
+    case OpCode::Abs: return Make(OpCode::Mul, Make(OpCode::Sign, u), du);
+    case OpCode::LogE: return Make(OpCode::Div, du, u);
+    case OpCode::Log2: return Make(OpCode::Div, du, Make(OpCode::Mul, u, Make(OpCode::LogE, MakeConstant(2))));
+    case OpCode::Log10: return Make(OpCode::Div, du, Make(OpCode::Mul, u, Make(OpCode::LogE, MakeConstant(10))));
+    case OpCode::Exp: return Make(OpCode::Mul, node, du);
+    case OpCode::Sqrt: return Make(OpCode::Div, du, Make(OpCode::Mul, MakeConstant(2), node));
+    case OpCode::Sign: return MakeConstant(0);
+    case OpCode::Sin: return Make(OpCode::Mul, Make(OpCode::Cos, u), du);
+    case OpCode::Cos: return Make(OpCode::Negate, Make(OpCode::Mul, Make(OpCode::Sin, u), du));
+    case OpCode::Tan: return Make(OpCode::Div, du, Square(Make(OpCode::Cos, u)));
+    case OpCode::Cot: return Make(OpCode::Negate, Make(OpCode::Div, du, Square(Make(OpCode::Sin, u))));
+    case OpCode::Asin: return Make(OpCode::Div, du, Make(OpCode::Sqrt, Make(OpCode::Sub, one, Square(u))));
+    case OpCode::Acos: return Make(OpCode::Negate, Make(OpCode::Div, du, Make(OpCode::Sqrt, Make(OpCode::Sub, one, Square(u)))));
+    case OpCode::Atan: return Make(OpCode::Div, du, Make(OpCode::Add, one, Square(u)));
+    case OpCode::Sinh: return Make(OpCode::Mul, Make(OpCode::Cosh, u), du);
+    case OpCode::Cosh: return Make(OpCode::Mul, Make(OpCode::Sinh, u), du);
+    case OpCode::Tanh: return Make(OpCode::Div, du, Square(Make(OpCode::Cosh, u)));
+    case OpCode::Asinh: return Make(OpCode::Div, du, Make(OpCode::Sqrt, Make(OpCode::Add, Square(u), one)));
+    case OpCode::Acosh: return Make(OpCode::Div, du, Make(OpCode::Sqrt, Make(OpCode::Sub, Square(u), one)));
+    case OpCode::Atanh: return Make(OpCode::Div, du, Make(OpCode::Sub, one, Square(u)));
+    default: throw std::runtime_error("Operation can't be differentiated");
+    }
+}
+
+static SymbolicPtr DifferentiateBinary(const SymbolicPtr& node, const SymbolicPtr& du, const SymbolicPtr& dv)
+{
+    const SymbolicPtr& u = node->Lhs;
+    const SymbolicPtr& v = node->Rhs;
+    const bool constant_v = IsConstant(dv, 0);
+
+    switch (node->Op)
+    {
+    case OpCode::Add: return Make(OpCode::Add, du, dv);
+    case OpCode::Sub: return Make(OpCode::Sub, du, dv);
+    case OpCode::Mul: return Make(OpCode::Add, Make(OpCode::Mul, du, v), Make(OpCode::Mul, u, dv));
+    case OpCode::Div:
+        return Make(OpCode::Div, Make(OpCode::Sub, Make(OpCode::Mul, du, v), Make(OpCode::Mul, u, dv)), Square(v));
+    case OpCode::Pow:
+        // Power rule doesn't need a logarithm of the base, so it also works for negative bases
+        if (constant_v)
+            return Make(OpCode::Mul, Make(OpCode::Mul, v, Make(OpCode::Pow, u, Make(OpCode::Sub, v, MakeConstant(1)))), du);
+
+        return Make(OpCode::Mul, node, Make(OpCode::Add,
+            Make(OpCode::Mul, dv, Make(OpCode::LogE, u)),
+            Make(OpCode::Div, Make(OpCode::Mul, v, du), u)
+        ));
+    case OpCode::Log:
+    {
+        // log(u, v) = ln(u) / ln(v)
+        const SymbolicPtr ln_v = Make(OpCode::LogE, v);
+        if (constant_v) return Make(OpCode::Div, du, Make(OpCode::Mul, u, ln_v));
+
+        return Make(OpCode::Div,
+            Make(OpCode::Sub,
+                Make(OpCode::Div, Make(OpCode::Mul, du, ln_v), u),
+                Make(OpCode::Div, Make(OpCode::Mul, Make(OpCode::LogE, u), dv), v)
+            ),
+            Square(ln_v)
+        );
+    }
+    default: throw std::runtime_error("Operation can't be differentiated");
+    }
+}
+
+// Constants are written as the shortest decimal that reads back as the same value
+static void RenderConstant(long double value, std::string& out_text)
+{
+    if (value == static_cast<long double>(M_PI)) { out_text += "pi"; return; }
+    if (value == static_cast<long double>(M_E)) { out_text += "e"; return; }
+
+    MathExpressions::PrintNumber(value, out_text);
+}
+
+static void Render(const SymbolicPtr& node, std::string& out_text);
+
+// Operands that aren't a single number, variable or function call are put in brackets
+static void RenderOperand(const SymbolicPtr& node, std::string& out_text)
+{
+    bool atomic = node->Op == OpCode::Variable || node->Op == OpCode::Abs ||
+        (node->Op == OpCode::Constant && !std::signbit(node->Value)) ||
+        MathExpressions::GetFunctionName(node->Op);
+
+    if (atomic) return Render(node, out_text);
+
+    out_text.push_back('(');
+    Render(node, out_text);
+    out_text.push_back(')');
+}
+
+static void Render(const SymbolicPtr& node, std::string& out_text)
+{
+    switch (node->Op)
+    {
+    case OpCode::Constant:
+        if (std::signbit(node->Value))
+        {
+            out_text.push_back('-');
+            RenderConstant(-node->Value, out_text);
+        }
+        else RenderConstant(node->Value, out_text);
+        return;
+    case OpCode::Variable:
+        out_text += node->Name;
+        return;
+    case OpCode::Add: case OpCode::Sub: case OpCode::Mul: case OpCode::Div: case OpCode::Pow:
+        RenderOperand(node->Lhs, out_text);
+        out_text.push_back("+-*/^"[static_cast<size_t>(node->Op) - static_cast<size_t>(OpCode::Add)]);
+        RenderOperand(node->Rhs, out_text);
+        return;
+    case OpCode::Negate:
+        out_text.push_back('-');
+        RenderOperand(node->Lhs, out_text);
+        return;
+    case OpCode::Abs:
+        // Bracketed, so nested modulus brackets can't be matched with each other
+        out_text.push_back('|');
+        RenderOperand(node->Lhs, out_text);
+        out_text.push_back('|');
+        return;
+    case OpCode::Log:
+        out_text += "log(";
+        Render(node->Lhs, out_text);
+        out_text += ", ";
+        Render(node->Rhs, out_text);
+        out_text.push_back(')');
+        return;
+    default:
+        out_text += MathExpressions::GetFunctionName(node->Op);
+        out_text.push_back('(');
+        Render(node->Lhs, out_text);
+        out_text.push_back(')');
+    }
+}
+
+MathExpressions::CompiledExpressionPtr MathExpressions::Differentiate(
+    const MathExpressions::CompiledExpression& expression,
+    const std::string& variable
+) {
+    const Program& program = expression.GetProgram();
+    const std::vector<Instruction>& instructions = program.GetInstructions();
+
+    // Operands precede their users, so both the expression and it's derivative are built in a single pass
+    std::vector<SymbolicPtr> nodes(instructions.size()), derivatives(instructions.size());
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        const Instruction& instr = instructions[i];
+
+        switch (instr.Op)
+        {
+        case OpCode::Constant:
+            nodes[i] = MakeConstant(program.GetConstants()[instr.Lhs]);
+            derivatives[i] = MakeConstant(0);
+            break;
+        case OpCode::Variable:
+        {
+            const std::string& name = program.GetSymbols()[instr.Lhs];
+            nodes[i] = std::make_shared<const Symbolic>(Symbolic{ OpCode::Variable, 0, name, nullptr, nullptr });
+            derivatives[i] = MakeConstant(name == variable ? 1 : 0);
+            break;
+        }
+        case OpCode::Call:
+            throw std::invalid_argument("Native functions can't be differentiated");
+        default:
+            // The expression itself is kept as is, so each node is still the operation rules expect
+            nodes[i] = std::make_shared<const Symbolic>(Symbolic{
+                instr.Op, 0, std::string(), nodes[instr.Lhs], GetArity(instr.Op) == 2 ? nodes[instr.Rhs] : nullptr
+            });
+
+            if (GetArity(instr.Op) == 2)
+                derivatives[i] = DifferentiateBinary(nodes[i], derivatives[instr.Lhs], derivatives[instr.Rhs]);
+            else derivatives[i] = DifferentiateUnary(nodes[i], derivatives[instr.Lhs]);
+        }
+    }
+
+    std::string text;
+    Render(derivatives.back(), text);
+
+    return MathExpressions::Compile(text);
+}
+
+MathExpressions::CompiledExpressionPtr MathExpressions::Differentiate(
+    const std::string& expression,
+    const std::string& variable
+) {
+    return Differentiate(*MathExpressions::Compile(expression), variable);
+}
@@ -0,0 +1,49 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <string>
+#include "CompiledExpression.hpp"
+
+namespace MathExpressions
+{
+	/// <summary>
+	/// Builds derivative of an expression by a variable as an expression of it's own.
+	/// Derivative is assembled by differentiation rules and simplified (constants folded, additions of zero and
+	/// multiplications by one or zero dropped), written out as text, then tokenized, parsed and compiled
+	/// like any other expression, so it has a regular AST that 'Stringify' works with.
+	/// Variables other than 'variable' are treated as constants.
+	/// Throws std::invalid_argument if expression calls native functions, as their derivatives are unknown
+	/// </summary>
+	/// <param name="expression">- expression to differentiate</param>
+	/// <param name="variable">- name of the variable to differentiate by</param>
+	/// <returns>Compiled derivative. Constant zero if expression doesn't reference the variable</returns>
+	CompiledExpressionPtr Differentiate(const CompiledExpression& expression, const std::string& variable);
+
+	/// <summary>
+	/// Compiles an expression and builds it's derivative by a variable
+	/// </summary>
+	CompiledExpressionPtr Differentiate(const std::string& expression, const std::string& variable);
+}
@@ -0,0 +1,109 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Compares derivatives computed by both modes of automatic differentiation against finite differences
+Every expression is differentiated by every variable at a number of points where it's smooth.
+Central differences are accurate to about 1e-9 there, so both modes have to agree with them to 1e-6.
+Besides the shared smooth expressions, every other kind of token is differentiated, as well as a term
+that has an infinite partial derivative but is multiplied by zero
+*/
+
+#include <cstdio>
+#include <exception>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/AutomaticDifferentiation.hpp"
+#include "TestSupport.hpp"
+
+// Smooth around every one of 'Testing::SmoothPoints' too
+static const char* const Expressions[] = {
+    "|x-y|*z", "tg(x/2)+ctg(z)", "asin(x/3)*log2(y)", "log10(x*y)-acosh(y+z)", "atanh(x/4)+sign(y-1)*z", "sqrt(y*0)+x"
+};
+
+int main()
+{
+    std::vector<const char*> texts(std::begin(Testing::SmoothExpressions), std::end(Testing::SmoothExpressions));
+    texts.insert(texts.end(), std::begin(Expressions), std::end(Expressions));
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        for (const char* text : texts)
+        {
+            MathExpressions::CompiledExpressionPtr expression = MathExpressions::Compile(text);
+            const MathExpressions::Program& program = expression->GetProgram();
+            const std::vector<std::string>& symbols = program.GetSymbols();
+
+            for (const long double* point : Testing::SmoothPoints)
+            {
+                std::vector<long double> values;
+                for (const std::string& symbol : symbols) values.push_back(point[symbol[0] - 'x']);
+
+                std::vector<long double> gradient(symbols.size());
+                if (MathExpressions::TryEvaluateGradient(program, values.data(), gradient.data()).Status != MathExpressions::EvaluationStatus::Success)
+                {
+                    std::printf("%s: reverse mode failed\n", text);
+                    mismatches++;
+                    continue;
+                }
+
+                for (size_t i = 0; i < symbols.size(); i++)
+                {
+                    std::vector<long double> tangents(symbols.size(), 0);
+                    tangents[i] = 1;
+
+                    long double directional = 0;
+                    if (MathExpressions::TryEvaluateDirectional(program, values.data(), tangents.data(), directional).Status !=
+                        MathExpressions::EvaluationStatus::Success)
+                    {
+                        std::printf("%s: forward mode failed\n", text);
+                        mismatches++;
+                        continue;
+                    }
+
+                    const long double difference = Testing::CentralDifference([&](long double at) {
+                        std::vector<long double> shifted = values;
+                        shifted[i] = at;
+                        return program.TryEvaluate(shifted.data()).Value;
+                    }, values[i]);
+
+                    checks++;
+                    if (Testing::IsClose(directional, difference) && Testing::IsClose(gradient[i], difference)) continue;
+
+                    std::printf("%s by %s at (%Lg, %Lg, %Lg): forward %.12Lg, reverse %.12Lg, finite difference %.12Lg\n",
+                        text, symbols[i].c_str(), point[0], point[1], point[2], directional, gradient[i], difference);
+                    mismatches++;
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "derivatives", "differ from finite differences", "match finite differences");
+}
@@ -0,0 +1,418 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Evaluates batches of rows with every fault policy and compares every row against scalar evaluation
+Rows are generated with zeroes and negative values, so they run into every kind of error. Batch evaluation faults
+arguments outside of function's domain with 'OutOfDomain', where scalar evaluation returns NaN, so such rows are expected
+to fault unless scalar evaluation runs into an error before them. Row counts are neither multiples of 64 (words of masks)
+nor of the chunk size, and typed columns are loaded with gaps in their validity
+*/
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/BatchEvaluation.hpp"
+#include "TestSupport.hpp"
+
+using MathExpressions::ColumnType;
+using MathExpressions::EvaluationResult;
+using MathExpressions::EvaluationStatus;
+using MathExpressions::FaultPolicy;
+using MathExpressions::OpCode;
+
+static const char* const Expressions[] = {
+    "x/y", "sqrt(x)+y", "ln(x)*y", "acos(y/4)+x", "log(x, y)", "x^y", "acosh(x)-atanh(y/3)", "log10(y)/x", "(x-y)/(x+y)"
+};
+
+static const size_t RowCounts[] = { 1, 63, 65, 257, 1000 };
+
+static const FaultPolicy Policies[] = { FaultPolicy::NaN, FaultPolicy::Sentinel, FaultPolicy::PreviousValue };
+
+static const long double Sentinel = 42.5L;
+
+// Eighths keep values exact in every floating-point column, whole numbers are stored in integer ones
+static long double Numerator(const std::string& symbol, size_t row)
+{
+    if (symbol == "x") return static_cast<long double>((row * 37 + 11) % 61) - 30;
+    return static_cast<long double>((row * 53 + 7) % 47) - 23;
+}
+
+// Value faulted rows are expected to keep with 'FaultPolicy::PreviousValue'
+static long double Previous(size_t row)
+{
+    return -1000.0L - row;
+}
+
+static bool IsRowSet(const std::vector<uint64_t>& mask, size_t row)
+{
+    return (mask[row / 64] >> (row % 64)) & 1;
+}
+
+static bool IsSameValue(long double lhs, long double rhs)
+{
+    return lhs == rhs || (lhs != lhs && rhs != rhs);
+}
+
+// Whether batch evaluation faults operation with 'OutOfDomain' status
+static bool IsOutOfDomain(const MathExpressions::Instruction& instr, const long double* values)
+{
+    switch (instr.Op)
+    {
+    case OpCode::Log: return values[instr.Lhs] < 0 || values[instr.Rhs] < 0;
+    case OpCode::LogE: case OpCode::Log2: case OpCode::Log10: return values[instr.Lhs] < 0;
+    case OpCode::Asin: case OpCode::Acos: case OpCode::Atanh: return std::fabs(values[instr.Lhs]) > 1;
+    case OpCode::Acosh: return values[instr.Lhs] < 1;
+    default: return false;
+    }
+}
+
+// Scalar result, unless an argument outside of function's domain comes before the error scalar evaluation has ran into
+static EvaluationResult Expected(const MathExpressions::Program& program, const long double* symbol_values)
+{
+    const std::vector<MathExpressions::Instruction>& instructions = program.GetInstructions();
+    std::vector<long double> values(instructions.size());
+
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        if (program.Execute(i, values.data(), symbol_values) != EvaluationStatus::Success) break;
+        if (IsOutOfDomain(instructions[i], values.data())) return { 0, EvaluationStatus::OutOfDomain, i };
+    }
+
+    return program.TryEvaluate(symbol_values);
+}
+
+static std::string DescribePolicy(FaultPolicy policy)
+{
+    if (policy == FaultPolicy::NaN) return "NaN";
+    if (policy == FaultPolicy::Sentinel) return "sentinel";
+    return "previous value";
+}
+
+// Evaluates every row into 'BatchResult' and checks values, error kinds and masks
+static size_t CheckBatchResult(
+    const char* expression, const MathExpressions::Program& program, size_t row_count, FaultPolicy policy, size_t& checks
+) {
+    const std::vector<std::string>& symbols = program.GetSymbols();
+    std::vector<std::vector<long double>> columns(symbols.size());
+    std::vector<const long double*> column_pointers;
+
+    for (size_t k = 0; k < symbols.size(); k++)
+    {
+        for (size_t r = 0; r < row_count; r++) columns[k].push_back(Numerator(symbols[k], r) / 8);
+        column_pointers.push_back(columns[k].data());
+    }
+
+    MathExpressions::BatchResult result;
+    if (policy == FaultPolicy::PreviousValue)
+        for (size_t r = 0; r < row_count; r++) result.Values.push_back(Previous(r));
+
+    MathExpressions::EvaluateBatch(program, column_pointers.data(), row_count, { policy, Sentinel }, result);
+
+    size_t mismatches = 0, faulted = 0;
+    std::vector<long double> symbol_values(symbols.size());
+
+    checks++;
+    if (result.Values.size() != row_count || result.Errors.size() != row_count || result.ErrorMask.size() != (row_count + 63) / 64)
+    {
+        std::printf("'%s' of %zu rows: result has the wrong size\n", expression, row_count);
+        return 1;
+    }
+
+    for (size_t r = 0; r < row_count; r++)
+    {
+        for (size_t k = 0; k < symbols.size(); k++) symbol_values[k] = columns[k][r];
+        const EvaluationResult expected = Expected(program, symbol_values.data());
+        const bool fault = expected.Status != EvaluationStatus::Success;
+        faulted += fault;
+
+        long double expected_value = expected.Value;
+        if (fault && policy == FaultPolicy::NaN) expected_value = std::nan("");
+        if (fault && policy == FaultPolicy::Sentinel) expected_value = Sentinel;
+        if (fault && policy == FaultPolicy::PreviousValue) expected_value = Previous(r);
+
+        checks++;
+        if (result.Errors[r] != expected.Status || IsRowSet(result.ErrorMask, r) != fault || !IsSameValue(result.Values[r], expected_value))
+        {
+            std::printf(
+                "'%s' of %zu rows with %s policy: row %zu gives %.20Lg with status %d and mask bit %d, expected %.20Lg with status %d\n",
+                expression, row_count, DescribePolicy(policy).c_str(), r, result.Values[r],
+                static_cast<int>(result.Errors[r]), static_cast<int>(IsRowSet(result.ErrorMask, r)),
+                expected_value, static_cast<int>(expected.Status)
+            );
+            mismatches++;
+        }
+    }
+
+    checks++;
+    if (result.ErrorCount != faulted)
+    {
+        std::printf("'%s' of %zu rows: %zu rows are reported faulted, %zu have faulted\n", expression, row_count, result.ErrorCount, faulted);
+        mismatches++;
+    }
+
+    checks++;
+    for (size_t r = row_count; r < result.ErrorMask.size() * 64; r++)
+    {
+        if (!IsRowSet(result.ErrorMask, r)) continue;
+
+        std::printf("'%s' of %zu rows: error mask has bit %zu set past the last row\n", expression, row_count, r);
+        mismatches++;
+        break;
+    }
+
+    return mismatches;
+}
+
+// Column of any type, along with the values the evaluator is expected to load out of it
+struct TypedColumn
+{
+    ColumnType Type;
+    std::vector<unsigned char> Bytes;
+    std::vector<long double> Loaded;
+    std::vector<uint64_t> Validity;
+};
+
+template<typename T>
+static void Append(TypedColumn& column, long double value)
+{
+    const T typed = static_cast<T>(value);
+    const size_t offset = column.Bytes.size();
+
+    column.Bytes.resize(offset + sizeof(T));
+    std::memcpy(&column.Bytes[offset], &typed, sizeof(T));
+    column.Loaded.push_back(static_cast<long double>(typed));
+}
+
+static TypedColumn MakeColumn(const std::string& symbol, ColumnType type, size_t row_count, size_t gap)
+{
+    TypedColumn column;
+    column.Type = type;
+    column.Validity.assign((row_count + 63) / 64, 0);
+
+    for (size_t r = 0; r < row_count; r++)
+    {
+        const long double numerator = Numerator(symbol, r);
+        switch (type)
+        {
+        case ColumnType::LongDouble: Append<long double>(column, numerator / 8); break;
+        case ColumnType::Double: Append<double>(column, numerator / 8); break;
+        case ColumnType::Float: Append<float>(column, numerator / 8); break;
+        case ColumnType::Int32: Append<int32_t>(column, numerator); break;
+        case ColumnType::Int64: Append<int64_t>(column, numerator); break;
+        }
+
+        if (r % gap != 3) column.Validity[r / 64] |= static_cast<uint64_t>(1) << (r % 64);
+    }
+
+    return column;
+}
+
+template<typename T>
+static long double ReadTarget(const std::vector<unsigned char>& bytes, size_t row)
+{
+    T value;
+    std::memcpy(&value, &bytes[row * sizeof(T)], sizeof(T));
+    return static_cast<long double>(value);
+}
+
+template<typename T>
+static void FillTarget(std::vector<unsigned char>& bytes, size_t row_count)
+{
+    bytes.resize(row_count * sizeof(T));
+    for (size_t r = 0; r < row_count; r++)
+    {
+        const T value = static_cast<T>(Previous(r));
+        std::memcpy(&bytes[r * sizeof(T)], &value, sizeof(T));
+    }
+}
+
+// Rounds value the way a target column of the type stores it
+static long double Round(long double value, ColumnType type)
+{
+    if (type == ColumnType::Double) return static_cast<double>(value);
+    if (type == ColumnType::Float) return static_cast<float>(value);
+    return value;
+}
+
+// Evaluates typed columns with gaps into a typed target and checks values and validity of every row
+static size_t CheckTypedColumns(
+    const char* expression, const MathExpressions::Program& program, size_t row_count, FaultPolicy policy,
+    size_t variant, size_t& checks
+) {
+    static const ColumnType SourceTypes[] = {
+        ColumnType::LongDouble, ColumnType::Double, ColumnType::Float, ColumnType::Int32, ColumnType::Int64
+    };
+    static const ColumnType TargetTypes[] = { ColumnType::LongDouble, ColumnType::Double, ColumnType::Float };
+
+    const std::vector<std::string>& symbols = program.GetSymbols();
+    std::vector<TypedColumn> columns;
+    std::vector<MathExpressions::ColumnView> views;
+
+    // Views point into the columns, so they can't be reallocated
+    columns.reserve(symbols.size());
+    for (size_t k = 0; k < symbols.size(); k++)
+    {
+        columns.push_back(MakeColumn(symbols[k], SourceTypes[(variant + k) % 5], row_count, 7 + 4 * k));
+
+        // Columns without a validity bitmap have a value in every row
+        const bool has_validity = (variant + k) % 3 != 0;
+        if (!has_validity) columns[k].Validity.assign(columns[k].Validity.size(), ~static_cast<uint64_t>(0));
+        views.push_back({ columns[k].Bytes.data(), columns[k].Type, has_validity ? columns[k].Validity.data() : nullptr });
+    }
+
+    const ColumnType target_type = TargetTypes[variant % 3];
+    std::vector<unsigned char> target;
+    switch (target_type)
+    {
+    case ColumnType::LongDouble: FillTarget<long double>(target, row_count); break;
+    case ColumnType::Double: FillTarget<double>(target, row_count); break;
+    default: FillTarget<float>(target, row_count); break;
+    }
+
+    // Bits past the last row have to stay as they were
+    const uint64_t pattern = 0x5555555555555555ull;
+    std::vector<uint64_t> validity((row_count + 63) / 64, pattern);
+
+    const size_t fault_count = MathExpressions::EvaluateBatch(
+        program, views.data(), row_count, { policy, Sentinel }, { target.data(), target_type, validity.data() }
+    );
+
+    size_t mismatches = 0, faulted = 0;
+    std::vector<long double> symbol_values(symbols.size());
+
+    for (size_t r = 0; r < row_count; r++)
+    {
+        bool fault = false;
+        for (size_t k = 0; k < symbols.size(); k++)
+        {
+            symbol_values[k] = columns[k].Loaded[r];
+            fault |= !IsRowSet(columns[k].Validity, r);
+        }
+
+        const EvaluationResult expected = Expected(program, symbol_values.data());
+        fault |= expected.Status != EvaluationStatus::Success;
+        faulted += fault;
+
+        long double expected_value = fault ? std::nan("") : expected.Value;
+        if (fault && policy == FaultPolicy::Sentinel) expected_value = Sentinel;
+        if (fault && policy == FaultPolicy::PreviousValue) expected_value = Previous(r);
+        expected_value = Round(expected_value, target_type);
+
+        long double value;
+        switch (target_type)
+        {
+        case ColumnType::LongDouble: value = ReadTarget<long double>(target, r); break;
+        case ColumnType::Double: value = ReadTarget<double>(target, r); break;
+        default: value = ReadTarget<float>(target, r); break;
+        }
+
+        checks++;
+        if (!IsSameValue(value, expected_value) || IsRowSet(validity, r) == fault)
+        {
+            std::printf(
+                "'%s' of %zu typed rows with %s policy: row %zu gives %.20Lg with validity bit %d, expected %.20Lg that is %s\n",
+                expression, row_count, DescribePolicy(policy).c_str(), r, value, static_cast<int>(IsRowSet(validity, r)),
+                expected_value, fault ? "faulted" : "valid"
+            );
+            mismatches++;
+        }
+    }
+
+    checks++;
+    if (fault_count != faulted)
+    {
+        std::printf("'%s' of %zu typed rows: %zu rows are reported faulted, %zu have faulted\n", expression, row_count, fault_count, faulted);
+        mismatches++;
+    }
+
+    checks++;
+    for (size_t r = row_count; r < validity.size() * 64; r++)
+    {
+        if (IsRowSet(validity, r) == (((pattern >> (r % 64)) & 1) != 0)) continue;
+
+        std::printf("'%s' of %zu typed rows: validity bit %zu past the last row has been changed\n", expression, row_count, r);
+        mismatches++;
+        break;
+    }
+
+    return mismatches;
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        std::vector<std::string> expressions(std::begin(Expressions), std::end(Expressions));
+
+        // Program long enough to be evaluated in chunks smaller than the largest one
+        std::string chain = "x/y";
+        for (size_t k = 1; k < 150; k++) chain += "+sqrt(x+" + std::to_string(k % 4) + ")/(y-" + std::to_string(k % 3) + ")";
+        expressions.push_back(chain);
+
+        for (size_t i = 0; i < expressions.size(); i++)
+        {
+            const MathExpressions::CompiledExpressionPtr compiled = MathExpressions::Compile(expressions[i]);
+            const MathExpressions::Program& program = compiled->GetProgram();
+            const char* description = i < sizeof(Expressions) / sizeof(Expressions[0]) ? Expressions[i] : "long chain";
+
+            for (size_t row_count : RowCounts)
+                for (FaultPolicy policy : Policies)
+                {
+                    mismatches += CheckBatchResult(description, program, row_count, policy, checks);
+                    mismatches += CheckTypedColumns(description, program, row_count, policy, i + row_count, checks);
+                }
+        }
+
+        // Results can't be stored in integer columns
+        checks++;
+        const MathExpressions::CompiledExpressionPtr compiled = MathExpressions::Compile("x+1");
+        const TypedColumn column = MakeColumn("x", ColumnType::Double, 4, 7);
+        const MathExpressions::ColumnView view = { column.Bytes.data(), column.Type, nullptr };
+        std::vector<int32_t> target(4);
+        try
+        {
+            MathExpressions::EvaluateBatch(
+                compiled->GetProgram(), &view, 4, MathExpressions::BatchOptions(), { target.data(), ColumnType::Int32, nullptr }
+            );
+            std::printf("Integer target column isn't refused\n");
+            mismatches++;
+        }
+        catch (const std::invalid_argument&) {}
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "rows of batches", "don't match scalar evaluation", "match scalar evaluation");
+}
@@ -0,0 +1,171 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Compiles formula files line by line with different numbers of threads
+Every line that compiles has to land at the index of it's line, blank lines and comments have to be skipped without
+diagnostics, and every line that fails has to get exactly one diagnostic, with diagnostics ordered by line.
+Results have to be the same however many threads compile them, and the same whether text is compiled from memory or a file
+*/
+
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/BulkCompilation.hpp"
+#include "TestSupport.hpp"
+
+static const char* const FilePath = "bulk_compilation.txt";
+
+enum class LineKind { Formula, Skipped, Failing };
+
+// Lines repeat enough times for several threads to claim batches of them
+static const std::pair<const char*, LineKind> Lines[] = {
+    { "x*sin(y)+2", LineKind::Formula }, { "", LineKind::Skipped }, { "  \t", LineKind::Skipped },
+    { "# comment", LineKind::Skipped }, { "  # indented comment", LineKind::Skipped }, { "x+", LineKind::Failing },
+    { "sqrt(x)/(y-1)\r", LineKind::Formula }, { "sin(x", LineKind::Failing }, { "|x-y|*2", LineKind::Formula },
+    { "x*)", LineKind::Failing }
+};
+static const size_t Repeats = 100;
+
+static bool IsSameTable(const MathExpressions::FormulaTable& lhs, const MathExpressions::FormulaTable& rhs)
+{
+    if (lhs.Formulas.size() != rhs.Formulas.size() || lhs.Diagnostics.size() != rhs.Diagnostics.size()) return false;
+
+    for (size_t i = 0; i < lhs.Formulas.size(); i++)
+    {
+        if (!lhs.Formulas[i] != !rhs.Formulas[i]) return false;
+        if (lhs.Formulas[i] && lhs.Formulas[i]->GetSource() != rhs.Formulas[i]->GetSource()) return false;
+    }
+
+    for (size_t i = 0; i < lhs.Diagnostics.size(); i++)
+    {
+        const MathExpressions::FormulaDiagnostic& a = lhs.Diagnostics[i];
+        const MathExpressions::FormulaDiagnostic& b = rhs.Diagnostics[i];
+        if (a.Line != b.Line || a.Column != b.Column || a.Message != b.Message) return false;
+    }
+
+    return true;
+}
+
+// Returns number of lines whose formula or diagnostics are wrong
+static size_t CheckTable(const MathExpressions::FormulaTable& table, size_t& checks)
+{
+    const size_t line_count = Repeats * (sizeof(Lines) / sizeof(Lines[0]));
+    size_t mismatches = 0, diagnostic = 0;
+
+    checks++;
+    if (table.Formulas.size() != line_count)
+    {
+        std::printf("%zu formulas for %zu lines\n", table.Formulas.size(), line_count);
+        return 1;
+    }
+
+    for (size_t i = 0; i < line_count; i++)
+    {
+        const std::pair<const char*, LineKind>& line = Lines[i % (sizeof(Lines) / sizeof(Lines[0]))];
+        std::string text = line.first;
+        if (!text.empty() && text.back() == '\r') text.pop_back();
+
+        // Diagnostics are ordered by line, so the ones of this line are next, if there are any
+        size_t diagnostic_count = 0;
+        for (; diagnostic < table.Diagnostics.size() && table.Diagnostics[diagnostic].Line == i + 1; diagnostic++)
+            diagnostic_count++;
+
+        checks++;
+        bool correct =
+            line.second == LineKind::Formula ? table.Formulas[i] && table.Formulas[i]->GetSource() == text && !diagnostic_count :
+            line.second == LineKind::Skipped ? !table.Formulas[i] && !diagnostic_count :
+            !table.Formulas[i] && diagnostic_count == 1;
+        if (correct) continue;
+
+        std::printf("Line %zu ('%s') has %s formula and %zu diagnostics\n",
+            i + 1, text.c_str(), table.Formulas[i] ? "a" : "no", diagnostic_count);
+        mismatches++;
+    }
+
+    checks++;
+    if (diagnostic != table.Diagnostics.size())
+    {
+        std::printf("%zu diagnostics are out of order or past the last line\n", table.Diagnostics.size() - diagnostic);
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    std::string text;
+    for (size_t repeat = 0; repeat < Repeats; repeat++)
+        for (const std::pair<const char*, LineKind>& line : Lines) (text += line.first) += '\n';
+
+    try
+    {
+        const MathExpressions::FormulaTable sequential = MathExpressions::CompileLines(text.data(), text.size(), 1);
+        mismatches += CheckTable(sequential, checks);
+
+        for (size_t threads : { 2, 4, 8, 0 })
+        {
+            checks++;
+            if (IsSameTable(MathExpressions::CompileLines(text.data(), text.size(), threads), sequential)) continue;
+
+            std::printf("Compiling with %zu threads differs from compiling on one\n", threads);
+            mismatches++;
+        }
+
+        {
+            std::ofstream file(FilePath, std::ios::binary | std::ios::trunc);
+            file << text;
+        }
+
+        checks++;
+        if (!IsSameTable(MathExpressions::CompileFile(FilePath, 4), sequential))
+        {
+            std::printf("Compiling a file differs from compiling it's text\n");
+            mismatches++;
+        }
+
+        checks++;
+        try
+        {
+            MathExpressions::CompileFile("bulk_compilation_missing.txt");
+            std::printf("Missing file has been compiled\n");
+            mismatches++;
+        }
+        catch (const std::runtime_error&) {}
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        mismatches++;
+    }
+
+    std::remove(FilePath);
+
+    return Testing::Report(mismatches, checks, "checks of compiled lines", "have failed", "have passed");
+}
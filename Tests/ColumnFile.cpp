@@ -0,0 +1,361 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Writes input columns of different types into a column file, reopens it and evaluates an expression
+straight from the mapped file into an output file, with windows that don't divide the number of rows.
+Every row read back from the output has to match scalar evaluation, then damaged copies of the input,
+truncated or of a different version, have to be refused with std::runtime_error
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/ColumnFile.hpp"
+#include "TestSupport.hpp"
+
+using MathExpressions::ColumnType;
+using MathExpressions::FaultPolicy;
+
+// Offsets of header fields, and sizes of the header and of a column record
+static const size_t MagicOffset = 0, VersionOffset = 4, ByteOrderOffset = 8, RowCountOffset = 16, ColumnCountOffset = 24;
+static const size_t HeaderSize = 64, RecordSize = 40;
+
+static const size_t RowCount = 1000;
+static const long double Sentinel = 42.5L;
+
+// Faults with division by zero where 'z' is zero and with a negative root where 'y' is below -20
+static const char* const Expression = "x*y/z+sqrt(y+20)";
+
+static const char* const InputPath = "column_file_input.mepc";
+static const char* const OutputPath = "column_file_output.mepc";
+static const char* const DamagedPath = "column_file_damaged.mepc";
+
+// Output columns, each evaluated with it's own window and policy
+struct OutputCase
+{
+    MathExpressions::ColumnSpec Spec;
+    size_t WindowRows;
+    FaultPolicy Policy;
+};
+
+static const OutputCase Outputs[] = {
+    { { "coarse", ColumnType::Double, true }, 300, FaultPolicy::NaN },
+    { { "fine", ColumnType::Float, true }, 100, FaultPolicy::Sentinel },
+    // Writer starts every value as zero, which is what faulted rows keep
+    { { "plain", ColumnType::LongDouble, false }, 1, FaultPolicy::PreviousValue }
+};
+
+static long double GetX(size_t row) { return (static_cast<long double>((row * 37 + 11) % 61) - 30) / 8; }
+static int32_t GetY(size_t row) { return static_cast<int32_t>((row * 53 + 7) % 47) - 23; }
+static float GetZ(size_t row) { return static_cast<float>((row * 29 + 5) % 13) / 4 - 1.5f; }
+
+static bool HasX(size_t row) { return row % 7 != 3; }
+static bool HasZ(size_t row) { return row % 11 != 5; }
+
+static bool IsRowSet(const uint64_t* mask, size_t row)
+{
+    return (mask[row / 64] >> (row % 64)) & 1;
+}
+
+static void SetRow(uint64_t* mask, size_t row)
+{
+    mask[row / 64] |= static_cast<uint64_t>(1) << (row % 64);
+}
+
+static bool IsSameValue(long double lhs, long double rhs)
+{
+    return lhs == rhs || (lhs != lhs && rhs != rhs);
+}
+
+static std::string ReadFile(const char* path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const char* path, const std::string& bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), bytes.size());
+}
+
+template<typename T>
+static void WriteField(std::string& bytes, size_t offset, T value)
+{
+    std::memcpy(&bytes[offset], &value, sizeof(value));
+}
+
+template<typename T>
+static T ReadField(const std::string& bytes, size_t offset)
+{
+    T value;
+    std::memcpy(&value, &bytes[offset], sizeof(value));
+    return value;
+}
+
+template<typename T>
+static long double ReadValue(const void* data, size_t row)
+{
+    return static_cast<long double>(static_cast<const T*>(data)[row]);
+}
+
+static long double ReadValue(const MathExpressions::ColumnView& column, size_t row)
+{
+    switch (column.Type)
+    {
+    case ColumnType::LongDouble: return ReadValue<long double>(column.Data, row);
+    case ColumnType::Double: return ReadValue<double>(column.Data, row);
+    case ColumnType::Float: return ReadValue<float>(column.Data, row);
+    case ColumnType::Int32: return ReadValue<int32_t>(column.Data, row);
+    case ColumnType::Int64: return ReadValue<int64_t>(column.Data, row);
+    }
+
+    return 0;
+}
+
+// Rounds value the way a column of the type stores it
+static long double Round(long double value, ColumnType type)
+{
+    if (type == ColumnType::Double) return static_cast<double>(value);
+    if (type == ColumnType::Float) return static_cast<float>(value);
+    return value;
+}
+
+static void WriteInput()
+{
+    MathExpressions::ColumnFileWriter writer(InputPath, RowCount, {
+        { "x", ColumnType::Double, true }, { "y", ColumnType::Int32, false }, { "z", ColumnType::Float, true }
+    });
+
+    const MathExpressions::ColumnTarget x = writer.GetColumn(writer.FindColumn("x"));
+    const MathExpressions::ColumnTarget y = writer.GetColumn(writer.FindColumn("y"));
+    const MathExpressions::ColumnTarget z = writer.GetColumn(writer.FindColumn("z"));
+
+    for (size_t r = 0; r < RowCount; r++)
+    {
+        static_cast<double*>(x.Data)[r] = static_cast<double>(GetX(r));
+        static_cast<int32_t*>(y.Data)[r] = GetY(r);
+        static_cast<float*>(z.Data)[r] = GetZ(r);
+
+        if (HasX(r)) SetRow(x.Validity, r);
+        if (HasZ(r)) SetRow(z.Validity, r);
+    }
+
+    writer.Flush();
+}
+
+// Checks that reopened input holds what has been written
+static size_t CheckInput(const MathExpressions::ColumnFile& input, size_t& checks)
+{
+    checks++;
+    const size_t x = input.FindColumn("x"), y = input.FindColumn("y"), z = input.FindColumn("z");
+    if (input.GetRowCount() != RowCount || input.GetColumns().size() != 3 || x == 3 || y == 3 || z == 3 ||
+        input.GetColumns()[y].Type != ColumnType::Int32 || input.GetColumns()[y].HasValidity)
+    {
+        std::printf("Input is reopened with %zu rows and %zu columns, which aren't the ones written\n",
+            input.GetRowCount(), input.GetColumns().size());
+        return 1;
+    }
+
+    const MathExpressions::ColumnView views[] = { input.GetColumn(x), input.GetColumn(y), input.GetColumn(z) };
+    size_t mismatches = 0;
+
+    for (size_t r = 0; r < RowCount; r++)
+    {
+        checks++;
+        if (ReadValue(views[0], r) == GetX(r) && ReadValue(views[1], r) == GetY(r) && ReadValue(views[2], r) == GetZ(r) &&
+            IsRowSet(views[0].Validity, r) == HasX(r) && IsRowSet(views[2].Validity, r) == HasZ(r))
+            continue;
+
+        std::printf("Row %zu of the input is read back differently than it has been written\n", r);
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+// Evaluates every output column, then reopens the output and compares every row against scalar evaluation
+static size_t CheckOutput(const MathExpressions::Program& program, const MathExpressions::ColumnFile& input, size_t& checks)
+{
+    std::vector<MathExpressions::ColumnSpec> specs;
+    for (const OutputCase& output : Outputs) specs.push_back(output.Spec);
+
+    std::vector<size_t> fault_counts;
+    {
+        MathExpressions::ColumnFileWriter writer(OutputPath, RowCount, specs);
+        for (size_t i = 0; i < specs.size(); i++)
+            fault_counts.push_back(MathExpressions::EvaluateColumns(
+                program, input, writer, i, { Outputs[i].Policy, Sentinel }, Outputs[i].WindowRows
+            ));
+
+        writer.Flush();
+    }
+
+    const MathExpressions::ColumnFile output(OutputPath);
+    const std::vector<std::string>& symbols = program.GetSymbols();
+    std::vector<long double> symbol_values(symbols.size());
+    size_t mismatches = 0;
+
+    for (size_t i = 0; i < specs.size(); i++)
+    {
+        const MathExpressions::ColumnView column = output.GetColumn(output.FindColumn(specs[i].Name));
+        size_t faulted = 0;
+
+        for (size_t r = 0; r < RowCount; r++)
+        {
+            for (size_t k = 0; k < symbols.size(); k++)
+            {
+                if (symbols[k] == "x") symbol_values[k] = GetX(r);
+                else if (symbols[k] == "y") symbol_values[k] = GetY(r);
+                else symbol_values[k] = GetZ(r);
+            }
+
+            const MathExpressions::EvaluationResult expected = program.TryEvaluate(symbol_values.data());
+            const bool fault = !HasX(r) || !HasZ(r) || expected.Status != MathExpressions::EvaluationStatus::Success;
+            faulted += fault;
+
+            long double expected_value = expected.Value;
+            if (fault && Outputs[i].Policy == FaultPolicy::NaN) expected_value = std::numeric_limits<long double>::quiet_NaN();
+            if (fault && Outputs[i].Policy == FaultPolicy::Sentinel) expected_value = Sentinel;
+            if (fault && Outputs[i].Policy == FaultPolicy::PreviousValue) expected_value = 0;
+            expected_value = Round(expected_value, specs[i].Type);
+
+            const long double value = ReadValue(column, r);
+            const bool valid = !column.Validity || IsRowSet(column.Validity, r);
+
+            checks++;
+            if (IsSameValue(value, expected_value) && valid == (!fault || !column.Validity)) continue;
+
+            std::printf("Row %zu of '%s' is read back as %.20Lg that is %s, expected %.20Lg that is %s\n",
+                r, specs[i].Name.c_str(), value, valid ? "valid" : "faulted", expected_value, fault ? "faulted" : "valid");
+            mismatches++;
+        }
+
+        checks++;
+        if (fault_counts[i] != faulted)
+        {
+            std::printf("%zu rows of '%s' are reported faulted, %zu have faulted\n", fault_counts[i], specs[i].Name.c_str(), faulted);
+            mismatches++;
+        }
+    }
+
+    // Output has to hold every row of the input
+    checks++;
+    try
+    {
+        MathExpressions::ColumnFileWriter writer(DamagedPath, RowCount - 1, specs);
+        MathExpressions::EvaluateColumns(program, input, writer, 0);
+        std::printf("Output with fewer rows than input isn't refused\n");
+        mismatches++;
+    }
+    catch (const std::invalid_argument&) {}
+
+    return mismatches;
+}
+
+// Writes the damaged copy and checks that opening it throws
+static bool IsRefused(const std::string& bytes)
+{
+    WriteFile(DamagedPath, bytes);
+
+    try
+    {
+        MathExpressions::ColumnFile file(DamagedPath);
+    }
+    catch (const std::runtime_error&)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        const MathExpressions::CompiledExpressionPtr compiled = MathExpressions::Compile(Expression);
+
+        WriteInput();
+        {
+            const MathExpressions::ColumnFile input(InputPath);
+            mismatches += CheckInput(input, checks);
+            mismatches += CheckOutput(compiled->GetProgram(), input, checks);
+        }
+
+        const std::string original = ReadFile(InputPath);
+
+        std::vector<std::pair<const char*, std::function<void(std::string&)>>> damages = {
+            { "missing last byte", [](std::string& bytes) { bytes.pop_back(); } },
+            { "missing last column", [](std::string& bytes) { bytes.resize(bytes.size() - RowCount); } },
+            { "header cut short", [](std::string& bytes) { bytes.resize(ColumnCountOffset); } },
+            { "records cut short", [](std::string& bytes) { bytes.resize(HeaderSize + RecordSize); } },
+            { "wrong magic", [](std::string& bytes) { bytes[MagicOffset] ^= 0x20; } },
+            { "newer version", [](std::string& bytes) {
+                WriteField<uint32_t>(bytes, VersionOffset, MathExpressions::ColumnFile::Version + 1);
+            } },
+            { "older version", [](std::string& bytes) {
+                WriteField<uint32_t>(bytes, VersionOffset, MathExpressions::ColumnFile::Version - 1);
+            } },
+            { "swapped byte order", [](std::string& bytes) { WriteField<uint32_t>(bytes, ByteOrderOffset, 0x04030201); } },
+            { "rows past the end", [](std::string& bytes) {
+                WriteField<uint64_t>(bytes, RowCountOffset, ReadField<uint64_t>(bytes, RowCountOffset) + 64);
+            } },
+            { "records past the end", [](std::string& bytes) { WriteField<uint64_t>(bytes, ColumnCountOffset, 1ull << 40); } }
+        };
+
+        for (const auto& damage : damages)
+        {
+            std::string bytes = original;
+            damage.second(bytes);
+
+            checks++;
+            if (IsRefused(bytes)) continue;
+
+            std::printf("Column file with %s isn't refused\n", damage.first);
+            mismatches++;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    std::remove(InputPath);
+    std::remove(OutputPath);
+    std::remove(DamagedPath);
+
+    return Testing::Report(mismatches, checks, "checks of column files", "have failed", "have passed");
+}
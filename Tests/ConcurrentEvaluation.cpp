@@ -0,0 +1,124 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Evaluates the same compiled expressions from many threads at once
+Meant to be run under ThreadSanitizer (see MATHEXPRESSIONPARSER_THREAD_SANITIZER CMake option),
+which reports any data race between threads sharing an expression. Without it, the test only checks
+that every thread computes exactly what a single thread does
+*/
+
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MathExpressionParser/CompiledExpression.hpp"
+
+static const size_t ThreadCount = 8;
+static const size_t Rounds = 2000;
+
+// Expressions cover brackets of both kinds, functions, constants and repeated variables
+static const char* const Expressions[] = {
+    "x*y-z/2", "(x+y)*(z-x)", "-x^2+|y-z|/2", "sqrt(z)*pi+e^x",
+    "sin(x)*cos(y)+log(z, 2)-atan(y/2)", "((x+1)*(y+2))/((z+3)*(x+4))", "x/(y-y)"
+};
+
+int main()
+{
+    std::vector<MathExpressions::CompiledExpressionPtr> compiled;
+    for (const char* expression : Expressions) compiled.push_back(MathExpressions::Compile(expression));
+
+    const MathExpressions::Environment env = { { "x", 0.5 }, { "y", 0.25 }, { "z", 2 } };
+
+    // What every thread should arrive at, computed before any of them starts
+    std::vector<MathExpressions::EvaluationResult> expected;
+    std::vector<std::string> expected_text;
+    for (const MathExpressions::CompiledExpressionPtr& expression : compiled)
+    {
+        expected.push_back(expression->TryEvaluate(env));
+        expected_text.emplace_back();
+        expression->Stringify(expected_text.back());
+    }
+
+    std::atomic<size_t> mismatches(0);
+
+    auto work = [&]() {
+        // Each thread has it's own environment, while expressions are shared
+        const MathExpressions::Environment thread_env = env;
+        const MathExpressions::Environment missing_env = { { "x", 1 } };
+        std::string text;
+
+        for (size_t round = 0; round < Rounds; round++)
+        {
+            for (size_t i = 0; i < compiled.size(); i++)
+            {
+                // Copying the pointer touches the reference count the other threads share
+                const MathExpressions::CompiledExpressionPtr expression = compiled[i];
+
+                MathExpressions::EvaluationResult result = expression->TryEvaluate(thread_env);
+                if (result.Status != expected[i].Status ||
+                    (result.Status == MathExpressions::EvaluationStatus::Success && result.Value != expected[i].Value))
+                    mismatches.fetch_add(1);
+
+                // Errors refer to tokens of the expression, which have to be read without being modified
+                try
+                {
+                    expression->Evaluate(missing_env);
+                    mismatches.fetch_add(1);
+                }
+                catch (const std::exception&) {}
+
+                // Tree is evaluated by tokens directly, rather than by the program
+                const Tree<Parser::TokenPtr>& tree = expression->GetTree();
+                auto token = dynamic_cast<const MathExpressions::Token*>(tree.Root->Value.get());
+                try
+                {
+                    if (token->Evaluate(tree.Root, thread_env) != expected[i].Value) mismatches.fetch_add(1);
+                }
+                catch (const std::exception&)
+                {
+                    if (expected[i].Status == MathExpressions::EvaluationStatus::Success) mismatches.fetch_add(1);
+                }
+
+                text.clear();
+                expression->Stringify(text);
+                if (text != expected_text[i]) mismatches.fetch_add(1);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < ThreadCount; i++) threads.emplace_back(work);
+    for (std::thread& thread : threads) thread.join();
+
+    if (mismatches.load())
+    {
+        std::printf("%zu evaluations differed from single-threaded ones\n", mismatches.load());
+        return 1;
+    }
+
+    std::printf("%zu threads agree on %zu expressions\n", ThreadCount, compiled.size());
+    return 0;
+}
@@ -0,0 +1,50 @@
+# Runs MathExpressionParser_csv over headers with empty and repeated column names, empty lines and bad thread counts
+# Usage: cmake -D TOOL=<path to the tool> -D WORK_DIR=<directory for input files> -P CsvHeader.cmake
+
+# Runs the tool over 'input' with a formula, stores exit code and everything it has printed
+function(run_tool input formula)
+	file(WRITE "${WORK_DIR}/header_test.csv" "${input}")
+	execute_process(
+		COMMAND "${TOOL}" -j 1 -i "${WORK_DIR}/header_test.csv" "${formula}"
+		RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE error
+	)
+	string(REPLACE "\r" "" output "${output}")
+	set(result "${result}" PARENT_SCOPE)
+	set(output "${output}" PARENT_SCOPE)
+	set(error "${error}" PARENT_SCOPE)
+endfunction()
+
+# Empty names take fields without being bound to anything
+run_tool("x,,,y\n1,2,3,4\n5,6,7,8\n" "r=x+y")
+if (NOT result EQUAL 0 OR NOT output STREQUAL "x,,,y,r\n1,2,3,4,5\n5,6,7,8,13\n")
+	message(FATAL_ERROR "Header with empty names, exit code ${result}:\n${output}${error}")
+endif()
+
+# Formulas can't tell which of the columns a repeated name means
+run_tool("x,y,x\n1,2,3\n" "r=x+y")
+if (result EQUAL 0 OR NOT error MATCHES "more than one column")
+	message(FATAL_ERROR "Formula using a repeated name, exit code ${result}:\n${output}${error}")
+endif()
+
+# Repeated names don't matter to formulas that don't use them
+run_tool("x,y,x\n1,2,3\n" "r=y*2")
+if (NOT result EQUAL 0 OR NOT output STREQUAL "x,y,x,r\n1,2,3,4\n")
+	message(FATAL_ERROR "Header with a repeated name, exit code ${result}:\n${output}${error}")
+endif()
+
+# Empty lines aren't rows, so they're left out
+run_tool("x\n1\n\n\r\n2\n" "r=x*2")
+if (NOT result EQUAL 0 OR NOT output STREQUAL "x,r\n1,2\n2,4\n")
+	message(FATAL_ERROR "Input with empty lines, exit code ${result}:\n${output}${error}")
+endif()
+
+# Negative counts would wrap around to huge ones, and too many threads are refused before any of them is started
+foreach(threads -1 0 " 4" 100000)
+	execute_process(
+		COMMAND "${TOOL}" -j "${threads}" -i "${WORK_DIR}/header_test.csv" "r=x*2"
+		RESULT_VARIABLE result OUTPUT_VARIABLE output ERROR_VARIABLE error
+	)
+	if (NOT result EQUAL 2 OR NOT error MATCHES "Expected")
+		message(FATAL_ERROR "Thread count '${threads}', exit code ${result}:\n${output}${error}")
+	endif()
+endforeach()
@@ -0,0 +1,210 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Writes expressions into an archive, loads them back and compares how they evaluate,
+then damages copies of the file in different ways, each of which has to be refused with std::runtime_error
+rather than loaded. Damage past the header only passes the checksum if the checksum is rewritten as well,
+which is how an out-of-range opcode is smuggled in
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/ExpressionArchive.hpp"
+#include "TestSupport.hpp"
+
+// Offsets of header fields, and of the first record's instruction offset within the payload
+static const size_t MagicOffset = 0, VersionOffset = 4, PayloadSizeOffset = 24, ChecksumOffset = 32;
+static const size_t RecordInstructionOffset = 16;
+
+static const char* const Expressions[] = {
+    "x*y-z/2", "sin(x)*cos(y)+log(z, 2)", "(x+1)/(y-y)", "-x^2+|y-z|/2", "sqrt(z)*pi+e^x", "42"
+};
+
+static const char* const ArchivePath = "expression_archive.mepa";
+static const char* const DamagedPath = "expression_archive_damaged.mepa";
+
+// Same 64-bit FNV-1a hash the archive uses
+static uint64_t Checksum(const char* data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+static std::string ReadFile(const char* path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const char* path, const std::string& bytes)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), bytes.size());
+}
+
+template<typename T>
+static T ReadField(const std::string& bytes, size_t offset)
+{
+    T value;
+    std::memcpy(&value, &bytes[offset], sizeof(value));
+    return value;
+}
+
+template<typename T>
+static void WriteField(std::string& bytes, size_t offset, T value)
+{
+    std::memcpy(&bytes[offset], &value, sizeof(value));
+}
+
+// Start of the payload, i.e. size of the header
+static size_t GetPayloadStart(const std::string& bytes)
+{
+    return bytes.size() - static_cast<size_t>(ReadField<uint64_t>(bytes, PayloadSizeOffset));
+}
+
+// Rewrites the checksum, so damage past the header goes unnoticed by it
+static void Reseal(std::string& bytes)
+{
+    const size_t start = GetPayloadStart(bytes);
+    WriteField(bytes, ChecksumOffset, Checksum(bytes.data() + start, bytes.size() - start));
+}
+
+// Writes the damaged copy and checks that opening it or loading every expression from it throws
+static bool IsRefused(const std::string& bytes)
+{
+    WriteFile(DamagedPath, bytes);
+
+    try
+    {
+        MathExpressions::ExpressionArchive archive(DamagedPath);
+        for (size_t i = 0; i < archive.GetExpressionCount(); i++) archive.Load(i);
+    }
+    catch (const std::runtime_error&)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        std::vector<MathExpressions::CompiledExpressionPtr> compiled;
+        for (const char* text : Expressions) compiled.push_back(MathExpressions::Compile(text));
+        MathExpressions::ExpressionArchive::Write(ArchivePath, compiled);
+
+        {
+            MathExpressions::ExpressionArchive archive(ArchivePath);
+
+            checks++;
+            if (archive.GetExpressionCount() != compiled.size())
+            {
+                std::printf("Archive holds %zu of %zu expressions\n", archive.GetExpressionCount(), compiled.size());
+                mismatches++;
+            }
+
+            const MathExpressions::Environment env = { { "x", 0.5L }, { "y", 1.25L }, { "z", 3 } };
+            for (size_t i = 0; i < compiled.size() && i < archive.GetExpressionCount(); i++)
+            {
+                MathExpressions::CompiledExpressionPtr loaded = archive.Load(i);
+                const MathExpressions::EvaluationResult actual = loaded->TryEvaluate(env);
+                const MathExpressions::EvaluationResult expected = compiled[i]->TryEvaluate(env);
+
+                checks++;
+                if (loaded->GetSource() == Expressions[i] && archive.GetSource(i) == Expressions[i] &&
+                    Testing::SameResult(actual, expected, true))
+                    continue;
+
+                std::printf("'%s' is loaded as '%s', which gives %.20Lg (status %d) instead of %.20Lg (status %d)\n",
+                    Expressions[i], loaded->GetSource().c_str(), actual.Value, static_cast<int>(actual.Status),
+                    expected.Value, static_cast<int>(expected.Status));
+                mismatches++;
+            }
+        }
+
+        const std::string original = ReadFile(ArchivePath);
+        const size_t payload_start = GetPayloadStart(original);
+        const size_t instructions = payload_start +
+            static_cast<size_t>(ReadField<uint64_t>(original, payload_start + RecordInstructionOffset));
+
+        std::vector<std::pair<const char*, std::function<void(std::string&)>>> damages = {
+            { "missing last byte", [](std::string& bytes) { bytes.pop_back(); } },
+            { "header cut short", [payload_start](std::string& bytes) { bytes.resize(payload_start / 2); } },
+            { "wrong magic", [](std::string& bytes) { bytes[MagicOffset] ^= 0x20; } },
+            { "newer version", [](std::string& bytes) {
+                WriteField<uint32_t>(bytes, VersionOffset, MathExpressions::ExpressionArchive::Version + 1);
+            } },
+            { "flipped checksum byte", [](std::string& bytes) { bytes[ChecksumOffset + 3] ^= 0x01; } },
+            { "flipped payload byte", [](std::string& bytes) { bytes[bytes.size() - 2] ^= 0x01; } },
+            { "opcode out of range", [instructions](std::string& bytes) {
+                WriteField<uint32_t>(bytes, instructions, 0xFF);
+                Reseal(bytes);
+            } },
+            { "call opcode", [instructions](std::string& bytes) {
+                WriteField<uint32_t>(bytes, instructions, static_cast<uint32_t>(MathExpressions::OpCode::Call));
+                Reseal(bytes);
+            } }
+        };
+
+        for (const auto& damage : damages)
+        {
+            std::string bytes = original;
+            damage.second(bytes);
+
+            checks++;
+            if (IsRefused(bytes)) continue;
+
+            std::printf("Archive with %s isn't refused\n", damage.first);
+            mismatches++;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    std::remove(ArchivePath);
+    std::remove(DamagedPath);
+
+    return Testing::Report(mismatches, checks, "checks of archived expressions", "have failed", "have passed");
+}
@@ -0,0 +1,246 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Asks a shared expression cache for the same and for different expressions from many threads at once
+Meant to be run under ThreadSanitizer (see MATHEXPRESSIONPARSER_THREAD_SANITIZER CMake option), same as ConcurrentEvaluation.
+Threads that miss on the same expression at once have to share a single compilation, failed compilations
+have to reach every waiting thread and leave nothing cached, and a cache too small for every expression
+has to keep evicting without dropping expressions that are still being compiled
+*/
+
+#include <atomic>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MathExpressionParser/ExpressionCache.hpp"
+#include "TestSupport.hpp"
+
+static const size_t ThreadCount = 8;
+static const size_t Rounds = 200;
+
+// Spellings of each expression differ only by whitespace, so they share a key
+static const std::vector<std::vector<std::string>> Spellings = {
+    { "x*y + sin(z)", "x*y+sin(z)", " x * y + sin( z ) " },
+    { "log(x, 2) - y", "log(x,2)-y", "\tlog( x ,2 )\t- y" },
+    { "sin (x)/y", "sin (x) / y", "sin  (x)/y" }
+};
+
+// Whitespace that separates words or a name from a bracket stays, so they don't merge into a different expression
+static const char* const Normalized[][2] = {
+    { "x + y", "x+y" }, { "\tx\t*  ( y -1 )", "x*(y-1)" }, { "sin  ( x )", "sin (x)" }, { "a   b + 1", "a b+1" }
+};
+
+// Runs the work on every thread at once, passing it the index of the thread
+static void RunThreads(const std::function<void(size_t)>& work)
+{
+    std::promise<void> start;
+    std::shared_future<void> started = start.get_future().share();
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < ThreadCount; i++)
+        threads.emplace_back([&work, started, i]() {
+            started.wait();
+            work(i);
+        });
+
+    start.set_value();
+    for (std::thread& thread : threads) thread.join();
+}
+
+// Joins 'x*K' for K from 1 to the count, so the expression takes a while to compile
+static std::string MakeLong(size_t count, size_t variant)
+{
+    std::string text = std::to_string(variant);
+    for (size_t k = 1; k <= count; k++) text += "+x*" + std::to_string(k);
+
+    return text;
+}
+
+// Every spelling of an expression has to result in the very same compiled expression, compiled once
+static size_t CheckSingleFlight(size_t& checks)
+{
+    std::vector<std::vector<std::string>> spellings = Spellings;
+    spellings.push_back({ MakeLong(400, 0), " " + MakeLong(400, 0) + " " });
+
+    MathExpressions::ExpressionCache cache(1 << 24, 4);
+    std::vector<std::vector<MathExpressions::CompiledExpressionPtr>> seen(ThreadCount);
+
+    RunThreads([&](size_t thread) {
+        for (size_t round = 0; round < Rounds; round++)
+            for (size_t i = 0; i < spellings.size(); i++)
+            {
+                const std::vector<std::string>& group = spellings[i];
+                MathExpressions::CompiledExpressionPtr compiled = cache.Get(group[(thread + round) % group.size()]);
+
+                if (seen[thread].size() <= i) seen[thread].push_back(compiled);
+                else if (seen[thread][i] != compiled) seen[thread][i] = nullptr;
+            }
+    });
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < spellings.size(); i++)
+    {
+        checks++;
+        for (size_t thread = 0; thread < ThreadCount; thread++)
+        {
+            if (seen[thread][i] && seen[thread][i] == seen[0][i]) continue;
+
+            std::printf("Threads got different expressions for '%s'\n", spellings[i][0].c_str());
+            mismatches++;
+            break;
+        }
+    }
+
+    checks++;
+    const MathExpressions::ExpressionCacheStats stats = cache.GetStats();
+    if (stats.Misses != spellings.size() || stats.Evictions != 0 || stats.Entries != spellings.size())
+    {
+        std::printf("%zu expressions have been compiled %zu times into %zu entries, with %zu evictions\n",
+            spellings.size(), stats.Misses, stats.Entries, stats.Evictions);
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+// Failure reaches every thread that has asked for the expression, and the expression is compiled again next time
+static size_t CheckFailures(size_t& checks)
+{
+    const char* const broken[] = { "x*(y+", "x * ( y +" };
+
+    MathExpressions::ExpressionCache cache(1 << 24, 4);
+    std::atomic<size_t> unthrown(0);
+
+    RunThreads([&](size_t thread) {
+        for (size_t round = 0; round < Rounds; round++)
+        {
+            try
+            {
+                cache.Get(broken[(thread + round) % 2]);
+                unthrown.fetch_add(1);
+            }
+            catch (const std::exception&) {}
+        }
+    });
+
+    size_t mismatches = 0;
+
+    checks++;
+    if (unthrown.load())
+    {
+        std::printf("%zu requests of a broken expression haven't thrown\n", unthrown.load());
+        mismatches++;
+    }
+
+    checks++;
+    const MathExpressions::ExpressionCacheStats stats = cache.GetStats();
+    if (stats.Entries != 0 || stats.Bytes != 0 || stats.Misses == 0)
+    {
+        std::printf("Broken expression has left %zu entries of %zu bytes after %zu compilations\n",
+            stats.Entries, stats.Bytes, stats.Misses);
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+// Cache that only fits a few expressions keeps evicting, while every thread keeps getting correct expressions
+static size_t CheckEviction(size_t& checks)
+{
+    std::vector<std::string> texts;
+    std::vector<MathExpressions::EvaluationResult> expected;
+    const MathExpressions::Environment env = { { "x", 0.5L }, { "y", 3 }, { "z", 7 } };
+
+    for (size_t k = 0; k < 24; k++)
+    {
+        texts.push_back("x*" + std::to_string(k) + "+sin(y)/(z-" + std::to_string(k) + ")");
+        if (k % 4 == 0) texts.back() = MakeLong(100, k);
+        expected.push_back(MathExpressions::Compile(texts.back())->TryEvaluate(env));
+    }
+
+    // Single shard, so every expression competes for the same few slots
+    const size_t budget = 4 * MathExpressions::Compile(texts[1])->GetMemoryUsage();
+    MathExpressions::ExpressionCache cache(budget, 1);
+    std::atomic<size_t> wrong(0);
+
+    RunThreads([&](size_t thread) {
+        for (size_t round = 0; round < Rounds; round++)
+        {
+            const size_t i = (thread * 7 + round * 5) % texts.size();
+            if (!Testing::SameResult(cache.Get(texts[i])->TryEvaluate(env), expected[i])) wrong.fetch_add(1);
+        }
+    });
+
+    size_t mismatches = 0;
+
+    checks++;
+    if (wrong.load())
+    {
+        std::printf("%zu expressions from a small cache evaluate differently\n", wrong.load());
+        mismatches++;
+    }
+
+    checks++;
+    const MathExpressions::ExpressionCacheStats stats = cache.GetStats();
+    if (stats.Evictions == 0 || stats.Bytes > budget)
+    {
+        std::printf("Cache of %zu bytes holds %zu bytes after %zu evictions\n", budget, stats.Bytes, stats.Evictions);
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        for (const auto& pair : Normalized)
+        {
+            checks++;
+            const std::string normalized = MathExpressions::NormalizeExpression(pair[0]);
+            if (normalized == pair[1]) continue;
+
+            std::printf("'%s' is normalized into '%s' instead of '%s'\n", pair[0], normalized.c_str(), pair[1]);
+            mismatches++;
+        }
+
+        mismatches += CheckSingleFlight(checks);
+        mismatches += CheckFailures(checks);
+        mismatches += CheckEviction(checks);
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "checks of the shared cache", "have failed", "have passed");
+}
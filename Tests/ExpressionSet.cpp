@@ -0,0 +1,129 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Merges expressions into a set and checks that every one of them evaluates exactly as it does on it's own,
+failures included: the same status at the same instruction (or symbol) of expression's own program.
+Expressions share subexpressions, some only once operands of '+' and '*' are ordered, and fail in places
+that merging reorders, such as an operand that's merged earlier than the one sequential evaluation fails at first.
+Zeroes of both signs have to stay apart, as they're different constants once divided by
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/ExpressionSet.hpp"
+#include "TestSupport.hpp"
+
+static const char* const Expressions[] = {
+    "exp(-r*t)*s", "exp(-t*r)+s", "sqrt(-x)", "1/(y-y)+sqrt(-x)", "c*2", "b+c", "1/(y-y)+b",
+    "x*y+y*x", "(x+1)/(y-2)", "log(x, y)*exp(-r*t)", "x*0", "c+sqrt(-x)"
+};
+
+static const MathExpressions::Environment Environments[] = {
+    { { "x", 2 }, { "y", 3 }, { "r", 0.5L }, { "t", 2 }, { "s", 1.5L }, { "b", 1 }, { "c", 4 } },
+    { { "x", -2 }, { "y", 2 }, { "r", -1 }, { "t", 0.25L }, { "s", 0 }, { "b", -3 }, { "c", 0.5L } },
+    // 'b' and 'c' are missing, so they fail expressions before anything is computed
+    { { "x", 0.75L }, { "y", 1 }, { "r", 2 }, { "t", 1 }, { "s", 2 } }
+};
+
+// Same as 'Testing::SameResult' at the same index, but zeroes of different signs differ too
+static bool IsSame(const MathExpressions::EvaluationResult& actual, const MathExpressions::EvaluationResult& expected)
+{
+    if (!Testing::SameResult(actual, expected, true)) return false;
+    return actual.Status != MathExpressions::EvaluationStatus::Success || std::signbit(actual.Value) == std::signbit(expected.Value);
+}
+
+// 'x*-0' built out of parts, since literals are never negative
+static MathExpressions::CompiledExpressionPtr MakeNegativeZeroProduct()
+{
+    using MathExpressions::OpCode;
+    MathExpressions::Program code(
+        { { OpCode::Variable, 0, 0 }, { OpCode::Constant, 0, 0 }, { OpCode::Mul, 0, 1 } }, { -0.0L }, { "x" }
+    );
+
+    return std::make_shared<const MathExpressions::CompiledExpression>("x*-0", std::move(code));
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        std::vector<MathExpressions::CompiledExpressionPtr> compiled;
+        for (const char* text : Expressions) compiled.push_back(MathExpressions::Compile(text));
+        compiled.push_back(MakeNegativeZeroProduct());
+
+        const MathExpressions::ExpressionSet set(compiled);
+        std::vector<MathExpressions::EvaluationResult> results;
+
+        for (const MathExpressions::Environment& env : Environments)
+        {
+            set.TryEvaluate(env, results);
+
+            for (size_t e = 0; e < compiled.size(); e++)
+            {
+                const MathExpressions::EvaluationResult expected = compiled[e]->TryEvaluate(env);
+
+                checks++;
+                if (IsSame(results[e], expected)) continue;
+
+                std::printf("'%s' gives %.20Lg (status %d at %zu) in the set and %.20Lg (status %d at %zu) on it's own\n",
+                    compiled[e]->GetSource().c_str(), results[e].Value, static_cast<int>(results[e].Status), results[e].Index,
+                    expected.Value, static_cast<int>(expected.Status), expected.Index);
+                mismatches++;
+            }
+        }
+
+        // Operands of commutative operations are ordered, so both spellings of the discount are one subexpression.
+        // Everything but the roots is shared
+        checks++;
+        const MathExpressions::ExpressionSet discounts({ compiled[0], compiled[1] });
+        const size_t discount_size = compiled[0]->GetProgram().GetInstructions().size() - 1;
+        if (discounts.GetReport().SharedInstructions != discount_size)
+        {
+            std::printf("'%s' and '%s' share %zu instructions instead of %zu\n", Expressions[0], Expressions[1],
+                discounts.GetReport().SharedInstructions, discount_size);
+            mismatches++;
+        }
+
+        // Zeroes only compare equal
+        checks++;
+        const MathExpressions::ExpressionSet zeroes({ compiled[10], compiled.back() });
+        if (zeroes.GetProgram().GetConstants().size() != 2)
+        {
+            std::printf("Zeroes of both signs are merged into %zu constants\n", zeroes.GetProgram().GetConstants().size());
+            mismatches++;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "results of merged expressions", "differ from standalone ones", "match standalone ones");
+}
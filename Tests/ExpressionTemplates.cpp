@@ -0,0 +1,133 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Compares expression trees built out of C++ operators against the same expressions compiled at runtime
+Every tree is evaluated directly and converted into a compiled expression, whose AST has to have the same structure
+as the one parsed from text and whose instructions have to point at it's tokens. Both have to give exactly the same values
+and failures as the expression compiled from text. Variables named so they wouldn't read back as themselves are refused
+*/
+
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include "MathExpressionParser/ExpressionTemplates.hpp"
+#include "MathExpressionParser/StructuralHashing.hpp"
+#include "TestSupport.hpp"
+
+using namespace MathExpressions::Static;
+
+// Values of x, y and z. Zeroes fail divisions and logarithms, negative x fails square roots
+static const long double Values[][3] = { { 0.5L, 2, 3 }, { 4, 1, -0.25L }, { -2, 0.75L, 10 }, { 0, 0, 0 } };
+
+// Returns number of evaluations that differ from the runtime parser
+template<class Node>
+static size_t Check(const Node& tree, const char* text)
+{
+    MathExpressions::CompiledExpressionPtr runtime = MathExpressions::Compile(text);
+    MathExpressions::CompiledExpressionPtr converted = ToCompiledExpression(tree);
+
+    size_t mismatches = 0;
+    if (!converted->GetTree().Root || !MathExpressions::IsSameStructure(converted->GetTree(), runtime->GetTree()))
+    {
+        std::printf("'%s' (written as '%s'): AST differs from the runtime parser's\n", text, converted->GetSource().c_str());
+        mismatches++;
+    }
+
+    const MathExpressions::Program& program = converted->GetProgram();
+    for (size_t i = 0; i < program.GetInstructions().size(); i++)
+    {
+        if (program.GetOrigin(i)) continue;
+
+        std::printf("'%s' (written as '%s'): instruction %zu has no token\n", text, converted->GetSource().c_str(), i);
+        mismatches++;
+    }
+
+    for (const long double* values : Values)
+    {
+        MathExpressions::Environment env = { { "x", values[0] }, { "y", values[1] }, { "z", values[2] } };
+
+        const MathExpressions::EvaluationResult expected = runtime->TryEvaluate(env);
+        const MathExpressions::EvaluationResult direct = TryEvaluate(tree, values);
+        const MathExpressions::EvaluationResult compiled = converted->TryEvaluate(env);
+
+        if (Testing::SameResult(direct, expected) && Testing::SameResult(compiled, expected)) continue;
+
+        std::printf("'%s' (written as '%s'): tree gives %.20Lg, compiled expression %.20Lg, runtime parser %.20Lg\n",
+            text, converted->GetSource().c_str(), direct.Value, compiled.Value, expected.Value);
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+int main()
+{
+    const Symbol x = { 0, "x" }, y = { 1, "y" }, z = { 2, "z" };
+    size_t mismatches = 0;
+
+    try
+    {
+        mismatches += Check(x * sin(y) + 2, "x*sin(y)+2");
+        mismatches += Check(pow(pow(2, x), y) - z, "2^x^y-z");
+        mismatches += Check(pow(x, pow(y, 2)), "x^(y^2)");
+        mismatches += Check(-pow(x, 2) + y, "-x^2+y");
+        mismatches += Check(x - (y - z), "x-(y-z)");
+        mismatches += Check(x / y / z, "x/y/z");
+        mismatches += Check(x / (y * z), "x/(y*z)");
+        mismatches += Check(abs(x - y) * 2, "|x-y|*2");
+        mismatches += Check(sqrt(x) / z, "sqrt(x)/z");
+        mismatches += Check(log(x * x, y + 1) + ln(z * z), "log(x*x, y+1)+ln(z*z)");
+        mismatches += Check(atan(x / y) - cos(Pi() * x) + exp(-z) * Euler(), "atan(x/y)-cos(pi*x)+exp(-z)*e");
+        mismatches += Check(0.125 * x - 10.5 / y + sign(z), "0.125*x-10.5/y+sign(z)");
+        mismatches += Check(x * -2.5 + tanh(y) - cot(z), "x*(-2.5)+tanh(y)-ctg(z)");
+        mismatches += Check(-0.0 * x + log2(y * y) - abs(-y) - pow(z, -1), "(-0)*x+log2(y*y)-|-y|-z^(-1)");
+
+        // Digits, built-in names and constants at the start would all be read as something else
+        for (const char* name : { "x1", "epsilon", "sin", "pin", "e", "" })
+        {
+            try
+            {
+                Symbol symbol = { 3, name };
+                std::printf("Variable named '%s' has been accepted\n", symbol.Name);
+                mismatches++;
+            }
+            catch (const std::invalid_argument&) {}
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    if (mismatches)
+    {
+        std::printf("%zu evaluations differ from the runtime parser\n", mismatches);
+        return 1;
+    }
+
+    std::printf("Expression trees match the runtime parser\n");
+    return 0;
+}
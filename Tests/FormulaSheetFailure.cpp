@@ -0,0 +1,108 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Evaluates formula sheets where formulas of some level throw, with several threads
+Every thread has to leave evaluation, and the error has to reach the caller, no matter
+which level fails. A hang is reported as a failure once the watchdog runs out of time
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <string>
+#include <thread>
+#include "MathExpressionParser/FormulaSheet.hpp"
+
+static const size_t FormulasPerLevel = 16;
+static const size_t ThreadCount = 8;
+static const size_t Rounds = 200;
+static const std::chrono::seconds Timeout(60);
+
+// Three levels: 'aX = x+1', 'bX = aX/y' and 'cX = bX+1', where X is a letter
+static void FillSheet(MathExpressions::FormulaSheet& sheet)
+{
+    for (size_t i = 0; i < FormulasPerLevel; i++)
+    {
+        const std::string suffix(1, static_cast<char>('a' + i));
+
+        sheet.Set("a" + suffix, "x+1");
+        sheet.Set("b" + suffix, "a" + suffix + "/y");
+        sheet.Set("c" + suffix, "b" + suffix + "+1");
+    }
+}
+
+// Returns number of evaluations that didn't throw although they should have
+static size_t Run(long double y)
+{
+    MathExpressions::FormulaSheet sheet;
+    FillSheet(sheet);
+
+    size_t failures = 0;
+    for (size_t round = 0; round < Rounds; round++)
+    {
+        MathExpressions::Environment store = { { "x", 1 }, { "y", y } };
+        try
+        {
+            sheet.Evaluate(store, ThreadCount);
+            if (y == 0) failures++;
+        }
+        catch (const std::exception&)
+        {
+            if (y != 0) failures++;
+        }
+    }
+
+    return failures;
+}
+
+int main()
+{
+    std::promise<size_t> finished;
+    std::future<size_t> result = finished.get_future();
+
+    // Evaluation runs on it's own thread, so a deadlock can't keep the watchdog from reporting it
+    std::thread([&finished]() {
+        // Division by zero fails the second level, while a non-zero divisor evaluates everything
+        finished.set_value(Run(0) + Run(2));
+    }).detach();
+
+    if (result.wait_for(Timeout) != std::future_status::ready)
+    {
+        std::printf("Evaluation hasn't finished in %lld seconds\n", static_cast<long long>(Timeout.count()));
+        // Stuck threads can't be joined, so the process is ended without unwinding
+        std::fflush(stdout);
+        std::_Exit(1);
+    }
+
+    if (size_t failures = result.get())
+    {
+        std::printf("%zu evaluations ended unexpectedly\n", failures);
+        return 1;
+    }
+
+    std::printf("Failures in every level were reported by all %zu threads\n", ThreadCount);
+    return 0;
+}
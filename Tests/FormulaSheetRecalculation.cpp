@@ -0,0 +1,147 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Recalculates a formula sheet after changes of inputs and compares it against evaluating everything again
+Values in the store have to match full evaluation exactly, zeroes' signs included, and the returned names have to be
+exactly the formulas whose values have changed, in evaluation order. Formulas that come out the same, such as
+'|m|' when 'm' only changes it's sign, cut off recalculation of their dependents
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/FormulaSheet.hpp"
+#include "TestSupport.hpp"
+
+static const char* const Formulas[][2] = {
+    { "m", "a-b" }, { "r", "m/a" }, { "s", "r*2+c" }, { "t", "c*c" }, { "u", "|m|" },
+    // 'k' is a zero of the same sign as 'a', which only 'v' can tell apart
+    { "k", "a*0" }, { "w", "k+d" }, { "v", "k^(0-1)" }
+};
+
+// Each step changes some inputs. Some of them change nothing, or nothing past the formulas reading them
+static const std::vector<MathExpressions::Environment> Steps = {
+    { { "a", 5 } }, { { "b", 3 } }, { { "b", 7 } }, { { "a", -5 } }, { { "c", 2 }, { "d", 4 } }, { { "a", 5 }, { "b", 3 } }
+};
+
+static bool IsSameValue(long double lhs, long double rhs)
+{
+    return lhs == rhs && std::signbit(lhs) == std::signbit(rhs);
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        MathExpressions::FormulaSheet sheet, reference;
+        for (const auto& formula : Formulas)
+        {
+            sheet.Set(formula[0], formula[1]);
+            reference.Set(formula[0], formula[1]);
+        }
+
+        std::map<std::string, size_t> levels;
+        const std::vector<std::vector<std::string>> names = sheet.GetLevels();
+        for (size_t level = 0; level < names.size(); level++)
+            for (const std::string& name : names[level]) levels[name] = level;
+
+        MathExpressions::Environment store = { { "a", 5 }, { "b", 2 }, { "c", 1 }, { "d", 3 } };
+        sheet.Evaluate(store, 1);
+
+        for (size_t step = 0; step < Steps.size(); step++)
+        {
+            const MathExpressions::Environment previous = store;
+            MathExpressions::Environment expected = store;
+            for (const auto& change : Steps[step]) expected[change.first] = change.second;
+            reference.Evaluate(expected, 1);
+
+            const std::vector<std::string> changed = sheet.Recalculate(store, Steps[step]);
+
+            std::vector<std::string> expected_changed;
+            for (const auto& formula : Formulas)
+            {
+                checks++;
+                if (!IsSameValue(store[formula[0]], expected[formula[0]]))
+                {
+                    std::printf("Step %zu: '%s' is %Lg, full evaluation gives %Lg\n", step, formula[0], store[formula[0]], expected[formula[0]]);
+                    mismatches++;
+                }
+
+                if (!IsSameValue(previous.at(formula[0]), expected[formula[0]])) expected_changed.push_back(formula[0]);
+            }
+
+            checks++;
+            std::vector<std::string> sorted = changed;
+            std::sort(sorted.begin(), sorted.end());
+            std::sort(expected_changed.begin(), expected_changed.end());
+            if (sorted != expected_changed)
+            {
+                std::printf("Step %zu: %zu formulas are reported changed, %zu have changed\n", step, changed.size(), expected_changed.size());
+                mismatches++;
+            }
+
+            checks++;
+            for (size_t i = 1; i < changed.size(); i++)
+            {
+                if (levels[changed[i - 1]] <= levels[changed[i]]) continue;
+
+                std::printf("Step %zu: '%s' is reported before '%s', which it depends on\n", step, changed[i - 1].c_str(), changed[i].c_str());
+                mismatches++;
+                break;
+            }
+        }
+
+        // Formulas can't be changed directly, as their dependents would be left as they were
+        checks++;
+        const MathExpressions::Environment before = store;
+        try
+        {
+            sheet.Recalculate(store, { { "m", 1 }, { "a", 2 } });
+            std::printf("Changing formula 'm' isn't refused\n");
+            mismatches++;
+        }
+        catch (const std::invalid_argument&)
+        {
+            if (store != before)
+            {
+                std::printf("Refused changes are applied to the store\n");
+                mismatches++;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "checks of recalculation", "have failed", "have passed");
+}
@@ -0,0 +1,140 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Compares calls of functions defined in a library against the same expressions with bodies written out by hand
+Calls are inlined when compiled, so their programs must have no calls left, and evaluate to exactly
+the same values and failures as expressions where every call is replaced with it's bracketed body.
+Definitions that can't work (taken names, bad parameters, references to itself, captured variables) have to be refused
+*/
+
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include "MathExpressionParser/FunctionLibrary.hpp"
+#include "TestSupport.hpp"
+
+static const char* const Definitions[] = {
+    "sq(x) = x^2", "f(x, y) = x^2 + y", "discount(r, t) = exp(-r*t)",
+    "hyp(a, b) = sqrt(sq(a) + sq(b))", "scaled(x) = k*x", "first(x, y) = x"
+};
+
+// Calls paired with the same expressions written out by hand
+static const char* const Cases[][2] = {
+    { "f(a+1, b)*2", "((a+1)^2+b)*2" },
+    { "discount(a, b) - 1", "exp(-a*b)-1" },
+    { "hyp(a, b/2)", "sqrt((a)^2+(b/2)^2)" },
+    { "scaled(a) + f(b, a)", "(k*a)+((b)^2+a)" },
+    { "f(f(a, b), sq(b))", "((a^2+b)^2+(b^2))" },
+    { "sq(a)/f(b, -1)", "(a^2)/((b)^2+(-1))" },
+    // Body only returns a parameter, while the last instruction computes the other argument
+    { "first(a, b)", "(a)" },
+    { "first(b, sq(a))*2", "(b)*2" }
+};
+
+// Definitions that have to be refused, each for a different reason
+static const char* const Refused[] = {
+    "sin(x) = x", "twice(x) = x", "sq(x) = x", "g(x, x) = x", "g(ex) = ex", "g(pix) = pix",
+    "g(x) = x*g", "g(k) = scaled(k) + k"
+};
+
+static long double Twice(const long double* arguments)
+{
+    return arguments[0] * 2;
+}
+
+// Values of a, b and k. 'b' of one fails the division by 'f(b, -1)'
+static const long double Values[][3] = { { 0.5L, 2, 3 }, { -1.5L, 1, 0.25L }, { 3, -0.75L, -2 } };
+
+int main()
+{
+    size_t mismatches = 0;
+
+    try
+    {
+        MathExpressions::FunctionLibrary library;
+        for (const char* definition : Definitions) library.Define(definition);
+
+        MathExpressions::RegisterNativeFunction({ "twice", 1, true, Twice, nullptr });
+        for (const char* definition : Refused)
+        {
+            try
+            {
+                library.Define(definition);
+            }
+            catch (const std::invalid_argument&)
+            {
+                continue;
+            }
+
+            std::printf("Definition '%s' isn't refused\n", definition);
+            mismatches++;
+        }
+
+        if (library.Find("g") || library.Find("twice"))
+        {
+            std::printf("Refused definitions are left in the library\n");
+            mismatches++;
+        }
+
+        for (const auto& pair : Cases)
+        {
+            MathExpressions::CompiledExpressionPtr inlined = library.Compile(pair[0]);
+            MathExpressions::CompiledExpressionPtr direct = MathExpressions::Compile(pair[1]);
+
+            if (!inlined->GetProgram().GetCalls().empty())
+            {
+                std::printf("'%s' still has calls after compilation\n", pair[0]);
+                mismatches++;
+            }
+
+            for (const long double* values : Values)
+            {
+                MathExpressions::Environment env = { { "a", values[0] }, { "b", values[1] }, { "k", values[2] } };
+
+                const MathExpressions::EvaluationResult actual = inlined->TryEvaluate(env);
+                const MathExpressions::EvaluationResult expected = direct->TryEvaluate(env);
+                if (Testing::SameResult(actual, expected)) continue;
+
+                std::printf("'%s' gives %.20Lg (status %d), '%s' gives %.20Lg (status %d)\n",
+                    pair[0], actual.Value, static_cast<int>(actual.Status), pair[1], expected.Value, static_cast<int>(expected.Status));
+                mismatches++;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    if (mismatches)
+    {
+        std::printf("%zu evaluations differ from bodies written out by hand\n", mismatches);
+        return 1;
+    }
+
+    std::printf("Inlined calls match bodies written out by hand\n");
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Evaluates expressions incrementally across updates of their variables and compares them against full evaluation
+Results have to match 'Program::TryEvaluate' exactly, zeroes' signs included, and every evaluation after a successful one
+has to recompute exactly the instructions that load a changed variable or have an operand whose value has changed.
+Updates flip signs of zeroes, which compare equal but differ once divided by, and assign values that are already there
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <vector>
+#include "MathExpressionParser/IncrementalEvaluation.hpp"
+#include "TestSupport.hpp"
+
+static const char* const Expressions[] = {
+    "x^(0-1)", "(x*0)^(0-1)+y", "|x|*y+sin(z)", "(x-x)*y+z", "y/x", "1/(x*y)+z", "sqrt(z)+x*x"
+};
+
+// Values of x, y and z in order of updates. Some of them repeat the previous ones, some of them divide by zero
+static const long double Updates[][3] = {
+    { 1, 2, 3 }, { 1, 2, 3 }, { 0, 2, 3 }, { -0.0L, 2, 3 }, { -0.0L, 5, 3 }, { 0, 5, -1 },
+    { 2, 5, -1 }, { -2, 5, -1 }, { -2, 5, 0 }, { -2, 5, 0 }
+};
+
+static bool IsSameValue(long double lhs, long double rhs)
+{
+    return lhs == rhs && std::signbit(lhs) == std::signbit(rhs);
+}
+
+// Values of every instruction of the program, computed in full. Instructions past a failure are left at zero
+static std::vector<long double> ExecuteAll(const MathExpressions::Program& code, const std::vector<long double>& symbols)
+{
+    std::vector<long double> values(code.GetInstructions().size(), 0);
+    for (size_t i = 0; i < values.size(); i++)
+        if (code.Execute(i, values.data(), symbols.data()) != MathExpressions::EvaluationStatus::Success) break;
+
+    return values;
+}
+
+// How many instructions have to be recomputed to get from one set of values to the other
+static size_t CountRecomputed(
+    const MathExpressions::Program& code,
+    const std::vector<long double>& previous_symbols, const std::vector<long double>& symbols,
+    const std::vector<long double>& previous, const std::vector<long double>& current
+) {
+    const std::vector<MathExpressions::Instruction>& instructions = code.GetInstructions();
+    std::vector<bool> changed(instructions.size(), false);
+    size_t count = 0;
+
+    for (size_t i = 0; i < instructions.size(); i++)
+    {
+        const MathExpressions::Instruction& instr = instructions[i];
+        bool recomputed = false;
+
+        if (instr.Op == MathExpressions::OpCode::Variable)
+            recomputed = !IsSameValue(previous_symbols[instr.Lhs], symbols[instr.Lhs]);
+        else if (instr.Op == MathExpressions::OpCode::Call)
+        {
+            const MathExpressions::NativeCall& call = code.GetCalls()[instr.Lhs];
+            recomputed = !call.Function->Pure;
+            for (unsigned argument : call.Arguments) recomputed = recomputed || changed[argument];
+        }
+        else
+        {
+            size_t arity = MathExpressions::GetArity(instr.Op);
+            recomputed = (arity >= 1 && changed[instr.Lhs]) || (arity == 2 && changed[instr.Rhs]);
+        }
+
+        if (!recomputed) continue;
+
+        count++;
+        changed[i] = !IsSameValue(previous[i], current[i]);
+    }
+
+    return count;
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        for (const char* source : Expressions)
+        {
+            MathExpressions::CompiledExpressionPtr expr = MathExpressions::Compile(source);
+            const MathExpressions::Program& code = expr->GetProgram();
+            MathExpressions::IncrementalEvaluator evaluator(expr);
+
+            std::vector<long double> previous_symbols, previous_values;
+            bool previous_succeeded = false;
+
+            for (const auto& update : Updates)
+            {
+                MathExpressions::Environment env = { { "x", update[0] }, { "y", update[1] }, { "z", update[2] } };
+                std::vector<long double> symbols;
+                code.ResolveSymbols(env, symbols);
+
+                evaluator.SetVariables(env);
+                MathExpressions::EvaluationResult actual = evaluator.TryEvaluate();
+                MathExpressions::EvaluationResult expected = code.TryEvaluate(symbols.data());
+                std::vector<long double> values = ExecuteAll(code, symbols);
+
+                checks++;
+                bool same = Testing::SameResult(actual, expected, true) &&
+                    (expected.Status != MathExpressions::EvaluationStatus::Success || expected.Value != expected.Value ||
+                    IsSameValue(actual.Value, expected.Value));
+                if (!same)
+                {
+                    mismatches++;
+                    std::printf(
+                        "'%s' at (%Lg, %Lg, %Lg): %Lg (status %d) instead of %Lg (status %d)\n",
+                        source, update[0], update[1], update[2],
+                        actual.Value, (int)actual.Status, expected.Value, (int)expected.Status
+                    );
+                }
+
+                // Instructions left queued by a failure make the next evaluation recompute more than the difference
+                if (expected.Status == MathExpressions::EvaluationStatus::Success && (previous_values.empty() || previous_succeeded))
+                {
+                    size_t expected_count = previous_values.empty() ? values.size() :
+                        CountRecomputed(code, previous_symbols, symbols, previous_values, values);
+                    checks++;
+                    if (evaluator.GetRecomputedCount() != expected_count)
+                    {
+                        mismatches++;
+                        std::printf(
+                            "'%s' at (%Lg, %Lg, %Lg) has recomputed %zu instructions instead of %zu\n",
+                            source, update[0], update[1], update[2], evaluator.GetRecomputedCount(), expected_count
+                        );
+                    }
+                }
+
+                previous_succeeded = expected.Status == MathExpressions::EvaluationStatus::Success;
+                previous_symbols = symbols;
+                previous_values = values;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "incremental evaluations", "differ from full evaluation", "match full evaluation");
+}
@@ -0,0 +1,107 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Evaluates expressions over random ranges of variables and checks that results contain point evaluations
+Points are corners of the ranges, where extremes often are, plus random points inside of them. Every point that
+evaluates to a number has to lie within the resulting range, and ranges that are certain to fail can't have
+a single point that evaluates
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "MathExpressionParser/IntervalEvaluation.hpp"
+#include "TestSupport.hpp"
+
+static const char* const Expressions[] = {
+    "x*y-z", "x^2-x", "sin(x)*cos(y)", "exp(x)/(y+z)", "sqrt(x)+ln(y)", "1/x", "x^y", "tan(x)",
+    "atan(x)+acos(y/2)", "|x|-sign(y)*z", "log(x, y)", "log(x, 1)", "sinh(x)-cosh(y)*tanh(z)",
+    "(x-y)^3", "-x^2+y/(z*z)"
+};
+
+static const size_t RangeCount = 200;
+static const size_t InnerPoints = 20;
+
+int main()
+{
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<double> bound(-3, 3), fraction(0, 1);
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        for (const char* text : Expressions)
+        {
+            MathExpressions::CompiledExpressionPtr expression = MathExpressions::Compile(text);
+            const MathExpressions::Program& program = expression->GetProgram();
+            const size_t symbol_count = program.GetSymbols().size();
+
+            for (size_t range = 0; range < RangeCount; range++)
+            {
+                std::vector<MathExpressions::Interval> ranges;
+                for (size_t i = 0; i < symbol_count; i++)
+                {
+                    long double lo = bound(random), hi = bound(random);
+                    if (lo > hi) std::swap(lo, hi);
+                    ranges.push_back({ lo, hi });
+                }
+
+                const MathExpressions::IntervalResult result = MathExpressions::TryEvaluateInterval(program, ranges.data());
+
+                // Corners are enumerated by bits of the index, followed by points inside
+                const size_t corners = size_t(1) << symbol_count;
+                for (size_t k = 0; k < corners + InnerPoints; k++)
+                {
+                    std::vector<long double> point;
+                    for (size_t i = 0; i < symbol_count; i++)
+                    {
+                        const long double t = (k < corners) ? ((k >> i) & 1) : fraction(random);
+                        point.push_back((k < corners && t) ? ranges[i].Hi : ranges[i].Lo + t * (ranges[i].Hi - ranges[i].Lo));
+                    }
+
+                    const MathExpressions::EvaluationResult value = program.TryEvaluate(point.data());
+                    if (value.Status != MathExpressions::EvaluationStatus::Success || std::isnan(value.Value)) continue;
+
+                    checks++;
+                    if (result.Status == MathExpressions::EvaluationStatus::Success && result.Value.Contains(value.Value)) continue;
+
+                    std::printf("%s: point evaluates to %.12Lg, outside of [%.12Lg, %.12Lg] (status %d)\n",
+                        text, value.Value, result.Value.Lo, result.Value.Hi, static_cast<int>(result.Status));
+                    mismatches++;
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "points", "lie outside of their ranges", "lie within their ranges");
+}
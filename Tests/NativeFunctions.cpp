@@ -0,0 +1,365 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Calls of registered native functions
+Checks that the tokenizer finds registered functions only when their name is followed by a bracket, that invalid
+registrations and call tables are refused, and that every evaluator computes calls the same way the program does:
+the VM against the expression tree, and batches (with and without a batch implementation), merged sets,
+incremental and interval evaluation against the VM. Archives can't store function pointers, so they refuse calls
+*/
+
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/BatchEvaluation.hpp"
+#include "MathExpressionParser/ExpressionArchive.hpp"
+#include "MathExpressionParser/ExpressionSet.hpp"
+#include "MathExpressionParser/IncrementalEvaluation.hpp"
+#include "MathExpressionParser/IntervalEvaluation.hpp"
+#include "TestSupport.hpp"
+
+// Number of times batch implementation of 'spread' has been called
+static size_t BatchCalls = 0;
+// Added by 'drift', which is impure as it's result changes without it's argument changing
+static long double Drift = 0;
+
+static long double Weigh(const long double* arguments)
+{
+    return arguments[0] * 2 + arguments[1];
+}
+
+static long double Spread(const long double* arguments)
+{
+    return (arguments[0] - arguments[1]) * arguments[2];
+}
+
+static void SpreadBatch(const long double* const* arguments, size_t count, long double* out_values)
+{
+    BatchCalls++;
+    for (size_t i = 0; i < count; i++) out_values[i] = (arguments[0][i] - arguments[1][i]) * arguments[2][i];
+}
+
+static long double DriftBy(const long double* arguments)
+{
+    return arguments[0] + Drift;
+}
+
+// 'weigh' has no batch implementation, so batches call it row by row
+static const char* const Expressions[] = {
+    "weigh(x, y) + spread(x, y, z)", "spread(weigh(x, 1), z, x*y)/(y-2)", "drift(x)*weigh(x, y) + drift(x)",
+    "weigh(sqrt(x), y)", "weigh(x, y)*weigh(y, x) - weigh(x, y)", "spread(x, y, z)^2/weigh(z, -2*x)"
+};
+
+// Values of x, y and z. Some fail the division by 'y-2', the root of 'x' or the division by 'weigh(z, -2*x)'
+static const long double Rows[][3] = {
+    { 0.5L, 1.5L, 3 }, { 2, 2, 1 }, { -1, 0.25L, -0.5L }, { 1.25L, -3, 2.5L }, { 3, 0.75L, 3 }
+};
+
+static const size_t RowCount = sizeof(Rows) / sizeof(Rows[0]);
+
+// Whether the action throws the exception
+template<typename Exception>
+static bool Throws(const std::function<void()>& action)
+{
+    try
+    {
+        action();
+    }
+    catch (const Exception&)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+static MathExpressions::Environment MakeEnvironment(const long double* row)
+{
+    return { { "x", row[0] }, { "y", row[1] }, { "z", row[2] } };
+}
+
+// Values of program's symbols at the row, ordered as in the symbol table
+static std::vector<long double> GetSymbolValues(const MathExpressions::Program& code, const long double* row)
+{
+    std::vector<long double> values;
+    for (const std::string& symbol : code.GetSymbols()) values.push_back(row[symbol[0] - 'x']);
+
+    return values;
+}
+
+// Number of calls of the function in the call table of the program
+static size_t CountCalls(const MathExpressions::Program& code, const char* name)
+{
+    size_t count = 0;
+    for (const MathExpressions::NativeCall& call : code.GetCalls()) count += call.Function->Name == name;
+
+    return count;
+}
+
+static size_t CheckRegistration(size_t& checks)
+{
+    using MathExpressions::NativeFunction;
+    const NativeFunction invalid[] = {
+        { "", 1, true, Weigh, nullptr }, { "weigh2", 2, true, Weigh, nullptr }, { "sin", 1, true, Weigh, nullptr },
+        { "pi", 1, true, Weigh, nullptr }, { "nullary", 0, true, Weigh, nullptr },
+        { "wide", NativeFunction::MaxArity + 1, true, Weigh, nullptr }, { "empty", 1, true, nullptr, nullptr },
+        { "weigh", 2, true, Weigh, nullptr }
+    };
+
+    size_t mismatches = 0;
+    for (const NativeFunction& function : invalid)
+    {
+        checks++;
+        if (Throws<std::invalid_argument>([&]() { MathExpressions::RegisterNativeFunction(function); })) continue;
+
+        std::printf("Registration of '%s' with arity %zu isn't refused\n", function.Name.c_str(), function.Arity);
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+static size_t CheckTokenizer(size_t& checks)
+{
+    size_t mismatches = 0;
+
+    // A call is a single token that refers to the registered function
+    checks++;
+    MathExpressions::CompiledExpressionPtr call = MathExpressions::Compile("weigh(x, 2)");
+    auto token = dynamic_cast<const MathExpressions::NativeFunctionCall*>(call->GetTree().Root->Value.get());
+    if (!token || token->Function != MathExpressions::FindNativeFunction("weigh"))
+    {
+        std::printf("'weigh(x, 2)' isn't tokenized as a call of 'weigh'\n");
+        mismatches++;
+    }
+
+    // Without a bracket, the same name is a variable
+    checks++;
+    MathExpressions::CompiledExpressionPtr variable = MathExpressions::Compile("weigh*2");
+    const std::vector<std::string>& symbols = variable->GetProgram().GetSymbols();
+    if (symbols.size() != 1 || symbols[0] != "weigh" || !variable->GetProgram().GetCalls().empty())
+    {
+        std::printf("'weigh*2' isn't tokenized as a variable\n");
+        mismatches++;
+    }
+
+    checks++;
+    if (MathExpressions::FindNativeFunction("sin") || MathExpressions::FindNativeFunction("unknown"))
+    {
+        std::printf("Lookup finds functions that aren't registered\n");
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+static size_t CheckCallTables(size_t& checks)
+{
+    using MathExpressions::Instruction;
+    using MathExpressions::NativeCall;
+    using MathExpressions::OpCode;
+
+    const MathExpressions::NativeFunction* weigh = MathExpressions::FindNativeFunction("weigh");
+    const std::vector<Instruction> instructions = { { OpCode::Variable, 0, 0 }, { OpCode::Variable, 1, 0 }, { OpCode::Call, 0, 0 } };
+    const std::vector<std::string> symbols = { "x", "y" };
+    size_t mismatches = 0;
+
+    checks++;
+    const MathExpressions::Program valid(instructions, {}, symbols, { { weigh, { 0, 1 } } });
+    const long double values[] = { 1.5L, -4 };
+    if (valid.Evaluate(values) != Weigh(values))
+    {
+        std::printf("Call of a program built out of parts evaluates to %.20Lg\n", valid.Evaluate(values));
+        mismatches++;
+    }
+
+    // Missing call, missing function, wrong number of arguments, and an argument that doesn't precede the call
+    const std::vector<NativeCall> invalid[] = {
+        {}, { { nullptr, { 0, 1 } } }, { { weigh, { 0 } } }, { { weigh, { 0, 2 } } }
+    };
+    for (const std::vector<NativeCall>& calls : invalid)
+    {
+        checks++;
+        if (Throws<std::runtime_error>([&]() { MathExpressions::Program(instructions, {}, symbols, calls); })) continue;
+
+        std::printf("Invalid call table with %zu calls isn't refused\n", calls.size());
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        MathExpressions::RegisterNativeFunction({ "weigh", 2, true, Weigh, nullptr });
+        MathExpressions::RegisterNativeFunction({ "spread", 3, true, Spread, SpreadBatch });
+        MathExpressions::RegisterNativeFunction({ "drift", 1, false, DriftBy, nullptr });
+
+        mismatches += CheckRegistration(checks);
+        mismatches += CheckTokenizer(checks);
+        mismatches += CheckCallTables(checks);
+
+        std::vector<MathExpressions::CompiledExpressionPtr> compiled;
+        for (const char* text : Expressions) compiled.push_back(MathExpressions::Compile(text));
+
+        checks++;
+        if (!Throws<std::invalid_argument>([&]() { MathExpressions::ExpressionArchive::Write("native_functions.archive", compiled); }))
+        {
+            std::printf("Archive doesn't refuse expressions with calls\n");
+            mismatches++;
+        }
+
+        const MathExpressions::ExpressionSet set(compiled);
+        std::vector<MathExpressions::EvaluationResult> set_results;
+
+        for (size_t i = 0; i < compiled.size(); i++)
+        {
+            const MathExpressions::Program& code = compiled[i]->GetProgram();
+            MathExpressions::IncrementalEvaluator incremental(compiled[i]);
+
+            std::vector<std::vector<long double>> columns(code.GetSymbols().size());
+            std::vector<const long double*> column_pointers;
+            for (const long double* row : Rows)
+            {
+                const std::vector<long double> values = GetSymbolValues(code, row);
+                for (size_t k = 0; k < values.size(); k++) columns[k].push_back(values[k]);
+            }
+            for (const std::vector<long double>& column : columns) column_pointers.push_back(column.data());
+
+            MathExpressions::BatchResult batch;
+            const size_t batch_calls = BatchCalls;
+            MathExpressions::EvaluateBatch(code, column_pointers.data(), RowCount, MathExpressions::BatchOptions(), batch);
+
+            checks++;
+            if (std::string(Expressions[i]).find("spread") != std::string::npos && BatchCalls == batch_calls)
+            {
+                std::printf("Batch of '%s' doesn't call the batch implementation of 'spread'\n", Expressions[i]);
+                mismatches++;
+            }
+
+            for (size_t r = 0; r < RowCount; r++)
+            {
+                const MathExpressions::Environment env = MakeEnvironment(Rows[r]);
+                const MathExpressions::EvaluationResult expected = code.TryEvaluate(env);
+
+                // Expression tree calls the scalar implementation through the token
+                if (expected.Status == MathExpressions::EvaluationStatus::Success)
+                {
+                    checks++;
+                    const Tree<Parser::TokenPtr>& tree = compiled[i]->GetTree();
+                    auto token = dynamic_cast<const MathExpressions::Token*>(tree.Root->Value.get());
+                    const long double tree_value = token->Evaluate(tree.Root, env);
+                    if (tree_value != expected.Value)
+                    {
+                        std::printf("'%s' at row %zu: tree gives %.20Lg, program gives %.20Lg\n", Expressions[i], r, tree_value, expected.Value);
+                        mismatches++;
+                    }
+                }
+
+                checks++;
+                const MathExpressions::EvaluationResult batch_result = { batch.Values[r], batch.Errors[r], expected.Index };
+                if (!Testing::SameResult(batch_result, expected))
+                {
+                    std::printf("'%s' at row %zu: batch gives %.20Lg (status %d), program gives %.20Lg (status %d)\n",
+                        Expressions[i], r, batch.Values[r], static_cast<int>(batch.Errors[r]), expected.Value, static_cast<int>(expected.Status));
+                    mismatches++;
+                }
+
+                // Changing the drift alone has to be picked up, as impure calls are recomputed by every evaluation
+                incremental.SetVariables(env);
+                for (long double drift : { 0.0L, 1.5L })
+                {
+                    Drift = drift;
+                    const MathExpressions::EvaluationResult drifted = code.TryEvaluate(env);
+
+                    checks++;
+                    const MathExpressions::EvaluationResult result = incremental.TryEvaluate();
+                    if (!Testing::SameResult(result, drifted, true))
+                    {
+                        std::printf("'%s' at row %zu with drift %Lg: incremental evaluation gives %.20Lg (status %d), program gives %.20Lg (status %d)\n",
+                            Expressions[i], r, drift, result.Value, static_cast<int>(result.Status), drifted.Value, static_cast<int>(drifted.Status));
+                        mismatches++;
+                    }
+                }
+                Drift = 0;
+
+                checks++;
+                set.TryEvaluate(env, set_results);
+                if (!Testing::SameResult(set_results[i], expected, true))
+                {
+                    std::printf("'%s' at row %zu: merged set gives %.20Lg (status %d), program gives %.20Lg (status %d)\n",
+                        Expressions[i], r, set_results[i].Value, static_cast<int>(set_results[i].Status), expected.Value, static_cast<int>(expected.Status));
+                    mismatches++;
+                }
+
+                // Ranges made of single points have to contain the value at that point
+                if (expected.Status != MathExpressions::EvaluationStatus::Success) continue;
+
+                std::vector<MathExpressions::Interval> ranges;
+                for (long double value : GetSymbolValues(code, Rows[r])) ranges.push_back({ value, value });
+
+                checks++;
+                const MathExpressions::IntervalResult range = MathExpressions::TryEvaluateInterval(code, ranges.data());
+                if (range.Status != MathExpressions::EvaluationStatus::Success || !range.Value.Contains(expected.Value))
+                {
+                    std::printf("'%s' at row %zu: range [%Lg, %Lg] doesn't contain %.20Lg\n",
+                        Expressions[i], r, range.Value.Lo, range.Value.Hi, expected.Value);
+                    mismatches++;
+                }
+            }
+        }
+
+        // Calls of the pure function are merged across expressions, while calls of the impure one are all kept
+        size_t drift_calls = 0, weigh_calls = 0;
+        for (const MathExpressions::CompiledExpressionPtr& expression : compiled)
+        {
+            drift_calls += CountCalls(expression->GetProgram(), "drift");
+            weigh_calls += CountCalls(expression->GetProgram(), "weigh");
+        }
+        const size_t merged_drift_calls = CountCalls(set.GetProgram(), "drift");
+        const size_t merged_weigh_calls = CountCalls(set.GetProgram(), "weigh");
+
+        checks++;
+        if (merged_drift_calls != drift_calls || merged_weigh_calls >= weigh_calls)
+        {
+            std::printf("Merged set has %zu of %zu calls of 'drift' and %zu of %zu calls of 'weigh'\n",
+                merged_drift_calls, drift_calls, merged_weigh_calls, weigh_calls);
+            mismatches++;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "checks of native calls", "have failed", "have passed");
+}
@@ -0,0 +1,115 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Evaluates long chains of cheap operands, such as 'a + b + c + ...', on a thread pool
+Operands along such chains are forked in groups, so every chain is split up between threads.
+Values, statuses and indices of failed instructions have to match sequential evaluation exactly,
+wherever along the chain the first error is. Arguments of pure native functions are forked the same way
+*/
+
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/NativeFunctions.hpp"
+#include "MathExpressionParser/ParallelEvaluation.hpp"
+#include "TestSupport.hpp"
+
+static const size_t TermCount = 1500;
+static const size_t ThreadCount = 4;
+static const size_t Rounds = 20;
+
+// Joins 'sin(x*K)/(y-K)' for K from 1 to 'TermCount' with the operator, so division fails wherever 'y' is K
+static std::string MakeChain(const char* op)
+{
+    std::string text;
+    for (size_t k = 1; k <= TermCount; k++)
+    {
+        if (k > 1) text += op;
+        text += "sin(x*" + std::to_string(k) + ")/(y-" + std::to_string(k) + ")";
+    }
+    return text;
+}
+
+static long double Blend(const long double* arguments)
+{
+    return arguments[0] * 0.25L + arguments[1] * 0.75L - arguments[2];
+}
+
+int main()
+{
+    MathExpressions::RegisterNativeFunction({ "blend", 3, true, Blend, nullptr });
+
+    const std::string sum = MakeChain("+"), product = MakeChain("*");
+    const std::string expressions[] = { sum, product, "-(" + sum + ")", "(" + sum + ")-(" + product + ")",
+        "blend(" + sum + ", " + product + ", x)", "blend(x, " + sum + ", " + sum + ")+blend(y, x, " + product + ")" };
+
+    // No failure, failures near both ends of the chain and in the middle of it
+    const long double ys[] = { 0.5, 1, 2, TermCount / 2, TermCount - 1, TermCount };
+
+    MathExpressions::TaskPool pool(ThreadCount);
+    size_t mismatches = 0;
+
+    try
+    {
+        for (const std::string& text : expressions)
+        {
+            MathExpressions::ParallelEvaluator evaluator(MathExpressions::Compile(text));
+            const MathExpressions::Program& code = evaluator.GetExpression()->GetProgram();
+
+            for (long double y : ys)
+            {
+                std::vector<long double> symbol_values;
+                for (const std::string& symbol : code.GetSymbols()) symbol_values.push_back(symbol == "x" ? 0.75L : y);
+
+                const MathExpressions::EvaluationResult expected = code.TryEvaluate(symbol_values.data());
+
+                for (size_t round = 0; round < Rounds; round++)
+                {
+                    const MathExpressions::EvaluationResult result = evaluator.TryEvaluate(symbol_values.data(), pool);
+                    if (Testing::SameResult(result, expected, true)) continue;
+
+                    std::printf("Chain of %zu characters with y = %Lg: got status %d at %zu, expected status %d at %zu\n",
+                        text.size(), y, static_cast<int>(result.Status), result.Index, static_cast<int>(expected.Status), expected.Index);
+                    mismatches++;
+                    break;
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    if (mismatches)
+    {
+        std::printf("%zu evaluations differ from sequential ones\n", mismatches);
+        return 1;
+    }
+
+    std::printf("Chains evaluated on %zu threads match sequential evaluation\n", ThreadCount);
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Prints expressions in compact mode and parses the text back, which has to give the same AST minus left out brackets
+and print the same text again. Then prints numbers across the whole range of long double, each of which has to read back
+as exactly the same value, sign of zero included, without an exponent that would be read as Euler's number
+*/
+
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/StructuralHashing.hpp"
+#include "TestSupport.hpp"
+
+// Brackets that matter and brackets that don't, next to each other
+static const char* const Expressions[] = {
+    "(x+y)+z", "x+(y+z)", "(x-y)-z", "x-(y-z)", "(x/y)/z", "x/(y/z)", "x/(y*z)", "(x*y)/z",
+    "2^3^2", "(2^3)^2", "2^(3^2)", "-x^2", "(-x)^2", "-(x^2)", "-(x+y)", "x*(-y)", "x-(-y)",
+    "|x-y|*2", "|(x)|+|y*2|", "sin((x))+cos(((y)))", "log((x+1), (y*2))", "tg(x)-ctg(y)", "((((x))))",
+    "sqrt(x*x+y*y)/(x-y)", "0.125*x-10.5/y", "pi*r^2", "e^(x*y)", "x*y^z/w", "(x^y)^(z+1)", "exp(-(x-y)^2/2)"
+};
+
+// Whether text reads back as exactly the value, sign of zero included
+static bool ReadsBack(const std::string& text, long double value)
+{
+    const long double read = std::strtold(text.c_str(), nullptr);
+    return read == value && std::signbit(read) == std::signbit(value);
+}
+
+static size_t CheckExpression(const std::string& expression, size_t& checks)
+{
+    const MathExpressions::CompiledExpressionPtr compiled = MathExpressions::Compile(expression);
+
+    std::string text;
+    MathExpressions::Print(compiled->GetTree(), text, MathExpressions::PrintMode::Compact);
+    const MathExpressions::CompiledExpressionPtr reparsed = MathExpressions::Compile(text);
+
+    std::string reprinted;
+    MathExpressions::Print(reparsed->GetTree(), reprinted, MathExpressions::PrintMode::Compact);
+
+    checks++;
+    if (MathExpressions::IsSameStructure(compiled->GetTree(), reparsed->GetTree()) && reprinted == text) return 0;
+
+    std::printf("'%s' is printed as '%s', which parses into a different AST or is printed again as '%s'\n",
+        expression.c_str(), text.c_str(), reprinted.c_str());
+    return 1;
+}
+
+static size_t CheckNumber(long double value, size_t& checks)
+{
+    std::string text;
+    MathExpressions::PrintNumber(value, text);
+
+    checks++;
+    if (ReadsBack(text, value) && text.find_first_of("eE") == std::string::npos) return 0;
+
+    std::printf("%.21Lg is printed as '%s', which reads back as %.21Lg\n", value, text.c_str(), std::strtold(text.c_str(), nullptr));
+    return 1;
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        for (const char* expression : Expressions) mismatches += CheckExpression(expression, checks);
+        for (const char* expression : Testing::SmoothExpressions) mismatches += CheckExpression(expression, checks);
+
+        std::vector<long double> numbers = {
+            0.0L, -0.0L, 1, -1, 0.1L, 0.5L, 1.0L / 3, 2.0L / 3, 10.5L, 123456.789L, 1e-30L, 1e30L,
+            18446744073709551615.0L, 18446744073709551616.0L, LDBL_MAX, LDBL_MIN, LDBL_EPSILON, std::numeric_limits<long double>::denorm_min(),
+            std::nextafter(1.0L, 2.0L), std::nextafter(0.1L, 0.0L)
+        };
+
+        // Irrational significands scaled across the whole range of exponents
+        for (int exponent = LDBL_MIN_EXP; exponent < LDBL_MAX_EXP; exponent += 37)
+            numbers.push_back(std::ldexp(std::sqrt(static_cast<long double>(exponent & 0xFF) + 2), exponent - 2));
+
+        for (long double number : numbers)
+        {
+            mismatches += CheckNumber(number, checks);
+            mismatches += CheckNumber(-number, checks);
+        }
+
+        // Infinities and NaNs can't be written as numbers
+        for (long double number : { std::numeric_limits<long double>::infinity(), std::numeric_limits<long double>::quiet_NaN() })
+        {
+            checks++;
+            try
+            {
+                std::string text;
+                MathExpressions::PrintNumber(number, text);
+                std::printf("%Lg is printed as '%s' instead of being refused\n", number, text.c_str());
+                mismatches++;
+            }
+            catch (const std::invalid_argument&) {}
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "printed expressions and numbers", "don't read back the same", "read back the same");
+}
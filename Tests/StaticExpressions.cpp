@@ -0,0 +1,121 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Compares expressions parsed at compile time against the same literals compiled at runtime
+Every literal is evaluated with several sets of values, some of which make it fail, both as it is and
+converted into a compiled expression, whose AST has to be the one the runtime parser gives.
+Values have to be exactly the same as those of the runtime parser, and failures have to be reported with the same status
+*/
+
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/ExpressionTemplates.hpp"
+#include "MathExpressionParser/StructuralHashing.hpp"
+#include "TestSupport.hpp"
+
+MATHEXPRESSIONS_STATIC_EXPRESSION(Product, "x*sin(y)+2");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Powers, "2^3^2-x");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Negation, "-x^2+y");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Area, "pi*r^2");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Modulus, "|x-y|*2");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Root, "sqrt(x)/(y-1)");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Trigonometry, "atan(x/y)-cos(pi*x)");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Quotients, "x/y/2");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Exponent, "exp(-x)*e");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Numbers, "0.125*x-10.5/y+12345678901234567890");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Aliases, "tgh(x)+arcsin(y/4)-log(x*x, 2)+ln(y*y)");
+MATHEXPRESSIONS_STATIC_EXPRESSION(Spaced, " x * ( y + 1 ) ");
+
+// Values of x, y and r. Zero x and y fail square roots, divisions and logarithms
+static const long double Values[][3] = { { 0.5L, 2, 3 }, { 4, 1, 0.1L }, { -2, 0.75L, 10 }, { 0, 0, 0 } };
+
+// Returns number of evaluations that differ from the runtime parser
+template<class Expression>
+static size_t Check()
+{
+    const std::string source = Expression::GetSource();
+    MathExpressions::CompiledExpressionPtr runtime = MathExpressions::Compile(source);
+    MathExpressions::CompiledExpressionPtr converted = MathExpressions::Static::ToCompiledExpression(typename Expression::Tree());
+
+    size_t mismatches = 0;
+    if (!converted->GetTree().Root || !MathExpressions::IsSameStructure(converted->GetTree(), runtime->GetTree()))
+    {
+        std::printf("'%s' (converted to '%s'): AST differs from the runtime parser's\n", source.c_str(), converted->GetSource().c_str());
+        mismatches++;
+    }
+
+    for (const long double* values : Values)
+    {
+        MathExpressions::Environment env;
+        std::vector<long double> variables;
+        for (size_t i = 0; i < Expression::GetVariableCount(); i++)
+        {
+            const std::string name = Expression::GetVariableName(i);
+            variables.push_back(values[name == "x" ? 0 : name == "y" ? 1 : 2]);
+            env[name] = variables.back();
+        }
+
+        const MathExpressions::EvaluationResult expected = runtime->TryEvaluate(env);
+        const MathExpressions::EvaluationResult parsed = Expression::TryEvaluate(variables.data());
+        const MathExpressions::EvaluationResult compiled = converted->TryEvaluate(env);
+
+        if (Testing::SameResult(parsed, expected) && Testing::SameResult(compiled, expected)) continue;
+
+        std::printf("'%s' (converted to '%s'): literal gives %.20Lg (status %d), program %.20Lg (status %d), runtime parser %.20Lg (status %d)\n",
+            source.c_str(), converted->GetSource().c_str(),
+            parsed.Value, static_cast<int>(parsed.Status), compiled.Value, static_cast<int>(compiled.Status),
+            expected.Value, static_cast<int>(expected.Status));
+        mismatches++;
+    }
+
+    return mismatches;
+}
+
+int main()
+{
+    size_t mismatches = 0;
+
+    try
+    {
+        mismatches += Check<Product>() + Check<Powers>() + Check<Negation>() + Check<Area>();
+        mismatches += Check<Modulus>() + Check<Root>() + Check<Trigonometry>() + Check<Quotients>();
+        mismatches += Check<Exponent>() + Check<Numbers>() + Check<Aliases>() + Check<Spaced>();
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    if (mismatches)
+    {
+        std::printf("%zu evaluations differ from the runtime parser\n", mismatches);
+        return 1;
+    }
+
+    std::printf("Literals parsed at compile time match the runtime parser\n");
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Compares pairs of expressions by structure with both operand orders, then checks every pair of expressions
+for equal structures hashing the same. Only names of variables and called functions tell tokens of the same kind apart,
+so aliases of built-in functions are the same, while calls of different native and library functions aren't
+*/
+
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/FunctionLibrary.hpp"
+#include "MathExpressionParser/StructuralHashing.hpp"
+#include "TestSupport.hpp"
+
+using MathExpressions::OperandOrder;
+
+struct Case
+{
+    const char* Lhs;
+    const char* Rhs;
+    // Whether expressions are the same with operands as written and with them normalized
+    bool AsWritten, Normalized;
+};
+
+static const Case Cases[] = {
+    { "tg(x)", "tan(x)", true, true },
+    { "arctg(x)+ctg(y)", "atan(x)+ctan(y)", true, true },
+    { "tgh(x)*arcsin(y)", "tanh(x)*asin(y)", true, true },
+    { " x / ( y ) ", "x/y", true, true },
+    { "2*x", "2.0*x", true, true },
+    { "x+y", "y+x", false, true },
+    { "x*y*z", "z*(x*y)", false, true },
+    { "(x+y)*(y+x)", "(y+x)*(x+y)", false, true },
+    { "|x|+sin(y)", "sin(y)+|x|", false, true },
+    { "x+y+z", "x+(y+z)", false, false },
+    { "x-y", "y-x", false, false },
+    { "x^y", "y^x", false, false },
+    { "sin(x)", "cos(x)", false, false },
+    { "x+y", "x+yy", false, false },
+    { "twice(x)", "thrice(x)", false, false },
+    { "twice(x)+1", "1+twice(x)", false, true },
+    { "sq(x)", "cube(x)", false, false },
+    { "sq(x)*sq(y)", "sq( y )*sq( x )", false, true },
+    { "sq(x)", "x^2", false, false }
+};
+
+static long double Twice(const long double* arguments)
+{
+    return arguments[0] * 2;
+}
+
+static long double Thrice(const long double* arguments)
+{
+    return arguments[0] * 3;
+}
+
+static const char* DescribeOrder(OperandOrder order)
+{
+    return order == OperandOrder::AsWritten ? "as written" : "normalized";
+}
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        MathExpressions::RegisterNativeFunction({ "twice", 1, true, Twice, nullptr });
+        MathExpressions::RegisterNativeFunction({ "thrice", 1, true, Thrice, nullptr });
+
+        MathExpressions::FunctionLibrary library;
+        library.Define("sq(x) = x^2");
+        library.Define("cube(x) = x^3");
+
+        std::vector<MathExpressions::CompiledExpressionPtr> compiled;
+        for (const Case& pair : Cases)
+        {
+            compiled.push_back(library.Compile(pair.Lhs));
+            compiled.push_back(library.Compile(pair.Rhs));
+        }
+
+        for (OperandOrder order : { OperandOrder::AsWritten, OperandOrder::Normalized })
+        {
+            for (size_t i = 0; i < sizeof(Cases) / sizeof(Cases[0]); i++)
+            {
+                const Case& pair = Cases[i];
+                const bool expected = order == OperandOrder::AsWritten ? pair.AsWritten : pair.Normalized;
+                const Tree<Parser::TokenPtr>& lhs = compiled[2 * i]->GetTree();
+                const Tree<Parser::TokenPtr>& rhs = compiled[2 * i + 1]->GetTree();
+
+                checks++;
+                if (MathExpressions::IsSameStructure(lhs, rhs, order) == expected &&
+                    MathExpressions::IsSameStructure(rhs, lhs, order) == expected)
+                    continue;
+
+                std::printf("'%s' and '%s' %s: are expected to be %s\n",
+                    pair.Lhs, pair.Rhs, DescribeOrder(order), expected ? "the same" : "different");
+                mismatches++;
+            }
+
+            // Containers keyed by structure rely on equal expressions hashing the same
+            const MathExpressions::StructuralHash hash(order);
+            const MathExpressions::StructuralEqual equal(order);
+            for (const MathExpressions::CompiledExpressionPtr& lhs : compiled)
+                for (const MathExpressions::CompiledExpressionPtr& rhs : compiled)
+                {
+                    checks++;
+                    if (!equal(lhs, rhs) || hash(lhs) == hash(rhs)) continue;
+
+                    std::printf("'%s' and '%s' %s: are the same, but hash differently\n",
+                        lhs->GetSource().c_str(), rhs->GetSource().c_str(), DescribeOrder(order));
+                    mismatches++;
+                }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "comparisons of structures", "have failed", "have passed");
+}
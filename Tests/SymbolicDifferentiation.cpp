@@ -0,0 +1,80 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Evaluates symbolic derivatives and compares them against finite differences of the original expressions
+Every expression is differentiated by every variable, including ones it doesn't reference, whose derivative is zero.
+Derivatives are checked at points where expressions are smooth, to 1e-6
+*/
+
+#include <cstdio>
+#include <exception>
+#include <string>
+#include "MathExpressionParser/SymbolicDifferentiation.hpp"
+#include "TestSupport.hpp"
+
+static const char* const Variables[] = { "x", "y", "z" };
+
+int main()
+{
+    size_t mismatches = 0, checks = 0;
+
+    try
+    {
+        for (const char* text : Testing::SmoothExpressions)
+        {
+            MathExpressions::CompiledExpressionPtr expression = MathExpressions::Compile(text);
+
+            for (size_t i = 0; i < 3; i++)
+            {
+                MathExpressions::CompiledExpressionPtr derivative = MathExpressions::Differentiate(*expression, Variables[i]);
+
+                for (const long double* point : Testing::SmoothPoints)
+                {
+                    const MathExpressions::Environment env = { { "x", point[0] }, { "y", point[1] }, { "z", point[2] } };
+                    const long double value = derivative->Evaluate(env);
+
+                    const long double difference = Testing::CentralDifference([&](long double at) {
+                        MathExpressions::Environment shifted = env;
+                        shifted[Variables[i]] = at;
+                        return expression->Evaluate(shifted);
+                    }, point[i]);
+
+                    checks++;
+                    if (Testing::IsClose(value, difference)) continue;
+
+                    std::printf("%s by %s at (%Lg, %Lg, %Lg): derivative '%s' gives %.12Lg, finite difference %.12Lg\n",
+                        text, Variables[i], point[0], point[1], point[2], derivative->GetSource().c_str(), value, difference);
+                    mismatches++;
+                }
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::printf("%s\n", e.what());
+        return 1;
+    }
+
+    return Testing::Report(mismatches, checks, "derivatives", "differ from finite differences", "match finite differences");
+}
@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Helpers shared by tests
+Tests compare results of some evaluation against a reference, count checks and mismatches on the way,
+and report the outcome with the same wording, so helpers for all of these steps live here
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include "MathExpressionParser/CompiledExpression.hpp"
+
+namespace Testing
+{
+	// Expressions of x, y and z that are smooth around every one of 'SmoothPoints'
+	static const char* const SmoothExpressions[] = {
+		"x*y+sin(z)", "x^y", "exp(x/y)-ln(z)", "sqrt(x*x+y*y+z*z)", "atan(x/y)*cos(z)",
+		"log(x+z, y)", "tanh(x)*asinh(y)+acos(z/4)", "(x-y)/(x+z)", "sinh(y)/cosh(x)-2^z*x", "x^3-2*x+1"
+	};
+
+	// Points lie within x in [0.5, 2], y in [1.2, 2.5] and z in [0.3, 3]
+	static const long double SmoothPoints[][3] = {
+		{ 0.5L, 1.2L, 0.3L }, { 1, 2, 3 }, { 1.75L, 1.5L, 0.8L }, { 2, 2.5L, 1.9L }
+	};
+
+	// Whether values agree to 1e-6, relative to the expected one once it's larger than one
+	inline bool IsClose(long double actual, long double expected)
+	{
+		return std::fabs(actual - expected) <= 1e-6L * std::max(1.0L, std::fabs(expected));
+	}
+
+	/// <summary>
+	/// Central difference of a function, with a step scaled to the point it's taken at.
+	/// Accurate to about 1e-9 where the function is smooth
+	/// </summary>
+	inline long double CentralDifference(const std::function<long double(long double)>& function, long double at)
+	{
+		const long double step = 1e-5L * std::max(1.0L, std::fabs(at));
+		return (function(at + step) - function(at - step)) / (2 * step);
+	}
+
+	/// <summary>
+	/// Whether both results have the same status and, if they succeeded, exactly the same value.
+	/// NaNs are considered the same value. If 'same_index' is set, failures also have to happen at the same instruction
+	/// </summary>
+	inline bool SameResult(
+		const MathExpressions::EvaluationResult& lhs,
+		const MathExpressions::EvaluationResult& rhs,
+		bool same_index = false
+	) {
+		if (lhs.Status != rhs.Status) return false;
+		if (lhs.Status != MathExpressions::EvaluationStatus::Success) return !same_index || lhs.Index == rhs.Index;
+		return lhs.Value == rhs.Value || (lhs.Value != lhs.Value && rhs.Value != rhs.Value);
+	}
+
+	/// <summary>
+	/// Prints the outcome of checks and returns the exit code of the test, e.g. for 'subject' of "points",
+	/// 'failure' of "lie outside of their ranges" and 'success' of "lie within their ranges"
+	/// </summary>
+	inline int Report(size_t mismatches, size_t checks, const char* subject, const char* failure, const char* success)
+	{
+		if (mismatches)
+		{
+			std::printf("%zu of %zu %s %s\n", mismatches, checks, subject, failure);
+			return 1;
+		}
+
+		std::printf("All %zu %s %s\n", checks, subject, success);
+		return 0;
+	}
+}
@@ -0,0 +1,639 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Streams a CSV file through one or more formulas, appending a column with the result of each formula to every row
+Usage: MathExpressionParser_csv [options] name=formula [name=formula ...]
+Columns of the header bind to variables of the same name. Rows a formula fails on get an empty field instead.
+Empty lines aren't rows, so they're left out of the output
+
+Work is split into stages connected by bounded queues, so each stage only runs ahead of the next one
+by a fixed number of chunks, and memory usage doesn't depend on the size of the input:
+reader (cuts input into chunks of whole lines) -> parsers (split fields and convert used columns to numbers)
+-> evaluators (evaluate every formula over the whole chunk at once, format output) -> writer (restores order of chunks)
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "MathExpressionParser/BatchEvaluation.hpp"
+#include "ToolSupport.hpp"
+
+/* Queue that blocks producers while it's full and consumers while it's empty
+Closing lets consumers drain what's left, aborting wakes everyone up and discards the rest
+*/
+template<typename T>
+class BoundedQueue
+{
+    std::mutex Mutex;
+    std::condition_variable NotEmpty, NotFull;
+    std::queue<T> Items;
+    const size_t Capacity;
+    bool Closed, Aborted;
+public:
+    BoundedQueue(size_t capacity) : Capacity(capacity), Closed(false), Aborted(false) {}
+
+    // Returns false if the queue has been aborted
+    bool Push(T item)
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        NotFull.wait(lock, [this]() { return Aborted || Items.size() < Capacity; });
+        if (Aborted) return false;
+
+        Items.push(std::move(item));
+        NotEmpty.notify_one();
+        return true;
+    }
+
+    // Returns false once the queue is closed and empty, or aborted
+    bool Pop(T& out_item)
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        NotEmpty.wait(lock, [this]() { return Aborted || Closed || !Items.empty(); });
+        if (Aborted || Items.empty()) return false;
+
+        out_item = std::move(Items.front());
+        Items.pop();
+        NotFull.notify_one();
+        return true;
+    }
+
+    void Close()
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Closed = true;
+        NotEmpty.notify_all();
+    }
+
+    void Abort()
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Aborted = true;
+        NotEmpty.notify_all();
+        NotFull.notify_all();
+    }
+};
+
+struct Formula
+{
+    std::string Name;
+    MathExpressions::CompiledExpressionPtr Expression;
+};
+
+struct Options
+{
+    std::string InputPath, OutputPath;
+    char Delimiter;
+    size_t Threads, ChunkSize;
+    int Precision;
+    std::vector<Formula> Formulas;
+};
+
+// Piece of input that consists of whole lines, along with everything computed out of it
+struct Chunk
+{
+    // Position of the chunk in the input
+    size_t Index;
+    std::string Text;
+    // Offsets of the beginning and the end of each non-empty line
+    std::vector<std::pair<size_t, size_t>> Lines;
+    // Values of columns formulas use, one after another, each 'Lines.size()' values long
+    std::vector<long double> Columns;
+    std::vector<MathExpressions::BatchResult> Results;
+    std::string Output;
+};
+
+using ChunkPtr = std::unique_ptr<Chunk>;
+
+// Chunks are held by every stage at once, so a few of them have to fit in memory
+static const size_t MaxChunkSize = static_cast<size_t>(1) << 30;
+
+// Marks fields of rows that no formula uses
+static const size_t UnusedField = static_cast<size_t>(-1);
+
+/* Everything stages share
+Chunks circulate from 'Free' through every stage and back, so their buffers are reused,
+and the number of chunks in flight (including ones waiting to be written in order) never exceeds the pool's size
+*/
+struct Pipeline
+{
+    const Options& Settings;
+    // Maps index of a field in a row to the parsed column it's stored in, or to 'UnusedField'
+    std::vector<size_t> FieldColumns;
+    size_t ParsedColumnCount;
+    // Index of the parsed column that feeds each symbol of each formula's program
+    std::vector<std::vector<size_t>> SymbolColumns;
+    BoundedQueue<ChunkPtr> Free, Read, Parsed, Evaluated;
+
+    std::mutex ErrorMutex;
+    std::exception_ptr Error;
+
+    Pipeline(const Options& settings, size_t pool_size)
+        : Settings(settings), ParsedColumnCount(0),
+        Free(pool_size), Read(pool_size), Parsed(pool_size), Evaluated(pool_size) {}
+
+    // Records the first error and stops every stage
+    void Fail(std::exception_ptr error)
+    {
+        {
+            std::lock_guard<std::mutex> lock(ErrorMutex);
+            if (!Error) Error = error;
+        }
+
+        Free.Abort();
+        Read.Abort();
+        Parsed.Abort();
+        Evaluated.Abort();
+    }
+};
+
+static void PrintUsage()
+{
+    std::fprintf(stderr,
+        "Usage: MathExpressionParser_csv [options] name=formula [name=formula ...]\n"
+        "Evaluates formulas for every row of a CSV file, appending a column per formula.\n"
+        "Columns of the header are bound to variables of the same name,\n"
+        "names of more than one column can't be used by formulas.\n"
+        "Empty lines are skipped, so the output has a line for every other line of the input.\n"
+        "Options:\n"
+        "  -i <path>    input file (standard input by default)\n"
+        "  -o <path>    output file (standard output by default)\n"
+        "  -d <char>    field delimiter (',' by default)\n"
+        "  -j <count>   number of parser and evaluator threads (hardware concurrency by default, %zu at most)\n"
+        "  -c <bytes>   size of a chunk of input processed at once (4 MiB by default, 1 GiB at most)\n"
+        "  -p <digits>  significant digits of results (%d by default, %d at most)\n",
+        Tools::MaxThreadCount, std::numeric_limits<long double>::digits10, std::numeric_limits<long double>::max_digits10
+    );
+}
+
+static Options ParseArguments(int argc, char** argv)
+{
+    Options options;
+    options.Delimiter = ',';
+    options.Threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), Tools::MaxThreadCount);
+    options.ChunkSize = 4 << 20;
+    options.Precision = std::numeric_limits<long double>::digits10;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if (arg.size() == 2 && arg[0] == '-')
+        {
+            if (i + 1 >= argc) throw std::invalid_argument("Option " + arg + " requires a value");
+            const char* value = argv[++i];
+
+            switch (arg[1])
+            {
+            case 'i': options.InputPath = value; break;
+            case 'o': options.OutputPath = value; break;
+            case 'd':
+                if (std::strlen(value) != 1) throw std::invalid_argument("Delimiter must be a single character");
+                options.Delimiter = value[0];
+                break;
+            case 'j': options.Threads = Tools::ParseCount(value, Tools::MaxThreadCount); break;
+            case 'c': options.ChunkSize = Tools::ParseCount(value, MaxChunkSize); break;
+            case 'p':
+                // More digits than it takes to tell any two values apart only add noise, and wouldn't fit the number buffer
+                options.Precision = static_cast<int>(Tools::ParseCount(value, std::numeric_limits<long double>::max_digits10));
+                break;
+            default: throw std::invalid_argument("Unknown option " + arg);
+            }
+            continue;
+        }
+
+        size_t separator = arg.find('=');
+        if (separator == std::string::npos || separator == 0)
+            throw std::invalid_argument("Expected name=formula, got '" + arg + "'");
+
+        try
+        {
+            options.Formulas.push_back({ arg.substr(0, separator), MathExpressions::Compile(arg.substr(separator + 1)) });
+        }
+        catch (const std::exception& e)
+        {
+            throw std::runtime_error("Formula '" + arg.substr(0, separator) + "': " + e.what());
+        }
+    }
+
+    if (options.Formulas.empty()) throw std::invalid_argument("No formulas given");
+    return options;
+}
+
+// Strips spaces around a field and quotes around it, if there are any
+static void TrimField(const char*& begin, const char*& end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t')) begin++;
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) end--;
+
+    if (end - begin >= 2 && *begin == '"' && end[-1] == '"')
+    {
+        begin++;
+        end--;
+    }
+}
+
+/* Finds the end of a field that starts at 'begin'. Delimiters inside quotes don't end a field.
+Quoted fields may not span multiple lines, as input is only ever cut between lines
+*/
+static const char* FindFieldEnd(const char* begin, const char* end, char delimiter)
+{
+    bool quoted = false;
+    for (const char* it = begin; it < end; it++)
+    {
+        if (*it == '"') quoted = !quoted;
+        else if (*it == delimiter && !quoted) return it;
+    }
+
+    return end;
+}
+
+// Splits a line into fields, calling 'visit(index, begin, end)' with each trimmed field
+template<typename Visitor>
+static void SplitLine(const char* begin, const char* end, char delimiter, Visitor visit)
+{
+    for (size_t index = 0; ; index++)
+    {
+        const char* field_end = FindFieldEnd(begin, end, delimiter);
+        const char* field_begin = begin;
+        const char* trimmed_end = field_end;
+        TrimField(field_begin, trimmed_end);
+
+        visit(index, field_begin, trimmed_end);
+
+        if (field_end == end) break;
+        begin = field_end + 1;
+    }
+}
+
+// Converts a field to a number. Fields that aren't numbers become NaN, which every formula propagates
+static long double ParseValue(const char* begin, const char* end)
+{
+    if (begin == end) return std::numeric_limits<long double>::quiet_NaN();
+
+    // Fields are never null-terminated, but a number can't span past the end of the line anyway
+    char* number_end;
+    long double value = std::strtold(begin, &number_end);
+
+    return (number_end == end) ? value : std::numeric_limits<long double>::quiet_NaN();
+}
+
+/* Reads the header, binds formulas' variables to it's columns and writes the header of the output.
+Returns what's left of the input after the header
+*/
+static std::string ProcessHeader(Pipeline& pipeline, std::FILE* input, std::FILE* output)
+{
+    const Options& settings = pipeline.Settings;
+    std::string buffer;
+    size_t line_end;
+
+    // Header may be longer than a chunk, so reading continues until the first line break
+    char block[1 << 16];
+    while ((line_end = buffer.find('\n')) == std::string::npos)
+    {
+        size_t read = std::fread(block, 1, sizeof(block), input);
+        if (!read) break;
+        buffer.append(block, read);
+    }
+    if (line_end == std::string::npos) line_end = buffer.size();
+    if (!line_end) throw std::runtime_error("Input has no header");
+
+    std::string header = buffer.substr(0, line_end);
+    if (!header.empty() && header.back() == '\r') header.pop_back();
+
+    /* Names may repeat or be empty, so fields are counted by position rather than by name.
+    A repeated name is bound to it's first field, but formulas can't use it, as they can't tell which field they mean
+    */
+    std::unordered_map<std::string, size_t> field_indices;
+    std::unordered_set<std::string> repeated_names;
+    size_t field_count = 0;
+    SplitLine(header.data(), header.data() + header.size(), settings.Delimiter,
+        [&](size_t index, const char* begin, const char* end) {
+            field_count = index + 1;
+            if (!field_indices.emplace(std::string(begin, end), index).second) repeated_names.insert(std::string(begin, end));
+        }
+    );
+
+    // Only columns that are referenced by formulas are parsed, each once
+    pipeline.FieldColumns.assign(field_count, UnusedField);
+    pipeline.SymbolColumns.resize(settings.Formulas.size());
+    for (size_t f = 0; f < settings.Formulas.size(); f++)
+    {
+        const Formula& formula = settings.Formulas[f];
+        const MathExpressions::Program& program = formula.Expression->GetProgram();
+
+        for (size_t i = 0; i < program.GetSymbols().size(); i++)
+        {
+            std::unordered_map<std::string, size_t>::const_iterator field_it = field_indices.find(program.GetSymbols()[i]);
+            if (field_it == field_indices.cend())
+                throw std::runtime_error("Formula '" + formula.Name + "' uses '" + program.GetSymbols()[i] + "', which isn't a column");
+            if (repeated_names.count(program.GetSymbols()[i]))
+                throw std::runtime_error("Formula '" + formula.Name + "' uses '" + program.GetSymbols()[i] + "', which names more than one column");
+
+            size_t& column = pipeline.FieldColumns[field_it->second];
+            if (column == UnusedField) column = pipeline.ParsedColumnCount++;
+            pipeline.SymbolColumns[f].push_back(column);
+        }
+    }
+
+    std::string output_header = header;
+    for (const Formula& formula : settings.Formulas) output_header += settings.Delimiter + formula.Name;
+    output_header.push_back('\n');
+    if (std::fwrite(output_header.data(), 1, output_header.size(), output) != output_header.size())
+        throw std::runtime_error("Failed to write output");
+
+    return buffer.substr(std::min(line_end + 1, buffer.size()));
+}
+
+// Cuts input into chunks of whole lines. Text after the last line break of a chunk is carried over to the next one
+static void ReadStage(Pipeline& pipeline, std::FILE* input, std::string carry)
+{
+    size_t index = 0;
+    bool eof = false;
+
+    while (!eof)
+    {
+        ChunkPtr chunk;
+        if (!pipeline.Free.Pop(chunk)) return;
+
+        chunk->Index = index++;
+        chunk->Text.swap(carry);
+        carry.clear();
+
+        // Lines longer than a chunk make it grow until a line break is found
+        size_t line_end = std::string::npos;
+        while (line_end == std::string::npos && !eof)
+        {
+            size_t filled = chunk->Text.size();
+            chunk->Text.resize(filled + pipeline.Settings.ChunkSize);
+
+            size_t read = std::fread(&chunk->Text[filled], 1, pipeline.Settings.ChunkSize, input);
+            chunk->Text.resize(filled + read);
+
+            if (read < pipeline.Settings.ChunkSize)
+            {
+                if (std::ferror(input)) throw std::runtime_error(std::string("Failed to read input: ") + std::strerror(errno));
+                eof = true;
+            }
+            else line_end = chunk->Text.rfind('\n');
+        }
+
+        if (!eof)
+        {
+            carry.assign(chunk->Text, line_end + 1, std::string::npos);
+            chunk->Text.resize(line_end + 1);
+        }
+
+        if (!pipeline.Read.Push(std::move(chunk))) return;
+    }
+}
+
+// Splits chunks into lines and converts fields of used columns to numbers
+static void ParseStage(Pipeline& pipeline)
+{
+    const char delimiter = pipeline.Settings.Delimiter;
+    ChunkPtr chunk;
+
+    while (pipeline.Read.Pop(chunk))
+    {
+        const char* text = chunk->Text.data();
+        chunk->Lines.clear();
+
+        for (size_t begin = 0; begin < chunk->Text.size();)
+        {
+            size_t end = chunk->Text.find('\n', begin);
+            if (end == std::string::npos) end = chunk->Text.size();
+
+            size_t next = end + 1;
+            if (end > begin && text[end - 1] == '\r') end--;
+            if (end > begin) chunk->Lines.emplace_back(begin, end);
+
+            begin = next;
+        }
+
+        const size_t row_count = chunk->Lines.size();
+        chunk->Columns.assign(pipeline.ParsedColumnCount * row_count, std::numeric_limits<long double>::quiet_NaN());
+
+        for (size_t row = 0; row < row_count; row++)
+        {
+            SplitLine(text + chunk->Lines[row].first, text + chunk->Lines[row].second, delimiter,
+                [&](size_t index, const char* begin, const char* end) {
+                    // Rows may have more fields than the header, and those aren't bound to anything
+                    if (index >= pipeline.FieldColumns.size() || pipeline.FieldColumns[index] == UnusedField) return;
+
+                    chunk->Columns[pipeline.FieldColumns[index] * row_count + row] = ParseValue(begin, end);
+                }
+            );
+        }
+
+        if (!pipeline.Parsed.Push(std::move(chunk))) return;
+    }
+}
+
+// Evaluates every formula over the whole chunk and formats output lines
+static void EvaluateStage(Pipeline& pipeline)
+{
+    const Options& settings = pipeline.Settings;
+    std::vector<const long double*> symbol_columns;
+    // Fits any number '-p' allows: sign, 'max_digits10' digits, point and exponent of a long double
+    char number[64];
+    ChunkPtr chunk;
+
+    while (pipeline.Parsed.Pop(chunk))
+    {
+        const size_t row_count = chunk->Lines.size();
+        chunk->Results.resize(settings.Formulas.size());
+
+        for (size_t f = 0; f < settings.Formulas.size(); f++)
+        {
+            symbol_columns.clear();
+            for (size_t column : pipeline.SymbolColumns[f]) symbol_columns.push_back(chunk->Columns.data() + column * row_count);
+
+            MathExpressions::EvaluateBatch(
+                settings.Formulas[f].Expression->GetProgram(), symbol_columns.data(), row_count,
+                MathExpressions::BatchOptions(), chunk->Results[f]
+            );
+        }
+
+        chunk->Output.clear();
+        for (size_t row = 0; row < row_count; row++)
+        {
+            chunk->Output.append(chunk->Text, chunk->Lines[row].first, chunk->Lines[row].second - chunk->Lines[row].first);
+
+            for (const MathExpressions::BatchResult& result : chunk->Results)
+            {
+                chunk->Output.push_back(settings.Delimiter);
+                if (result.ErrorMask[row / 64] >> (row % 64) & 1) continue;
+
+                int length = std::snprintf(number, sizeof(number), "%.*Lg", settings.Precision, result.Values[row]);
+                chunk->Output.append(number, std::min(static_cast<size_t>(length), sizeof(number) - 1));
+            }
+
+            chunk->Output.push_back('\n');
+        }
+
+        if (!pipeline.Evaluated.Push(std::move(chunk))) return;
+    }
+}
+
+// Runs a stage, turning exceptions into a failure of the whole pipeline
+template<typename Stage>
+static void RunStage(Pipeline& pipeline, Stage stage)
+{
+    try
+    {
+        stage();
+    }
+    catch (...)
+    {
+        pipeline.Fail(std::current_exception());
+    }
+}
+
+static void Run(const Options& settings, std::FILE* input, std::FILE* output)
+{
+    // Enough chunks for every worker to hold one, plus some slack for the writer to reorder them
+    const size_t pool_size = 2 * settings.Threads + 2;
+    Pipeline pipeline(settings, pool_size);
+
+    std::string rest = ProcessHeader(pipeline, input, output);
+
+    for (size_t i = 0; i < pool_size; i++) pipeline.Free.Push(ChunkPtr(new Chunk()));
+
+    std::thread reader, closer;
+    std::vector<std::thread> parsers, evaluators;
+    try
+    {
+        parsers.reserve(settings.Threads);
+        evaluators.reserve(settings.Threads);
+
+        reader = std::thread([&]() {
+            RunStage(pipeline, [&]() { ReadStage(pipeline, input, std::move(rest)); });
+            pipeline.Read.Close();
+        });
+        for (size_t i = 0; i < settings.Threads; i++)
+        {
+            parsers.emplace_back([&]() { RunStage(pipeline, [&]() { ParseStage(pipeline); }); });
+            evaluators.emplace_back([&]() { RunStage(pipeline, [&]() { EvaluateStage(pipeline); }); });
+        }
+
+        // Stages are closed once every thread of the previous one is done, so nothing gets lost
+        closer = std::thread([&]() {
+            for (std::thread& parser : parsers) parser.join();
+            pipeline.Parsed.Close();
+            for (std::thread& evaluator : evaluators) evaluator.join();
+            pipeline.Evaluated.Close();
+        });
+    }
+    catch (...)
+    {
+        // Threads that have started would wait on their queues forever, and destroying them would terminate
+        pipeline.Fail(std::current_exception());
+        if (reader.joinable()) reader.join();
+        for (std::thread& parser : parsers) parser.join();
+        for (std::thread& evaluator : evaluators) evaluator.join();
+        throw;
+    }
+
+    // Writer is the current thread. Chunks finish out of order, so they wait until all preceding ones are written
+    RunStage(pipeline, [&]() {
+        std::map<size_t, ChunkPtr> pending;
+        size_t next = 0;
+        ChunkPtr chunk;
+
+        while (pipeline.Evaluated.Pop(chunk))
+        {
+            pending.emplace(chunk->Index, std::move(chunk));
+
+            for (auto it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it), next++)
+            {
+                const std::string& text = it->second->Output;
+                if (std::fwrite(text.data(), 1, text.size(), output) != text.size())
+                    throw std::runtime_error("Failed to write output");
+
+                pipeline.Free.Push(std::move(it->second));
+            }
+        }
+    });
+
+    reader.join();
+    closer.join();
+
+    if (pipeline.Error) std::rethrow_exception(pipeline.Error);
+    if (std::fflush(output)) throw std::runtime_error("Failed to write output");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    std::FILE* input = stdin;
+    std::FILE* output = stdout;
+
+    try
+    {
+        Options settings = ParseArguments(argc, argv);
+
+        if (!settings.InputPath.empty() && !(input = std::fopen(settings.InputPath.c_str(), "rb")))
+            throw std::runtime_error("Cannot open " + settings.InputPath + ": " + std::strerror(errno));
+        if (!settings.OutputPath.empty() && !(output = std::fopen(settings.OutputPath.c_str(), "wb")))
+            throw std::runtime_error("Cannot open " + settings.OutputPath + ": " + std::strerror(errno));
+
+        Run(settings, input, output);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        PrintUsage();
+        return 2;
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+
+    if (input != stdin) std::fclose(input);
+    if (output != stdout && std::fclose(output)) return 1;
+
+    return 0;
+}
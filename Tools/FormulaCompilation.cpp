@@ -0,0 +1,128 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Compiles a file with one formula per line in parallel and reports every line that fails
+Usage: MathExpressionParser_compile [-j threads] [-o archive] formulas.txt
+Diagnostics are printed as 'path:line:column: message'. With '-o', formulas that compiled
+are written to an expression archive, so they can be loaded later without parsing them again.
+The archive only holds formulas that compiled, in order of their lines, so it's indices
+don't match line numbers once a blank line, a comment or a failed line has been skipped
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "MathExpressionParser/BulkCompilation.hpp"
+#include "MathExpressionParser/ExpressionArchive.hpp"
+#include "ToolSupport.hpp"
+
+static void PrintUsage()
+{
+    std::fprintf(stderr,
+        "Usage: MathExpressionParser_compile [options] formulas.txt\n"
+        "Compiles every line of the file as a separate formula, reporting lines that fail.\n"
+        "Blank lines and lines starting with '#' are skipped.\n"
+        "Options:\n"
+        "  -j <count>   number of threads (hardware concurrency by default, %zu at most)\n"
+        "  -o <path>    write formulas that compiled to an expression archive, in order of their lines.\n"
+        "               Skipped and failed lines get no entry, so archive indices aren't line numbers\n",
+        Tools::MaxThreadCount
+    );
+}
+
+int main(int argc, char** argv)
+{
+    std::string input_path, archive_path;
+    size_t thread_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+
+        if ((arg == "-j" || arg == "-o") && i + 1 < argc)
+        {
+            if (arg == "-j")
+            {
+                try
+                {
+                    thread_count = Tools::ParseCount(argv[++i], Tools::MaxThreadCount);
+                }
+                catch (const std::invalid_argument& e)
+                {
+                    std::fprintf(stderr, "%s\n", e.what());
+                    PrintUsage();
+                    return 2;
+                }
+            }
+            else archive_path = argv[++i];
+        }
+        else if (input_path.empty() && arg[0] != '-') input_path = arg;
+        else
+        {
+            PrintUsage();
+            return 2;
+        }
+    }
+
+    if (input_path.empty())
+    {
+        PrintUsage();
+        return 2;
+    }
+
+    try
+    {
+        typedef std::chrono::steady_clock Clock;
+        Clock::time_point start = Clock::now();
+
+        MathExpressions::FormulaTable table = MathExpressions::CompileFile(input_path, thread_count);
+
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        for (const MathExpressions::FormulaDiagnostic& diagnostic : table.Diagnostics)
+        {
+            if (diagnostic.Column == std::string::npos)
+                std::fprintf(stderr, "%s:%zu: %s\n", input_path.c_str(), diagnostic.Line, diagnostic.Message.c_str());
+            else
+                std::fprintf(stderr, "%s:%zu:%zu: %s\n", input_path.c_str(), diagnostic.Line, diagnostic.Column + 1, diagnostic.Message.c_str());
+        }
+
+        std::vector<MathExpressions::CompiledExpressionPtr> compiled;
+        for (const MathExpressions::CompiledExpressionPtr& formula : table.Formulas)
+            if (formula) compiled.push_back(formula);
+
+        std::fprintf(stderr, "%zu formulas compiled, %zu failed in %.3f s\n", compiled.size(), table.Diagnostics.size(), seconds);
+
+        if (!archive_path.empty()) MathExpressions::ExpressionArchive::Write(archive_path, compiled);
+
+        return table.Diagnostics.empty() ? 0 : 1;
+    }
+    catch (const std::exception& e)
+    {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
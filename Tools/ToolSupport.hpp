@@ -0,0 +1,57 @@
+/*
+MIT License
+
+Copyright (c) 2024 LordofCreepers
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/* Helpers shared by command-line tools
+Tools read their options the same way, so parsing of option values lives here
+*/
+
+#pragma once
+
+#include <cerrno>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace Tools
+{
+	// More threads than any machine runs at once only cost memory and time to start
+	static const size_t MaxThreadCount = 1024;
+
+	/// <summary>
+	/// Parses a positive decimal number no larger than 'limit', e.g. a thread count or a chunk size.
+	/// Throws std::invalid_argument if the text isn't one
+	/// </summary>
+	inline size_t ParseCount(const char* text, size_t limit)
+	{
+		// 'strtoull' skips blanks and takes signs, so it would read "-1" as the largest number there is
+		char* end;
+		errno = 0;
+		unsigned long long value = (*text >= '0' && *text <= '9') ? std::strtoull(text, &end, 10) : 0;
+		if (!value || *end || errno == ERANGE) throw std::invalid_argument(std::string("Expected a positive number, got '") + text + "'");
+		if (value > limit)
+			throw std::invalid_argument("Expected a number of at most " + std::to_string(limit) + ", got '" + text + "'");
+
+		return static_cast<size_t>(value);
+	}
+}